@@ -11,8 +11,11 @@ namespace Avf
 	void							GetFileExtensions(ArrayBridge<std::string>&& Extensions);
 
 #if defined(__OBJC__)
+	//	packets are allocated from PacketPool (or a shared pool) so their data gets reused
 	std::shared_ptr<TMediaPacket>	GetH264Packet(CMSampleBufferRef SampleBuffer,size_t StreamIndex);
+	std::shared_ptr<TMediaPacket>	GetH264Packet(CMSampleBufferRef SampleBuffer,size_t StreamIndex,TMediaPacketPool& PacketPool);
 	std::shared_ptr<TMediaPacket>	GetFormatDescriptionPacket(CMSampleBufferRef SampleBuffer,size_t ParamIndex,SoyMediaFormat::Type Format,size_t StreamIndex);
+	std::shared_ptr<TMediaPacket>	GetFormatDescriptionPacket(CMSampleBufferRef SampleBuffer,size_t ParamIndex,SoyMediaFormat::Type Format,size_t StreamIndex,TMediaPacketPool& PacketPool);
 	void							GetFormatDescriptionData(ArrayBridge<uint8>&& Data,CMFormatDescriptionRef FormatDesc,size_t ParamIndex,SoyMediaFormat::Type Format);
 	TStreamMeta						GetStreamMeta(CMFormatDescriptionRef FormatDesc);
 	CMFormatDescriptionRef			GetFormatDescription(const TStreamMeta& Stream);
@@ -16,6 +16,12 @@
 #include <VideoToolbox/VTErrors.h>
 
 
+namespace Avf
+{
+	TMediaPacketPool&	GetDefaultPacketPool();		//	for callers without their own pool
+}
+
+
 
 std::ostream& operator<<(std::ostream& out,const AVAssetExportSessionStatus& in)
 {
@@ -37,11 +43,25 @@ std::ostream& operator<<(std::ostream& out,const AVAssetExportSessionStatus& in)
 }
 
 
+TMediaPacketPool& Avf::GetDefaultPacketPool()
+{
+	//	outstanding packets keep the pool's free list alive, so it doesn't matter if they outlive this
+	static TMediaPacketPool Pool;
+	return Pool;
+}
+
+
 std::shared_ptr<TMediaPacket> Avf::GetFormatDescriptionPacket(CMSampleBufferRef SampleBuffer,size_t ParamIndex,SoyMediaFormat::Type Format,size_t StreamIndex)
+{
+	return GetFormatDescriptionPacket( SampleBuffer, ParamIndex, Format, StreamIndex, GetDefaultPacketPool() );
+}
+
+
+std::shared_ptr<TMediaPacket> Avf::GetFormatDescriptionPacket(CMSampleBufferRef SampleBuffer,size_t ParamIndex,SoyMediaFormat::Type Format,size_t StreamIndex,TMediaPacketPool& PacketPool)
 {
 	auto Desc = CMSampleBufferGetFormatDescription( SampleBuffer );
 	
-	std::shared_ptr<TMediaPacket> pPacket( new TMediaPacket() );
+	auto pPacket = PacketPool.Alloc();
 	auto& Packet = *pPacket;
 	Packet.mMeta = GetStreamMeta( Desc );
 	Packet.mMeta.mStreamIndex = StreamIndex;
@@ -101,6 +121,12 @@ void Avf::GetFormatDescriptionData(ArrayBridge<uint8>&& Data,CMFormatDescription
 
 
 std::shared_ptr<TMediaPacket> Avf::GetH264Packet(CMSampleBufferRef SampleBuffer,size_t StreamIndex)
+{
+	return GetH264Packet( SampleBuffer, StreamIndex, GetDefaultPacketPool() );
+}
+
+
+std::shared_ptr<TMediaPacket> Avf::GetH264Packet(CMSampleBufferRef SampleBuffer,size_t StreamIndex,TMediaPacketPool& PacketPool)
 {
 	auto Desc = CMSampleBufferGetFormatDescription( SampleBuffer );
 	
@@ -114,7 +140,7 @@ std::shared_ptr<TMediaPacket> Avf::GetH264Packet(CMSampleBufferRef SampleBuffer,
 	//	extract SPS/PPS packet
 	auto Fourcc = CFSwapInt32HostToBig( CMFormatDescriptionGetMediaSubType(Desc) );
 	auto Codec = SoyMediaFormat::FromFourcc( Fourcc, nal_size_field_bytes );
-	std::shared_ptr<TMediaPacket> pPacket( new TMediaPacket() );
+	auto pPacket = PacketPool.Alloc();
 	auto& Packet = *pPacket;
 	Packet.mMeta = GetStreamMeta( Desc );
 	Packet.mMeta.mCodec = Codec;
@@ -0,0 +1,138 @@
+//	include this .cpp where we want to time things! These only report timings, so they're kept out of the unit tests (SoyTest.cpp)
+//	define ENABLE_SOYBENCHMARK first, so projects that build every .cpp in src don't compile it
+#if defined(ENABLE_SOYBENCHMARK)
+#include "SoyPixels.h"
+#include "SoyPng.h"
+#include "SoyImage.h"
+#include "SoyMedia.h"
+#include "SoyDebug.h"
+#include "SoyTestPattern.h"
+
+
+namespace SoyBenchmark
+{
+	void	PngCompression();
+	void	PngEncode();
+	void	PixelBufferManager();
+	void	ImageProbe();
+	
+	void	RunAll();
+}
+
+
+void SoyBenchmark::PngCompression()
+{
+	//	compare size & speed of the encoder presets against the uncompressed (store) output
+	SoyPixels Pixels;
+	Pixels.Init( 1280, 720, SoyPixelsFormat::RGBA );
+	FillTestPattern( Pixels );
+	auto& PixelsArray = Pixels.GetPixelsArray();
+	
+	std::pair<const char*,TPng::TEncodeParams> Presets[] =
+	{
+		{ "Store",	TPng::TEncodeParams::Store() },
+		{ "Fast",	TPng::TEncodeParams::Fast() },
+		{ "Default",TPng::TEncodeParams() },
+		{ "Small",	TPng::TEncodeParams::Small() },
+	};
+	
+	for ( auto& Preset : Presets )
+	{
+		Array<char> PngData;
+		SoyTime Start(true);
+		Pixels.GetPng( GetArrayBridge(PngData), Preset.second );
+		SoyTime End(true);
+		
+		auto Ms = std::max<uint64>( 1, End.GetTime() - Start.GetTime() );
+		auto MbPerSec = (PixelsArray.GetDataSize() / (1024.f*1024.f)) / (Ms / 1000.f);
+		std::Debug << "Png " << Preset.first << ": " << Soy::FormatSizeBytes(PngData.GetDataSize()) << " " << Ms << "ms (" << MbPerSec << "mb/s)" << std::endl;
+	}
+}
+
+
+void SoyBenchmark::PngEncode()
+{
+	//	row framing & filtering should scale linearly with image size
+	vec2x<size_t> Sizes[] = { vec2x<size_t>( 1920, 1080 ), vec2x<size_t>( 3840, 2160 ) };
+	for ( auto Size : Sizes )
+	{
+		SoyPixels Pixels;
+		Pixels.Init( Size.x, Size.y, SoyPixelsFormat::RGBA );
+		FillTestPattern( Pixels );
+		
+		for ( auto Params : { TPng::TEncodeParams::Store(), TPng::TEncodeParams::Fast() } )
+		{
+			Array<char> PngData;
+			SoyTime Start(true);
+			Pixels.GetPng( GetArrayBridge(PngData), Params );
+			SoyTime End(true);
+			std::Debug << "Png encode " << Size.x << "x" << Size.y << " level " << Params.mCompressionLevel << ": " << (End.GetTime() - Start.GetTime()) << "ms" << std::endl;
+		}
+	}
+}
+
+
+void SoyBenchmark::PixelBufferManager()
+{
+	//	push + sync pop per frame, with frames arriving in decode order (IPBB -> 1,4,2,3)
+	std::shared_ptr<TPixelBuffer> Pixels( new TDumbPixelBuffer() );
+	auto NoBlock = []	{	return false;	};
+	size_t FrameCount = 100000;
+	size_t Depths[] = { 8, 64, 512 };
+	for ( auto Depth : Depths )
+	{
+		TPixelBufferParams Params;
+		Params.mMaxBufferSize = Depth + 1;
+		Params.mMinBufferSize = 0;
+		Params.mAllowPushRejection = false;
+		TPixelBufferManager Frames( Params );
+		
+		size_t Popped = 0;
+		SoyTime Start(true);
+		for ( size_t i=0;	i<FrameCount;	i++ )
+		{
+			size_t Reorder[] = { 0, 3, 1, 2 };
+			TPixelBufferFrame Frame;
+			Frame.mPixels = Pixels;
+			Frame.mTimestamp = SoyTime( std::chrono::milliseconds( 1 + (i/4)*4 + Reorder[i%4] ) );
+			Frames.PushPixelBuffer( Frame, NoBlock );
+			if ( i < Depth )
+				continue;
+			
+			SoyTime Timestamp( std::chrono::milliseconds( Popped + 1 ) );
+			if ( Frames.PopPixelBuffer( Timestamp ) )
+				Popped++;
+		}
+		SoyTime End(true);
+		std::Debug << "Pixel buffer depth " << Depth << ": " << FrameCount << " push+pop " << (End.GetTime() - Start.GetTime()) << "ms" << std::endl;
+	}
+}
+
+
+void SoyBenchmark::ImageProbe()
+{
+	//	probing is meant to be cheap enough to do for every file before deciding to decode it
+	SoyPixels Pixels;
+	Pixels.Init( 1920, 1080, SoyPixelsFormat::RGBA );
+	Array<char> PngData;
+	Pixels.GetPng( GetArrayBridge(PngData) );
+	
+	SoyPixelsMeta Meta;
+	size_t ProbeCount = 100000;
+	SoyTime Start(true);
+	for ( size_t i=0;	i<ProbeCount;	i++ )
+		Png::Probe( Meta, GetArrayBridge(PngData) );
+	SoyTime End(true);
+	std::Debug << "Png probe x" << ProbeCount << ": " << (End.GetTime() - Start.GetTime()) << "ms" << std::endl;
+}
+
+
+void SoyBenchmark::RunAll()
+{
+	PngCompression();
+	PngEncode();
+	PixelBufferManager();
+	ImageProbe();
+}
+
+#endif
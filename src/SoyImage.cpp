@@ -1,5 +1,13 @@
 #include "SoyImage.h"
 #include "SoyStream.h"
+#include "SoyPng.h"
+#include "SoyThread.h"
+#include "SoyFilesystem.h"
+#include <atomic>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <thread>
 
 
 #define USE_STB
@@ -8,6 +16,21 @@
 #define STB_IMAGE_IMPLEMENTATION
 #define STBI_NO_STDIO				//	all soy file access is abstracted so don't allow it in stb
 
+//	route stb's allocations through us so it can decode straight into the destination pixels
+namespace Stb
+{
+	void*	Malloc(size_t Size);
+	void*	Realloc(void* Data,size_t Size);
+	void	Free(void* Data);
+}
+#define STBI_MALLOC(Size)			Stb::Malloc(Size)
+#define STBI_REALLOC(Data,Size)		Stb::Realloc(Data,Size)
+#define STBI_FREE(Data)				Stb::Free(Data)
+
+//	stb's failure reason is a global, give each thread its own so concurrent decodes report their own errors.
+//	gr: not __thread, that's defined away on android/apple/ps4 (see SoyTypes_xxx.h). It's only a pointer so thread_local is fine on OSX
+#define STBI_THREAD_LOCAL			thread_local
+
 //	gr: on windows we currently get a whole load of extra stb warnings
 #if defined(TARGET_WINDOWS)
 #pragma warning(push)
@@ -26,6 +49,165 @@ namespace Stb
 	typedef std::function<stbi_uc*(stbi__context* s,int* x,int* y,int* comp,int req_comp)> TReadFunction;
 	void	Read(SoyPixelsImpl& Pixels,TStreamBuffer& Buffer,TReadFunction ReadFunction);
 	void	Read(SoyPixelsImpl& Pixels,const ArrayBridge<char>& Buffer,TReadFunction ReadFunction);
+	void	Read(SoyPixelsImpl& Pixels,const ArrayBridge<char>& Buffer,int RequestedChannels);	//	any format stb knows, 0 channels keeps the file's
+	
+	//	while one of these is alive, the first allocation on this thread of exactly the destination's size
+	//	(ie. stb's output image) is given the destination's storage instead of the heap.
+	//	Only empty destinations are used, so a failed decode never wipes an existing image
+	class TDecodeTarget;
+	class TAllocTarget
+	{
+	public:
+		void*	mData;
+		size_t	mSize;
+		bool	mInUse;
+	};
+	
+	std::mutex								gAllocTargetsLock;
+	std::map<std::thread::id,TAllocTarget>	gAllocTargets;
+	std::atomic<int>						gAllocTargetCount( 0 );
+	
+	//	the failure reason is per-thread, reset it before a call so we don't report an earlier decode's error
+	void		ResetError();
+	std::string	GetError();
+	
+	//	header probe, so the destination can be sized before decoding
+	bool	GetMeta(SoyPixelsMeta& Meta,const ArrayBridge<char>& Buffer,int RequestedChannels);
+	void	Read(SoyPixelsImpl& Pixels,const SoyPixelsMeta& ExpectedMeta,std::function<stbi_uc*(int& Width,int& Height,int& Channels)> Decode);
+	
+	//	peeks a growing prefix of the buffer until the probe has the whole header, nothing is popped
+	bool	Probe(TStreamBuffer& Buffer,size_t InitialSize,std::function<bool(const ArrayBridge<char>&)> ProbeData);
+	//	probe with one of stb's header readers, HeaderSize being enough that it never reads past the end
+	typedef std::function<int(stbi__context* s,int* x,int* y,int* comp)> TInfoFunction;
+	bool	Probe(SoyPixelsMeta& Meta,const ArrayBridge<char>& Data,size_t HeaderSize,TInfoFunction InfoFunction,const char* FormatName);
+}
+
+
+class Stb::TDecodeTarget
+{
+public:
+	TDecodeTarget(SoyPixelsImpl& Pixels,const SoyPixelsMeta& Meta);
+	~TDecodeTarget();
+	
+	bool			IsTarget(const void* Data) const	{	return mData && Data == mData;	}
+	void			OnDecoded()							{	mDecoded = true;	}
+	
+private:
+	SoyPixelsImpl&	mPixels;
+	SoyPixelsMeta	mOldMeta;
+	size_t			mOldSize;
+	void*			mData;
+	bool			mDecoded;
+};
+
+
+Stb::TDecodeTarget::TDecodeTarget(SoyPixelsImpl& Pixels,const SoyPixelsMeta& Meta) :
+	mPixels		( Pixels ),
+	mOldSize	( 0 ),
+	mData		( nullptr ),
+	mDecoded	( false )
+{
+	if ( !Meta.IsValid() )
+		return;
+	
+	//	an existing image would be lost if the decode fails, so that gets copied over afterwards instead
+	if ( Pixels.IsValid() )
+		return;
+	
+	mOldMeta = Pixels.GetMeta();
+	mOldSize = Pixels.GetPixelsArray().GetSize();
+	//	reuses the existing allocation when it's already big enough
+	Pixels.Init( Meta );
+	auto& PixelsArray = Pixels.GetPixelsArray();
+	if ( PixelsArray.GetDataSize() != Meta.GetDataSize() )
+		return;
+	
+	TAllocTarget Target;
+	Target.mData = PixelsArray.GetArray();
+	Target.mSize = PixelsArray.GetDataSize();
+	Target.mInUse = false;
+	
+	std::lock_guard<std::mutex> Lock( gAllocTargetsLock );
+	gAllocTargets[std::this_thread::get_id()] = Target;
+	gAllocTargetCount++;
+	mData = Target.mData;
+}
+
+
+Stb::TDecodeTarget::~TDecodeTarget()
+{
+	if ( !mData )
+		return;
+	
+	{
+		std::lock_guard<std::mutex> Lock( gAllocTargetsLock );
+		gAllocTargets.erase( std::this_thread::get_id() );
+		gAllocTargetCount--;
+	}
+	
+	//	leave the destination empty, as it was, rather than a half decoded image
+	if ( !mDecoded )
+	{
+		mPixels.GetMeta() = mOldMeta;
+		mPixels.GetPixelsArray().SetSize( mOldSize );
+	}
+}
+
+
+void* Stb::Malloc(size_t Size)
+{
+	if ( gAllocTargetCount > 0 )
+	{
+		std::lock_guard<std::mutex> Lock( gAllocTargetsLock );
+		auto it = gAllocTargets.find( std::this_thread::get_id() );
+		if ( it != gAllocTargets.end() )
+		{
+			auto& Target = it->second;
+			if ( !Target.mInUse && Target.mSize == Size )
+			{
+				Target.mInUse = true;
+				return Target.mData;
+			}
+		}
+	}
+	return malloc( Size );
+}
+
+
+void* Stb::Realloc(void* Data,size_t Size)
+{
+	if ( Data && gAllocTargetCount > 0 )
+	{
+		std::lock_guard<std::mutex> Lock( gAllocTargetsLock );
+		auto it = gAllocTargets.find( std::this_thread::get_id() );
+		if ( it != gAllocTargets.end() && it->second.mData == Data )
+		{
+			//	a scratch buffer that happened to be the right size is growing, move it onto the heap and free up the target again
+			auto& Target = it->second;
+			auto* NewData = malloc( Size );
+			if ( NewData )
+				memcpy( NewData, Data, std::min( Size, Target.mSize ) );
+			Target.mInUse = false;
+			return NewData;
+		}
+	}
+	return realloc( Data, Size );
+}
+
+
+void Stb::Free(void* Data)
+{
+	if ( Data && gAllocTargetCount > 0 )
+	{
+		std::lock_guard<std::mutex> Lock( gAllocTargetsLock );
+		auto it = gAllocTargets.find( std::this_thread::get_id() );
+		if ( it != gAllocTargets.end() && it->second.mData == Data )
+		{
+			it->second.mInUse = false;
+			return;
+		}
+	}
+	free( Data );
 }
 
 
@@ -143,71 +325,198 @@ void StbContext::Flush()
 
 std::string StbContext::GetError()
 {
-	//	gr: as this is not thread safe, it could come out mangled :( maybe add a lock around error popping before read (maybe have to lock around the whole thing)
+	return Stb::GetError();
+}
+
+
+void Stb::ResetError()
+{
+	stbi__g_failure_reason = nullptr;
+}
+
+
+std::string Stb::GetError()
+{
 	auto* StbError = stbi_failure_reason();
-	if ( !StbError )
+	if ( !StbError || StbError[0] == '\0' )
 		return "Unknown error";
-
+	
 	return StbError;
 }
 
 
-void Stb::Read(SoyPixelsImpl& Pixels,TStreamBuffer& Buffer,TReadFunction ReadFunction)
+bool Stb::GetMeta(SoyPixelsMeta& Meta,const ArrayBridge<char>& Buffer,int RequestedChannels)
 {
-	StbContext Context( Buffer, true );
 	int Width = 0;
 	int Height = 0;
 	int Channels = 0;
-	//	gr: use 0 for "defaults"
-	int RequestedChannels = 0;
-	auto* DecodedPixels = ReadFunction( &Context.mContext, &Width, &Height, &Channels, RequestedChannels );
-	if ( !DecodedPixels )
+	auto* Data = reinterpret_cast<const stbi_uc*>( Buffer.GetArray() );
+	if ( !stbi_info_from_memory( Data, size_cast<int>( Buffer.GetDataSize() ), &Width, &Height, &Channels ) )
+		return false;
+	
+	if ( RequestedChannels != 0 )
+		Channels = RequestedChannels;
+	Meta = SoyPixelsMeta( Width, Height, SoyPixelsFormat::GetFormatFromChannelCount( Channels ) );
+	return Meta.IsValid();
+}
+
+
+bool Stb::Probe(TStreamBuffer& Buffer,size_t InitialSize,std::function<bool(const ArrayBridge<char>&)> ProbeData)
+{
+	Array<char> Header;
+	auto PeekSize = InitialSize;
+	while ( true )
 	{
-		throw Soy::AssertException( Context.GetError() );
-	}
+		auto BufferedSize = Buffer.GetBufferedSize();
+		if ( BufferedSize == 0 )
+			return false;
+		
+		Header.SetSize( std::min( PeekSize, BufferedSize ), false );
+		auto HeaderBridge = GetArrayBridge( Header );
+		if ( !Buffer.Peek( HeaderBridge ) )
+			return false;
+		if ( ProbeData( HeaderBridge ) )
+			return true;
 		
-	//	convert output into pixels
+		//	need more than there is
+		if ( Header.GetSize() >= BufferedSize )
+			return false;
+		PeekSize *= 2;
+	}
+}
+
+
+bool Stb::Probe(SoyPixelsMeta& Meta,const ArrayBridge<char>& Data,size_t HeaderSize,TInfoFunction InfoFunction,const char* FormatName)
+{
+	if ( Data.GetDataSize() < HeaderSize )
+		return false;
+	
+	//	a memory context is just a couple of pointers, only the header is touched
+	stbi__context Context;
+	stbi__start_mem( &Context, reinterpret_cast<const stbi_uc*>( Data.GetArray() ), size_cast<int>( HeaderSize ) );
+	
+	int Width = 0;
+	int Height = 0;
+	int Channels = 0;
+	if ( !InfoFunction( &Context, &Width, &Height, &Channels ) )
+	{
+		std::stringstream Error;
+		Error << "Not a valid " << FormatName << " header";
+		throw Soy::AssertException( Error.str() );
+	}
+	
+	Meta = SoyPixelsMeta( Width, Height, SoyPixelsFormat::GetFormatFromChannelCount( Channels ) );
+	if ( !Meta.IsValid() )
+	{
+		std::stringstream Error;
+		Error << FormatName << " header has invalid dimensions/format";
+		throw Soy::AssertException( Error.str() );
+	}
+	return true;
+}
+
+
+void Stb::Read(SoyPixelsImpl& Pixels,const SoyPixelsMeta& ExpectedMeta,std::function<stbi_uc*(int& Width,int& Height,int& Channels)> Decode)
+{
+	TDecodeTarget Target( Pixels, ExpectedMeta );
+	
+	int Width = 0;
+	int Height = 0;
+	int Channels = 0;
+	auto* DecodedPixels = Decode( Width, Height, Channels );
+	
+	//	decoded straight into the pixels
+	if ( Target.IsTarget( DecodedPixels ) )
+	{
+		auto Format = SoyPixelsFormat::GetFormatFromChannelCount( Channels );
+		Soy::Assert( SoyPixelsMeta( Width, Height, Format ) == ExpectedMeta, "stb decoded into pixels with different meta to the header" );
+		Target.OnDecoded();
+		return;
+	}
+	
+	//	stb allocated elsewhere, copy over
 	//	gr: have to assume size
 	auto Format = SoyPixelsFormat::GetFormatFromChannelCount( Channels );
 	SoyPixelsMeta Meta( Width, Height, Format );
 	SoyPixelsRemote OutputPixels( DecodedPixels, Meta.GetDataSize(), Meta );
-	Pixels.Copy( OutputPixels );
+	try
+	{
+		Pixels.Copy( OutputPixels );
+	}
+	catch(...)
+	{
+		stbi_image_free( DecodedPixels );
+		throw;
+	}
+	stbi_image_free( DecodedPixels );
+	Target.OnDecoded();
+}
+
+
+void Stb::Read(SoyPixelsImpl& Pixels,TStreamBuffer& Buffer,TReadFunction ReadFunction)
+{
+	//	gr: use 0 for "defaults"
+	int RequestedChannels = 0;
+	
+	//	probe the header from the front of the buffer so we know the output size up front
+	SoyPixelsMeta ExpectedMeta;
+	{
+		static size_t MaxProbeSize = 64*1024;
+		Array<char> Header;
+		Header.SetSize( std::min( MaxProbeSize, Buffer.GetBufferedSize() ) );
+		if ( Buffer.Peek( GetArrayBridge(Header) ) )
+			GetMeta( ExpectedMeta, GetArrayBridge(Header), RequestedChannels );
+	}
+	
+	StbContext Context( Buffer, true );
+	auto Decode = [&](int& Width,int& Height,int& Channels)
+	{
+		ResetError();
+		auto* DecodedPixels = ReadFunction( &Context.mContext, &Width, &Height, &Channels, RequestedChannels );
+		if ( !DecodedPixels )
+			throw Soy::AssertException( Context.GetError() );
+		return DecodedPixels;
+	};
+	Read( Pixels, ExpectedMeta, Decode );
 	
 	//	success, don't let context unpop data
 	Context.Flush();
-
 }
 
 
 
 void Stb::Read(SoyPixelsImpl& Pixels,const ArrayBridge<char>& ArrayBuffer,TReadFunction ReadFunction)
+{
+	//	keep the file's format, same as the stream path and what Probe() reports
+	Read( Pixels, ArrayBuffer, 0 );
+}
+
+
+void Stb::Read(SoyPixelsImpl& Pixels,const ArrayBridge<char>& ArrayBuffer,int RequestedChannels)
 {
 #if defined(USE_STB)
 	const stbi_uc* Buffer = reinterpret_cast<const stbi_uc*>( ArrayBuffer.GetArray() );
 	auto BufferSize = size_cast<int>( ArrayBuffer.GetDataSize() );
-	int Width = 0;
-	int Height = 0;
-	int Channels = 0;
-	int RequestedChannels = 4;
-	auto* DecodedPixels = stbi_load_from_memory( Buffer, BufferSize, &Width, &Height, &Channels, RequestedChannels );
-	if ( !DecodedPixels )
-	{
-		//	gr: as this is not thread safe, it could come out mangled :( maybe add a lock around error popping before read (maybe have to lock around the whole thing)
-		auto* StbError = stbi_failure_reason();
-		if ( !StbError )
-			StbError = "Unknown error";
-		std::stringstream Error;
-		Error << "Failed to read image pixels; " << StbError;
-		
-		throw Soy::AssertException( Error.str() );
-	}
 	
-	//	convert output into pixels
-	//	gr: have to assume size
-	auto Format = SoyPixelsFormat::GetFormatFromChannelCount( Channels );
-	SoyPixelsMeta Meta( Width, Height, Format );
-	SoyPixelsRemote OutputPixels( DecodedPixels, Meta.GetDataSize(), Meta );
-	Pixels.Copy( OutputPixels );
+	SoyPixelsMeta ExpectedMeta;
+	GetMeta( ExpectedMeta, ArrayBuffer, RequestedChannels );
+	
+	auto Decode = [&](int& Width,int& Height,int& Channels)
+	{
+		ResetError();
+		auto* DecodedPixels = stbi_load_from_memory( Buffer, BufferSize, &Width, &Height, &Channels, RequestedChannels );
+		if ( !DecodedPixels )
+		{
+			std::stringstream Error;
+			Error << "Failed to read image pixels; " << GetError();
+			throw Soy::AssertException( Error.str() );
+		}
+		//	some loaders report the file's channel count rather than what they output
+		if ( RequestedChannels != 0 )
+			Channels = RequestedChannels;
+		return DecodedPixels;
+	};
+	Read( Pixels, ExpectedMeta, Decode );
 #else
 	throw Soy::AssertException("No STB support, no image reading");
 #endif
@@ -224,7 +533,86 @@ void Png::Read(SoyPixelsImpl& Pixels,const ArrayBridge<char>& Buffer)
 	Stb::Read( Pixels, Buffer, stbi__png_load );
 }
 
-/*static */int stbi__process_marker(stbi__jpeg *z, int m);
+bool Png::Probe(SoyPixelsMeta& Meta,const ArrayBridge<char>& Data)
+{
+	static const uint8 Signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+	auto* Bytes = reinterpret_cast<const uint8*>( Data.GetArray() );
+	auto Size = Data.GetDataSize();
+	
+	if ( Size < sizeof(Signature) )
+		return false;
+	if ( memcmp( Bytes, Signature, sizeof(Signature) ) != 0 )
+		throw Soy::AssertException("Not a png, bad signature");
+	
+	//	walk the chunk headers up to the first IDAT, as a tRNS chunk adds an alpha channel to what stb outputs
+	auto ReadBe32 = [](const uint8* p)	{	return (uint32(p[0])<<24) | (uint32(p[1])<<16) | (uint32(p[2])<<8) | uint32(p[3]);	};
+	size_t Width = 0;
+	size_t Height = 0;
+	size_t Channels = 0;
+	bool Transparency = false;
+	size_t Pos = sizeof(Signature);
+	while ( true )
+	{
+		if ( Pos + 8 > Size )
+			return false;
+		auto ChunkLength = ReadBe32( &Bytes[Pos] );
+		auto* ChunkType = reinterpret_cast<const char*>( &Bytes[Pos+4] );
+		auto* ChunkData = &Bytes[Pos+8];
+		
+		if ( !memcmp( ChunkType, "IHDR", 4 ) )
+		{
+			if ( Pos + 8 + 13 > Size )
+				return false;
+			Soy::Assert( ChunkLength == 13, "Png IHDR chunk wrong size" );
+			Width = ReadBe32( &ChunkData[0] );
+			Height = ReadBe32( &ChunkData[4] );
+			auto ColourType = static_cast<TPng::TColour::Type>( ChunkData[9] );
+			auto PixelFormat = ( ColourType == TPng::TColour::Palette ) ? SoyPixelsFormat::RGB : TPng::GetPixelFormatType( ColourType );
+			if ( PixelFormat == SoyPixelsFormat::Invalid )
+			{
+				std::stringstream Error;
+				Error << "Invalid png colour type " << static_cast<int>( ColourType );
+				throw Soy::AssertException( Error.str() );
+			}
+			Channels = SoyPixelsFormat::GetChannelCount( PixelFormat );
+		}
+		else if ( !memcmp( ChunkType, "tRNS", 4 ) )
+		{
+			Transparency = true;
+		}
+		else if ( !memcmp( ChunkType, "IDAT", 4 ) || !memcmp( ChunkType, "IEND", 4 ) )
+		{
+			break;
+		}
+		else if ( Channels == 0 && memcmp( ChunkType, "CgBI", 4 ) )
+		{
+			throw Soy::AssertException("Png first chunk is not IHDR");
+		}
+		
+		//	length, type, data, crc
+		Pos += 4 + 4 + ChunkLength + 4;
+	}
+	
+	Soy::Assert( Channels != 0, "Png missing IHDR" );
+	
+	//	stb adds an alpha channel for tRNS (unless we're already RGBA)
+	if ( Transparency && ( Channels == 1 || Channels == 3 ) )
+		Channels++;
+	
+	Meta = SoyPixelsMeta( Width, Height, SoyPixelsFormat::GetFormatFromChannelCount( Channels ) );
+	if ( !Meta.IsValid() )
+		throw Soy::AssertException("Png header has invalid dimensions");
+	return true;
+}
+
+bool Png::Probe(SoyPixelsMeta& Meta,TStreamBuffer& Buffer)
+{
+	auto ProbeData = [&](const ArrayBridge<char>& Data)
+	{
+		return Probe( Meta, Data );
+	};
+	return Stb::Probe( Buffer, 256, ProbeData );
+}
 
 
 //	http://wwwimages.adobe.com/content/dam/Adobe/en/devnet/xmp/pdfs/XMP%20SDK%20Release%20cc-2014-12/XMPSpecificationPart3.pdf
@@ -295,113 +683,144 @@ bool DataStartsWith(const ArrayBridge<uint8>& Data,const char (& Signature)[BUFF
 
 
 
-static int stbi__process_marker_withmeta(stbi__jpeg *z, int m,std::function<void(ArrayBridge<uint8>&&)> HandleAppMarker)
-{
-	// check for comment block or APP blocks
-	if ((m >= 0xE0 && m <= 0xEF) || m == 0xFE) {
-		
-		int length = stbi__get16be(z->s)-2;
-		if ( HandleAppMarker )
-		{
-			auto* Data = (unsigned char*)stbi__malloc( length );
-			if (!Data)
-				return stbi__err("outofmem", "Out of memory");
 
-			if (!stbi__getn(z->s, Data, length ))
-			{
-				STBI_FREE(Data);
-				return stbi__err("failedtoreadapp", "Failed to read APP data");
-			}
-			
-			auto DataArray = GetRemoteArray( Data, length );
-			HandleAppMarker( GetArrayBridge(DataArray) );
-			STBI_FREE(Data);
-		}
-		else
-		{
-			stbi__skip(z->s, length );
-		}
-		return 1;
+void HandleJpegAppMarker(Jpeg::TMeta& Meta,ArrayBridge<uint8>&& AppData)
+{
+	if ( DataStartsWith( AppData, ExiffSignature ) )
+	{
+		auto SubData = AppData.GetSubArray( sizeof(ExiffSignature)-1 );
+		ExtractExiff( Meta, GetArrayBridge(SubData) );
+		return;
 	}
 	
-	return stbi__process_marker( z, m );
-}
-
-static int stbi__decode_jpeg_header_with_meta(stbi__jpeg *z, int scan,std::function<void(ArrayBridge<uint8>&&)> HandleAppMarker)
-{
-	int m;
-	z->marker = STBI__MARKER_none; // initialize cached marker to empty
-	m = stbi__get_marker(z);
-	if (!stbi__SOI(m)) return stbi__err("no SOI","Corrupt JPEG");
-	if (scan == STBI__SCAN_type) return 1;
-	m = stbi__get_marker(z);
-	while (!stbi__SOF(m)) {
-		if (!stbi__process_marker_withmeta(z,m,HandleAppMarker)) return 0;
-		m = stbi__get_marker(z);
-		while (m == STBI__MARKER_none) {
-			// some files have extra padding after their blocks, so ok, we'll scan
-			if (stbi__at_eof(z->s)) return stbi__err("no SOF", "Corrupt JPEG");
-			m = stbi__get_marker(z);
-		}
+	if ( DataStartsWith( AppData, XmpStandardSignature ) )
+	{
+		auto SubData = AppData.GetSubArray( sizeof(XmpStandardSignature)-1 );
+		ExtractXmpStandard( Meta, GetArrayBridge(SubData) );
+		return;
+	}
+	
+	if ( DataStartsWith( AppData, XmpExtendedSignature ) )
+	{
+		auto SubData = AppData.GetSubArray( sizeof(XmpExtendedSignature)-1 );
+		ExtractXmpExtended( Meta, GetArrayBridge(SubData) );
+		return;
+	}
+	
+	if ( DataStartsWith( AppData, Photoshop3Signature ) )
+	{
+		auto SubData = AppData.GetSubArray( sizeof(Photoshop3Signature)-1 );
+		ExtractPhotoshop3( Meta, GetArrayBridge(SubData) );
+		return;
+	}
+	
+	static bool DebugUnknownMeta = true;
+	if ( DebugUnknownMeta )
+	{
+		std::stringstream Signature;
+		Soy::ArrayToString( GetArrayBridge(AppData), Signature, 30 );
+		std::Debug << "unknown jpeg meta signature; " << Signature.str() << Soy::FormatSizeBytes(AppData.GetSize()) << std::endl;
 	}
-	z->progressive = stbi__SOF_progressive(m);
-	if (!stbi__process_frame_header(z, scan)) return 0;
-	return 1;
 }
 
-void Jpeg::ReadMeta(Jpeg::TMeta& Meta,TStreamBuffer& Buffer)
+
+bool Jpeg::Probe(SoyPixelsMeta& Meta,Jpeg::TMeta& JpegMeta,const ArrayBridge<char>& Data)
 {
-	StbContext Context( Buffer, false );
+	//	walk the markers up to the frame header (same rules as stb's header scan) without the stb context
+	auto* Bytes = reinterpret_cast<const uint8*>( Data.GetArray() );
+	auto Size = Data.GetDataSize();
+	
+	if ( Size < 2 )
+		return false;
+	if ( Bytes[0] != 0xff || Bytes[1] != 0xd8 )
+		throw Soy::AssertException("Not a jpeg, missing SOI");
 	
-	auto HandleAppMarker = [&](ArrayBridge<uint8>&& AppData)
+	//	only apply the meta once we know we have the whole header, so a retry with more data doesn't duplicate it
+	Jpeg::TMeta NewMeta;
+	size_t Pos = 2;
+	while ( true )
 	{
-		if ( DataStartsWith( AppData, ExiffSignature ) )
-		{
-			auto SubData = AppData.GetSubArray( sizeof(ExiffSignature)-1 );
-			ExtractExiff( Meta, GetArrayBridge(SubData) );
-			return;
-		}
+		//	some files have extra padding after their blocks, and any number of 0xff fill bytes before a marker
+		while ( Pos < Size && Bytes[Pos] != 0xff )
+			Pos++;
+		while ( Pos < Size && Bytes[Pos] == 0xff )
+			Pos++;
+		if ( Pos >= Size )
+			return false;
+		auto Marker = Bytes[Pos++];
 		
-		if ( DataStartsWith( AppData, XmpStandardSignature ) )
-		{
-			auto SubData = AppData.GetSubArray( sizeof(XmpStandardSignature)-1 );
-			ExtractXmpStandard( Meta, GetArrayBridge(SubData) );
-			return;
-		}
+		//	markers without a length
+		if ( Marker == 0x01 || Marker == 0xd8 || ( Marker >= 0xd0 && Marker <= 0xd7 ) )
+			continue;
 		
-		if ( DataStartsWith( AppData, XmpExtendedSignature ) )
-		{
-			auto SubData = AppData.GetSubArray( sizeof(XmpExtendedSignature)-1 );
-			ExtractXmpExtended( Meta, GetArrayBridge(SubData) );
-			return;
-		}
+		if ( Marker == 0xd9 || Marker == 0xda )
+			throw Soy::AssertException("Jpeg has no SOF");
+		
+		if ( Pos + 2 > Size )
+			return false;
+		size_t Length = ( Bytes[Pos] << 8 ) | Bytes[Pos+1];
+		if ( Length < 2 )
+			throw Soy::AssertException("Jpeg marker has bad length");
+		if ( Pos + Length > Size )
+			return false;
+		auto* Segment = &Bytes[Pos+2];
+		auto SegmentSize = Length - 2;
+		Pos += Length;
 		
-		if ( DataStartsWith( AppData, Photoshop3Signature ) )
+		//	baseline, extended or progressive frame header. precision, height, width, components
+		if ( Marker >= 0xc0 && Marker <= 0xc2 )
 		{
-			auto SubData = AppData.GetSubArray( sizeof(Photoshop3Signature)-1 );
-			ExtractPhotoshop3( Meta, GetArrayBridge(SubData) );
-			return;
+			if ( SegmentSize < 6 )
+				throw Soy::AssertException("Jpeg SOF too short");
+			size_t Height = ( Segment[1] << 8 ) | Segment[2];
+			size_t Width = ( Segment[3] << 8 ) | Segment[4];
+			size_t Components = Segment[5];
+			if ( Segment[0] != 8 )
+				throw Soy::AssertException("Jpeg only 8 bit supported");
+			if ( Height == 0 )
+				throw Soy::AssertException("Jpeg with no height (DNL) not supported");
+			if ( Components != 1 && Components != 3 )
+				throw Soy::AssertException("Jpeg bad component count");
+			
+			Meta = SoyPixelsMeta( Width, Height, SoyPixelsFormat::GetFormatFromChannelCount( Components ) );
+			if ( !Meta.IsValid() )
+				throw Soy::AssertException("Jpeg header has invalid dimensions");
+			
+			JpegMeta.mExif.PushBackArray( NewMeta.mExif );
+			JpegMeta.mXmp += NewMeta.mXmp;
+			return true;
 		}
 		
-		static bool DebugUnknownMeta = true;
-		if ( DebugUnknownMeta )
+		//	lossless/arithmetic frames, stb can't decode these
+		if ( Marker >= 0xc3 && Marker <= 0xcf && Marker != 0xc4 && Marker != 0xc8 && Marker != 0xcc )
+			throw Soy::AssertException("Jpeg frame type not supported");
+		
+		//	APPn/comment
+		if ( ( Marker >= 0xe0 && Marker <= 0xef ) || Marker == 0xfe )
 		{
-			std::stringstream Signature;
-			Soy::ArrayToString( GetArrayBridge(AppData), Signature, 30 );
-			std::Debug << "unknown jpeg meta signature; " << Signature.str() << Soy::FormatSizeBytes(AppData.GetSize()) << std::endl;
+			auto AppData = GetRemoteArray( const_cast<uint8*>(Segment), SegmentSize );
+			HandleJpegAppMarker( NewMeta, GetArrayBridge(AppData) );
 		}
+	}
+}
+
+
+bool Jpeg::Probe(SoyPixelsMeta& Meta,Jpeg::TMeta& JpegMeta,TStreamBuffer& Buffer)
+{
+	auto ProbeData = [&](const ArrayBridge<char>& Data)
+	{
+		return Probe( Meta, JpegMeta, Data );
 	};
-	
-	auto* s = &Context.mContext;
-	stbi__jpeg j;
-	j.s = s;
-	stbi__setup_jpeg(&j);
-	auto r = stbi__decode_jpeg_header_with_meta(&j, STBI__SCAN_load, HandleAppMarker );
-	stbi__rewind(s);
-    
-    //  throw on error
-    if ( r == 0 )
-        throw Soy::AssertException( Context.GetError() );
+	//	exif is usually in the first few kb, but can be up to 64kb
+	return Stb::Probe( Buffer, 4*1024, ProbeData );
+}
+
+
+void Jpeg::ReadMeta(Jpeg::TMeta& Meta,TStreamBuffer& Buffer)
+{
+	SoyPixelsMeta PixelsMeta;
+	if ( !Probe( PixelsMeta, Meta, Buffer ) )
+		throw Soy::AssertException("Not enough data for jpeg header");
 }
 
 void Jpeg::Read(SoyPixelsImpl& Pixels,TStreamBuffer& Buffer)
@@ -415,17 +834,271 @@ void Gif::Read(SoyPixelsImpl& Pixels,TStreamBuffer& Buffer)
 	Stb::Read( Pixels, Buffer, stbi__gif_load );
 }
 
+bool Gif::Probe(SoyPixelsMeta& Meta,const ArrayBridge<char>& Data)
+{
+	return Stb::Probe( Meta, Data, 10, stbi__gif_info, "Gif" );
+}
+
+bool Gif::Probe(SoyPixelsMeta& Meta,TStreamBuffer& Buffer)
+{
+	auto ProbeData = [&](const ArrayBridge<char>& Data)
+	{
+		return Probe( Meta, Data );
+	};
+	return Stb::Probe( Buffer, 10, ProbeData );
+}
+
 void Tga::Read(SoyPixelsImpl& Pixels,TStreamBuffer& Buffer)
 {
 	Stb::Read( Pixels, Buffer, stbi__tga_load );
 }
 
+bool Tga::Probe(SoyPixelsMeta& Meta,const ArrayBridge<char>& Data)
+{
+	return Stb::Probe( Meta, Data, 17, stbi__tga_info, "Tga" );
+}
+
+bool Tga::Probe(SoyPixelsMeta& Meta,TStreamBuffer& Buffer)
+{
+	auto ProbeData = [&](const ArrayBridge<char>& Data)
+	{
+		return Probe( Meta, Data );
+	};
+	return Stb::Probe( Buffer, 17, ProbeData );
+}
+
 void Bmp::Read(SoyPixelsImpl& Pixels,TStreamBuffer& Buffer)
 {
 	Stb::Read( Pixels, Buffer, stbi__bmp_load );
 }
 
+bool Bmp::Probe(SoyPixelsMeta& Meta,const ArrayBridge<char>& Data)
+{
+	return Stb::Probe( Meta, Data, 30, stbi__bmp_info, "Bmp" );
+}
+
+bool Bmp::Probe(SoyPixelsMeta& Meta,TStreamBuffer& Buffer)
+{
+	auto ProbeData = [&](const ArrayBridge<char>& Data)
+	{
+		return Probe( Meta, Data );
+	};
+	return Stb::Probe( Buffer, 30, ProbeData );
+}
+
 void Psd::Read(SoyPixelsImpl& Pixels,TStreamBuffer& Buffer)
 {
 	Stb::Read( Pixels, Buffer, stbi__psd_load );
 }
+
+bool Psd::Probe(SoyPixelsMeta& Meta,const ArrayBridge<char>& Data)
+{
+	return Stb::Probe( Meta, Data, 26, stbi__psd_info, "Psd" );
+}
+
+bool Psd::Probe(SoyPixelsMeta& Meta,TStreamBuffer& Buffer)
+{
+	auto ProbeData = [&](const ArrayBridge<char>& Data)
+	{
+		return Probe( Meta, Data );
+	};
+	return Stb::Probe( Buffer, 26, ProbeData );
+}
+
+
+
+TImageBatchDecoder::TImageBatchDecoder(size_t ThreadCount,size_t MemoryBudget) :
+	mNextThread		( 0 ),
+	mPushedCount	( 0 ),
+	mDeliveredCount	( 0 ),
+	mMemoryBudget	( MemoryBudget ),
+	mMemoryUsed		( 0 ),
+	mShutdown		( false )
+{
+	if ( ThreadCount == 0 )
+		ThreadCount = std::max<size_t>( 1, std::thread::hardware_concurrency() );
+	
+	for ( size_t t=0;	t<ThreadCount;	t++ )
+	{
+		std::stringstream Name;
+		Name << "TImageBatchDecoder " << t;
+		auto Thread = std::make_shared<SoyWorkerJobThread>( Name.str() );
+		Thread->Start();
+		mThreads.PushBack( Thread );
+	}
+}
+
+
+TImageBatchDecoder::~TImageBatchDecoder()
+{
+	{
+		std::lock_guard<std::mutex> Lock( mLock );
+		mShutdown = true;
+		mPending.clear();
+		mChanged.notify_all();
+	}
+	
+	for ( size_t t=0;	t<mThreads.GetSize();	t++ )
+		mThreads[t]->WaitToFinish();
+	mThreads.Clear();
+}
+
+
+size_t TImageBatchDecoder::Push(const std::string& Filename)
+{
+	TPending Pending;
+	Pending.mName = Filename;
+	Pending.mFilename = Filename;
+	return Push( Pending );
+}
+
+
+size_t TImageBatchDecoder::Push(const std::string& Name,std::shared_ptr<Array<char>> Data)
+{
+	Soy::Assert( Data != nullptr, "TImageBatchDecoder::Push expected data" );
+	TPending Pending;
+	Pending.mName = Name;
+	Pending.mData = Data;
+	return Push( Pending );
+}
+
+
+size_t TImageBatchDecoder::Push(TPending& Pending)
+{
+	{
+		std::lock_guard<std::mutex> Lock( mLock );
+		Pending.mIndex = mPushedCount++;
+		mPending.push_back( Pending );
+	}
+	
+	//	each job decodes until the queue is empty, so a thread stuck on a big image doesn't hold up the rest
+	auto& Thread = *mThreads[ mNextThread++ % mThreads.GetSize() ];
+	Thread.PushJob( [this]	{	DecodePending();	} );
+	return Pending.mIndex;
+}
+
+
+void TImageBatchDecoder::Wait()
+{
+	std::unique_lock<std::mutex> Lock( mLock );
+	mChanged.wait( Lock, [this]	{	return mShutdown || mDeliveredCount == mPushedCount;	} );
+}
+
+
+void TImageBatchDecoder::DecodePending()
+{
+	while ( true )
+	{
+		TPending Pending;
+		{
+			std::lock_guard<std::mutex> Lock( mLock );
+			if ( mPending.empty() )
+				return;
+			Pending = mPending.front();
+			mPending.pop_front();
+		}
+		
+		TImageBatchItem Item;
+		Item.mIndex = Pending.mIndex;
+		Item.mName = Pending.mName;
+		size_t ReservedMemory = 0;
+		try
+		{
+			Decode( Pending, Item, ReservedMemory );
+		}
+		catch(std::exception& e)
+		{
+			Item.mPixels.reset();
+			Item.mError = e.what();
+		}
+		
+		mOnDecoded.OnTriggered( Item );
+		
+		std::lock_guard<std::mutex> Lock( mLock );
+		mMemoryUsed -= ReservedMemory;
+		mDeliveredCount++;
+		mChanged.notify_all();
+	}
+}
+
+
+void TImageBatchDecoder::Decode(TPending& Pending,TImageBatchItem& Item,size_t& ReservedMemory)
+{
+	auto& Data = Pending.mData;
+	if ( !Data )
+	{
+		LoadFile( Pending.mFilename, Data, ReservedMemory );
+	}
+	else
+	{
+		//	estimate the decoded size from the header so we can wait for room before decoding
+		SoyPixelsMeta Meta;
+		Stb::GetMeta( Meta, GetArrayBridge(*Data), 0 );
+		auto Reserve = Data->GetDataSize() + Meta.GetDataSize();
+		if ( !ReserveMemory( Reserve ) )
+			throw Soy::AssertException("TImageBatchDecoder shutting down");
+		ReservedMemory = Reserve;
+	}
+	
+	Item.mPixels = std::make_shared<SoyPixels>();
+	Stb::Read( *Item.mPixels, GetArrayBridge(*Data), 0 );
+	
+	//	don't hold onto the file any longer than we need to
+	Data.reset();
+}
+
+
+void TImageBatchDecoder::LoadFile(const std::string& Filename,std::shared_ptr<Array<char>>& Data,size_t& ReservedMemory)
+{
+	std::ifstream Stream( Filename, std::ios::binary|std::ios::in );
+	if ( !Stream.is_open() )
+	{
+		std::stringstream Error;
+		Error << "Failed to open " << Filename << " (" << ::Platform::GetLastErrorString() << ")";
+		throw Soy::AssertException( Error.str() );
+	}
+	
+	Stream.seekg( 0, std::ios::end );
+	auto FileSize = static_cast<size_t>( Stream.tellg() );
+	Stream.seekg( 0, std::ios::beg );
+	
+	//	size the decoded image from the start of the file, so the reservation covers the file and the pixels
+	//	before we load either. If the header isn't in there, we can only count the file
+	static size_t MaxHeaderSize = 64*1024;
+	Array<char> Header;
+	Header.SetSize( std::min( MaxHeaderSize, FileSize ) );
+	Stream.read( Header.GetArray(), Header.GetDataSize() );
+	if ( Stream.gcount() != static_cast<std::streamsize>( Header.GetDataSize() ) )
+	{
+		std::stringstream Error;
+		Error << "Failed to read header of " << Filename;
+		throw Soy::AssertException( Error.str() );
+	}
+	SoyPixelsMeta Meta;
+	Stb::GetMeta( Meta, GetArrayBridge(Header), 0 );
+	
+	auto Reserve = FileSize + Meta.GetDataSize();
+	if ( !ReserveMemory( Reserve ) )
+		throw Soy::AssertException("TImageBatchDecoder shutting down");
+	ReservedMemory = Reserve;
+	
+	Data = std::make_shared<Array<char>>();
+	Data->Reserve( FileSize );
+	Data->PushBackArray( Header );
+	auto DataBridge = GetArrayBridge( *Data );
+	Soy::ReadStream( DataBridge, Stream );
+}
+
+
+bool TImageBatchDecoder::ReserveMemory(size_t Bytes)
+{
+	std::unique_lock<std::mutex> Lock( mLock );
+	
+	//	always let one image through (even if it's over budget on its own) so we can't stall
+	mChanged.wait( Lock, [&]	{	return mShutdown || mMemoryUsed == 0 || mMemoryUsed + Bytes <= mMemoryBudget;	} );
+	if ( mShutdown )
+		return false;
+	
+	mMemoryUsed += Bytes;
+	return true;
+}
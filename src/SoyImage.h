@@ -1,19 +1,28 @@
 #pragma once
 
 #include "SoyPixels.h"
+#include "SoyEvent.h"
 #include <tuple>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
 
 class SoyPixelsMeta;
 class SoyPixelsImpl;
 class TStreamBuffer;
+class SoyWorkerJobThread;
 
 
 
 //	stb interfaces which haven't yet had any specific Soy stuff yet
+//	Probe() reads just enough of the header to get the meta Read() will output, without decoding any pixels.
+//	Returns false if there isn't enough data yet (streams are only peeked) and throws if it's not that format
 namespace Png
 {
 	void		Read(SoyPixelsImpl& Pixels,TStreamBuffer& Buffer);
 	void		Read(SoyPixelsImpl& Pixels,const ArrayBridge<char>& Buffer);
+	bool		Probe(SoyPixelsMeta& Meta,TStreamBuffer& Buffer);
+	bool		Probe(SoyPixelsMeta& Meta,const ArrayBridge<char>& Data);
 	static const char*	FileExtensions[] = {".png"};
 }
 
@@ -28,6 +37,8 @@ namespace Jpeg
 	
 	void		Read(SoyPixelsImpl& Pixels,TStreamBuffer& Buffer);
 	void		ReadMeta(Jpeg::TMeta& Meta,TStreamBuffer& Buffer);
+	bool		Probe(SoyPixelsMeta& Meta,TMeta& JpegMeta,TStreamBuffer& Buffer);
+	bool		Probe(SoyPixelsMeta& Meta,TMeta& JpegMeta,const ArrayBridge<char>& Data);
 
 	static const char*	FileExtensions[] = {".jpg",".jpeg"};
 }
@@ -35,25 +46,94 @@ namespace Jpeg
 namespace Gif
 {
 	void		Read(SoyPixelsImpl& Pixels,TStreamBuffer& Buffer);
+	bool		Probe(SoyPixelsMeta& Meta,TStreamBuffer& Buffer);
+	bool		Probe(SoyPixelsMeta& Meta,const ArrayBridge<char>& Data);
 	static const char*	FileExtensions[] = {".gif"};
 }
 
 namespace Tga
 {
 	void		Read(SoyPixelsImpl& Pixels,TStreamBuffer& Buffer);
+	bool		Probe(SoyPixelsMeta& Meta,TStreamBuffer& Buffer);
+	bool		Probe(SoyPixelsMeta& Meta,const ArrayBridge<char>& Data);
 	static const char*	FileExtensions[] = {".tga"};
 }
 
 namespace Bmp
 {
 	void		Read(SoyPixelsImpl& Pixels,TStreamBuffer& Buffer);
+	bool		Probe(SoyPixelsMeta& Meta,TStreamBuffer& Buffer);
+	bool		Probe(SoyPixelsMeta& Meta,const ArrayBridge<char>& Data);
 	static const char*	FileExtensions[] = {".bmp"};
 }
 
 namespace Psd
 {
 	void		Read(SoyPixelsImpl& Pixels,TStreamBuffer& Buffer);
+	bool		Probe(SoyPixelsMeta& Meta,TStreamBuffer& Buffer);
+	bool		Probe(SoyPixelsMeta& Meta,const ArrayBridge<char>& Data);
 	static const char*	FileExtensions[] = {".psd"};
 }
 
 
+
+class TImageBatchItem
+{
+public:
+	TImageBatchItem() :
+		mIndex	( 0 )
+	{
+	}
+	
+	size_t						mIndex;		//	order it was pushed in
+	std::string					mName;		//	filename, or the name given with the data
+	std::shared_ptr<SoyPixels>	mPixels;	//	null if decoding failed
+	std::string					mError;
+};
+
+
+//	decodes lots of images (anything stb can read, by content not extension) across a pool of threads.
+//	Results are delivered as soon as they're done (so not in push order) on the worker threads.
+//	The memory budget covers the encoded data and decoded pixels of images in flight, up until they're delivered
+class TImageBatchDecoder
+{
+public:
+	TImageBatchDecoder(size_t ThreadCount=0,size_t MemoryBudget=256*1024*1024);	//	0 threads = one per core
+	~TImageBatchDecoder();
+	
+	size_t			Push(const std::string& Filename);	//	returns the item's index
+	size_t			Push(const std::string& Name,std::shared_ptr<Array<char>> Data);
+	void			Wait();								//	block until everything pushed has been delivered
+	
+private:
+	class TPending
+	{
+	public:
+		size_t						mIndex;
+		std::string					mName;
+		std::string					mFilename;
+		std::shared_ptr<Array<char>>	mData;
+	};
+	
+	size_t			Push(TPending& Pending);
+	void			DecodePending();				//	keep decoding until there's nothing left
+	void			Decode(TPending& Pending,TImageBatchItem& Item,size_t& ReservedMemory);
+	void			LoadFile(const std::string& Filename,std::shared_ptr<Array<char>>& Data,size_t& ReservedMemory);	//	reserves memory before loading
+	bool			ReserveMemory(size_t Bytes);	//	blocks until there's room, false if shutting down
+	
+public:
+	SoyEvent<TImageBatchItem>	mOnDecoded;
+	
+private:
+	Array<std::shared_ptr<SoyWorkerJobThread>>	mThreads;
+	size_t						mNextThread;
+	
+	std::mutex					mLock;
+	std::condition_variable		mChanged;		//	memory released, item delivered, or shutting down
+	std::deque<TPending>		mPending;
+	size_t						mPushedCount;
+	size_t						mDeliveredCount;
+	size_t						mMemoryBudget;
+	size_t						mMemoryUsed;
+	bool						mShutdown;
+};
@@ -60,6 +60,109 @@ std::ostream& operator<<(std::ostream& out,const TMediaPacket& in)
 }
 
 
+class TMediaPacketPool::TFreeList
+{
+public:
+	TFreeList(size_t MaxFreePackets) :
+		mFree			( SoyMedia::GetDefaultHeap() ),
+		mMaxFreePackets	( MaxFreePackets ),
+		mHitCount		( 0 ),
+		mMissCount		( 0 ),
+		mDiscardCount	( 0 )
+	{
+	}
+	~TFreeList()
+	{
+		for ( size_t i=0;	i<mFree.GetSize();	i++ )
+			delete mFree[i];
+	}
+	
+	TMediaPacket*			Pop();
+	void					Push(TMediaPacket* Packet);
+
+public:
+	std::mutex				mFreeLock;
+	Array<TMediaPacket*>	mFree;
+	size_t					mMaxFreePackets;
+	size_t					mHitCount;		//	allocs served from the free list
+	size_t					mMissCount;		//	allocs that had to new a packet
+	size_t					mDiscardCount;	//	released packets deleted because the free list was full
+};
+
+
+TMediaPacket* TMediaPacketPool::TFreeList::Pop()
+{
+	std::lock_guard<std::mutex> Lock( mFreeLock );
+	if ( mFree.IsEmpty() )
+	{
+		mMissCount++;
+		return nullptr;
+	}
+	mHitCount++;
+	return mFree.PopBack();
+}
+
+
+void TMediaPacketPool::TFreeList::Push(TMediaPacket* Packet)
+{
+	//	reset outside the lock, releasing the pixel buffer/format may be expensive. Data keeps its allocation
+	Packet->mEof = false;
+	Packet->mTimecode.mTime = 0;
+	Packet->mDuration.mTime = 0;
+	Packet->mDecodeTimecode.mTime = 0;
+	Packet->mIsKeyFrame = false;
+	Packet->mEncrypted = false;
+	Packet->mFormat.reset();
+	Packet->mMeta = TStreamMeta();
+	Packet->mData.Clear(false);
+	Packet->mPixelBuffer.reset();
+	
+	{
+		std::lock_guard<std::mutex> Lock( mFreeLock );
+		if ( mFree.GetSize() < mMaxFreePackets )
+		{
+			mFree.PushBack( Packet );
+			return;
+		}
+		mDiscardCount++;
+	}
+	delete Packet;
+}
+
+
+TMediaPacketPool::TMediaPacketPool(size_t MaxFreePackets) :
+	mFreeList	( new TFreeList(MaxFreePackets) )
+{
+}
+
+
+std::shared_ptr<TMediaPacket> TMediaPacketPool::Alloc()
+{
+	auto* Packet = mFreeList->Pop();
+	if ( !Packet )
+		Packet = new TMediaPacket();
+	
+	//	the deleter keeps the free list alive, so packets outliving the pool still get cleaned up
+	auto FreeList = mFreeList;
+	auto Release = [FreeList](TMediaPacket* Packet)
+	{
+		FreeList->Push( Packet );
+	};
+	return std::shared_ptr<TMediaPacket>( Packet, Release );
+}
+
+
+void TMediaPacketPool::GetMeta(const std::string& Prefix,TJsonWriter& Json) const
+{
+	auto& FreeList = *mFreeList;
+	std::lock_guard<std::mutex> Lock( FreeList.mFreeLock );
+	Json.Push( Prefix + "HitCount", static_cast<uint64>( FreeList.mHitCount ) );
+	Json.Push( Prefix + "MissCount", static_cast<uint64>( FreeList.mMissCount ) );
+	Json.Push( Prefix + "DiscardCount", static_cast<uint64>( FreeList.mDiscardCount ) );
+	Json.Push( Prefix + "FreeCount", static_cast<uint64>( FreeList.mFree.GetSize() ) );
+}
+
+
 void TStreamMeta::SetPixelMeta(const SoyPixelsMeta& Meta)
 {
 	mPixelMeta = Meta;
@@ -115,9 +218,19 @@ TMediaDecoder::~TMediaDecoder()
 	{
 		mInput->mOnNewPacket.RemoveListener( mOnNewPacketListener );
 	}
+	Stop();
 	WaitToFinish();
 }
 
+void TMediaDecoder::Stop()
+{
+	SoyWorkerThread::Stop();
+	
+	//	a push blocked on a full buffer needs to see we've stopped
+	if ( mPixelOutput )
+		mPixelOutput->WakeBlockedPush();
+}
+
 bool TMediaDecoder::CanSleep()
 {
 	//	don't sleep when there's work to do!
@@ -227,6 +340,70 @@ void TMediaDecoder::OnDecodeFrameSubmitted(const SoyTime& Time)
 
 
 
+namespace SoyMediaBufferWait
+{
+	//	Lock must hold the buffer's mutex. returns false if Block() gave up (or there's no Block) while still full
+	bool	WaitForSpace(std::unique_lock<std::mutex>& Lock,std::condition_variable& PoppedConditional,std::function<bool()> HasSpace,std::function<bool()>& Block,std::chrono::milliseconds Timeout,TMediaBufferWaitMetrics& Metrics);
+}
+
+
+bool SoyMediaBufferWait::WaitForSpace(std::unique_lock<std::mutex>& Lock,std::condition_variable& PoppedConditional,std::function<bool()> HasSpace,std::function<bool()>& Block,std::chrono::milliseconds Timeout,TMediaBufferWaitMetrics& Metrics)
+{
+	if ( HasSpace() )
+		return true;
+	
+	auto WaitStart = std::chrono::steady_clock::now();
+	bool Cancelled = false;
+	while ( !HasSpace() )
+	{
+		//	don't call out with the lock held, Block() might want the buffer
+		Lock.unlock();
+		bool KeepWaiting = Block && Block();
+		Lock.lock();
+		
+		if ( !KeepWaiting )
+		{
+			Cancelled = !HasSpace();
+			break;
+		}
+		
+		//	a pop while we were unlocked has already notified
+		if ( HasSpace() )
+			break;
+		
+		//	no predicate, WakeBlockedPush() needs us back round to Block() even while still full
+		PoppedConditional.wait_for( Lock, Timeout );
+	}
+	
+	auto WaitDuration = std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now() - WaitStart );
+	Metrics.OnWaited( WaitDuration, Cancelled );
+	return !Cancelled;
+}
+
+
+void TMediaBufferWaitMetrics::OnWaited(std::chrono::microseconds Duration,bool Cancelled)
+{
+	mWaitCount++;
+	if ( Cancelled )
+		mWaitCancelledCount++;
+	mWaitTotal += Duration;
+	mWaitMax = std::max( mWaitMax, Duration );
+}
+
+
+void TMediaBufferWaitMetrics::GetMeta(const std::string& Prefix,TJsonWriter& Json) const
+{
+	uint64 TotalUs = mWaitTotal.count();
+	uint64 AverageUs = mWaitCount > 0 ? TotalUs / mWaitCount : 0;
+	Json.Push( Prefix + "PushWaitCount", static_cast<uint64>( mWaitCount ) );
+	Json.Push( Prefix + "PushWaitCancelledCount", static_cast<uint64>( mWaitCancelledCount ) );
+	Json.Push( Prefix + "PushWaitTotalMs", TotalUs / 1000 );
+	Json.Push( Prefix + "PushWaitAverageUs", AverageUs );
+	Json.Push( Prefix + "PushWaitMaxUs", static_cast<uint64>( mWaitMax.count() ) );
+}
+
+
+
 TMediaPacketBuffer::~TMediaPacketBuffer()
 {
 	//	make sure everyone has finished accessing
@@ -243,33 +420,174 @@ TMediaPacketBuffer::~TMediaPacketBuffer()
 	mPackets.Clear();
 }
 
+size_t TMediaPacketBuffer::GetPacketCount() const
+{
+	std::lock_guard<std::mutex> Lock( mPacketsLock );
+	return GetPacketCountLocked();
+}
+
+size_t TMediaPacketBuffer::GetPacketCountLocked() const
+{
+	return mPackets.GetSize() + GetRingPacketCount();
+}
+
+size_t TMediaPacketBuffer::GetRingPacketCount() const
+{
+	if ( !mSingleProducerConsumer )
+		return 0;
+	
+	//	gr: ring & unpopped packet are only exact on the consumer thread, elsewhere this is a snapshot
+	auto Count = mRing.GetSize();
+	if ( mHasUnPoppedPacket )
+		Count++;
+	return Count;
+}
+
 std::shared_ptr<TMediaPacket> TMediaPacketBuffer::PopPacket()
 {
-	if ( mPackets.IsEmpty() )
-		return nullptr;
+	if ( mSingleProducerConsumer )
+	{
+		//	fast path, packets are in order. A flush switches to sorted, so anything it drops goes through MergeRing()
+		if ( !mSorted )
+		{
+			if ( mUnPoppedPacket )
+			{
+				std::shared_ptr<TMediaPacket> Packet;
+				std::swap( Packet, mUnPoppedPacket );
+				mHasUnPoppedPacket = false;
+				OnRingPopped();
+				return Packet;
+			}
+			
+			std::shared_ptr<TMediaPacket> Packet;
+			if ( mRing.Pop( Packet ) )
+			{
+				OnRingPopped();
+				return Packet;
+			}
+			
+			//	if we've switched in the meantime, the packet may be in the sorted packets
+			if ( !mSorted )
+				return nullptr;
+		}
+	}
 	
+	//	gr: no peeking at mPackets before locking, the producer may be inserting
 	std::lock_guard<std::mutex> Lock( mPacketsLock );
+	MergeRing();
+	
 	//	todo: options here so we can get the next packet we need
 	//		where we skip over all frames until the prev-to-Time keyframe
-	if ( mPackets.IsEmpty() )
-		return nullptr;
+	std::shared_ptr<TMediaPacket> Packet;
+	if ( !mPackets.IsEmpty() )
+	{
+		//if ( mPackets[0]->mTimecode > Time )
+		//	return nullptr;
+		Packet = mPackets.PopAt(0);
+		mPacketsPoppedConditional.notify_all();
+	}
 	
-	//if ( mPackets[0]->mTimecode > Time )
-	//	return nullptr;
+	//	drained, back to the lock-free ring. Anything the producer pushes from now on is after everything we've popped
+	if ( mSingleProducerConsumer && mPackets.IsEmpty() )
+		mSorted = false;
 	
-	return mPackets.PopAt(0);
+	return Packet;
 }
 
 
 void TMediaPacketBuffer::UnPopPacket(std::shared_ptr<TMediaPacket> Packet)
 {
+	//	only the consumer unpops, so it can hold on to it and give it back first next time
+	if ( mSingleProducerConsumer && !mSorted && !mUnPoppedPacket )
+	{
+		mUnPoppedPacket = Packet;
+		mHasUnPoppedPacket = true;
+		return;
+	}
+	
 	std::lock_guard<std::mutex> Lock( mPacketsLock );
+	//	switch before mPackets gets anything, the producer's lock-free count assumes it's empty while we're unsorted
+	if ( mSingleProducerConsumer )
+		mSorted = true;
+	MergeRing();
 	
 	//	gr: no sorted insert, assuming this was the last packet popped (assuming we onlyhave one thing popping packets from this buffer)
 	//		so go straight back to the start
 	GetArrayBridge(mPackets).InsertAt( 0, Packet );
 }
 
+void TMediaPacketBuffer::OnRingPopped()
+{
+	//	pairs with the fence in PushPacket; either we see the push is blocked, or it sees our pop when it checks for space
+	std::atomic_thread_fence( std::memory_order_seq_cst );
+	if ( !mPushBlocked )
+		return;
+	
+	//	take the lock so the notify can't land between the push checking for space and it starting to wait
+	{
+		std::lock_guard<std::mutex> Lock( mPacketsLock );
+	}
+	mPacketsPoppedConditional.notify_all();
+}
+
+void TMediaPacketBuffer::MergeRing()
+{
+	if ( !mSingleProducerConsumer )
+		return;
+	
+	//	flushed while in the ring
+	auto IsFlushed = [this](const TMediaPacket& Packet)
+	{
+		return mRingFlushTime.IsValid() && Packet.GetStartTime() > mRingFlushTime;
+	};
+	
+	//	an unpopped packet goes back to the start, everything in the ring was pushed after it
+	if ( mUnPoppedPacket )
+	{
+		if ( !IsFlushed( *mUnPoppedPacket ) )
+			GetArrayBridge(mPackets).InsertAt( 0, mUnPoppedPacket );
+		mUnPoppedPacket.reset();
+		mHasUnPoppedPacket = false;
+	}
+	
+	std::shared_ptr<TMediaPacket> Packet;
+	while ( mRing.Pop( Packet ) )
+	{
+		if ( IsFlushed( *Packet ) )
+			continue;
+		PushSortedPacket( Packet );
+	}
+	mRingFlushTime.mTime = 0;
+}
+
+void TMediaPacketBuffer::PushSortedPacket(std::shared_ptr<TMediaPacket>& Packet)
+{
+	//	in order, no need to sort
+	if ( mPackets.IsEmpty() || !( Packet->mDecodeTimecode < mPackets.GetBack()->mDecodeTimecode ) )
+	{
+		mPackets.PushBack( Packet );
+		return;
+	}
+	
+	//	sort by decode order
+	auto SortPackets = [](const std::shared_ptr<TMediaPacket>& a,const std::shared_ptr<TMediaPacket>& b)
+	{
+		auto Timea = a->mDecodeTimecode;
+		auto Timeb = b->mDecodeTimecode;
+			
+		if ( Timea < Timeb )
+			return -1;
+		if ( Timea > Timeb )
+			return 1;
+			
+		return 0;
+	};
+	
+	auto mPacketsBridge = GetArrayBridge(mPackets);
+	SortArrayLambda<std::shared_ptr<TMediaPacket>> SortedPackets( mPacketsBridge, SortPackets );
+	SortedPackets.Push( Packet );
+}
+
 void TMediaPacketBuffer::PushPacket(std::shared_ptr<TMediaPacket> Packet,std::function<bool()> Block)
 {
 	Soy::Assert( Packet != nullptr, "Packet expected");
@@ -280,55 +598,90 @@ void TMediaPacketBuffer::PushPacket(std::shared_ptr<TMediaPacket> Packet,std::fu
 		return;
 	}
 	
-	//	gr: maybe needs to be atomic?
-	while ( mPackets.GetSize() >= mMaxBufferSize )
+	//	fast path; in order and there's space, straight into the ring without locking
+	if ( mSingleProducerConsumer && PushRingPacket( Packet ) )
 	{
-		if ( !Block() )
-		{
-			std::Debug << "MediaPacketBuffer buffer full " << mPackets.GetSize() << "/" << mMaxBufferSize << ", dropped packet: " << *Packet << std::endl;
-			return;
-		}
+		mOnNewPacket.OnTriggered( Packet );
+		return;
 	}
 	
-	//	gr: fix incoming timestamps
-	CorrectIncomingPacketTimecode( *Packet );
-
 	{
-		std::lock_guard<std::mutex> Lock( mPacketsLock );
+		std::unique_lock<std::mutex> Lock( mPacketsLock );
 		
-		//	sort by decode order
-		auto SortPackets = [](const std::shared_ptr<TMediaPacket>& a,const std::shared_ptr<TMediaPacket>& b)
+		auto HasSpace = [this]	{	return GetPacketCountLocked() < mMaxBufferSize;	};
+		mPushBlocked = true;
+		//	make sure the consumer sees we're blocked before we check for space (which a lock-free pop won't change with the lock)
+		std::atomic_thread_fence( std::memory_order_seq_cst );
+		bool Pushable = SoyMediaBufferWait::WaitForSpace( Lock, mPacketsPoppedConditional, HasSpace, Block, mPushBlockTimeout.GetMilliSeconds(), mPushWaitMetrics );
+		mPushBlocked = false;
+		if ( !Pushable )
 		{
-			auto Timea = a->mDecodeTimecode;
-			auto Timeb = b->mDecodeTimecode;
-				
-			if ( Timea < Timeb )
-				return -1;
-			if ( Timea > Timeb )
-				return 1;
-				
-			return 0;
-		};
-
-		//	it is going to be rare for DTS to be out of order, and on android(note4 especially) it really slows down up the GPU, so issue a warning
-		if ( !mPackets.IsEmpty() )
+			std::Debug << "MediaPacketBuffer buffer full " << GetPacketCountLocked() << "/" << mMaxBufferSize << ", dropped packet: " << *Packet << std::endl;
+			return;
+		}
+		
+		//	gr: fix incoming timestamps
+		CorrectIncomingPacketTimecode( *Packet );
+		
+		//	the consumer may have drained the sorted packets and gone back to the ring while we waited. A flush can't happen while we have the lock
+		bool InOrder = !( Packet->mDecodeTimecode < mLastPushedDecodeTimecode );
+		if ( mSingleProducerConsumer && !mSorted && InOrder && mRing.Push( Packet ) )
+		{
+			mLastPushedDecodeTimecode.mTime = Packet->mDecodeTimecode.mTime;
+		}
+		else
 		{
-			auto TailTimecode = mPackets.GetBack()->mDecodeTimecode;
-			if ( Packet->mDecodeTimecode < TailTimecode )
+			//	it is going to be rare for DTS to be out of order, and on android(note4 especially) it really slows down up the GPU, so issue a warning
+			if ( !mPackets.IsEmpty() )
 			{
-				std::Debug << "Warning; adding DTS " << Packet->mDecodeTimecode << " out of order (tail=" << TailTimecode << ")" << std::endl;
+				auto TailTimecode = mPackets.GetBack()->mDecodeTimecode;
+				if ( Packet->mDecodeTimecode < TailTimecode )
+				{
+					std::Debug << "Warning; adding DTS " << Packet->mDecodeTimecode << " out of order (tail=" << TailTimecode << ")" << std::endl;
+				}
 			}
+			
+			if ( mSingleProducerConsumer && !mSorted )
+			{
+				if ( !InOrder )
+					std::Debug << "Warning; adding DTS " << Packet->mDecodeTimecode << " out of order (last=" << mLastPushedDecodeTimecode << "), switching to sorted packet buffer" << std::endl;
+				mSorted = true;
+				mSortedFallbackCount++;
+			}
+			PushSortedPacket( Packet );
+			mLastPushedDecodeTimecode.mTime = std::max( mLastPushedDecodeTimecode.mTime, Packet->mDecodeTimecode.mTime );
 		}
 		
-		auto mPacketsBridge = GetArrayBridge(mPackets);
-		SortArrayLambda<std::shared_ptr<TMediaPacket>> SortedPackets( mPacketsBridge, SortPackets );
-		SortedPackets.Push( Packet );
-		
 		//std::Debug << "Pushed intput packet to buffer " << *Packet << std::endl;
 	}
 	mOnNewPacket.OnTriggered( Packet );
 }
 
+bool TMediaPacketBuffer::PushRingPacket(std::shared_ptr<TMediaPacket>& Packet)
+{
+	//	a flush switches to sorted and then waits for us to leave, so either we see the switch here, or it waits for this packet to be in the ring (where MergeRing() drops it)
+	mRingPushInFlight = true;
+	
+	bool Pushed = false;
+	//	while unsorted, mPackets is empty so the ring is everything
+	if ( !mSorted && GetRingPacketCount() < mMaxBufferSize )
+	{
+		//	gr: fix incoming timestamps. Does nothing to a packet that's already been through it, if we fall back to the locked push
+		CorrectIncomingPacketTimecode( *Packet );
+		
+		//	out of order needs sorting, and there's space so the ring (as big as the buffer) can't be full
+		bool InOrder = !( Packet->mDecodeTimecode < mLastPushedDecodeTimecode );
+		if ( InOrder && mRing.Push( Packet ) )
+		{
+			mLastPushedDecodeTimecode.mTime = Packet->mDecodeTimecode.mTime;
+			Pushed = true;
+		}
+	}
+	
+	mRingPushInFlight = false;
+	return Pushed;
+}
+
 void TMediaPacketBuffer::CorrectIncomingPacketTimecode(TMediaPacket& Packet)
 {
 	//	apparently (not seen it yet) in some formats (eg. ts) some players (eg. vlc) can't cope if DTS is same as PTS
@@ -376,6 +729,14 @@ void TMediaPacketBuffer::ReleaseFramesAfter(SoyTime FlushTime)
 {
 	std::lock_guard<std::mutex> Lock( mPacketsLock  );
 	
+	//	switch the producer off the ring before touching its state
+	if ( mSingleProducerConsumer )
+	{
+		mSorted = true;
+		while ( mRingPushInFlight )
+			std::this_thread::yield();
+	}
+	
 	for ( ssize_t i=mPackets.GetSize()-1;	i>=0;	i-- )
 	{
 		auto& Packet = *mPackets[i];
@@ -384,6 +745,27 @@ void TMediaPacketBuffer::ReleaseFramesAfter(SoyTime FlushTime)
 		
 		mPackets.RemoveBlock( i, 1 );
 	}
+	
+	//	whatever comes after a seek is in order again, rather than behind what we had before it
+	mLastPushedDecodeTimecode.mTime = 0;
+	
+	//	we can't pop the ring from here, so have the consumer merge it (and drop what's flushed) on its next pop
+	if ( mSingleProducerConsumer )
+	{
+		if ( !mRingFlushTime.IsValid() || FlushTime < mRingFlushTime )
+			mRingFlushTime.mTime = FlushTime.mTime;
+	}
+	mPacketsPoppedConditional.notify_all();
+}
+
+
+void TMediaPacketBuffer::GetMeta(const std::string& Prefix,TJsonWriter& Json)
+{
+	std::lock_guard<std::mutex> Lock( mPacketsLock );
+	Json.Push( Prefix + "PacketCount", static_cast<uint64>( GetPacketCountLocked() ) );
+	Json.Push( Prefix + "SingleProducerConsumer", mSingleProducerConsumer );
+	Json.Push( Prefix + "SortedFallbackCount", static_cast<uint64>( mSortedFallbackCount ) );
+	mPushWaitMetrics.GetMeta( Prefix, Json );
 }
 
 
@@ -419,16 +801,31 @@ TMediaExtractor::TMediaExtractor(const TMediaExtractorParams& Params,size_t RunA
 
 TMediaExtractor::~TMediaExtractor()
 {
+	Stop();
 	WaitToFinish();
 }
 
+void TMediaExtractor::Stop()
+{
+	SoyWorkerThread::Stop();
+	
+	//	a push blocked on a full buffer needs to see we've stopped
+	for ( auto it=mStreamBuffers.begin();	it!=mStreamBuffers.end();	it++ )
+	{
+		auto Buffer = it->second;
+		if ( Buffer )
+			Buffer->WakeBlockedPush();
+	}
+}
+
 std::shared_ptr<TMediaPacketBuffer> TMediaExtractor::AllocStreamBuffer(size_t StreamIndex,size_t MaxBufferSize)
 {
 	auto& Buffer = mStreamBuffers[StreamIndex];
 	
 	if ( !Buffer )
 	{
-		Buffer.reset( new TMediaPacketBuffer(MaxBufferSize) );
+		//	the extractor thread is the only thing pushing, and the stream's decoder the only thing popping
+		Buffer.reset( new TMediaPacketBuffer( MaxBufferSize, true ) );
 		
 		auto OnPacketExtracted = [StreamIndex,this](std::shared_ptr<TMediaPacket>& Packet)
 		{
@@ -551,8 +948,8 @@ void TMediaExtractor::ReadPacketsUntil(SoyTime Time,std::function<bool()> While)
 			//	can have a packet with no data (eg. eof) skip this
 			if ( NextPacket->HasData() )
 			{
-				//	block thread unless it's stopped
-				auto Block = [this,&NextPacket]()
+				//	block thread unless it's stopped. The buffer does the waiting (and wakes when a packet is popped), this just decides whether to keep going
+				auto Block = [this]()
 				{
 					//	gr: wording is wrong here, but regardless, we block when buffer X is full, we shouldn't need them all flushed!
 					//	gr: use only for testing for now!
@@ -560,12 +957,6 @@ void TMediaExtractor::ReadPacketsUntil(SoyTime Time,std::function<bool()> While)
 					if ( DiscardDoesntBlock && this->mParams.mDiscardOldFrames )
 						return false;
 
-					//	gr: this is happening a LOT, probably because the extractor is very fast... maybe throttle the thread...
-					if ( IsWorking() )
-					{
-						//std::Debug << "MediaExtractor blocking in push packet; " << *NextPacket << std::endl;
-						std::this_thread::sleep_for( std::chrono::milliseconds(100) );
-					}
 					return IsWorking();
 				};
 				
@@ -607,6 +998,18 @@ void TMediaExtractor::ReadPacketsUntil(SoyTime Time,std::function<bool()> While)
 void TMediaExtractor::GetMeta(TJsonWriter& Json)
 {
 	Json.Push("CanSeekBackwards", CanSeekBackwards() );
+	mPacketPool.GetMeta( "PacketPool", Json );
+	
+	for ( auto it=mStreamBuffers.begin();	it!=mStreamBuffers.end();	it++ )
+	{
+		auto Buffer = it->second;
+		if ( !Buffer )
+			continue;
+		
+		std::stringstream Prefix;
+		Prefix << "Stream" << it->first << "PacketBuffer";
+		Buffer->GetMeta( Prefix.str(), Json );
+	}
 }
 
 
@@ -822,7 +1225,11 @@ void TMediaEncoder::PushFrame(std::shared_ptr<TMediaPacket>& Packet,std::functio
 void TMediaEncoder::GetMeta(TJsonWriter& Json)
 {
 	if ( mOutput )
+	{
 		Json.Push("EncoderPendingOutputFrames", mOutput->GetPacketCount() );
+		mOutput->GetMeta( "EncoderOutput", Json );
+	}
+	mPacketPool.GetMeta( "EncoderPacketPool", Json );
 }
 
 
@@ -1911,7 +2318,10 @@ bool TMediaPassThroughDecoder::ProcessPixelPacket(const TMediaPacket& Packet)
 
 		SoyPixelsRemote Pixels( GetArrayBridge(Packet.mData), Packet.mMeta.mPixelMeta );
 
-		Frame.mPixels.reset( new TDumbPixelBuffer( Pixels, Packet.mMeta.GetTransform() ) );
+		auto Buffer = Output.AllocPixelBuffer( Pixels.GetMeta() );
+		Buffer->mPixels.Copy( Pixels );
+		Buffer->mTransform = Packet.mMeta.GetTransform();
+		Frame.mPixels = Buffer;
 		Output.PushPixelBuffer( Frame, Block );
 		return true;
 	}
@@ -2018,6 +2428,121 @@ TDumbPixelBuffer::TDumbPixelBuffer(const SoyPixelsImpl& Pixels,const float3x3& T
 }
 
 
+class TPixelBufferPool::TFreeList
+{
+public:
+	TFreeList(size_t MaxFreeBuffers) :
+		mFree			( SoyMedia::GetDefaultHeap() ),
+		mMaxFreeBuffers	( MaxFreeBuffers ),
+		mHitCount		( 0 ),
+		mMissCount		( 0 ),
+		mDiscardCount	( 0 )
+	{
+	}
+	~TFreeList()
+	{
+		for ( size_t i=0;	i<mFree.GetSize();	i++ )
+			delete mFree[i];
+	}
+	
+	TDumbPixelBuffer*			Pop(const SoyPixelsMeta& Meta);
+	void						Push(TDumbPixelBuffer* Buffer);
+	
+public:
+	std::mutex					mFreeLock;
+	Array<TDumbPixelBuffer*>	mFree;			//	oldest first
+	size_t						mMaxFreeBuffers;
+	size_t						mHitCount;		//	allocs served from the free list
+	size_t						mMissCount;		//	allocs with no free buffer of the same meta
+	size_t						mDiscardCount;	//	free buffers deleted to make room (eg. left over from a different resolution)
+};
+
+
+TDumbPixelBuffer* TPixelBufferPool::TFreeList::Pop(const SoyPixelsMeta& Meta)
+{
+	std::lock_guard<std::mutex> Lock( mFreeLock );
+	
+	//	most recently released first, it's most likely to still be in cache
+	for ( ssize_t i=size_cast<ssize_t>(mFree.GetSize())-1;	i>=0;	i-- )
+	{
+		auto* Buffer = mFree[i];
+		if ( !( Buffer->mPixels.GetMeta() == Meta ) )
+			continue;
+		
+		mFree.RemoveBlock( i, 1 );
+		mHitCount++;
+		return Buffer;
+	}
+	
+	mMissCount++;
+	return nullptr;
+}
+
+
+void TPixelBufferPool::TFreeList::Push(TDumbPixelBuffer* Buffer)
+{
+	Buffer->mTransform = float3x3();
+	
+	TDumbPixelBuffer* Discard = nullptr;
+	{
+		std::lock_guard<std::mutex> Lock( mFreeLock );
+		
+		//	when full, drop the oldest rather than this one, so buffers of a meta we no longer use age out
+		if ( mFree.GetSize() >= mMaxFreeBuffers )
+		{
+			if ( mFree.IsEmpty() )
+			{
+				Discard = Buffer;
+				Buffer = nullptr;
+			}
+			else
+			{
+				Discard = mFree[0];
+				mFree.RemoveBlock( 0, 1 );
+			}
+			mDiscardCount++;
+		}
+		
+		if ( Buffer )
+			mFree.PushBack( Buffer );
+	}
+	delete Discard;
+}
+
+
+TPixelBufferPool::TPixelBufferPool(size_t MaxFreeBuffers) :
+	mFreeList	( new TFreeList(MaxFreeBuffers) )
+{
+}
+
+
+std::shared_ptr<TDumbPixelBuffer> TPixelBufferPool::Alloc(const SoyPixelsMeta& Meta)
+{
+	auto* Buffer = mFreeList->Pop( Meta );
+	if ( !Buffer )
+		Buffer = new TDumbPixelBuffer( Meta );
+	
+	//	the deleter keeps the free list alive, so buffers outliving the pool still get cleaned up
+	auto FreeList = mFreeList;
+	auto Release = [FreeList](TDumbPixelBuffer* Buffer)
+	{
+		FreeList->Push( Buffer );
+	};
+	return std::shared_ptr<TDumbPixelBuffer>( Buffer, Release );
+}
+
+
+void TPixelBufferPool::GetMeta(const std::string& Prefix,TJsonWriter& Json) const
+{
+	auto& FreeList = *mFreeList;
+	std::lock_guard<std::mutex> Lock( FreeList.mFreeLock );
+	Json.Push( Prefix + "HitCount", static_cast<uint64>( FreeList.mHitCount ) );
+	Json.Push( Prefix + "MissCount", static_cast<uint64>( FreeList.mMissCount ) );
+	Json.Push( Prefix + "DiscardCount", static_cast<uint64>( FreeList.mDiscardCount ) );
+	Json.Push( Prefix + "FreeCount", static_cast<uint64>( FreeList.mFree.GetSize() ) );
+}
+
+
 void TPixelBufferManager::GetMeta(const std::string& Prefix,TJsonWriter& Json)
 {
 	Json.Push( Prefix + "Type", "Pixel" );
@@ -2027,12 +2552,20 @@ void TPixelBufferManager::GetMeta(const std::string& Prefix,TJsonWriter& Json)
 	BufferArray<uint64,10> NextTimecodes;
 	{
 		std::lock_guard<std::mutex> Lock( mFrameLock );
-		for ( int i=0;	i<mFrames.size() && !NextTimecodes.IsFull();	i++ )
+		for ( size_t i=0;	i<mFrames.GetSize() && !NextTimecodes.IsFull();	i++ )
 		{
 			auto& Frame = mFrames[i];
 			NextTimecodes.PushBack( Frame.mTimestamp.mTime );
 		}
+		mPushWaitMetrics.GetMeta( Prefix, Json );
+		
+		if ( mParams.mSingleProducerConsumer )
+		{
+			Json.Push( Prefix + "RingFrameCount", static_cast<uint64>( mRing.GetSize() ) );
+			Json.Push( Prefix + "SortedFallbackCount", static_cast<uint64>( mSortedFallbackCount ) );
+		}
 	}
+	mPixelBufferPool.GetMeta( Prefix + "Pool", Json );
 	
 	Json.Push( (Prefix + "NextFrameTime").c_str(), GetArrayBridge(NextTimecodes) );
 }
@@ -2041,16 +2574,32 @@ void TPixelBufferManager::GetMeta(const std::string& Prefix,TJsonWriter& Json)
 
 SoyTime TPixelBufferManager::GetNextPixelBufferTime(bool Safe)
 {
-	if ( mFrames.empty() )
+	if ( mParams.mSingleProducerConsumer && !mSorted )
+	{
+		auto* Frame = mRing.Peek();
+		if ( Frame )
+			return Frame->mTimestamp;
+		
+		//	if we've switched in the meantime, the frame may be in mFrames
+		if ( !mSorted )
+			return SoyTime();
+	}
+	
+	if ( mFrames.IsEmpty() && mRing.IsEmpty() )
 		return SoyTime();
 	
 	if ( Safe )
 	{
 		std::lock_guard<std::mutex> Lock( mFrameLock );
+		MergeRing();
+		if ( mFrames.IsEmpty() )
+			return SoyTime();
 		return mFrames[0].mTimestamp;
 	}
 	else
 	{
+		if ( mFrames.IsEmpty() )
+			return SoyTime();
 		return mFrames[0].mTimestamp;
 	}
 }
@@ -2058,7 +2607,7 @@ SoyTime TPixelBufferManager::GetNextPixelBufferTime(bool Safe)
 bool TPixelBufferManager::IsPixelBufferFull() const
 {
 	//	gr: avoid a lock please! just have to assume number won't be corrupt
-	auto FrameCount = mFrames.size();
+	auto FrameCount = mFrames.GetSize() + mRing.GetSize();
 	
 	//	just in case number is corrupted due to [lack of] threadsafety
 	std::clamp<size_t>( FrameCount, 0, 100 );
@@ -2068,7 +2617,18 @@ bool TPixelBufferManager::IsPixelBufferFull() const
 
 bool TPixelBufferManager::PeekPixelBuffer(SoyTime Timestamp)
 {
-	if ( mFrames.empty() )
+	if ( mParams.mSingleProducerConsumer && !mSorted )
+	{
+		auto* Frame = mRing.Peek();
+		if ( Frame )
+			return Frame->mTimestamp <= Timestamp;
+		
+		//	if we've switched in the meantime, the frame may be in mFrames
+		if ( !mSorted )
+			return false;
+	}
+	
+	if ( mFrames.IsEmpty() && mRing.IsEmpty() )
 		return false;
 	
 	//	if the first is in the past, or now, then we have one, otherwise it's in the future and not ready to be popped
@@ -2077,8 +2637,13 @@ bool TPixelBufferManager::PeekPixelBuffer(SoyTime Timestamp)
 	if ( !mFrameLock.try_lock() )
 		return ContentionPeekResult;
 	
-	auto& NextFrameTime = mFrames[0].mTimestamp;
-	bool Result = NextFrameTime <= Timestamp;
+	MergeRing();
+	bool Result = false;
+	if ( !mFrames.IsEmpty() )
+	{
+		auto& NextFrameTime = mFrames[0].mTimestamp;
+		Result = NextFrameTime <= Timestamp;
+	}
 	
 	mFrameLock.unlock();
 	
@@ -2091,12 +2656,32 @@ std::shared_ptr<TPixelBuffer> TPixelBufferManager::PopPixelBuffer(SoyTime& Times
 	SoyTime RequestedTimestamp = Timestamp;
 	CorrectRequestedFrameTimestamp(RequestedTimestamp);
 
+	//	fast path, frames are in order
+	if ( mParams.mSingleProducerConsumer && !mSorted )
+	{
+		size_t PopCount = 0;
+		auto PeekFront = [this]	{	return mRing.Peek();	};
+		auto PopFront = [&]
+		{
+			TPixelBufferFrame Frame;
+			mRing.Pop( Frame );
+			PopCount++;
+		};
+		auto PixelBuffer = PopFrame( Timestamp, RequestedTimestamp, mRing.GetSize(), PeekFront, PopFront );
+		if ( PopCount > 0 )
+			OnRingPopped();
+		
+		//	if we've switched in the meantime, the frame may be in mFrames
+		if ( PixelBuffer || !mSorted )
+			return PixelBuffer;
+	}
+	
 	static bool AvoidLockContention = true;
 	
 	if ( AvoidLockContention )
 	{
 		//	pre-empty jump out to avoid lock contention
-		if ( mFrames.empty() )
+		if ( mFrames.IsEmpty() && mRing.IsEmpty() )
 			return nullptr;
 	}
 	
@@ -2111,18 +2696,39 @@ std::shared_ptr<TPixelBuffer> TPixelBufferManager::PopPixelBuffer(SoyTime& Times
 		mFrameLock.lock();
 	}
 	
-	Soy::TScopeCall AutoUnlock( nullptr, [&]{	mFrameLock.unlock();	} );
+	MergeRing();
+	
+	//	wake a push waiting for space if we popped anything
+	auto InitialFrameCount = mFrames.GetSize();
+	auto OnUnlock = [&]
+	{
+		if ( mFrames.GetSize() < InitialFrameCount )
+			mFramesPoppedConditional.notify_all();
+		
+		//	drained, back to the lock-free ring. Anything the producer pushes from now on is after everything we've popped
+		if ( mParams.mSingleProducerConsumer && mFrames.IsEmpty() )
+			mSorted = false;
+		mFrameLock.unlock();
+	};
+	Soy::TScopeCall AutoUnlock( nullptr, OnUnlock );
+
+	auto PeekFront = [this]	{	return mFrames.IsEmpty() ? nullptr : &mFrames[0];	};
+	auto PopFront = [this]	{	mFrames.PopFront();	};
+	return PopFrame( Timestamp, RequestedTimestamp, mFrames.GetSize(), PeekFront, PopFront );
+}
 
+std::shared_ptr<TPixelBuffer> TPixelBufferManager::PopFrame(SoyTime& Timestamp,const SoyTime& RequestedTimestamp,size_t FrameCount,std::function<TPixelBufferFrame*()> PeekFront,std::function<void()> PopFront)
+{
 	//	require buffering of N frames
 	//	gr: this may need to be more intelligent to skip over frames in the past still....
 	auto MinBufferSize = GetMinBufferSize();
 	if ( MinBufferSize > 0 )
 	{
-		if ( mFrames.size() < MinBufferSize )
+		if ( FrameCount < MinBufferSize )
 		{
 			static bool DebugMinBufferSize = false;
 			if ( DebugMinBufferSize )
-				std::Debug << "Waiting for " << (MinBufferSize-mFrames.size()) << " more frames to buffer..." << std::endl;
+				std::Debug << "Waiting for " << (MinBufferSize-FrameCount) << " more frames to buffer..." << std::endl;
 			return nullptr;
 		}
 	}
@@ -2130,29 +2736,27 @@ std::shared_ptr<TPixelBuffer> TPixelBufferManager::PopPixelBuffer(SoyTime& Times
 	//	not synchronised, just grab next frame
 	if ( !mParams.mPopFrameSync )
 	{
-		if ( mFrames.empty() )
+		auto* Frame = PeekFront();
+		if ( !Frame )
 		{
 			return nullptr;
 		}
 
-		auto& Frame = *mFrames.begin();
-		Timestamp = Frame.mTimestamp;
-		std::shared_ptr<TPixelBuffer> LastPixelBuffer = Frame.mPixels;
-		mFrames.erase( mFrames.begin() );
+		Timestamp.mTime = Frame->mTimestamp.mTime;
+		std::shared_ptr<TPixelBuffer> LastPixelBuffer = Frame->mPixels;
+		PopFront();
 		return LastPixelBuffer;
 	}
 	
 	BufferArray<SoyTime,100> FramesSkipped;
 	std::shared_ptr<TPixelBuffer> LastPixelBuffer;
-	for ( auto it=mFrames.begin();	it!=mFrames.end();	)
+	while ( auto* Frame = PeekFront() )
 	{
-		auto& Frame = *it;
-		
 		if ( mParams.mPopNearestFrame && LastPixelBuffer )
 		{
 			//	if this frame is further away than the currently found one, abort
 			auto OldDiff = Timestamp.GetDiff( RequestedTimestamp );
-			auto NewDiff = Frame.mTimestamp.GetDiff( RequestedTimestamp );
+			auto NewDiff = Frame->mTimestamp.GetDiff( RequestedTimestamp );
 			if ( labs(NewDiff) > labs(OldDiff) )
 				break;
 		}
@@ -2160,21 +2764,19 @@ std::shared_ptr<TPixelBuffer> TPixelBufferManager::PopPixelBuffer(SoyTime& Times
 		{
 			//	first frame in the buffer is ahead. don't pop it otherwise we'll just eat through the buffer				
 			//	future frame, stop looking
-			if ( Frame.mTimestamp > RequestedTimestamp )
+			if ( Frame->mTimestamp > RequestedTimestamp )
 				break;
 		}
 		
-		//	in the past, pop this
-		LastPixelBuffer = Frame.mPixels;
-		Timestamp = Frame.mTimestamp;
-		FramesSkipped.PushBack( Frame.mTimestamp );
-		it = mFrames.erase( it );
+		//	in the past, pop this, which skips the one we were going to return
+		//	gr: deep buffers can skip more than we report
+		if ( LastPixelBuffer && !FramesSkipped.IsFull() )
+			FramesSkipped.PushBack( Timestamp );
+		LastPixelBuffer = Frame->mPixels;
+		Timestamp.mTime = Frame->mTimestamp.mTime;
+		PopFront();
 	}
-
-	//	gr: last frame, wasn't skipped, it was returned!
-	if ( !FramesSkipped.IsEmpty() )
-		FramesSkipped.PopBack();
-
+	
 	//	gr: make sure this doesn't cause a deadlock as the mFrameLock is now released AFTER this
 	//	must have skipped a frame, report it
 	if ( !FramesSkipped.IsEmpty() )
@@ -2183,9 +2785,32 @@ std::shared_ptr<TPixelBuffer> TPixelBufferManager::PopPixelBuffer(SoyTime& Times
 	return LastPixelBuffer;
 }
 
-bool ComparePixelBuffers(const TPixelBufferFrame& a,const TPixelBufferFrame& b)
+void TPixelBufferManager::MergeRing()
+{
+	if ( !mParams.mSingleProducerConsumer )
+		return;
+	
+	TPixelBufferFrame Frame;
+	while ( mRing.Pop( Frame ) )
+	{
+		if ( !mRingFlushed )
+			mFrames.Insert( Frame );
+	}
+	mRingFlushed = false;
+}
+
+void TPixelBufferManager::OnRingPopped()
 {
-	return a.mTimestamp < b.mTimestamp;
+	//	pairs with the fence in PushPixelBuffer; either we see the push is blocked, or it sees our pop when it checks for space
+	std::atomic_thread_fence( std::memory_order_seq_cst );
+	if ( !mPushBlocked )
+		return;
+	
+	//	take the lock so the notify can't land between the push checking for space and it starting to wait
+	{
+		std::lock_guard<std::mutex> Lock( mFrameLock );
+	}
+	mFramesPoppedConditional.notify_all();
 }
 
 bool TPixelBufferManager::PrePushBuffer(SoyTime Timestamp)
@@ -2213,37 +2838,89 @@ bool TPixelBufferManager::PushPixelBuffer(TPixelBufferFrame& PixelBuffer,std::fu
 		PixelBuffer.mTimestamp.mTime = 1;
 	}
 	
-	do
+	//	fast path; in order and there's space, straight into the ring without locking
+	if ( mParams.mSingleProducerConsumer && PushRingFrame( PixelBuffer ) )
 	{
+		mOnFramePushed.OnTriggered( PixelBuffer.mTimestamp );
+		return true;
+	}
+	
+	{
+		std::unique_lock<std::mutex> Lock( mFrameLock );
+		
 		//	wait for frames to be popped
-		if ( mFrames.size() >= std::max<size_t>(mParams.mMaxBufferSize,1) )
+		auto MaxBufferSize = std::max<size_t>( mParams.mMaxBufferSize, 1 );
+		auto HasSpace = [&]	{	return mFrames.GetSize() + mRing.GetSize() < MaxBufferSize;	};
+		if ( mParams.mDebugFrameSkipping && !HasSpace() )
+			std::Debug << "Frame buffer full... (" << mFrames.GetSize() << ") " << std::endl;
+		
+		auto Timeout = std::chrono::milliseconds( std::max<size_t>( mParams.mPushBlockTimeoutMs, 1 ) );
+		mPushBlocked = true;
+		//	make sure the consumer sees we're blocked before we check for space (which a lock-free pop won't change with the lock)
+		std::atomic_thread_fence( std::memory_order_seq_cst );
+		bool Pushable = SoyMediaBufferWait::WaitForSpace( Lock, mFramesPoppedConditional, HasSpace, Block, Timeout, mPushWaitMetrics );
+		mPushBlocked = false;
+		if ( !Pushable )
 		{
-			if ( mParams.mDebugFrameSkipping )
-				std::Debug << "Frame buffer full... (" << mFrames.size() << ") " << std::endl;
-			
-			if ( !Block )
-				break;
-			
-			auto PauseMs = mParams.mPushBlockSleepMs * mFrames.size();
-			if ( mParams.mDebugFrameSkipping )
-				std::Debug << __func__ << " pausing for " << PauseMs << "ms" << std::endl;
-			std::this_thread::sleep_for( std::chrono::milliseconds(PauseMs) );
-			continue;
+			Lock.unlock();
+			mOnFramePushFailed.OnTriggered( PixelBuffer.mTimestamp );
+			return false;
 		}
 		
-		mFrameLock.lock();
-		mFrames.push_back( PixelBuffer );
-		std::sort( mFrames.begin(), mFrames.end(), ComparePixelBuffers );
-		mFrameLock.unlock();
-		
-		mOnFramePushed.OnTriggered( PixelBuffer.mTimestamp );
-		return true;
+		//	the consumer may have drained mFrames and gone back to the ring while we waited. A flush can't happen while we have the lock
+		bool InOrder = !( PixelBuffer.mTimestamp < mLastPushedTimestamp );
+		if ( mParams.mSingleProducerConsumer && !mSorted && InOrder && mRing.Push( PixelBuffer ) )
+		{
+			mLastPushedTimestamp.mTime = PixelBuffer.mTimestamp.mTime;
+		}
+		else
+		{
+			if ( mParams.mSingleProducerConsumer && !mSorted )
+			{
+				mSorted = true;
+				mSortedFallbackCount++;
+			}
+			mFrames.Insert( PixelBuffer );
+			mLastPushedTimestamp.mTime = std::max( mLastPushedTimestamp.mTime, PixelBuffer.mTimestamp.mTime );
+		}
 	}
-	while ( Block() );
 	
-	mOnFramePushFailed.OnTriggered( PixelBuffer.mTimestamp );
+	mOnFramePushed.OnTriggered( PixelBuffer.mTimestamp );
+	return true;
+}
+
+bool TPixelBufferManager::PushRingFrame(const TPixelBufferFrame& Frame)
+{
+	//	a flush switches to sorted and then waits for us to leave, so either we see the switch here, or it waits for this frame to be in the ring (where MergeRing() drops it)
+	mRingPushInFlight = true;
 	
-	return false;
+	bool Pushed = false;
+	//	while unsorted, mFrames is empty so the ring is everything. Out of order needs sorting
+	auto MaxBufferSize = std::max<size_t>( mParams.mMaxBufferSize, 1 );
+	bool InOrder = !( Frame.mTimestamp < mLastPushedTimestamp );
+	if ( !mSorted && InOrder && mRing.GetSize() < MaxBufferSize && mRing.Push( Frame ) )
+	{
+		mLastPushedTimestamp.mTime = Frame.mTimestamp.mTime;
+		Pushed = true;
+	}
+	
+	mRingPushInFlight = false;
+	return Pushed;
+}
+
+void TPixelBufferManager::FlushRing()
+{
+	if ( !mParams.mSingleProducerConsumer )
+		return;
+	
+	//	switch the producer off the ring before touching its state
+	mSorted = true;
+	while ( mRingPushInFlight )
+		std::this_thread::yield();
+	
+	//	we can't pop the ring from here, so have the consumer drop it on its next pop
+	mRingFlushed = true;
+	mLastPushedTimestamp.mTime = 0;
 }
 
 
@@ -2251,16 +2928,11 @@ bool TPixelBufferManager::PushPixelBuffer(TPixelBufferFrame& PixelBuffer,std::fu
 void TPixelBufferManager::ReleaseFrames()
 {
 	//	free up frames
+	//	gr: any frames in here shouldn't be locked/in use as they should have been popped before use
 	mFrameLock.lock();
-	//	erroenous loop, just here for debugging
-	for ( auto it=mFrames.begin();	it!=mFrames.end();	)
-	{
-		//	gr: any frames in here shouldn't be locked/in use as they should have been popped before use
-		auto& Frame = *it;
-		Frame.mPixels.reset();
-		it = mFrames.erase(it);
-	}
-	mFrames.clear();
+	FlushRing();
+	mFrames.Clear();
+	mFramesPoppedConditional.notify_all();
 	mFrameLock.unlock();
 }
 
@@ -2268,22 +2940,11 @@ void TPixelBufferManager::ReleaseFrames()
 void TPixelBufferManager::ReleaseFramesAfter(SoyTime FlushTime)
 {
 	//	free up frames
+	//	gr: should we ditch super-old frames too? (keep Frame.mTimestamp < FlushTime)
 	mFrameLock.lock();
-
-	for ( auto it=mFrames.begin();	it!=mFrames.end();	)
-	{
-		auto& Frame = *it;
-
-		/*
-		if ( Frame.mTimestamp < FlushTime )	//	gr: should we ditch super-old frames too?
-		{
-			it++;
-			continue;
-		}
-		*/
-		Frame.mPixels.reset();
-		it = mFrames.erase(it);
-	}
+	FlushRing();
+	mFrames.Clear();
+	mFramesPoppedConditional.notify_all();
 	mFrameLock.unlock();
 }
 
@@ -2354,7 +3015,7 @@ void TMediaPassThroughEncoder::Write(std::shared_ptr<SoyPixelsImpl> pImage,SoyTi
 	Soy::Assert( pImage!=nullptr, "Image expected");
 	auto& Image = *pImage;
 	
-	std::shared_ptr<TMediaPacket> pPacket( new TMediaPacket() );
+	auto pPacket = mPacketPool.Alloc();
 	auto& Packet = *pPacket;
 	
 	auto& PixelsArray = Image.GetPixelsArray();
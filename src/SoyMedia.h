@@ -4,6 +4,7 @@
 #include "SoyThread.h"
 #include "SoyMediaFormat.h"
 #include "SoyH264.h"
+#include "SoyRingArray.h"
 
 class TStreamWriter;
 class TStreamBuffer;
@@ -63,35 +64,42 @@ namespace SoyMedia
 class Soy::TYuvParams
 {
 private:
-	TYuvParams(float LumaMin,float LumaMax,float ChromaVRed,float ChromaUGreen,float ChromaVGreen,float ChromaUBlue) :
+	TYuvParams(float LumaMin,float LumaMax,float ChromaVRed,float ChromaUGreen,float ChromaVGreen,float ChromaUBlue,SoyYuvMatrix::Type Matrix) :
 	mLumaMin		( LumaMin ),
 	mLumaMax		( LumaMax ),
 	mChromaVRed		( ChromaVRed ),
 	mChromaUGreen	( ChromaUGreen ),
 	mChromaVGreen	( ChromaVGreen ),
-	mChromaUBlue	( ChromaUBlue )
+	mChromaUBlue	( ChromaUBlue ),
+	mMatrix			( Matrix )
 	{
 	}
 public:
-	static TYuvParams	Video()
+	static TYuvParams	Video(SoyYuvMatrix::Type Matrix=SoyYuvMatrix::Bt601)
 	{
 		float LumaMin = 16.0/255.0;
 		float LumaMax = 253.0/255.0;
+		if ( Matrix == SoyYuvMatrix::Bt709 )
+			return TYuvParams( LumaMin, LumaMax, 1.7927, -0.21325, -0.53291, 2.1124, Matrix );
+
 		float ChromaVRed = 1.5958;
 		float ChromaUGreen = -0.39173;
 		float ChromaVGreen = -0.81290;
 		float ChromaUBlue = 2.017;
-		return TYuvParams( LumaMin, LumaMax, ChromaVRed, ChromaUGreen, ChromaVGreen, ChromaUBlue );
+		return TYuvParams( LumaMin, LumaMax, ChromaVRed, ChromaUGreen, ChromaVGreen, ChromaUBlue, Matrix );
 	}
-	static TYuvParams	Full()
+	static TYuvParams	Full(SoyYuvMatrix::Type Matrix=SoyYuvMatrix::Bt601)
 	{
 		float LumaMin = 0;
 		float LumaMax = 1;
+		if ( Matrix == SoyYuvMatrix::Bt709 )
+			return TYuvParams( LumaMin, LumaMax, 1.5748, -0.18733, -0.46812, 1.8556, Matrix );
+		
 		float ChromaVRed = 1.4;
 		float ChromaUGreen = -0.343;
 		float ChromaVGreen = -0.711;
 		float ChromaUBlue = 1.765;
-		return TYuvParams( LumaMin, LumaMax, ChromaVRed, ChromaUGreen, ChromaVGreen, ChromaUBlue );
+		return TYuvParams( LumaMin, LumaMax, ChromaVRed, ChromaUGreen, ChromaVGreen, ChromaUBlue, Matrix );
 	}
 	
 	float	mLumaMin;
@@ -100,6 +108,7 @@ public:
 	float	mChromaUGreen;
 	float	mChromaVGreen;
 	float	mChromaUBlue;
+	SoyYuvMatrix::Type	mMatrix;	//	pass to SoyPixelsImpl::SetFormat for cpu conversion
 };
 
 
@@ -204,6 +213,7 @@ public:
 		mOverrideTransformShaderMetal		( nullptr )
 	{
 	}
+	virtual ~TPixelBuffer()	{}
 	
 	//	different paths return arrays now - shader/fbo blit is pretty generic now so move it out of pixel buffer
 	//	generic array, handle that internally (each implementation tends to have it's own lock info anyway)
@@ -228,6 +238,9 @@ public:
 
 class TPixelBufferFrame
 {
+public:
+	bool							operator<(const TPixelBufferFrame& That) const	{	return mTimestamp < That.mTimestamp;	}
+	
 public:
 	std::shared_ptr<TPixelBuffer>	mPixels;
 	SoyTime							mTimestamp;
@@ -243,15 +256,18 @@ public:
 		mAllowPushRejection		( true ),
 		mDebugFrameSkipping		( false ),
 		mPushBlockSleepMs		( 3 ),
+		mPushBlockTimeoutMs		( 100 ),
 		mMaxBufferSize			( 10 ),
 		mMinBufferSize			( 5 ),			//	specific per-codec for OOO packets, not applicable to a lot of other things (audio may want it, text etc)
 		mPopNearestFrame		( false ),
+		mSingleProducerConsumer	( false ),
 		mAudioSampleRate		( 0 ),			//	try and decode to this audio sample rate
 		mAudioChannelCount		( 0 )
 	{
 	}
 	
-	size_t		mPushBlockSleepMs;
+	size_t		mPushBlockSleepMs;			//	gr: blocked pushes used to sleep this long per buffered frame. They now wait for a pop instead, so this isn't used
+	size_t		mPushBlockTimeoutMs;		//	a push blocked on a full buffer wakes as soon as a frame is popped, this is how often it re-checks Block() in case it should give up
 	bool		mDebugFrameSkipping;
 	size_t		mMinBufferSize;				//	require X frames to be buffered before letting any be popped, this is to cope with OOO decoding. This may need to go up with different codecs (KBBBBI vs KBI)
 	size_t		mMaxBufferSize;				//	restrict mem/platform buffer usage (platform buffers should probably be managed explicitly if there are limits)
@@ -259,6 +275,7 @@ public:
 	bool		mPopFrameSync;				//	false to pop ASAP (out of sync)
 	bool		mPopNearestFrame;			//	instead of skipping to the latest frame (<= now), we find the nearest frame (98 will pop frame 99) and allow looking ahead
 	bool		mAllowPushRejection;		//	early frame rejection
+	bool		mSingleProducerConsumer;	//	pixel buffers: one thread pushes and one thread pops, peeks & gets the next time, so in-order frames can go through a lock-free ring
 	size_t		mAudioSampleRate;
 	size_t		mAudioChannelCount;
 };
@@ -320,6 +337,45 @@ public:
 };
 
 
+//	recycles pixel buffers (and their pixel storage) for the same meta once the last reference to a frame is dropped,
+//	so steady-state decoding isn't allocating a new frame every time
+class TPixelBufferPool
+{
+public:
+	TPixelBufferPool(size_t MaxFreeBuffers=10);
+	
+	std::shared_ptr<TDumbPixelBuffer>	Alloc(const SoyPixelsMeta& Meta);	//	contents are undefined
+	void								GetMeta(const std::string& Prefix,TJsonWriter& Json) const;
+	
+private:
+	class TFreeList;
+	std::shared_ptr<TFreeList>			mFreeList;	//	shared with the outstanding buffers so they can still be released after the pool has gone
+};
+
+
+
+//	how long pushes have spent blocked on a full buffer. Update & read with the buffer's lock held
+class TMediaBufferWaitMetrics
+{
+public:
+	TMediaBufferWaitMetrics() :
+		mWaitCount			( 0 ),
+		mWaitCancelledCount	( 0 ),
+		mWaitTotal			( 0 ),
+		mWaitMax			( 0 )
+	{
+	}
+	
+	void						OnWaited(std::chrono::microseconds Duration,bool Cancelled);
+	void						GetMeta(const std::string& Prefix,TJsonWriter& Json) const;
+	
+public:
+	size_t						mWaitCount;				//	pushes that found the buffer full
+	size_t						mWaitCancelledCount;	//	pushes that gave up (Block() returned false) and dropped their frame
+	std::chrono::microseconds	mWaitTotal;
+	std::chrono::microseconds	mWaitMax;
+};
+
 
 //	gr: I want to merge these pixel & audio types into the TPacketMediaBuffer type
 class TMediaBufferManager
@@ -377,7 +433,13 @@ class TPixelBufferManager : public TMediaBufferManager
 {
 public:
 	TPixelBufferManager(const TPixelBufferParams& Params) :
-		TMediaBufferManager	( Params )
+		TMediaBufferManager		( Params ),
+		mRing					( Params.mSingleProducerConsumer ? std::max<size_t>( Params.mMaxBufferSize, 1 ) : 0 ),
+		mSorted					( !Params.mSingleProducerConsumer ),
+		mPushBlocked			( false ),
+		mRingPushInFlight		( false ),
+		mRingFlushed			( false ),
+		mSortedFallbackCount	( 0 )
 	{
 	}
 	
@@ -390,14 +452,35 @@ public:
 	virtual bool		PrePushBuffer(SoyTime Timestamp) override;
 	bool				PeekPixelBuffer(SoyTime Timestamp);	//	is there a new pixel buffer?
 	bool				IsPixelBufferFull() const;
+	void				WakeBlockedPush()	{	mFramesPoppedConditional.notify_all();	}	//	make a blocked push re-check Block() now, rather than at the next timeout
+	std::shared_ptr<TDumbPixelBuffer>	AllocPixelBuffer(const SoyPixelsMeta& Meta)	{	return mPixelBufferPool.Alloc( Meta );	}	//	decoders producing pixels should allocate their frames here
 
 	virtual void		ReleaseFrames() override;
 	virtual void		ReleaseFramesAfter(SoyTime FlushTime) override;
 	
+private:
+	std::shared_ptr<TPixelBuffer>	PopFrame(SoyTime& Timestamp,const SoyTime& RequestedTimestamp,size_t FrameCount,std::function<TPixelBufferFrame*()> PeekFront,std::function<void()> PopFront);	//	pops up to the frame for RequestedTimestamp
+	bool				PushRingFrame(const TPixelBufferFrame& Frame);	//	producer, lock-free. false if it needs the locked push
+	void				MergeRing();			//	consumer, with mFrameLock held. moves the ring into mFrames
+	void				OnRingPopped();			//	consumer, wakes a blocked push after a lock-free pop
+	void				FlushRing();			//	with mFrameLock held, switches the producer off the ring and has the consumer drop it
 	
 private:
 	std::mutex						mFrameLock;
-	std::vector<TPixelBufferFrame>	mFrames;
+	std::condition_variable			mFramesPoppedConditional;
+	TSortedRingArray<TPixelBufferFrame,std::less<TPixelBufferFrame>>	mFrames;	//	frames mostly arrive in order so inserts are at (or near) the back, pops are from the front
+	TMediaBufferWaitMetrics			mPushWaitMetrics;
+	TPixelBufferPool				mPixelBufferPool;
+	
+	//	in single producer/consumer mode, frames arriving in timestamp order go through the ring, so the decoder never holds the lock the renderer try_lock's.
+	//	an out of order frame (or a flush) switches to the locked mFrames (the consumer merges the ring into it) until it drains
+	TSpscRingArray<TPixelBufferFrame>	mRing;
+	std::atomic<bool>				mSorted;				//	frames are going into mFrames. only set/cleared with mFrameLock held
+	std::atomic<bool>				mPushBlocked;			//	a push is waiting for space, so a lock-free pop has to notify
+	std::atomic<bool>				mRingPushInFlight;		//	producer is in PushRingFrame(), a flush waits for it to finish
+	bool							mRingFlushed;			//	with mFrameLock, the consumer drops the ring when it next merges
+	SoyTime							mLastPushedTimestamp;	//	producer only, except a flush resets it once the producer is out of PushRingFrame()
+	size_t							mSortedFallbackCount;
 };
 
 
@@ -547,15 +630,40 @@ public:
 std::ostream& operator<<(std::ostream& out,const TMediaPacket& in);
 
 
+//	recycles packets (and the capacity of their data) once the last owner (usually the decoder) lets go, rather than
+//	allocating a packet and growing its data from scratch for every frame
+class TMediaPacketPool
+{
+public:
+	TMediaPacketPool(size_t MaxFreePackets=32);
+	
+	std::shared_ptr<TMediaPacket>	Alloc();
+	void							GetMeta(const std::string& Prefix,TJsonWriter& Json) const;
+	
+private:
+	class TFreeList;
+	std::shared_ptr<TFreeList>		mFreeList;	//	shared with the outstanding packets so they can still be released after the pool has gone
+};
+
+
 
 //	abstracted so later we can handle multiple streams at once as seperate buffers
 class TMediaPacketBuffer
 {
 public:
-	TMediaPacketBuffer(size_t MaxBufferSize=10) :
+	//	SingleProducerConsumer: only one thread pushes and only one thread pops (& unpops), so in-order packets can go through a lock-free ring
+	TMediaPacketBuffer(size_t MaxBufferSize=10,bool SingleProducerConsumer=false) :
 		mPackets				( SoyMedia::GetDefaultHeap() ),
 		mMaxBufferSize			( MaxBufferSize ),
-		mAutoTimestampDuration	( std::chrono::milliseconds(33) )
+		mAutoTimestampDuration	( std::chrono::milliseconds(33) ),
+		mPushBlockTimeout		( std::chrono::milliseconds(100) ),
+		mSingleProducerConsumer	( SingleProducerConsumer ),
+		mRing					( SingleProducerConsumer ? MaxBufferSize : 0 ),
+		mSorted					( !SingleProducerConsumer ),
+		mPushBlocked			( false ),
+		mRingPushInFlight		( false ),
+		mHasUnPoppedPacket		( false ),
+		mSortedFallbackCount	( 0 )
 	{
 	}
 	~TMediaPacketBuffer();
@@ -566,8 +674,10 @@ public:
 	std::shared_ptr<TMediaPacket>	PopPacket();
 	void							UnPopPacket(std::shared_ptr<TMediaPacket> Packet);		//	gr: force a packet back into the buffer at the start; todo; enforce a decoder timestamp and just use push(but with a forced re-insertion)
 	void							PushPacket(std::shared_ptr<TMediaPacket> Packet,std::function<bool()> Block);
-	bool							HasPackets() const		{	return !mPackets.IsEmpty();	}
-	size_t							GetPacketCount() const	{	return mPackets.GetSize();	}
+	bool							HasPackets() const		{	return GetPacketCount() > 0;	}
+	size_t							GetPacketCount() const;
+	void							WakeBlockedPush()		{	mPacketsPoppedConditional.notify_all();	}	//	make a blocked push re-check Block() now, rather than at the next timeout
+	void							GetMeta(const std::string& Prefix,TJsonWriter& Json);
 
 	void							FlushFrames(SoyTime FlushTime);
 	virtual bool					PrePushBuffer(SoyTime Timestamp);
@@ -575,6 +685,14 @@ public:
 protected:
 	virtual void					ReleaseFramesAfter(SoyTime FlushTime);
 	void							CorrectIncomingPacketTimecode(TMediaPacket& Packet);
+	
+private:
+	void							PushSortedPacket(std::shared_ptr<TMediaPacket>& Packet);	//	mPacketsLock must be held
+	void							MergeRing();				//	consumer, with mPacketsLock held. moves the ring into the sorted packets
+	void							OnRingPopped();				//	consumer, wakes a blocked push after a lock-free pop
+	bool							PushRingPacket(std::shared_ptr<TMediaPacket>& Packet);	//	producer, lock-free. false if it needs the locked push
+	size_t							GetPacketCountLocked() const;	//	mPacketsLock must be held
+	size_t							GetRingPacketCount() const;		//	lock-free, ring & unpopped packet only
 
 public:
 	SoyEvent<std::shared_ptr<TMediaPacket>>	mOnNewPacket;
@@ -584,11 +702,27 @@ private:
 	//	gr: but it also needs to be sorted!
 	size_t									mMaxBufferSize;
 	Array<std::shared_ptr<TMediaPacket>>	mPackets;
-	std::mutex								mPacketsLock;
+	mutable std::mutex						mPacketsLock;
+	std::condition_variable					mPacketsPoppedConditional;
+	TMediaBufferWaitMetrics					mPushWaitMetrics;
 
 	SoyTime									mLastPacketTimestamp;	//	for when we have to calculate timecodes ourselves
 	SoyTime									mAutoTimestampDuration;
 	SoyTime									mFlushFenceTime;		//	if valid, don't allow frames over this, post-seek. Resets when we get a packet under
+	SoyTime									mPushBlockTimeout;		//	how often a blocked push re-checks Block()
+
+	//	in single producer/consumer mode, packets arriving in decode order go through the ring without locking.
+	//	an out of order packet (or a flush) switches to the locked, sorted mPackets (the consumer merges the ring into it) until it drains
+	bool									mSingleProducerConsumer;
+	TSpscRingArray<std::shared_ptr<TMediaPacket>>	mRing;
+	std::atomic<bool>						mSorted;				//	packets are going into mPackets. only set/cleared with mPacketsLock held
+	std::atomic<bool>						mPushBlocked;			//	a push is waiting for space, so a lock-free pop has to notify
+	std::atomic<bool>						mRingPushInFlight;		//	producer is in PushRingPacket(), a flush waits for it to finish
+	std::shared_ptr<TMediaPacket>			mUnPoppedPacket;		//	consumer only
+	std::atomic<bool>						mHasUnPoppedPacket;		//	so other threads can count mUnPoppedPacket
+	SoyTime									mLastPushedDecodeTimecode;	//	producer only, except a flush resets it once the producer is out of PushRingPacket()
+	SoyTime									mRingFlushTime;			//	if valid, the consumer drops ring packets after this when it merges
+	size_t									mSortedFallbackCount;
 };
 
 
@@ -732,6 +866,8 @@ public:
 	TMediaExtractor(const TMediaExtractorParams& Params,size_t RunAtFrameRate=0);
 	~TMediaExtractor();
 	
+	virtual void					Stop() override;		//	also wakes a push blocked on a full stream buffer
+	
 	void							Seek(SoyTime Time,const std::function<void(SoyTime)>& FlushFrames);				//	keep calling this, controls the packet read-ahead
 	virtual void					FlushFrames(SoyTime FlushTime);
 	
@@ -749,6 +885,7 @@ public:
 	
 	std::shared_ptr<TMediaPacketBuffer>	AllocStreamBuffer(size_t StreamIndex,size_t MaxBufferSize=10);
 	std::shared_ptr<TMediaPacketBuffer>	GetStreamBuffer(size_t StreamIndex);
+	std::shared_ptr<TMediaPacket>		AllocPacket()				{	return mPacketPool.Alloc();	}	//	use this in ReadNextPacket to reuse released packets
 
 public:
 //protected:	//	gr: only for subclasses, but the playlist media extractor needs to call this on it's children
@@ -790,6 +927,7 @@ public:
 protected:
 	std::map<size_t,std::shared_ptr<TMediaPacketBuffer>>	mStreamBuffers;
 	std::function<void(const SoyTime,size_t)>				mOnPacketExtracted;
+	TMediaPacketPool										mPacketPool;
 	
 private:
 	std::string						mFatalError;
@@ -812,6 +950,8 @@ public:
 	TMediaDecoder(const std::string& ThreadName,std::shared_ptr<TMediaPacketBuffer>& InputBuffer,std::shared_ptr<TTextBufferManager> OutputBuffer);
 	virtual ~TMediaDecoder();
 	
+	virtual void					Stop() override;		//	also wakes a push blocked on a full output buffer
+	
 	bool							HasFatalError(std::string& Error)
 	{
 		Error += mFatalError.str();
@@ -914,6 +1054,7 @@ public:
 protected:
 	std::shared_ptr<TMediaPacketBuffer>	mOutput;
 	std::stringstream					mFatalError;
+	TMediaPacketPool					mPacketPool;
 };
 
 
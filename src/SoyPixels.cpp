@@ -7,6 +7,15 @@
 #include "SoyMath.h"
 #include "SoyStream.h"
 #include "SoyImage.h"
+#include "SoySimd.h"
+#include "SoyThread.h"
+
+#if defined(SOY_SIMD_SSE2)
+#include <emmintrin.h>
+#endif
+#if defined(SOY_SIMD_AVX2)
+#include <immintrin.h>
+#endif
 
 
 /// Maximum value that a uint16_t pixel will take on in the buffer of any of the FREENECT_DEPTH_MM or FREENECT_DEPTH_REGISTERED frame callbacks
@@ -77,6 +86,244 @@ prmem::Heap& SoyPixels::GetDefaultHeap()
 	static auto* Heap = new prmem::Heap( true, true, "SoyPixels::DefaultHeap" );
 	return *Heap;
 }
+
+
+namespace SoyPixelsParallel
+{
+	class TThreadPool;
+	class TWorkerThread;
+	
+	TThreadPool&				GetPool();
+	std::mutex					gParamsLock;
+	TSoyPixelsParallelParams	gParams;
+}
+
+
+//	all threads flush the same job queue
+class SoyPixelsParallel::TThreadPool : public PopWorker::TJobQueue, public PopWorker::TContext
+{
+public:
+	TThreadPool(size_t ThreadCount);
+	~TThreadPool();
+	
+	virtual bool	IsLocked(std::thread::id Thread) override;	//	stops pool threads queuing (and waiting on) jobs for themselves
+	virtual void	Lock() override		{}
+	virtual void	Unlock() override	{}
+	
+	void			OnThreadStarted();
+	bool			WaitForJobs();		//	returns false when shutting down
+	
+private:
+	std::mutex						mWakeLock;
+	std::condition_variable			mWakeConditional;
+	bool							mRunning;
+	Array<std::thread::id>			mThreadIds;
+	Array<std::shared_ptr<TWorkerThread>>	mThreads;
+};
+
+
+class SoyPixelsParallel::TWorkerThread : public SoyThread
+{
+public:
+	TWorkerThread(const std::string& Name,TThreadPool& Pool) :
+		SoyThread	( Name ),
+		mPool		( Pool ),
+		mStarted	( false )
+	{
+		Start();
+	}
+	
+protected:
+	virtual void	Thread() override
+	{
+		if ( !mStarted )
+		{
+			mPool.OnThreadStarted();
+			mStarted = true;
+		}
+		
+		if ( mPool.WaitForJobs() )
+			mPool.Flush( mPool );
+	}
+	
+private:
+	TThreadPool&	mPool;
+	bool			mStarted;
+};
+
+
+SoyPixelsParallel::TThreadPool::TThreadPool(size_t ThreadCount) :
+	mRunning	( true )
+{
+	//	gr: pushing a job doesn't hold the wake lock, so lock & notify afterwards so a thread about to wait doesn't miss it
+	mOnJobPushed = [this](std::shared_ptr<PopWorker::TJob>&)
+	{
+		std::lock_guard<std::mutex> Lock( mWakeLock );
+		mWakeConditional.notify_one();
+	};
+	
+	for ( size_t t=0;	t<ThreadCount;	t++ )
+	{
+		std::stringstream Name;
+		Name << "SoyPixels worker " << t;
+		mThreads.PushBack( std::make_shared<TWorkerThread>( Name.str(), *this ) );
+	}
+}
+
+
+SoyPixelsParallel::TThreadPool::~TThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> Lock( mWakeLock );
+		mRunning = false;
+		mWakeConditional.notify_all();
+	}
+	
+	for ( size_t t=0;	t<mThreads.GetSize();	t++ )
+		mThreads[t]->Stop( true );
+	mThreads.Clear();
+}
+
+
+void SoyPixelsParallel::TThreadPool::OnThreadStarted()
+{
+	std::lock_guard<std::mutex> Lock( mWakeLock );
+	mThreadIds.PushBack( std::this_thread::get_id() );
+}
+
+
+bool SoyPixelsParallel::TThreadPool::IsLocked(std::thread::id Thread)
+{
+	std::lock_guard<std::mutex> Lock( mWakeLock );
+	return mThreadIds.Find( Thread ) != nullptr;
+}
+
+
+bool SoyPixelsParallel::TThreadPool::WaitForJobs()
+{
+	std::unique_lock<std::mutex> Lock( mWakeLock );
+	mWakeConditional.wait( Lock, [this]	{	return !mRunning || HasJobs();	} );
+	return mRunning;
+}
+
+
+SoyPixelsParallel::TThreadPool& SoyPixelsParallel::GetPool()
+{
+	//	calling thread does a band too, but always have one worker so a forced mMaxTasks can't stall on a single core
+	static TThreadPool* Pool = new TThreadPool( std::max<size_t>( 2, std::thread::hardware_concurrency() ) - 1 );
+	return *Pool;
+}
+
+
+void SoyPixelsParallel::SetParams(const TSoyPixelsParallelParams& Params)
+{
+	std::lock_guard<std::mutex> Lock( gParamsLock );
+	gParams = Params;
+}
+
+
+TSoyPixelsParallelParams SoyPixelsParallel::GetParams()
+{
+	std::lock_guard<std::mutex> Lock( gParamsLock );
+	return gParams;
+}
+
+
+size_t SoyPixelsParallel::GetBandCount(size_t RowCount,size_t RowAlignment)
+{
+	auto Params = GetParams();
+	if ( !Params.mEnabled )
+		return 1;
+	
+	auto MaxBands = Params.mMaxTasks ? Params.mMaxTasks : std::max<size_t>( 1, std::thread::hardware_concurrency() );
+	auto MinRows = std::max<size_t>( std::max<size_t>( 1, Params.mMinRowsPerTask ), RowAlignment );
+	auto Bands = std::min( MaxBands, RowCount / MinRows );
+	return std::max<size_t>( 1, Bands );
+}
+
+
+void SoyPixelsParallel::ForEachRowBand(size_t RowCount,size_t RowAlignment,std::function<void(size_t FirstRow,size_t RowCount)> Function)
+{
+	RowAlignment = std::max<size_t>( 1, RowAlignment );
+	auto Bands = GetBandCount( RowCount, RowAlignment );
+	if ( Bands <= 1 )
+	{
+		Function( 0, RowCount );
+		return;
+	}
+
+	auto& Pool = GetPool();
+	if ( Pool.IsLockedToThisThread() )
+	{
+		Function( 0, RowCount );
+		return;
+	}
+	
+	//	round band size up to the alignment
+	auto BandRows = (RowCount + Bands - 1) / Bands;
+	BandRows = ((BandRows + RowAlignment - 1) / RowAlignment) * RowAlignment;
+	
+	//	the jobs reference this (and Function) on our stack, so the count is only changed, and read, under the lock,
+	//	that way we can't return until the last job has finished with it
+	std::mutex Lock;
+	std::condition_variable BandFinished;
+	size_t BandsRunning = 0;
+	std::string Error;
+	
+	auto OnBandFinished = [&](const std::string& BandError)
+	{
+		std::lock_guard<std::mutex> Guard( Lock );
+		if ( Error.empty() )
+			Error = BandError;
+		BandsRunning--;
+		BandFinished.notify_all();
+	};
+	
+	for ( size_t b=1;	b<Bands;	b++ )
+	{
+		auto FirstRow = b * BandRows;
+		if ( FirstRow >= RowCount )
+			break;
+		auto BandRowCount = std::min( BandRows, RowCount - FirstRow );
+		{
+			std::lock_guard<std::mutex> Guard( Lock );
+			BandsRunning++;
+		}
+		auto Band = [&Function,&OnBandFinished,FirstRow,BandRowCount]
+		{
+			std::string BandError;
+			try
+			{
+				Function( FirstRow, BandRowCount );
+			}
+			catch(std::exception& e)
+			{
+				BandError = e.what();
+			}
+			OnBandFinished( BandError );
+		};
+		Pool.PushJob( Band );
+	}
+	
+	//	do the first band ourselves, but always wait for the others
+	std::string FirstBandError;
+	try
+	{
+		Function( 0, std::min( BandRows, RowCount ) );
+	}
+	catch(std::exception& e)
+	{
+		FirstBandError = e.what();
+	}
+	
+	std::unique_lock<std::mutex> Guard( Lock );
+	BandFinished.wait( Guard, [&]	{	return BandsRunning == 0;	} );
+	if ( !FirstBandError.empty() )
+		Error = FirstBandError;
+	
+	if ( !Error.empty() )
+		throw Soy::AssertException( Error );
+}
 	
 
 SoyPixelsFormat::Type SoyPixelsFormat::GetYuvFull(SoyPixelsFormat::Type Format)
@@ -233,6 +480,11 @@ SoyPixelsFormat::Type SoyPixelsFormat::GetFloatFormat(Type Format)
 		case Float4:
 			return Format;
 			
+		case Half1:	return Float1;
+		case Half2:	return Float2;
+		case Half3:	return Float3;
+		case Half4:	return Float4;
+			
 		case Greyscale:
 		case ChromaU_8:
 		case ChromaV_8:
@@ -263,20 +515,53 @@ SoyPixelsFormat::Type SoyPixelsFormat::GetFloatFormat(Type Format)
 
 }
 
+SoyPixelsFormat::Type SoyPixelsFormat::GetHalfFormat(Type Format)
+{
+	switch ( Format )
+	{
+		case Half1:
+		case Half2:
+		case Half3:
+		case Half4:
+			return Format;
+			
+		default:
+			break;
+	}
+	
+	//	same channels as the float format
+	switch ( GetFloatFormat( Format ) )
+	{
+		case Float1:	return Half1;
+		case Float2:	return Half2;
+		case Float3:	return Half3;
+		case Float4:	return Half4;
+		default:		break;
+	}
+	
+	std::stringstream Error;
+	Error << std::string(__func__) << " " << Format << " no conversion";
+	throw Soy::AssertException( Error.str() );
+}
+
 SoyPixelsFormat::Type SoyPixelsFormat::GetByteFormat(Type Format)
 {
 	switch ( Format )
 	{
 		case Float1:
+		case Half1:
 			return Greyscale;
 			
 		case Float2:
+		case Half2:
 			return GreyscaleAlpha;
 			
 		case Float3:
+		case Half3:
 			return RGB;
 			
 		case Float4:
+		case Half4:
 			return RGBA;
 		
 		default:
@@ -390,12 +675,17 @@ size_t SoyPixelsFormat::GetChannelCount(SoyPixelsFormat::Type Format)
 	case YYuv_8888_Full:
 	case YYuv_8888_Ntsc:
 	case YYuv_8888_Smptec:
+	case uyvy:
 		return 2;
 
 	case Float1:	return 1;
 	case Float2:	return 2;
 	case Float3:	return 3;
 	case Float4:	return 4;
+	case Half1:		return 1;
+	case Half2:		return 2;
+	case Half3:		return 3;
+	case Half4:		return 4;
 
 	//	throw if we try and get a channel count of zero
 	case Invalid:
@@ -419,6 +709,10 @@ bool SoyPixelsFormat::IsFloatChannel(SoyPixelsFormat::Type Format)
 		case Float4:
 			return true;
 
+		case Half1:
+		case Half2:
+		case Half3:
+		case Half4:
 		case Greyscale:
 		case Luma_Ntsc:
 		case Luma_Smptec:
@@ -443,6 +737,7 @@ bool SoyPixelsFormat::IsFloatChannel(SoyPixelsFormat::Type Format)
 		case YYuv_8888_Full:
 		case YYuv_8888_Ntsc:
 		case YYuv_8888_Smptec:
+		case uyvy:
 			return false;
 			
 		default:
@@ -455,6 +750,22 @@ bool SoyPixelsFormat::IsFloatChannel(SoyPixelsFormat::Type Format)
 }
 
 
+bool SoyPixelsFormat::IsHalfChannel(SoyPixelsFormat::Type Format)
+{
+	switch ( Format )
+	{
+		case Half1:
+		case Half2:
+		case Half3:
+		case Half4:
+			return true;
+			
+		default:
+			return false;
+	}
+}
+
+
 SoyPixelsFormat::Type SoyPixelsFormat::GetFormatFromChannelCount(size_t ChannelCount)
 {
 	switch ( ChannelCount )
@@ -531,40 +842,55 @@ SoyPixelsFormat::Type SoyPixelsFormat::GetMergedFormat(SoyPixelsFormat::Type For
 	return SoyPixelsFormat::Invalid;
 }
 
+//	gr: palettised images store a 3 byte header, the palette, then 8 bit indexes (see MakePaletteised)
+namespace SoyPixelsPalette
+{
+	//	colours are counted in buckets of 5 bits of rgb and 3 of alpha
+	static const size_t	BucketCount = 1<<18;
+	
+	class TColourCount
+	{
+	public:
+		uint32		mBucket;
+		uint32		mCount;
+		uint8		mRgba[4];	//	bucket's lowest colour
+	};
+	
+	//	a range of colours for the median cut
+	class TBox
+	{
+	public:
+		void		Update(const ArrayBridge<TColourCount>& Colours);
+		
+	public:
+		size_t		mFirst;
+		size_t		mCount;
+		uint64		mPopulation;
+		int			mSplitChannel;
+		uint64		mScore;
+	};
+	
+	//	every distinct colour as 0xRRGGBBAA, sorted. false if there are more than MaxColours
+	bool			GetExactColours(const SoyPixelsImpl& Image,Array<uint32>& Colours,size_t MaxColours);
+	inline uint32	GetColourKey(const uint8* Pixel,size_t Channels)	{	return (uint32(Pixel[0])<<24) | (uint32(Pixel[1])<<16) | (uint32(Pixel[2])<<8) | ( Channels == 4 ? Pixel[3] : 255 );	}
+	
+	uint8*			InitPalettised(SoyPixelsImpl& PalettisedImage,size_t Width,size_t Height,const SoyPixelsImpl& Palette,uint8 TransparentIndex,size_t IndexesSize);	//	writes header & palette, returns where the indexes go
+	const uint8*	GetPaletteLut(const SoyPixelsImpl& PalettisedImage,SoyPixelsFormat::Type DstFormat,uint32 (&Lut)[256]);	//	palette as 32 bit colours in the output's order. returns the indexes
+	void			ExpandRow(const uint8* Indexes,uint8* Dst,size_t Width,size_t DstChannels,const uint32* Lut);
+#if defined(SOY_SIMD_AVX2)
+	size_t			ExpandRow_Avx2(const uint8* Indexes,uint8* Dst,size_t Width,const uint32* Lut);
+#endif
+}
+
+
 //	merge index & palette into Paletteised_8_8
 void SoyPixelsFormat::MakePaletteised(SoyPixelsImpl& PalettisedImage,const SoyPixelsImpl& IndexedImage,const SoyPixelsImpl& Palette,uint8 TransparentIndex)
 {
 	Soy::Assert( IndexedImage.GetFormat() == SoyPixelsFormat::Greyscale, "Expected IndexedImage to be Greyscale" );
-	Soy::Assert( Palette.GetFormat() == SoyPixelsFormat::RGB || Palette.GetFormat() == SoyPixelsFormat::RGBA, "Expected Palette to be RGB or RGBA" );
-	Soy::Assert( Palette.GetHeight() == 1, "Expected palette to have height of 1" );
-	Soy::Assert( Palette.GetWidth() <= ((1<<16)-1), "Expected palette to have max width of 65535" );
 
-	auto& PaletteArray = Palette.GetPixelsArray();
 	auto& IndexedArray = IndexedImage.GetPixelsArray();
-	
-	//	manually construct this image
-	auto& PiMeta = PalettisedImage.GetMeta();
-	auto& PiArray = PalettisedImage.GetPixelsArray();
-
-	if ( Palette.GetFormat() == SoyPixelsFormat::RGB )
-		PiMeta.DumbSetFormat( SoyPixelsFormat::Palettised_RGB_8 );
-	if ( Palette.GetFormat() == SoyPixelsFormat::RGBA )
-		PiMeta.DumbSetFormat( SoyPixelsFormat::Palettised_RGBA_8 );
-	PiMeta.DumbSetWidth( IndexedImage.GetWidth() );
-	PiMeta.DumbSetHeight( IndexedImage.GetHeight() );
-
-	PiArray.Clear();
-	
-	//	write header
-	uint8 PaletteSizeA = (Palette.GetWidth()>>0) & 0xff;
-	uint8 PaletteSizeB = (Palette.GetWidth()>>8) & 0xff;
-	GetArrayBridge(PiArray).PushBack( PaletteSizeA );
-	GetArrayBridge(PiArray).PushBack( PaletteSizeB );
-	GetArrayBridge(PiArray).PushBack( TransparentIndex );
-
-	//	write data
-	PiArray.PushBackArray( PaletteArray );
-	PiArray.PushBackArray( IndexedArray );
+	auto* Indexes = SoyPixelsPalette::InitPalettised( PalettisedImage, IndexedImage.GetWidth(), IndexedImage.GetHeight(), Palette, TransparentIndex, IndexedArray.GetDataSize() );
+	memcpy( Indexes, IndexedArray.GetArray(), IndexedArray.GetDataSize() );
 	
 	//	todo: verify by splitting
 	static bool Verify = false;
@@ -605,74 +931,514 @@ void SoyPixelsFormat::GetHeaderPalettised(const ArrayBridge<uint8>&& Data,size_t
 
 
 
-std::map<SoyPixelsFormat::Type, std::string> SoyPixelsFormat::EnumMap =
+
+uint8* SoyPixelsPalette::InitPalettised(SoyPixelsImpl& PalettisedImage,size_t Width,size_t Height,const SoyPixelsImpl& Palette,uint8 TransparentIndex,size_t IndexesSize)
 {
-	{ SoyPixelsFormat::Invalid,				"Invalid" },
-//	{ SoyPixelsFormat::UnityUnknown,		"UnityUnknown" },
-	{ SoyPixelsFormat::Greyscale,			"Greyscale" },
-	{ SoyPixelsFormat::GreyscaleAlpha,		"GreyscaleAlpha"	},
-	{ SoyPixelsFormat::RGB,					"RGB"	},
-	{ SoyPixelsFormat::RGBA,				"RGBA"	},
-	{ SoyPixelsFormat::BGRA,				"BGRA"	},
-	{ SoyPixelsFormat::BGR,					"BGR"	},
-	{ SoyPixelsFormat::ARGB,				"ARGB"	},
-	{ SoyPixelsFormat::KinectDepth,			"KinectDepth"	},
-	{ SoyPixelsFormat::FreenectDepth10bit,	"FreenectDepth10bit"	},
-	{ SoyPixelsFormat::FreenectDepth11bit,	"FreenectDepth11bit"	},
-	{ SoyPixelsFormat::FreenectDepthmm,		"FreenectDepthmm"	},
-	{ SoyPixelsFormat::Yuv_8_88_Full,		"Yuv_8_88_Full"	},
-	{ SoyPixelsFormat::Yuv_8_88_Ntsc,		"Yuv_8_88_Ntsc"	},
-	{ SoyPixelsFormat::Yuv_8_88_Smptec,		"Yuv_8_88_Smptec"	},
-	{ SoyPixelsFormat::Yuv_8_8_8_Full,		"Yuv_8_8_8_Full"	},
-	{ SoyPixelsFormat::Yuv_8_8_8_Ntsc,		"Yuv_8_8_8_Ntsc"	},
-	{ SoyPixelsFormat::Yuv_8_8_8_Smptec,	"Yuv_8_8_8_Smptec"	},
-	{ SoyPixelsFormat::YYuv_8888_Full,		"YYuv_8888_Full"	},
-	{ SoyPixelsFormat::YYuv_8888_Ntsc,		"YYuv_8888_Ntsc"	},
-	{ SoyPixelsFormat::YYuv_8888_Smptec,	"YYuv_8888_Smptec"	},
-	{ SoyPixelsFormat::Yuv_844_Full,		"Yuv_844_Full"	},
-	{ SoyPixelsFormat::Yuv_844_Ntsc,		"Yuv_844_Ntsc"	},
-	{ SoyPixelsFormat::Yuv_844_Smptec,		"Yuv_844_Smptec"	},
-	{ SoyPixelsFormat::Luma_Full,			"LumaFull"	},
-	{ SoyPixelsFormat::Luma_Ntsc,			"Luma_Ntsc"	},
-	{ SoyPixelsFormat::Luma_Smptec,			"Luma_Smptec"	},
-	{ SoyPixelsFormat::ChromaUV_8_8,		"ChromaUV_8_8"	},
-	{ SoyPixelsFormat::ChromaUV_88,			"ChromaUV_88"	},
-	{ SoyPixelsFormat::ChromaUV_44,			"ChromaUV_44"	},
-	{ SoyPixelsFormat::ChromaU_8,			"ChromaU_8"	},
-	{ SoyPixelsFormat::ChromaV_8,			"ChromaV_8"	},
-	{ SoyPixelsFormat::Palettised_RGB_8,	"Palettised_RGB_8"	},
-	{ SoyPixelsFormat::Palettised_RGBA_8,	"Palettised_RGBA_8"	},
-	{ SoyPixelsFormat::Float1,				"Float1"	},
-	{ SoyPixelsFormat::Float2,				"Float2"	},
-	{ SoyPixelsFormat::Float3,				"Float3"	},
-	{ SoyPixelsFormat::Float4,				"Float4"	},
-};
+	Soy::Assert( Palette.GetFormat() == SoyPixelsFormat::RGB || Palette.GetFormat() == SoyPixelsFormat::RGBA, "Expected Palette to be RGB or RGBA" );
+	Soy::Assert( Palette.GetHeight() == 1, "Expected palette to have height of 1" );
+	Soy::Assert( Palette.GetWidth() <= ((1<<16)-1), "Expected palette to have max width of 65535" );
 
+	auto& PaletteArray = Palette.GetPixelsArray();
+	
+	//	manually construct this image
+	auto& PiMeta = PalettisedImage.GetMeta();
+	auto& PiArray = PalettisedImage.GetPixelsArray();
 
-#if defined(SOY_OPENCL)
-bool TPixels::Get(msa::OpenCLImage& Pixels,SoyOpenClKernel& Kernel,cl_int clMemMode) const
-{
-	if ( !IsValid() )
-		return false;
-	if ( !Kernel.IsValid() )
-		return false;
+	if ( Palette.GetFormat() == SoyPixelsFormat::RGB )
+		PiMeta.DumbSetFormat( SoyPixelsFormat::Palettised_RGB_8 );
+	if ( Palette.GetFormat() == SoyPixelsFormat::RGBA )
+		PiMeta.DumbSetFormat( SoyPixelsFormat::Palettised_RGBA_8 );
+	PiMeta.DumbSetWidth( Width );
+	PiMeta.DumbSetHeight( Height );
+	PiMeta.DumbSetRowPitch( 0 );
+
+	//	allocate once, header, palette then indexes
+	auto HeaderSize = SoyPixelsFormat::GetHeaderSize( PiMeta.GetFormat() );
+	PiArray.SetSize( HeaderSize + PaletteArray.GetDataSize() + IndexesSize, false );
+	auto* Data = PiArray.GetArray();
 	
-	return Get( Pixels, Kernel.GetQueue(), clMemMode );
+	//	write header
+	Data[0] = (Palette.GetWidth()>>0) & 0xff;
+	Data[1] = (Palette.GetWidth()>>8) & 0xff;
+	Data[2] = TransparentIndex;
+	
+	//	write data
+	memcpy( Data + HeaderSize, PaletteArray.GetArray(), PaletteArray.GetDataSize() );
+	return Data + HeaderSize + PaletteArray.GetDataSize();
 }
-#endif
 
-#if defined(SOY_OPENCL)
-bool TPixels::Get(msa::OpenCLImage& Pixels,cl_command_queue Queue,cl_int clMemMode) const
+
+const uint8* SoyPixelsPalette::GetPaletteLut(const SoyPixelsImpl& PalettisedImage,SoyPixelsFormat::Type DstFormat,uint32 (&Lut)[256])
 {
-	assert( Queue );
-	if ( !Queue )
-		return false;
+	auto Format = PalettisedImage.GetFormat();
+	auto& PixelsArray = PalettisedImage.GetPixelsArray();
+	size_t PaletteSize = 0;
+	size_t TransparentIndex = 0;
+	SoyPixelsFormat::GetHeaderPalettised( GetArrayBridge(PixelsArray), PaletteSize, TransparentIndex );
 	
-	cl_int ChannelOrder;
-	if ( !GetMeta().GetOpenclFormat( ChannelOrder ) )
-		return false;
+	size_t PaletteChannels = ( Format == SoyPixelsFormat::Palettised_RGBA_8 ) ? 4 : 3;
+	auto HeaderSize = SoyPixelsFormat::GetHeaderSize( Format );
+	auto IndexesSize = PalettisedImage.GetWidth() * PalettisedImage.GetHeight();
+	Soy::Assert( PixelsArray.GetDataSize() >= HeaderSize + (PaletteSize*PaletteChannels) + IndexesSize, "Palettised data smaller than its palette & indexes" );
+	auto* Palette = PixelsArray.GetArray() + HeaderSize;
+	
+	//	the transparent index only applies to rgb palettes, rgba ones have their own alpha
+	bool Bgr = ( DstFormat == SoyPixelsFormat::BGRA );
+	for ( size_t i=0;	i<256;	i++ )
+	{
+		//	indexes outside the palette are transparent black
+		uint8 Rgba[4] = { 0, 0, 0, 0 };
+		if ( i < PaletteSize )
+		{
+			auto* Colour = &Palette[i*PaletteChannels];
+			Rgba[0] = Colour[ Bgr ? 2 : 0 ];
+			Rgba[1] = Colour[1];
+			Rgba[2] = Colour[ Bgr ? 0 : 2 ];
+			Rgba[3] = ( PaletteChannels == 4 ) ? Colour[3] : ( i == TransparentIndex ) ? 0 : 255;
+		}
+		memcpy( &Lut[i], Rgba, sizeof(Rgba) );
+	}
+	
+	return Palette + (PaletteSize*PaletteChannels);
+}
 
-	//	can't use 8 bit, 3 channels
+
+#if defined(SOY_SIMD_AVX2)
+SOY_SIMD_AVX2_FUNCTION size_t SoyPixelsPalette::ExpandRow_Avx2(const uint8* Indexes,uint8* Dst,size_t Width,const uint32* Lut)
+{
+	//	8 indexes widened to 32 bit, then gather their colours in one go
+	size_t x = 0;
+	for ( ;	x+8<=Width;	x+=8 )
+	{
+		auto Index = _mm256_cvtepu8_epi32( _mm_loadl_epi64( reinterpret_cast<const __m128i*>( &Indexes[x] ) ) );
+		auto Colours = _mm256_i32gather_epi32( reinterpret_cast<const int*>( Lut ), Index, 4 );
+		_mm256_storeu_si256( reinterpret_cast<__m256i*>( &Dst[x*4] ), Colours );
+	}
+	return x;
+}
+#endif
+
+
+void SoyPixelsPalette::ExpandRow(const uint8* Indexes,uint8* Dst,size_t Width,size_t DstChannels,const uint32* Lut)
+{
+	size_t x = 0;
+	if ( DstChannels == 4 )
+	{
+#if defined(SOY_SIMD_AVX2)
+		if ( SoySimd::IsEnabled( SoySimd::Avx2 ) )
+			x = ExpandRow_Avx2( Indexes, Dst, Width, Lut );
+#endif
+		for ( ;	x<Width;	x++ )
+			memcpy( &Dst[x*4], &Lut[Indexes[x]], 4 );
+		return;
+	}
+	
+	for ( ;	x<Width;	x++ )
+		memcpy( &Dst[x*DstChannels], &Lut[Indexes[x]], DstChannels );
+}
+
+
+void SoyPixelsFormat::ExpandPalettised(SoyPixelsImpl& Image,const SoyPixelsImpl& PalettisedImage)
+{
+	auto SrcFormat = PalettisedImage.GetFormat();
+	auto DstFormat = Image.GetFormat();
+	Soy::Assert( SrcFormat == SoyPixelsFormat::Palettised_RGB_8 || SrcFormat == SoyPixelsFormat::Palettised_RGBA_8, "Expected palettised image" );
+	if ( DstFormat != SoyPixelsFormat::RGB && DstFormat != SoyPixelsFormat::RGBA && DstFormat != SoyPixelsFormat::BGRA )
+	{
+		std::stringstream Error;
+		Error << "Cannot expand palettised image to " << DstFormat;
+		throw Soy::AssertException( Error.str() );
+	}
+	
+	uint32 Lut[256];
+	auto* Indexes = SoyPixelsPalette::GetPaletteLut( PalettisedImage, DstFormat, Lut );
+	
+	//	keep the destination's row pitch if it's already the right size
+	auto Width = PalettisedImage.GetWidth();
+	auto Height = PalettisedImage.GetHeight();
+	bool SameSize = ( Image.GetWidth() == Width && Image.GetHeight() == Height );
+	SoyPixelsMeta DstMeta = SameSize ? Image.GetMeta() : SoyPixelsMeta( Width, Height, DstFormat );
+	if ( !SameSize || Image.GetPixelsArray().GetDataSize() < DstMeta.GetDataSize() )
+		Image.Init( DstMeta );
+	Soy::Assert( Image.GetPixelsArray().GetDataSize() >= DstMeta.GetDataSize(), "Expand palettised destination too small" );
+	
+	auto* Dst = Image.GetPixelsArray().GetArray();
+	auto DstPitch = DstMeta.GetRowPitch();
+	auto DstChannels = DstMeta.GetChannels();
+	auto ExpandBand = [&](size_t FirstRow,size_t RowCount)
+	{
+		for ( size_t y=FirstRow;	y<FirstRow+RowCount;	y++ )
+			SoyPixelsPalette::ExpandRow( &Indexes[y*Width], &Dst[y*DstPitch], Width, DstChannels, Lut );
+	};
+	SoyPixelsParallel::ForEachRowBand( Height, 1, ExpandBand );
+}
+
+
+void SoyPixelsPalette::TBox::Update(const ArrayBridge<TColourCount>& Colours)
+{
+	uint8 Min[4] = { 255, 255, 255, 255 };
+	uint8 Max[4] = { 0, 0, 0, 0 };
+	mPopulation = 0;
+	for ( size_t i=mFirst;	i<mFirst+mCount;	i++ )
+	{
+		auto& Colour = Colours[i];
+		for ( int c=0;	c<4;	c++ )
+		{
+			Min[c] = std::min( Min[c], Colour.mRgba[c] );
+			Max[c] = std::max( Max[c], Colour.mRgba[c] );
+		}
+		mPopulation += Colour.mCount;
+	}
+	
+	mSplitChannel = 0;
+	for ( int c=1;	c<4;	c++ )
+		if ( Max[c]-Min[c] > Max[mSplitChannel]-Min[mSplitChannel] )
+			mSplitChannel = c;
+	
+	//	split the busiest, most varied boxes first
+	mScore = ( mCount > 1 ) ? mPopulation * ( Max[mSplitChannel] - Min[mSplitChannel] ) : 0;
+}
+
+
+bool SoyPixelsPalette::GetExactColours(const SoyPixelsImpl& Image,Array<uint32>& Colours,size_t MaxColours)
+{
+	auto Width = Image.GetWidth();
+	auto Height = Image.GetHeight();
+	auto Channels = Image.GetMeta().GetChannels();
+	auto Pitch = Image.GetMeta().GetRowPitch();
+	auto* Pixels = Image.GetPixelsArray().GetArray();
+	
+	//	gives up as soon as there are too many, so this is cheap for photos
+	Colours.Clear();
+	bool HaveLast = false;
+	uint32 Last = 0;
+	for ( size_t y=0;	y<Height;	y++ )
+	{
+		auto* Row = &Pixels[y*Pitch];
+		for ( size_t x=0;	x<Width;	x++ )
+		{
+			auto Key = GetColourKey( &Row[x*Channels], Channels );
+			if ( HaveLast && Key == Last )
+				continue;
+			HaveLast = true;
+			Last = Key;
+			
+			auto* End = Colours.GetArray() + Colours.GetSize();
+			auto* Match = std::lower_bound( Colours.GetArray(), End, Key );
+			if ( Match != End && *Match == Key )
+				continue;
+			if ( Colours.GetSize() >= MaxColours )
+				return false;
+			*Colours.InsertBlock( Match - Colours.GetArray(), 1 ) = Key;
+		}
+	}
+	return true;
+}
+
+
+void SoyPixelsFormat::Quantise(SoyPixelsImpl& PalettisedImage,const SoyPixelsImpl& Image,size_t MaxColours)
+{
+	using namespace SoyPixelsPalette;
+	auto Format = Image.GetFormat();
+	Soy::Assert( Format == SoyPixelsFormat::RGB || Format == SoyPixelsFormat::RGBA, "Quantise expects RGB or RGBA" );
+	Soy::Assert( &PalettisedImage != &Image, "Quantise can't write over its source" );
+	MaxColours = std::min<size_t>( std::max<size_t>( MaxColours, 1 ), 256 );
+	
+	auto Width = Image.GetWidth();
+	auto Height = Image.GetHeight();
+	auto Channels = Image.GetMeta().GetChannels();
+	auto Pitch = Image.GetMeta().GetRowPitch();
+	auto* Pixels = Image.GetPixelsArray().GetArray();
+	
+	//	few enough colours to keep them all, so the image round trips exactly
+	Array<uint32> ExactColours;
+	if ( GetExactColours( Image, ExactColours, MaxColours ) )
+	{
+		SoyPixels Palette;
+		Palette.Init( std::max<size_t>( ExactColours.GetSize(), 1 ), 1, SoyPixelsFormat::RGBA );
+		auto* PaletteRgba = Palette.GetPixelsArray().GetArray();
+		size_t TransparentIndex = 0;
+		bool FoundTransparent = false;
+		for ( size_t i=0;	i<ExactColours.GetSize();	i++ )
+		{
+			auto Key = ExactColours[i];
+			PaletteRgba[i*4+0] = static_cast<uint8>( Key >> 24 );
+			PaletteRgba[i*4+1] = static_cast<uint8>( Key >> 16 );
+			PaletteRgba[i*4+2] = static_cast<uint8>( Key >> 8 );
+			PaletteRgba[i*4+3] = static_cast<uint8>( Key );
+			if ( !FoundTransparent && PaletteRgba[i*4+3] == 0 )
+			{
+				TransparentIndex = i;
+				FoundTransparent = true;
+			}
+		}
+		
+		auto* Indexes = InitPalettised( PalettisedImage, Width, Height, Palette, size_cast<uint8>(TransparentIndex), Width*Height );
+		auto* ColoursStart = ExactColours.GetArray();
+		auto* ColoursEnd = ColoursStart + ExactColours.GetSize();
+		auto MapBand = [&](size_t FirstRow,size_t RowCount)
+		{
+			for ( size_t y=FirstRow;	y<FirstRow+RowCount;	y++ )
+			{
+				auto* Row = &Pixels[y*Pitch];
+				auto* RowIndexes = &Indexes[y*Width];
+				for ( size_t x=0;	x<Width;	x++ )
+				{
+					auto Key = GetColourKey( &Row[x*Channels], Channels );
+					RowIndexes[x] = size_cast<uint8>( std::lower_bound( ColoursStart, ColoursEnd, Key ) - ColoursStart );
+				}
+			}
+		};
+		SoyPixelsParallel::ForEachRowBand( Height, 1, MapBand );
+		return;
+	}
+	
+	auto GetBucket = [Channels](const uint8* Pixel)
+	{
+		uint8 Alpha = ( Channels == 4 ) ? Pixel[3] : 255;
+		return ((Pixel[0]>>3)<<13) | ((Pixel[1]>>3)<<8) | ((Pixel[2]>>3)<<3) | (Alpha>>5);
+	};
+	
+	//	histogram of bucketed colours, each band counts its own then they're added together
+	Array<uint32> Histogram;
+	Histogram.SetSize( BucketCount );
+	Histogram.SetAll( 0 );
+	std::mutex HistogramLock;
+	auto CountBand = [&](size_t FirstRow,size_t RowCount)
+	{
+		Array<uint32> BandHistogram;
+		BandHistogram.SetSize( BucketCount );
+		BandHistogram.SetAll( 0 );
+		for ( size_t y=FirstRow;	y<FirstRow+RowCount;	y++ )
+		{
+			auto* Row = &Pixels[y*Pitch];
+			for ( size_t x=0;	x<Width;	x++ )
+				BandHistogram[ GetBucket( &Row[x*Channels] ) ]++;
+		}
+		std::lock_guard<std::mutex> Lock( HistogramLock );
+		for ( size_t b=0;	b<BucketCount;	b++ )
+			Histogram[b] += BandHistogram[b];
+	};
+	SoyPixelsParallel::ForEachRowBand( Height, 1, CountBand );
+	
+	Array<TColourCount> Colours;
+	for ( size_t b=0;	b<BucketCount;	b++ )
+	{
+		if ( !Histogram[b] )
+			continue;
+		auto& Colour = Colours.PushBack();
+		Colour.mBucket = size_cast<uint32>( b );
+		Colour.mCount = Histogram[b];
+		Colour.mRgba[0] = ((b>>13) & 0x1f) << 3;
+		Colour.mRgba[1] = ((b>>8) & 0x1f) << 3;
+		Colour.mRgba[2] = ((b>>3) & 0x1f) << 3;
+		Colour.mRgba[3] = (b & 0x7) << 5;
+	}
+	auto ColoursBridge = GetArrayBridge( Colours );
+	
+	//	median cut; split the best box at the median of its widest channel until we have enough colours
+	Array<TBox> Boxes;
+	{
+		auto& Box = Boxes.PushBack();
+		Box.mFirst = 0;
+		Box.mCount = Colours.GetSize();
+		Box.Update( ColoursBridge );
+	}
+	while ( Boxes.GetSize() < MaxColours )
+	{
+		size_t Best = 0;
+		for ( size_t b=1;	b<Boxes.GetSize();	b++ )
+			if ( Boxes[b].mScore > Boxes[Best].mScore )
+				Best = b;
+		if ( Boxes[Best].mScore == 0 )
+			break;
+		
+		auto Box = Boxes[Best];
+		auto Channel = Box.mSplitChannel;
+		auto* First = &Colours[Box.mFirst];
+		std::sort( First, First+Box.mCount, [Channel](const TColourCount& a,const TColourCount& b)	{	return a.mRgba[Channel] < b.mRgba[Channel];	} );
+		
+		//	first half gets at least one colour, and leaves at least one
+		size_t SplitCount = 1;
+		uint64 Population = First[0].mCount;
+		while ( SplitCount < Box.mCount-1 && Population*2 < Box.mPopulation )
+			Population += First[SplitCount++].mCount;
+		
+		auto& Low = Boxes[Best];
+		Low.mCount = SplitCount;
+		Low.Update( ColoursBridge );
+		
+		TBox High;
+		High.mFirst = Box.mFirst + SplitCount;
+		High.mCount = Box.mCount - SplitCount;
+		High.Update( ColoursBridge );
+		Boxes.PushBack( High );
+	}
+	
+	//	every bucket in a box maps to its index
+	Array<uint8> BucketIndexes;
+	BucketIndexes.SetSize( BucketCount );
+	for ( size_t b=0;	b<Boxes.GetSize();	b++ )
+	{
+		auto& Box = Boxes[b];
+		for ( size_t i=Box.mFirst;	i<Box.mFirst+Box.mCount;	i++ )
+			BucketIndexes[Colours[i].mBucket] = size_cast<uint8>( b );
+	}
+	
+	//	map the pixels, summing the real colours that land in each box so the palette is their average rather than the bucket's
+	Array<uint8> Indexes;
+	Indexes.SetSize( Width*Height );
+	Array<uint64> BoxSums;
+	BoxSums.SetSize( Boxes.GetSize()*4 );
+	BoxSums.SetAll( 0 );
+	std::mutex BoxSumsLock;
+	auto MapBand = [&](size_t FirstRow,size_t RowCount)
+	{
+		Array<uint64> BandSums;
+		BandSums.SetSize( Boxes.GetSize()*4 );
+		BandSums.SetAll( 0 );
+		for ( size_t y=FirstRow;	y<FirstRow+RowCount;	y++ )
+		{
+			auto* Row = &Pixels[y*Pitch];
+			auto* RowIndexes = &Indexes[y*Width];
+			for ( size_t x=0;	x<Width;	x++ )
+			{
+				auto* Pixel = &Row[x*Channels];
+				auto Index = BucketIndexes[ GetBucket( Pixel ) ];
+				RowIndexes[x] = Index;
+				auto* Sum = &BandSums[Index*4];
+				Sum[0] += Pixel[0];
+				Sum[1] += Pixel[1];
+				Sum[2] += Pixel[2];
+				Sum[3] += ( Channels == 4 ) ? Pixel[3] : 255;
+			}
+		}
+		std::lock_guard<std::mutex> Lock( BoxSumsLock );
+		for ( size_t i=0;	i<BandSums.GetSize();	i++ )
+			BoxSums[i] += BandSums[i];
+	};
+	SoyPixelsParallel::ForEachRowBand( Height, 1, MapBand );
+	
+	SoyPixels Palette;
+	Palette.Init( Boxes.GetSize(), 1, SoyPixelsFormat::RGBA );
+	auto* PaletteRgba = Palette.GetPixelsArray().GetArray();
+	size_t TransparentIndex = 0;
+	bool FoundTransparent = false;
+	for ( size_t b=0;	b<Boxes.GetSize();	b++ )
+	{
+		auto Population = std::max<uint64>( Boxes[b].mPopulation, 1 );
+		for ( int c=0;	c<4;	c++ )
+			PaletteRgba[b*4+c] = static_cast<uint8>( (BoxSums[b*4+c] + Population/2) / Population );
+		
+		if ( !FoundTransparent && PaletteRgba[b*4+3] == 0 )
+		{
+			TransparentIndex = b;
+			FoundTransparent = true;
+		}
+	}
+	
+	auto* PalettisedIndexes = InitPalettised( PalettisedImage, Width, Height, Palette, size_cast<uint8>(TransparentIndex), Width*Height );
+	memcpy( PalettisedIndexes, Indexes.GetArray(), Indexes.GetDataSize() );
+}
+
+
+std::map<SoyPixelsFormat::Type, std::string> SoyPixelsFormat::EnumMap =
+{
+	{ SoyPixelsFormat::Invalid,				"Invalid" },
+//	{ SoyPixelsFormat::UnityUnknown,		"UnityUnknown" },
+	{ SoyPixelsFormat::Greyscale,			"Greyscale" },
+	{ SoyPixelsFormat::GreyscaleAlpha,		"GreyscaleAlpha"	},
+	{ SoyPixelsFormat::RGB,					"RGB"	},
+	{ SoyPixelsFormat::RGBA,				"RGBA"	},
+	{ SoyPixelsFormat::BGRA,				"BGRA"	},
+	{ SoyPixelsFormat::BGR,					"BGR"	},
+	{ SoyPixelsFormat::ARGB,				"ARGB"	},
+	{ SoyPixelsFormat::KinectDepth,			"KinectDepth"	},
+	{ SoyPixelsFormat::FreenectDepth10bit,	"FreenectDepth10bit"	},
+	{ SoyPixelsFormat::FreenectDepth11bit,	"FreenectDepth11bit"	},
+	{ SoyPixelsFormat::FreenectDepthmm,		"FreenectDepthmm"	},
+	{ SoyPixelsFormat::Yuv_8_88_Full,		"Yuv_8_88_Full"	},
+	{ SoyPixelsFormat::Yuv_8_88_Ntsc,		"Yuv_8_88_Ntsc"	},
+	{ SoyPixelsFormat::Yuv_8_88_Smptec,		"Yuv_8_88_Smptec"	},
+	{ SoyPixelsFormat::Yuv_8_8_8_Full,		"Yuv_8_8_8_Full"	},
+	{ SoyPixelsFormat::Yuv_8_8_8_Ntsc,		"Yuv_8_8_8_Ntsc"	},
+	{ SoyPixelsFormat::Yuv_8_8_8_Smptec,	"Yuv_8_8_8_Smptec"	},
+	{ SoyPixelsFormat::YYuv_8888_Full,		"YYuv_8888_Full"	},
+	{ SoyPixelsFormat::YYuv_8888_Ntsc,		"YYuv_8888_Ntsc"	},
+	{ SoyPixelsFormat::YYuv_8888_Smptec,	"YYuv_8888_Smptec"	},
+	{ SoyPixelsFormat::Yuv_844_Full,		"Yuv_844_Full"	},
+	{ SoyPixelsFormat::Yuv_844_Ntsc,		"Yuv_844_Ntsc"	},
+	{ SoyPixelsFormat::Yuv_844_Smptec,		"Yuv_844_Smptec"	},
+	{ SoyPixelsFormat::uyvy,				"uyvy"	},
+	{ SoyPixelsFormat::Luma_Full,			"LumaFull"	},
+	{ SoyPixelsFormat::Luma_Ntsc,			"Luma_Ntsc"	},
+	{ SoyPixelsFormat::Luma_Smptec,			"Luma_Smptec"	},
+	{ SoyPixelsFormat::ChromaUV_8_8,		"ChromaUV_8_8"	},
+	{ SoyPixelsFormat::ChromaUV_88,			"ChromaUV_88"	},
+	{ SoyPixelsFormat::ChromaUV_44,			"ChromaUV_44"	},
+	{ SoyPixelsFormat::ChromaU_8,			"ChromaU_8"	},
+	{ SoyPixelsFormat::ChromaV_8,			"ChromaV_8"	},
+	{ SoyPixelsFormat::Palettised_RGB_8,	"Palettised_RGB_8"	},
+	{ SoyPixelsFormat::Palettised_RGBA_8,	"Palettised_RGBA_8"	},
+	{ SoyPixelsFormat::Float1,				"Float1"	},
+	{ SoyPixelsFormat::Float2,				"Float2"	},
+	{ SoyPixelsFormat::Float3,				"Float3"	},
+	{ SoyPixelsFormat::Float4,				"Float4"	},
+	{ SoyPixelsFormat::Half1,				"Half1"	},
+	{ SoyPixelsFormat::Half2,				"Half2"	},
+	{ SoyPixelsFormat::Half3,				"Half3"	},
+	{ SoyPixelsFormat::Half4,				"Half4"	},
+};
+
+
+std::map<SoyYuvMatrix::Type,std::string> SoyYuvMatrix::EnumMap =
+{
+	{ SoyYuvMatrix::Invalid,	"Invalid"	},
+	{ SoyYuvMatrix::Bt601,		"Bt601"	},
+	{ SoyYuvMatrix::Bt709,		"Bt709"	},
+};
+
+
+void SoyYuvMatrix::GetLumaWeights(Type Matrix,float& Kr,float& Kb)
+{
+	switch ( Matrix )
+	{
+		case Bt601:	Kr = 0.299f;	Kb = 0.114f;	return;
+		case Bt709:	Kr = 0.2126f;	Kb = 0.0722f;	return;
+		default:
+			break;
+	}
+	
+	std::stringstream Error;
+	Error << __func__ << " not implemented for " << Matrix;
+	throw Soy::AssertException( Error.str() );
+}
+
+
+#if defined(SOY_OPENCL)
+bool TPixels::Get(msa::OpenCLImage& Pixels,SoyOpenClKernel& Kernel,cl_int clMemMode) const
+{
+	if ( !IsValid() )
+		return false;
+	if ( !Kernel.IsValid() )
+		return false;
+	
+	return Get( Pixels, Kernel.GetQueue(), clMemMode );
+}
+#endif
+
+#if defined(SOY_OPENCL)
+bool TPixels::Get(msa::OpenCLImage& Pixels,cl_command_queue Queue,cl_int clMemMode) const
+{
+	assert( Queue );
+	if ( !Queue )
+		return false;
+	
+	cl_int ChannelOrder;
+	if ( !GetMeta().GetOpenclFormat( ChannelOrder ) )
+		return false;
+
+	//	can't use 8 bit, 3 channels
 	//	http://www.khronos.org/registry/cl/sdk/1.0/docs/man/xhtml/cl_image_format.html
 	//	so fail (need to convert this to RGBA)
 	//	gr: auto convert here with temp pixels?
@@ -845,249 +1611,494 @@ void ConvertFormat_KinectDepthToRgb(ArrayInterface<uint8>& Pixels,SoyPixelsMeta&
 
 
 
-bool DepthToGreyOrRgb(ArrayInterface<uint8>& Pixels,SoyPixelsMeta& Meta,SoyPixelsFormat::Type NewFormat)
+//	gr: conversions work on a range of rows so SetFormat can split an image across threads.
+//		src & dst can be the same buffer (converting in-place) so conversions that grow run
+//		backwards and conversions that shrink run forwards
+class TConvertBuffers
 {
-	bool RawDepth = (Meta.GetFormat() != SoyPixelsFormat::FreenectDepthmm);
-	uint16 MinDepth = SoyPixelsFormat::GetMinValue( Meta.GetFormat() );
-	uint16 MaxDepth = SoyPixelsFormat::GetMaxValue( Meta.GetFormat() );
-	uint16 InvalidDepth = SoyPixelsFormat::GetInvalidValue( Meta.GetFormat() );
-	int PlayerIndexFirstBit = SoyPixelsFormat::GetPlayerIndexFirstBit( Meta.GetFormat() );
- 
-	Array<uint16> DepthPixels;
-	DepthPixels.SetSize( Pixels.GetSize() / 2 );
-	memcpy( DepthPixels.GetArray(), Pixels.GetArray(), DepthPixels.GetDataSize() );
-	
-	auto Components = SoyPixelsFormat::GetChannelCount( NewFormat );
-	auto Height = Meta.GetHeight();
-	auto PixelCount = Meta.GetWidth() * Height;
+public:
+	TConvertBuffers() :
+		mSrc			( nullptr ),
+		mSrcSize		( 0 ),
+		mSrcFirstRow	( 0 ),
+		mDst			( nullptr ),
+		mDstSize		( 0 ),
+		mDstFirstRow	( 0 ),
+		mYuvMatrix		( SoyYuvMatrix::Bt601 ),
+		mFloatParams	( nullptr )
+	{
+	}
 	
-	//	realloc
-	Pixels.SetSize( Components * PixelCount );
+	const uint8*	GetSrcRow(size_t y) const	{	return mSrc + ((y-mSrcFirstRow) * mSrcMeta.GetRowPitch());	}
+	uint8*			GetDstRow(size_t y) const	{	return mDst + ((y-mDstFirstRow) * mDstMeta.GetRowPitch());	}
+
+public:
+	const uint8*		mSrc;
+	size_t				mSrcSize;
+	size_t				mSrcFirstRow;	//	row mSrc points at, non-zero when the buffer only holds a strip of rows
+	SoyPixelsMeta		mSrcMeta;
+	uint8*				mDst;
+	size_t				mDstSize;
+	size_t				mDstFirstRow;
+	SoyPixelsMeta		mDstMeta;
+	SoyYuvMatrix::Type	mYuvMatrix;
+	const TSoyPixelsFloatParams*	mFloatParams;	//	null for the default 0..1
+};
+
+
+void DepthToGreyOrRgb(const TConvertBuffers& Buffers,size_t FirstRow,size_t RowCount)
+{
+	auto OldFormat = Buffers.mSrcMeta.GetFormat();
+	bool RawDepth = (OldFormat != SoyPixelsFormat::FreenectDepthmm);
+	uint16 MinDepth = SoyPixelsFormat::GetMinValue( OldFormat );
+	uint16 MaxDepth = SoyPixelsFormat::GetMaxValue( OldFormat );
+	uint16 InvalidDepth = SoyPixelsFormat::GetInvalidValue( OldFormat );
+	int PlayerIndexFirstBit = SoyPixelsFormat::GetPlayerIndexFirstBit( OldFormat );
+	auto Components = Buffers.mDstMeta.GetChannels();
+	auto Width = Buffers.mSrcMeta.GetWidth();
 	
 	static bool Debug = false;
 	
-	for ( int p=0;	p<PixelCount;	p++ )
+	for ( size_t y=FirstRow;	y<FirstRow+RowCount;	y++ )
 	{
-		uint16 KinectDepth = DepthPixels[p];
-		int PlayerIndex = 0;
-
-		if ( PlayerIndexFirstBit >= 0 )
-		{
-			PlayerIndex = KinectDepth >> PlayerIndexFirstBit;
-			KinectDepth &= (1<<PlayerIndexFirstBit) -1;
-		}
-
-		if ( Debug )
-			std::Debug << KinectDepth << " ";
+		auto* DepthPixels = reinterpret_cast<const uint16*>( Buffers.GetSrcRow(y) );
+		auto* Pixels = Buffers.GetDstRow(y);
 		
-
-		bool DepthInvalid = (KinectDepth == InvalidDepth);
-		float Depthf = Soy::Range( KinectDepth, MinDepth, MaxDepth );
-		
-		uint8& Red = Pixels[ p * (Components) + 0 ];
-		
-		//	if RGB then we do different colours for raw and mm
-		if ( Components >= 3 )
+		for ( size_t x=0;	x<Width;	x++ )
 		{
-			int CompZero = RawDepth ? 1 : 2;
-			int CompDepth = RawDepth ? 2 : 1;
-			uint8& Green = Pixels[ p * (Components) + CompZero ];
-			uint8& Blue = Pixels[ p * (Components) + CompDepth ];
+			uint16 KinectDepth = DepthPixels[x];
+			int PlayerIndex = 0;
+
+			if ( PlayerIndexFirstBit >= 0 )
+			{
+				PlayerIndex = KinectDepth >> PlayerIndexFirstBit;
+				KinectDepth &= (1<<PlayerIndexFirstBit) -1;
+			}
 
-			SetDepthColour( Red, Green, Blue, Depthf, PlayerIndex, DepthInvalid );
+			if ( Debug )
+				std::Debug << KinectDepth << " ";
 
-			/*
+			bool DepthInvalid = (KinectDepth == InvalidDepth);
+			float Depthf = Soy::Range( KinectDepth, MinDepth, MaxDepth );
 			
-			Green = 0;
-			Blue = DepthInvalid ? 0 : 255-Red;
+			uint8& Red = Pixels[ x * (Components) + 0 ];
 			
-			if ( Components > 3 )
+			//	if RGB then we do different colours for raw and mm
+			if ( Components >= 3 )
 			{
-				int c = 3;
-				uint8& Alpha = Pixels[ p * (Components) + c ];
-				Alpha = DepthInvalid ? 0 : 255;
+				int CompZero = RawDepth ? 1 : 2;
+				int CompDepth = RawDepth ? 2 : 1;
+				uint8& Green = Pixels[ x * (Components) + CompZero ];
+				uint8& Blue = Pixels[ x * (Components) + CompDepth ];
+
+				SetDepthColour( Red, Green, Blue, Depthf, PlayerIndex, DepthInvalid );
+				
+				if ( Components > 3 )
+				{
+					uint8& Alpha = Pixels[ x * (Components) + 3 ];
+					Alpha = DepthInvalid ? 0 : 255;
+				}
 			}
-			 */
-		}
-		else
-		{
-			//	greyscale...
-			static int GreyInvalid = 0;
-			static int GreyMin = 1;
-			uint8 Greyscale = std::clamped<int>( static_cast<int>(Depthf*255.f), GreyMin, 255 );
-
-			//	set first component to greyscale
-			Red = DepthInvalid ? GreyInvalid : Greyscale;
-			
-			//	other components just valid/not
-			for ( int c=1;	c<Components;	c++ )
+			else
 			{
-				uint8& Blue = Pixels[ p * (Components) + c ];
-				Blue = DepthInvalid ? 0 : 255;
+				//	greyscale...
+				static int GreyInvalid = 0;
+				static int GreyMin = 1;
+				uint8 Greyscale = std::clamped<int>( static_cast<int>(Depthf*255.f), GreyMin, 255 );
+
+				//	set first component to greyscale
+				Red = DepthInvalid ? GreyInvalid : Greyscale;
+				
+				//	other components just valid/not
+				for ( int c=1;	c<Components;	c++ )
+				{
+					uint8& Blue = Pixels[ x * (Components) + c ];
+					Blue = DepthInvalid ? 0 : 255;
+				}
 			}
 		}
-		
 	}
 
 	if ( Debug )
 		std::Debug << std::endl;
-	
-	Meta.DumbSetFormat( NewFormat );
-	assert( Meta.IsValid() );
-	assert( Meta.GetHeight() == Height );
-	return true;
 }
 
 
-bool ConvertFormat_BgrToRgb(ArrayInterface<uint8>& Pixels,SoyPixelsMeta& Meta,SoyPixelsFormat::Type NewFormat)
+//	gr: channel remapping (swizzle, drop or add alpha) a row at a time. With ssse3 each pshufb remaps 4 pixels.
+//		remapping in place is safe when the channel counts match
+namespace SoyPixelsRemap
 {
-	auto Height = Meta.GetHeight();
-	auto PixelCount = Meta.GetWidth() * Height;
-	auto SrcChannels = Meta.GetChannels();
-	auto DestChannels = SoyPixelsFormat::GetChannelCount( NewFormat );
-	if ( SrcChannels != DestChannels )
-		return false;
-
-	for ( int p=0;	p<PixelCount;	p++ )
-	{
-		auto& b = Pixels[(p*SrcChannels)+0];
-		//auto& g = Pixels[(p*SrcChannels)+1];
-		auto& r = Pixels[(p*SrcChannels)+2];
+	class TRemapper;
 	
-		uint8 Swap = b;
-		b = r;
-		r = Swap;
-	}
-
-	Meta.DumbSetFormat( NewFormat );
-	return true;
+	//	bigger copies than this bypass the cache (non-temporal stores), they're not going to be read again before they're evicted
+	const size_t	StreamMinBytes = 4*1024*1024;
+	
+	const char*		GetChannelNames(SoyPixelsFormat::Type Format);
+	void			RemapPixels(const TRemapper& Remapper,const uint8* Src,uint8* Dst,size_t FirstPixel,size_t PixelCount);
+	void			SwapRows(uint8* RowA,uint8* RowB,size_t RowSize);
+#if defined(SOY_SIMD_SSSE3)
+	size_t			RemapRow_Ssse3(const TRemapper& Remapper,const uint8* Src,uint8* Dst,size_t FirstPixel,size_t Width,bool Stream);
+#endif
 }
 
-bool ConvertFormat_RgbToRgba(ArrayInterface<uint8>& Pixels,SoyPixelsMeta& Meta,SoyPixelsFormat::Type NewFormat)
+
+class SoyPixelsRemap::TRemapper
 {
-	auto& RgbMeta = Meta;
-	auto w = RgbMeta.GetWidth();
-	auto h = RgbMeta.GetHeight();
-	SoyPixelsMeta RgbaMeta( w, h, NewFormat );
-	auto PixelCount = size_cast<int>(w*h);
-	auto RgbStride = RgbMeta.GetPixelDataSize();
-	auto RgbaStride = RgbaMeta.GetPixelDataSize();
-	Pixels.SetSize( RgbaMeta.GetDataSize() );
+public:
+	TRemapper(const TSoyPixelsChannelMap& Map,size_t SrcChannels,bool Stream=false);
 	
-	if ( RgbStride != 3 )
-		throw Soy::AssertException("ConvertFormat_RgbToRgba: Expected source stride of 3 bytes");
-	if ( RgbaStride != 4 )
-		throw Soy::AssertException("ConvertFormat_RgbToRgba: Expected destination stride of 4 bytes");
+	void	RemapRow(const uint8* Src,uint8* Dst,size_t Width) const;
 	
-	//	fill backwards and we won't overwrite anything
-	for ( int p=PixelCount-1;	p>=0;	p-- )
-	{
-		uint8_t* OldPos = &Pixels[p*RgbStride];
-		uint8_t* NewPos = &Pixels[p*RgbaStride];
-		NewPos[0] = OldPos[0];
-		NewPos[1] = OldPos[1];
-		NewPos[2] = OldPos[2];
-		NewPos[3] = 255;
-	}
+public:
+	TSoyPixelsChannelMap	mMap;
+	size_t					mSrcChannels;
+	size_t					mDstChannels;
+	bool					mStream;		//	non-temporal stores
+	uint8					mShuffle[16];	//	pshufb mask for 4 pixels
+	uint8					mFill[16];		//	or'd over the shuffled pixels
+};
+
+
+TSoyPixelsChannelMap::TSoyPixelsChannelMap(std::initializer_list<int> SourceChannels,uint8 FillValue) :
+	mCount		( 0 ),
+	mFillValue	( FillValue )
+{
+	if ( SourceChannels.size() > MaxChannels )
+		throw Soy::AssertException("Too many channels in channel map");
+	for ( auto Channel : SourceChannels )
+		mSource[mCount++] = Channel;
+}
+
+
+TSoyPixelsChannelMap TSoyPixelsChannelMap::Get(SoyPixelsFormat::Type Source,SoyPixelsFormat::Type Destination)
+{
+	TSoyPixelsChannelMap Map;
+	if ( SoyPixelsFormat::IsFloatChannel( Source ) || SoyPixelsFormat::IsFloatChannel( Destination ) )
+		return Map;
 	
-	Meta = RgbaMeta;
+	auto* SourceNames = SoyPixelsRemap::GetChannelNames( Source );
+	auto* DestinationNames = SoyPixelsRemap::GetChannelNames( Destination );
+	if ( !SourceNames || !DestinationNames )
+		return Map;
+	
+	for ( auto* Name=DestinationNames;	*Name;	Name++ )
+	{
+		auto* Match = strchr( SourceNames, *Name );
+		//	greyscale fills all the colour channels
+		if ( !Match && *Name != 'a' )
+			Match = strchr( SourceNames, 'w' );
+		
+		if ( Match )
+			Map.mSource[Map.mCount++] = static_cast<int>( Match - SourceNames );
+		else if ( *Name == 'a' )
+			Map.mSource[Map.mCount++] = Fill;
+		else
+			return TSoyPixelsChannelMap();
+	}
+	return Map;
+}
+
+
+bool TSoyPixelsChannelMap::IsIdentity(size_t SourceChannels) const
+{
+	if ( mCount != SourceChannels )
+		return false;
+	for ( size_t c=0;	c<mCount;	c++ )
+		if ( mSource[c] != static_cast<int>(c) )
+			return false;
 	return true;
 }
 
-bool ConvertFormat_GreyscaleToRgb(ArrayInterface<uint8>& PixelsArray,SoyPixelsMeta& Meta,SoyPixelsFormat::Type NewFormat)
+
+const char* SoyPixelsRemap::GetChannelNames(SoyPixelsFormat::Type Format)
+{
+	switch ( Format )
+	{
+		case SoyPixelsFormat::Greyscale:		return "w";
+		case SoyPixelsFormat::GreyscaleAlpha:	return "wa";
+		case SoyPixelsFormat::RGB:				return "rgb";
+		case SoyPixelsFormat::RGBA:				return "rgba";
+		case SoyPixelsFormat::ARGB:				return "argb";
+		case SoyPixelsFormat::BGRA:				return "bgra";
+		case SoyPixelsFormat::BGR:				return "bgr";
+		default:								return nullptr;
+	}
+}
+
+
+SoyPixelsRemap::TRemapper::TRemapper(const TSoyPixelsChannelMap& Map,size_t SrcChannels,bool Stream) :
+	mMap			( Map ),
+	mSrcChannels	( SrcChannels ),
+	mDstChannels	( Map.mCount ),
+	mStream			( Stream )
+{
+	if ( !Map.IsValid() || SrcChannels == 0 || SrcChannels > TSoyPixelsChannelMap::MaxChannels )
+		throw Soy::AssertException("Invalid channel remap");
+	for ( size_t c=0;	c<mDstChannels;	c++ )
+	{
+		if ( Map.mSource[c] >= static_cast<int>(SrcChannels) )
+		{
+			std::stringstream Error;
+			Error << "Channel remap reads channel " << Map.mSource[c] << " of " << SrcChannels;
+			throw Soy::AssertException( Error.str() );
+		}
+	}
+	
+	//	bytes after the 4 pixels are passed through when remapping in place, otherwise they're overwritten by the next 4
+	const uint8 Zero = 0x80;
+	for ( size_t i=0;	i<16;	i++ )
+	{
+		mShuffle[i] = ( mSrcChannels == mDstChannels ) ? static_cast<uint8>(i) : Zero;
+		mFill[i] = 0;
+	}
+	for ( size_t p=0;	p<4;	p++ )
+	{
+		for ( size_t c=0;	c<mDstChannels;	c++ )
+		{
+			auto i = (p*mDstChannels) + c;
+			auto Source = Map.mSource[c];
+			mShuffle[i] = ( Source < 0 ) ? Zero : static_cast<uint8>( (p*mSrcChannels) + Source );
+			mFill[i] = ( Source < 0 ) ? Map.mFillValue : 0;
+		}
+	}
+}
+
+
+void SoyPixelsRemap::RemapPixels(const TRemapper& Remapper,const uint8* Src,uint8* Dst,size_t FirstPixel,size_t PixelCount)
+{
+	auto SrcChannels = Remapper.mSrcChannels;
+	auto DstChannels = Remapper.mDstChannels;
+	auto& Map = Remapper.mMap;
+	for ( size_t x=FirstPixel;	x<FirstPixel+PixelCount;	x++ )
+	{
+		//	read the whole pixel first so this works in place
+		uint8 Pixel[TSoyPixelsChannelMap::MaxChannels];
+		auto* SrcPixel = &Src[x*SrcChannels];
+		for ( size_t c=0;	c<SrcChannels;	c++ )
+			Pixel[c] = SrcPixel[c];
+		
+		auto* DstPixel = &Dst[x*DstChannels];
+		for ( size_t c=0;	c<DstChannels;	c++ )
+			DstPixel[c] = ( Map.mSource[c] < 0 ) ? Map.mFillValue : Pixel[Map.mSource[c]];
+	}
+}
+
+
+#if defined(SOY_SIMD_SSSE3)
+SOY_SIMD_SSSE3_FUNCTION size_t SoyPixelsRemap::RemapRow_Ssse3(const TRemapper& Remapper,const uint8* Src,uint8* Dst,size_t FirstPixel,size_t Width,bool Stream)
+{
+	auto SrcChannels = Remapper.mSrcChannels;
+	auto DstChannels = Remapper.mDstChannels;
+	auto SrcRowSize = Width * SrcChannels;
+	auto DstRowSize = Width * DstChannels;
+	auto Shuffle = _mm_loadu_si128( reinterpret_cast<const __m128i*>( Remapper.mShuffle ) );
+	auto Fill = _mm_loadu_si128( reinterpret_cast<const __m128i*>( Remapper.mFill ) );
+	
+	//	16 byte loads & stores, so stop before we'd read or write past the end of the row
+	size_t x = FirstPixel;
+	if ( Stream )
+	{
+		for ( ;	x+4<=Width && (x*SrcChannels)+16<=SrcRowSize;	x+=4 )
+		{
+			auto Pixels = _mm_loadu_si128( reinterpret_cast<const __m128i*>( &Src[x*SrcChannels] ) );
+			Pixels = _mm_or_si128( _mm_shuffle_epi8( Pixels, Shuffle ), Fill );
+			_mm_stream_si128( reinterpret_cast<__m128i*>( &Dst[x*DstChannels] ), Pixels );
+		}
+		_mm_sfence();
+		return x;
+	}
+	
+	for ( ;	x+4<=Width && (x*SrcChannels)+16<=SrcRowSize && (x*DstChannels)+16<=DstRowSize;	x+=4 )
+	{
+		auto Pixels = _mm_loadu_si128( reinterpret_cast<const __m128i*>( &Src[x*SrcChannels] ) );
+		Pixels = _mm_or_si128( _mm_shuffle_epi8( Pixels, Shuffle ), Fill );
+		_mm_storeu_si128( reinterpret_cast<__m128i*>( &Dst[x*DstChannels] ), Pixels );
+	}
+	return x;
+}
+#endif
+
+
+void SoyPixelsRemap::TRemapper::RemapRow(const uint8* Src,uint8* Dst,size_t Width) const
+{
+	size_t x = 0;
+#if defined(SOY_SIMD_SSSE3)
+	if ( SoySimd::IsEnabled( SoySimd::Ssse3 ) )
+	{
+		//	streaming needs whole, aligned 16 byte stores, so do any unaligned pixels at the start normally
+		bool Stream = mStream && mDstChannels == 4 && ( reinterpret_cast<uintptr_t>(Dst) % 4 ) == 0;
+		if ( Stream )
+		{
+			while ( x < Width && ( reinterpret_cast<uintptr_t>(&Dst[x*mDstChannels]) % 16 ) != 0 )
+				x++;
+			RemapPixels( *this, Src, Dst, 0, x );
+		}
+		x = RemapRow_Ssse3( *this, Src, Dst, x, Width, Stream );
+	}
+#endif
+	RemapPixels( *this, Src, Dst, x, Width-x );
+}
+
+
+void SoyPixelsRemap::SwapRows(uint8* RowA,uint8* RowB,size_t RowSize)
+{
+	size_t i = 0;
+#if defined(SOY_SIMD_SSE2)
+	if ( SoySimd::IsEnabled( SoySimd::Sse2 ) )
+	{
+		for ( ;	i+16<=RowSize;	i+=16 )
+		{
+			auto* a = reinterpret_cast<__m128i*>( &RowA[i] );
+			auto* b = reinterpret_cast<__m128i*>( &RowB[i] );
+			auto Temp = _mm_loadu_si128( a );
+			_mm_storeu_si128( a, _mm_loadu_si128( b ) );
+			_mm_storeu_si128( b, Temp );
+		}
+	}
+#endif
+	for ( ;	i<RowSize;	i++ )
+		std::swap( RowA[i], RowB[i] );
+}
+
+
+
+void ConvertFormat_BgrToRgb(const TConvertBuffers& Buffers,size_t FirstRow,size_t RowCount)
+{
+	auto Channels = Buffers.mSrcMeta.GetChannels();
+	if ( Channels != Buffers.mDstMeta.GetChannels() )
+		throw Soy::AssertException("ConvertFormat_BgrToRgb: Expected same channel count");
+	
+	auto Map = TSoyPixelsChannelMap::Get( Buffers.mSrcMeta.GetFormat(), Buffers.mDstMeta.GetFormat() );
+	SoyPixelsRemap::TRemapper Remapper( Map, Channels );
+	auto Width = Buffers.mSrcMeta.GetWidth();
+	for ( size_t y=FirstRow;	y<FirstRow+RowCount;	y++ )
+		Remapper.RemapRow( Buffers.GetSrcRow(y), Buffers.GetDstRow(y), Width );
+}
+
+//	any rgb-family swizzle, adding or dropping alpha. Adding alpha grows the rows, so needs a copy of the source
+void ConvertFormat_RemapChannels(const TConvertBuffers& Buffers,size_t FirstRow,size_t RowCount)
+{
+	auto Map = TSoyPixelsChannelMap::Get( Buffers.mSrcMeta.GetFormat(), Buffers.mDstMeta.GetFormat() );
+	if ( Map.mCount != Buffers.mDstMeta.GetChannels() )
+		throw Soy::AssertException("ConvertFormat_RemapChannels: No channel map between formats");
+	
+	SoyPixelsRemap::TRemapper Remapper( Map, Buffers.mSrcMeta.GetChannels() );
+	auto Width = Buffers.mSrcMeta.GetWidth();
+	for ( size_t y=FirstRow;	y<FirstRow+RowCount;	y++ )
+		Remapper.RemapRow( Buffers.GetSrcRow(y), Buffers.GetDstRow(y), Width );
+}
+
+void ConvertFormat_RgbToRgba(const TConvertBuffers& Buffers,size_t FirstRow,size_t RowCount)
+{
+	auto Width = Buffers.mSrcMeta.GetWidth();
+	auto RgbStride = Buffers.mSrcMeta.GetPixelDataSize();
+	auto RgbaStride = Buffers.mDstMeta.GetPixelDataSize();
+	
+	if ( RgbStride != 3 )
+		throw Soy::AssertException("ConvertFormat_RgbToRgba: Expected source stride of 3 bytes");
+	if ( RgbaStride != 4 )
+		throw Soy::AssertException("ConvertFormat_RgbToRgba: Expected destination stride of 4 bytes");
+	
+	//	fill backwards and we won't overwrite anything
+	for ( size_t y=FirstRow+RowCount;	y-->FirstRow;	)
+	{
+		auto* Src = Buffers.GetSrcRow(y);
+		auto* Dst = Buffers.GetDstRow(y);
+		for ( size_t x=Width;	x-->0;	)
+		{
+			const uint8_t* OldPos = &Src[x*RgbStride];
+			uint8_t* NewPos = &Dst[x*RgbaStride];
+			uint8 r = OldPos[0];
+			uint8 g = OldPos[1];
+			uint8 b = OldPos[2];
+			NewPos[0] = r;
+			NewPos[1] = g;
+			NewPos[2] = b;
+			NewPos[3] = 255;
+		}
+	}
+}
+
+void ConvertFormat_GreyscaleToRgb(const TConvertBuffers& Buffers,size_t FirstRow,size_t RowCount)
 {
-	auto& GreyMeta = Meta;
-	auto w = GreyMeta.GetWidth();
-	auto h = GreyMeta.GetHeight();
-	SoyPixelsMeta RgbMeta( w, h, NewFormat );
-	auto PixelCount = size_cast<int>(w*h);
-	auto GreyStride = GreyMeta.GetPixelDataSize();
-	auto RgbStride = RgbMeta.GetPixelDataSize();
-	PixelsArray.SetSize( RgbMeta.GetDataSize() );
+	auto Width = Buffers.mSrcMeta.GetWidth();
+	auto GreyStride = Buffers.mSrcMeta.GetPixelDataSize();
+	auto RgbStride = Buffers.mDstMeta.GetPixelDataSize();
 	
 	if ( GreyStride != 1 )
 		throw Soy::AssertException("ConvertFormat_GreyscaleToRgb: Expected source stride of 1 bytes");
 	if ( RgbStride != 3 )
 		throw Soy::AssertException("ConvertFormat_GreyscaleToRgb: Expected destination stride of 3 bytes");
 	
-	auto* Pixels = PixelsArray.GetArray();
-	
 	//	fill backwards and we won't overwrite anything
-	for ( int p=PixelCount-1;	p>=0;	p-- )
+	for ( size_t y=FirstRow+RowCount;	y-->FirstRow;	)
 	{
-		uint8_t* OldPos = &Pixels[p*GreyStride];
-		uint8_t* NewPos = &Pixels[p*RgbStride];
-		NewPos[0] = OldPos[0];
-		NewPos[1] = OldPos[0];
-		NewPos[2] = OldPos[0];
+		auto* Src = Buffers.GetSrcRow(y);
+		auto* Dst = Buffers.GetDstRow(y);
+		for ( size_t x=Width;	x-->0;	)
+		{
+			uint8 Grey = Src[x*GreyStride];
+			uint8_t* NewPos = &Dst[x*RgbStride];
+			NewPos[0] = Grey;
+			NewPos[1] = Grey;
+			NewPos[2] = Grey;
+		}
 	}
-	
-	Meta = RgbMeta;
-	return true;
 }
 
 
-void ConvertFormat_GreyscaleToRgba(ArrayInterface<uint8>& PixelsArray,SoyPixelsMeta& Meta,SoyPixelsFormat::Type NewFormat)
+void ConvertFormat_GreyscaleToRgba(const TConvertBuffers& Buffers,size_t FirstRow,size_t RowCount)
 {
-	auto& GreyMeta = Meta;
-	auto w = GreyMeta.GetWidth();
-	auto h = GreyMeta.GetHeight();
-	SoyPixelsMeta RgbaMeta( w, h, NewFormat );
-	auto PixelCount = size_cast<int>(w*h);
-	auto GreyStride = GreyMeta.GetPixelDataSize();
-	auto RgbaStride = RgbaMeta.GetPixelDataSize();
-	PixelsArray.SetSize( RgbaMeta.GetDataSize() );
+	auto Width = Buffers.mSrcMeta.GetWidth();
+	auto GreyStride = Buffers.mSrcMeta.GetPixelDataSize();
+	auto RgbaStride = Buffers.mDstMeta.GetPixelDataSize();
 	
 	if ( GreyStride != 1 )
 		throw Soy::AssertException("ConvertFormat_GreyscaleToRgba: Expected source stride of 1 bytes");
 	if ( RgbaStride != 4 )
 		throw Soy::AssertException("ConvertFormat_GreyscaleToRgba: Expected destination stride of 4 bytes");
 	
-	auto* Pixels = PixelsArray.GetArray();
-	
 	//	fill backwards and we won't overwrite anything
-	for ( int p=PixelCount-1;	p>=0;	p-- )
+	for ( size_t y=FirstRow+RowCount;	y-->FirstRow;	)
 	{
-		uint8_t* OldPos = &Pixels[p*GreyStride];
-		uint8_t* NewPos = &Pixels[p*RgbaStride];
-		NewPos[0] = OldPos[0];
-		NewPos[1] = OldPos[0];
-		NewPos[2] = OldPos[0];
-		NewPos[3] = 255;
+		auto* Src = Buffers.GetSrcRow(y);
+		auto* Dst = Buffers.GetDstRow(y);
+		for ( size_t x=Width;	x-->0;	)
+		{
+			uint8 Grey = Src[x*GreyStride];
+			uint8_t* NewPos = &Dst[x*RgbaStride];
+			NewPos[0] = Grey;
+			NewPos[1] = Grey;
+			NewPos[2] = Grey;
+			NewPos[3] = 255;
+		}
 	}
-	
-	Meta = RgbaMeta;
 }
 
 
-bool ConvertFormat_RGBAToGreyscale(ArrayInterface<uint8>& Pixels,SoyPixelsMeta& Meta,SoyPixelsFormat::Type NewFormat)
+void ConvertFormat_RGBAToGreyscale(const TConvertBuffers& Buffers,size_t FirstRow,size_t RowCount)
 {
-	auto Height = Meta.GetHeight();
-	auto PixelCount = Meta.GetWidth() * Height;
-	auto Channels = Meta.GetChannels();
-	auto GreyscaleChannels = SoyPixelsFormat::GetChannelCount(NewFormat);
+	auto Width = Buffers.mSrcMeta.GetWidth();
+	auto Channels = Buffers.mSrcMeta.GetChannels();
+	auto GreyscaleChannels = Buffers.mDstMeta.GetChannels();
 
 	//	todo: store alpha in loop
-	assert( GreyscaleChannels == 1 );
+	if ( GreyscaleChannels != 1 )
+		throw Soy::AssertException("ConvertFormat_RGBAToGreyscale: Expected 1 channel destination");
 
-	for ( int p=0;	p<PixelCount;	p++ )
+	//	shrinking, so fill forwards
+	for ( size_t y=FirstRow;	y<FirstRow+RowCount;	y++ )
 	{
-		float Intensity = 0.f;
-		int ReadChannels = 3;
-		for ( int c=0;	c<ReadChannels;	c++ )
-			Intensity += Pixels[ p*Channels + c ];
-		Intensity /= ReadChannels;
-		
-		uint8& Greyscale = Pixels[ p * GreyscaleChannels ];
-		Greyscale = std::clamped<int>( static_cast<int>(Intensity), 0, 255 );
+		auto* Src = Buffers.GetSrcRow(y);
+		auto* Dst = Buffers.GetDstRow(y);
+		for ( size_t x=0;	x<Width;	x++ )
+		{
+			auto* Pixel = &Src[x*Channels];
+			//	gr: integer average truncates the same as the old float version
+			int Intensity = ( Pixel[0] + Pixel[1] + Pixel[2] ) / 3;
+			Dst[x*GreyscaleChannels] = static_cast<uint8>( Intensity );
+		}
 	}
-
-	//	half the pixels & change format
-	Pixels.SetSize( PixelCount * GreyscaleChannels );
-	Meta.DumbSetFormat( NewFormat );
-	assert( Meta.IsValid() );
-	assert( Meta.GetHeight() == Height );
-	return true;
 }
 
 int GetDepthFormatBits(SoyPixelsFormat::Type Format)
@@ -1100,9 +2111,10 @@ int GetDepthFormatBits(SoyPixelsFormat::Type Format)
 	}
 }
 
-void ConvertDepth16(ArrayInterface<uint8>& Pixels,SoyPixelsMeta& Meta,SoyPixelsFormat::Type NewFormat)
+void ConvertDepth16(const TConvertBuffers& Buffers,size_t FirstRow,size_t RowCount)
 {
-	auto OldFormat = Meta.GetFormat();
+	auto OldFormat = Buffers.mSrcMeta.GetFormat();
+	auto NewFormat = Buffers.mDstMeta.GetFormat();
 
 	//	assume this is a valid depth format...
 	Soy::Assert(SoyPixelsFormat::GetChannelCount(OldFormat) == 2, "expected 2-channel 16 bit depth format" );
@@ -1121,838 +2133,3798 @@ void ConvertDepth16(ArrayInterface<uint8>& Pixels,SoyPixelsMeta& Meta,SoyPixelsF
 	int OldDepthBits = GetDepthFormatBits( OldFormat );
 	//int NewDepthBits = GetDepthFormatBits( NewFormat );
 	
-	uint16* DepthPixels = reinterpret_cast<uint16*>( Pixels.GetArray() );
-	auto PixelCount = Meta.GetWidth() * Meta.GetHeight();
+	auto Width = Buffers.mSrcMeta.GetWidth();
 
 	static bool Debug = false;
 	
-	for ( int p=0;	p<PixelCount;	p++ )
+	for ( size_t y=FirstRow;	y<FirstRow+RowCount;	y++ )
 	{
-		auto& DepthValue = DepthPixels[p];
-		uint16 Depth16 = DepthValue & ((1<<OldDepthBits)-1);
-		//uint16 Player16 = DepthValue >> OldDepthBits;
-		bool InvalidDepth = (Depth16 == OldInvalid);
-		float Depthf = Soy::Range<uint16>( Depth16, OldMin, OldMax );
-		Depthf = std::clamped<float>( Depthf, 0.f, 1.f );
+		auto* SrcPixels = reinterpret_cast<const uint16*>( Buffers.GetSrcRow(y) );
+		auto* DstPixels = reinterpret_cast<uint16*>( Buffers.GetDstRow(y) );
 		
-		if ( OldFrontToBack != NewFrontToBack )
-			Depthf = 1.f - Depthf;
-		
-		if ( InvalidDepth )
-		{
-			//	todo: write player index if both formats have it
-			DepthValue = NewInvalid;
-		}
-		else
+		for ( size_t x=0;	x<Width;	x++ )
 		{
-			//	todo: write player index if both formats have it
-			DepthValue = static_cast<uint16>( Soy::Lerp( NewMin, NewMax, Depthf ) );
+			uint16 Depth16 = SrcPixels[x] & ((1<<OldDepthBits)-1);
+			//uint16 Player16 = SrcPixels[x] >> OldDepthBits;
+			bool InvalidDepth = (Depth16 == OldInvalid);
+			float Depthf = Soy::Range<uint16>( Depth16, OldMin, OldMax );
+			Depthf = std::clamped<float>( Depthf, 0.f, 1.f );
+			
+			if ( OldFrontToBack != NewFrontToBack )
+				Depthf = 1.f - Depthf;
+			
+			auto& DepthValue = DstPixels[x];
+			if ( InvalidDepth )
+			{
+				//	todo: write player index if both formats have it
+				DepthValue = NewInvalid;
+			}
+			else
+			{
+				//	todo: write player index if both formats have it
+				DepthValue = static_cast<uint16>( Soy::Lerp( NewMin, NewMax, Depthf ) );
+			}
+			
+			if ( Debug )
+				std::Debug << Depth16 << "/" << DepthValue << "   ";
 		}
-		
-		if ( Debug )
-			std::Debug << Depth16 << "/" << DepthValue << "   ";
 	}
 	if ( Debug )
 		std::Debug << std::endl;
+}
+
+
+//	gr: integer yuv->rgb so the simd and plain-c paths give identical results.
+//		fixed point with 12 bits of fraction keeps every product inside the 16x16->32 bit madd's
+namespace Yuv
+{
+	namespace TLayout
+	{
+		enum Type
+		{
+			Planar,			//	luma, u, v planes (Yuv_8_8_8)
+			Interleaved,	//	luma, uv plane (Yuv_8_88)
+			Yuyv,			//	YYuv_8888
+			Uyvy,			//	uyvy
+		};
+	}
+
+	const int	FixedShift = 12;
+	const int	FixedRound = 1 << (FixedShift-1);
 	
-	Meta.DumbSetFormat( NewFormat );
+	class TCoefficients;
+	class TRgbCoefficients;
+	class TImage;
+	class TRow;
+
+	typedef void(*TRowFunction)(const TRow& Row,uint8* Rgb,size_t Width,const TCoefficients& Coefficients);
+	//	Rgb1 & Luma1 are null for the last row of odd-height images (which then has no chroma)
+	typedef void(*TFromRgbRowFunction)(const uint8* Rgb0,const uint8* Rgb1,uint8* Luma0,uint8* Luma1,uint8* ChromaU,uint8* ChromaV,size_t Width,const TRgbCoefficients& Coefficients);
+
+	bool			IsYuvFormat(SoyPixelsFormat::Type Format);
+	TLayout::Type	GetLayout(SoyPixelsFormat::Type Format);
+	bool			IsVideoRange(SoyPixelsFormat::Type Format);
+	TRowFunction	GetRowFunction(TLayout::Type Layout,SoyPixelsFormat::Type RgbFormat);
+	TFromRgbRowFunction	GetFromRgbRowFunction(TLayout::Type Layout,SoyPixelsFormat::Type RgbFormat);
+	//	Rgb points at the rgb row FirstRow (so the rgb can be a band of a bigger image)
+	void			ConvertToRgb(const TImage& Image,uint8* Rgb,size_t RgbStride,SoyPixelsFormat::Type RgbFormat,SoyYuvMatrix::Type Matrix,size_t FirstRow,size_t RowCount);
+	void			ConvertFromRgb(const uint8* Rgb,size_t RgbStride,SoyPixelsFormat::Type RgbFormat,const TImage& Image,SoyYuvMatrix::Type Matrix,size_t FirstRow,size_t RowCount);
 }
 
-class TConvertFunc
+
+class Yuv::TCoefficients
 {
 public:
-	TConvertFunc()	{}
-
-	template<typename FUNCTYPE>
-	TConvertFunc(SoyPixelsFormat::Type SrcFormat,SoyPixelsFormat::Type DestFormat,FUNCTYPE Func) :
-		mSrcFormat	( SrcFormat ),
-		mDestFormat	( DestFormat ),
-		mFunction	( Func )
+	TCoefficients(bool VideoRange,SoyYuvMatrix::Type Matrix)
 	{
+		float Kr,Kb;
+		SoyYuvMatrix::GetLumaWeights( Matrix, Kr, Kb );
+		float Kg = 1.f - Kr - Kb;
+		float LumaScale = VideoRange ? (255.f / 219.f) : 1.f;
+		float ChromaScale = VideoRange ? (255.f / 224.f) : 1.f;
+		
+		mLumaOffset = VideoRange ? 16 : 0;
+		mLumaScale = ToFixed( LumaScale );
+		mVRed = ToFixed( 2.f * (1.f-Kr) * ChromaScale );
+		mUGreen = ToFixed( -2.f * (1.f-Kb) * Kb / Kg * ChromaScale );
+		mVGreen = ToFixed( -2.f * (1.f-Kr) * Kr / Kg * ChromaScale );
+		mUBlue = ToFixed( 2.f * (1.f-Kb) * ChromaScale );
 	}
 
-	inline bool		operator==(const std::tuple<SoyPixelsFormat::Type,SoyPixelsFormat::Type>& SrcToDestFormat) const
+	static sint16	ToFixed(float f)	{	return static_cast<sint16>( floorf( f * (1<<FixedShift) + 0.5f ) );	}
+	
+public:
+	sint16	mLumaOffset;
+	sint16	mLumaScale;
+	sint16	mVRed;
+	sint16	mUGreen;
+	sint16	mVGreen;
+	sint16	mUBlue;
+};
+
+
+//	rgb->yuv. Chroma is calculated from the sum of a 2x2 block, so it's shifted 2 more bits
+class Yuv::TRgbCoefficients
+{
+public:
+	TRgbCoefficients(bool VideoRange,SoyYuvMatrix::Type Matrix)
 	{
-		return (std::get<0>( SrcToDestFormat )==mSrcFormat) && (std::get<1>( SrcToDestFormat )==mDestFormat);
+		float Kr,Kb;
+		SoyYuvMatrix::GetLumaWeights( Matrix, Kr, Kb );
+		float Kg = 1.f - Kr - Kb;
+		float LumaScale = VideoRange ? (219.f / 255.f) : 1.f;
+		float ChromaScale = VideoRange ? (224.f / 255.f) : 1.f;
+		
+		mLumaBias = ( (VideoRange ? 16 : 0) << FixedShift ) + FixedRound;
+		mChromaBias = ( 128 << (FixedShift+2) ) + ( 1 << (FixedShift+1) );
+		mLumaRed = TCoefficients::ToFixed( Kr * LumaScale );
+		mLumaGreen = TCoefficients::ToFixed( Kg * LumaScale );
+		mLumaBlue = TCoefficients::ToFixed( Kb * LumaScale );
+		mURed = TCoefficients::ToFixed( -Kr / (2.f*(1.f-Kb)) * ChromaScale );
+		mUGreen = TCoefficients::ToFixed( -Kg / (2.f*(1.f-Kb)) * ChromaScale );
+		mUBlue = TCoefficients::ToFixed( 0.5f * ChromaScale );
+		mVRed = TCoefficients::ToFixed( 0.5f * ChromaScale );
+		mVGreen = TCoefficients::ToFixed( -Kg / (2.f*(1.f-Kr)) * ChromaScale );
+		mVBlue = TCoefficients::ToFixed( -Kb / (2.f*(1.f-Kr)) * ChromaScale );
 	}
+	
+public:
+	int		mLumaBias;
+	int		mChromaBias;
+	sint16	mLumaRed;
+	sint16	mLumaGreen;
+	sint16	mLumaBlue;
+	sint16	mURed;
+	sint16	mUGreen;
+	sint16	mUBlue;
+	sint16	mVRed;
+	sint16	mVGreen;
+	sint16	mVBlue;
+};
 
-	SoyPixelsFormat::Type	mSrcFormat;
-	SoyPixelsFormat::Type	mDestFormat;
-	std::function<void(ArrayInterface<uint8>&,SoyPixelsMeta&,SoyPixelsFormat::Type)>	mFunction;
+
+//	pointers to the luma & chroma of one row
+class Yuv::TRow
+{
+public:
+	const uint8*	mLuma;		//	for packed formats, this is the start of the row
+	const uint8*	mChromaU;
+	const uint8*	mChromaV;
+	size_t			mChromaWidth;	//	last chroma sample is re-used for odd widths
 };
 
 
-TConvertFunc gConversionFuncs[] =
+//	yuv frame split into planes. Pointers are writable so the same layout is used for rgb->yuv
+class Yuv::TImage
 {
-	TConvertFunc( SoyPixelsFormat::KinectDepth, SoyPixelsFormat::FreenectDepth10bit, ConvertDepth16 ),
-	TConvertFunc( SoyPixelsFormat::KinectDepth, SoyPixelsFormat::FreenectDepth11bit, ConvertDepth16 ),
-	TConvertFunc( SoyPixelsFormat::KinectDepth, SoyPixelsFormat::FreenectDepthmm, ConvertDepth16 ),
-	TConvertFunc( SoyPixelsFormat::FreenectDepth10bit, SoyPixelsFormat::FreenectDepthmm, ConvertDepth16 ),
-	TConvertFunc( SoyPixelsFormat::FreenectDepth10bit, SoyPixelsFormat::FreenectDepth11bit, ConvertDepth16 ),
-	TConvertFunc( SoyPixelsFormat::FreenectDepth10bit, SoyPixelsFormat::KinectDepth, ConvertDepth16 ),
-	TConvertFunc( SoyPixelsFormat::FreenectDepth11bit, SoyPixelsFormat::FreenectDepthmm, ConvertDepth16 ),
-	TConvertFunc( SoyPixelsFormat::FreenectDepth11bit, SoyPixelsFormat::FreenectDepth10bit, ConvertDepth16 ),
-	TConvertFunc( SoyPixelsFormat::FreenectDepth11bit, SoyPixelsFormat::KinectDepth, ConvertDepth16 ),
-	TConvertFunc( SoyPixelsFormat::FreenectDepthmm, SoyPixelsFormat::FreenectDepth10bit, ConvertDepth16 ),
-	TConvertFunc( SoyPixelsFormat::FreenectDepthmm, SoyPixelsFormat::FreenectDepth11bit, ConvertDepth16 ),
-	TConvertFunc( SoyPixelsFormat::FreenectDepthmm, SoyPixelsFormat::KinectDepth, ConvertDepth16 ),
-	TConvertFunc( SoyPixelsFormat::KinectDepth, SoyPixelsFormat::RGB, DepthToGreyOrRgb ),
-	TConvertFunc( SoyPixelsFormat::KinectDepth, SoyPixelsFormat::RGBA, DepthToGreyOrRgb ),
-	TConvertFunc( SoyPixelsFormat::KinectDepth, SoyPixelsFormat::Greyscale, DepthToGreyOrRgb ),
-	TConvertFunc( SoyPixelsFormat::FreenectDepth10bit, SoyPixelsFormat::RGB, DepthToGreyOrRgb ),
-	TConvertFunc( SoyPixelsFormat::FreenectDepth10bit, SoyPixelsFormat::RGBA, DepthToGreyOrRgb ),
-	TConvertFunc( SoyPixelsFormat::FreenectDepth10bit, SoyPixelsFormat::Greyscale, DepthToGreyOrRgb ),
-	TConvertFunc( SoyPixelsFormat::FreenectDepth11bit, SoyPixelsFormat::RGB, DepthToGreyOrRgb ),
-	TConvertFunc( SoyPixelsFormat::FreenectDepth11bit, SoyPixelsFormat::RGBA, DepthToGreyOrRgb ),
-	TConvertFunc( SoyPixelsFormat::FreenectDepth11bit, SoyPixelsFormat::Greyscale, DepthToGreyOrRgb ),
-	TConvertFunc( SoyPixelsFormat::FreenectDepthmm, SoyPixelsFormat::RGB, DepthToGreyOrRgb ),
-	TConvertFunc( SoyPixelsFormat::FreenectDepthmm, SoyPixelsFormat::RGBA, DepthToGreyOrRgb ),
-	TConvertFunc( SoyPixelsFormat::FreenectDepthmm, SoyPixelsFormat::Greyscale, DepthToGreyOrRgb ),
-	TConvertFunc( SoyPixelsFormat::BGR, SoyPixelsFormat::Greyscale, ConvertFormat_RGBAToGreyscale ),
-	TConvertFunc( SoyPixelsFormat::BGRA, SoyPixelsFormat::Greyscale, ConvertFormat_RGBAToGreyscale ),
-	TConvertFunc( SoyPixelsFormat::RGBA, SoyPixelsFormat::Greyscale, ConvertFormat_RGBAToGreyscale ),
-	TConvertFunc( SoyPixelsFormat::RGB, SoyPixelsFormat::Greyscale, ConvertFormat_RGBAToGreyscale ),
-	TConvertFunc( SoyPixelsFormat::BGRA, SoyPixelsFormat::RGBA, ConvertFormat_BgrToRgb ),
-	TConvertFunc( SoyPixelsFormat::BGR, SoyPixelsFormat::RGB, ConvertFormat_BgrToRgb ),
-	TConvertFunc( SoyPixelsFormat::RGBA, SoyPixelsFormat::BGRA, ConvertFormat_BgrToRgb ),
-	TConvertFunc( SoyPixelsFormat::RGB, SoyPixelsFormat::BGR, ConvertFormat_BgrToRgb ),
-	TConvertFunc( SoyPixelsFormat::RGB, SoyPixelsFormat::RGBA, ConvertFormat_RgbToRgba ),
-	TConvertFunc( SoyPixelsFormat::Greyscale, SoyPixelsFormat::RGB, ConvertFormat_GreyscaleToRgb ),
-	TConvertFunc( SoyPixelsFormat::Greyscale, SoyPixelsFormat::RGBA, ConvertFormat_GreyscaleToRgba ),
+public:
+	TImage(const SoyPixelsMeta& Meta,uint8* Data,size_t DataSize);
+	
+	TRow			GetRow(size_t y) const;
+	
+public:
+	TLayout::Type	mLayout;
+	size_t			mWidth;
+	size_t			mHeight;
+	uint8*			mLuma;
+	size_t			mLumaStride;
+	uint8*			mChromaU;
+	uint8*			mChromaV;
+	size_t			mChromaStride;
+	size_t			mChromaWidth;
+	size_t			mChromaHeight;
+	bool			mVideoRange;
 };
 
 
-void SoyPixelsImpl::SetFormat(SoyPixelsFormat::Type Format)
+bool Yuv::IsYuvFormat(SoyPixelsFormat::Type Format)
 {
-	auto OldFormat = GetFormat();
-	if ( !SoyPixelsFormat::IsValid( Format ) )
+	switch ( Format )
 	{
-		std::stringstream Error;
-		Error << "Trying to change to " << Format << " (invalid)";
-		throw Soy::AssertException(Error.str());
+		case SoyPixelsFormat::Yuv_8_88_Full:
+		case SoyPixelsFormat::Yuv_8_88_Ntsc:
+		case SoyPixelsFormat::Yuv_8_88_Smptec:
+		case SoyPixelsFormat::Yuv_8_8_8_Full:
+		case SoyPixelsFormat::Yuv_8_8_8_Ntsc:
+		case SoyPixelsFormat::Yuv_8_8_8_Smptec:
+		case SoyPixelsFormat::YYuv_8888_Full:
+		case SoyPixelsFormat::YYuv_8888_Ntsc:
+		case SoyPixelsFormat::YYuv_8888_Smptec:
+		case SoyPixelsFormat::uyvy:
+			return true;
+			
+		default:
+			return false;
 	}
+}
 
-	if ( OldFormat == Format )
-		return;
-	if ( !IsValid() )
-		throw Soy::AssertException("Pixels are not valid");
 
-	auto& PixelsArray = GetPixelsArray();
-	auto ConversionFuncs = GetRemoteArray( gConversionFuncs );
-	auto* ConversionFunc = GetArrayBridge(ConversionFuncs).Find( std::make_tuple( OldFormat, Format ) );
-	if ( ConversionFunc )
+Yuv::TLayout::Type Yuv::GetLayout(SoyPixelsFormat::Type Format)
+{
+	switch ( Format )
 	{
-		std::stringstream TimerName;
-		TimerName << "SoyPixel::SetFormat( " << OldFormat << " to " << Format << " )";
-		Soy::TScopeTimerPrint Timer( TimerName.str().c_str(), 5 );
-
-		ConversionFunc->mFunction( PixelsArray, GetMeta(), Format );
-		return;
+		case SoyPixelsFormat::Yuv_8_88_Full:
+		case SoyPixelsFormat::Yuv_8_88_Ntsc:
+		case SoyPixelsFormat::Yuv_8_88_Smptec:
+			return TLayout::Interleaved;
+			
+		case SoyPixelsFormat::Yuv_8_8_8_Full:
+		case SoyPixelsFormat::Yuv_8_8_8_Ntsc:
+		case SoyPixelsFormat::Yuv_8_8_8_Smptec:
+			return TLayout::Planar;
+			
+		case SoyPixelsFormat::YYuv_8888_Full:
+		case SoyPixelsFormat::YYuv_8888_Ntsc:
+		case SoyPixelsFormat::YYuv_8888_Smptec:
+			return TLayout::Yuyv;
+			
+		case SoyPixelsFormat::uyvy:
+			return TLayout::Uyvy;
+			
+		default:
+			break;
 	}
 	
+	std::stringstream Error;
+	Error << __func__ << " not implemented for " << Format;
+	throw Soy::AssertException( Error.str() );
+}
 
-	if ( GetFormat() == SoyPixelsFormat::KinectDepth && Format == SoyPixelsFormat::Greyscale )
-	{
-		ConvertFormat_KinectDepthToGreyscale( PixelsArray, GetMeta(), Format );
-		return;
-	}
 
-	if ( GetFormat() == SoyPixelsFormat::KinectDepth && Format == SoyPixelsFormat::GreyscaleAlpha )
-	{
-		ConvertFormat_KinectDepthToGreyscale( PixelsArray, GetMeta(), Format );
-		return;
-	}
-
-	//	see if we can use of simple channel-count change
-	bool UseOfPixels = false;
-	UseOfPixels |= ( GetFormat() == SoyPixelsFormat::RGB && Format == SoyPixelsFormat::RGBA );
-	UseOfPixels |= ( GetFormat() == SoyPixelsFormat::RGBA && Format == SoyPixelsFormat::RGB );
-	//UseOfPixels |= ( GetFormat() == SoyPixelsFormat::BGRA && Format == SoyPixelsFormat::BGR );
-	UseOfPixels |= ( GetFormat() == SoyPixelsFormat::RGBA && Format == SoyPixelsFormat::Greyscale );
-	UseOfPixels |= ( GetFormat() == SoyPixelsFormat::RGB && Format == SoyPixelsFormat::Greyscale );
+bool Yuv::IsVideoRange(SoyPixelsFormat::Type Format)
+{
+	//	kinect's uyvy uses video range (see format comments)
+	if ( Format == SoyPixelsFormat::uyvy )
+		return true;
 	
-	//	report missing, but desired conversions
-	std::stringstream Error;
-	Error << "No soypixel conversion from " << OldFormat << " to " << Format;
-	throw Soy::AssertException(Error.str());
+	//	gr: smptec (170M) is video range with the same 601 matrix as ntsc
+	return SoyPixelsFormat::GetYuvFull( Format ) != Format;
 }
 
-#if defined(SOY_OPENCL)
-bool TPixels::SetChannels(uint8 Channels,SoyOpenClManager& OpenClManager,const ofColour& FillerColour)
-{
-	clSetPixelParams Params = _clSetPixelParams();
-	Params.mDefaultColour = ofToCl_Rgba_int4( FillerColour );
-	return SetChannels( Channels, OpenClManager, Params );
-}
-#endif
 
-#if defined(SOY_OPENCL)
-bool TPixels::SetChannels(uint8 Channels,SoyOpenClManager& OpenClManager,const clSetPixelParams& Params)
+Yuv::TImage::TImage(const SoyPixelsMeta& Meta,uint8* Data,size_t DataSize) :
+	mLayout			( GetLayout( Meta.GetFormat() ) ),
+	mWidth			( Meta.GetWidth() ),
+	mHeight			( Meta.GetHeight() ),
+	mLuma			( Data ),
+	mLumaStride		( 0 ),
+	mChromaU		( nullptr ),
+	mChromaV		( nullptr ),
+	mChromaStride	( 0 ),
+	mChromaWidth	( Meta.GetWidth()/2 ),
+	mChromaHeight	( Meta.GetHeight()/2 ),
+	mVideoRange		( IsVideoRange( Meta.GetFormat() ) )
 {
-	if ( Channels < 1 )
-		return false;
-
-	//	skip if no change in channels, unless we have other options
-	if ( Channels == GetChannels() )
-		return true;
-
-	if ( !IsValid() )
-		return false;
-
-	//	use the lovely fast shader!
-	//	non-shader version takes about 340ms for 1080p
-	ClShaderSetPixelChannels Shader( OpenClManager );
-	if ( !Shader.Run( *this, Channels, Params ) )
-		return false;
-	return true;
-}
-#endif
+	size_t ExpectedSize = 0;
 
+	switch ( mLayout )
+	{
+		case TLayout::Planar:
+		case TLayout::Interleaved:
+		{
+			//	plane strides include any row padding
+			BufferArray<SoyPixelsMeta,3> Planes;
+			Meta.GetPlanes( GetArrayBridge(Planes) );
+			auto& LumaPlane = Planes[0];
+			auto& ChromaPlane = Planes[1];
+			mLumaStride = LumaPlane.GetRowPitch();
+			mChromaStride = ChromaPlane.GetRowPitch();
+			mChromaU = mLuma + LumaPlane.GetDataSize();
+			if ( mLayout == TLayout::Planar )
+				mChromaV = mChromaU + (mChromaStride * (mHeight/2));
+			else
+				mChromaV = mChromaU + 1;
+			ExpectedSize = Meta.GetDataSize();
+			
+			//	chroma planes are (w/2)x(h/2), so an image 1 pixel wide or high has no chroma to read
+			if ( mWidth > 0 && mHeight > 0 && ( mChromaWidth == 0 || mChromaHeight == 0 ) )
+			{
+				std::stringstream Error;
+				Error << "Yuv image " << Meta << " has no chroma plane, requires at least 2x2 pixels";
+				throw Soy::AssertException( Error.str() );
+			}
+			break;
+		}
+			
+		case TLayout::Yuyv:
+		case TLayout::Uyvy:
+			//	chroma is on every row
+			mLumaStride = Meta.IsPacked() ? mWidth * 2 : Meta.GetRowPitch();
+			mChromaHeight = mHeight;
+			ExpectedSize = mLumaStride * mHeight;
+			Soy::Assert( mWidth >= 2 || mHeight == 0, "Packed yuv formats require at least 2 pixels width" );
+			break;
+	}
 	
-#if defined(SOY_OPENCL)
-bool TPixels::RgbaToHsla(SoyOpenClManager& OpenClManager,std::shared_ptr<SoyClDataBuffer>& Hsla) const
-{
-	if ( !IsValid() )
-		return false;
-
-	ClShaderRgbaToHsla Shader( OpenClManager );
-	if ( !Shader.Run( *this, Hsla ) )
-		return false;
-
-	return true;
+	if ( DataSize < ExpectedSize )
+	{
+		std::stringstream Error;
+		Error << "Yuv data for " << Meta << " is " << DataSize << " bytes, expected " << ExpectedSize;
+		throw Soy::AssertException( Error.str() );
+	}
 }
-#endif
 
-#if defined(SOY_OPENCL)
-bool TPixels::RgbaToHsla(SoyOpenClManager& OpenClManager,std::shared_ptr<msa::OpenCLImage>& Hsla) const
-{
-	if ( !IsValid() )
-		return false;
 
-	ClShaderRgbaToHsla Shader( OpenClManager );
-	if ( !Shader.Run( *this, Hsla ) )
-		return false;
+Yuv::TRow Yuv::TImage::GetRow(size_t y) const
+{
+	TRow Row;
+	Row.mLuma = mLuma + (y * mLumaStride);
+	Row.mChromaWidth = mChromaWidth;
+	
+	if ( mLayout == TLayout::Yuyv || mLayout == TLayout::Uyvy )
+	{
+		Row.mChromaU = nullptr;
+		Row.mChromaV = nullptr;
+		return Row;
+	}
 
-	return true;
+	auto ChromaY = std::min( y/2, mChromaHeight-1 );
+	Row.mChromaU = mChromaU + (ChromaY * mChromaStride);
+	Row.mChromaV = mChromaV + (ChromaY * mChromaStride);
+	return Row;
 }
-#endif
 
-#if defined(SOY_OPENCL)
-bool TPixels::RgbaToHsla(SoyOpenClManager& OpenClManager)
-{
-	if ( !IsValid() )
-		return false;
 
-	ClShaderRgbaToHsla Shader( OpenClManager );
-	if ( !Shader.Run( *this ) )
-		return false;
-	return true;
+namespace Yuv
+{
+	inline uint8	ClampFixed(int Value)
+	{
+		Value >>= FixedShift;
+		return static_cast<uint8>( (Value < 0) ? 0 : ((Value > 255) ? 255 : Value) );
+	}
+	
+	template<TLayout::Type LAYOUT>
+	inline void		GetYuv(const TRow& Row,size_t x,int& Luma,int& ChromaU,int& ChromaV)
+	{
+		auto ChromaX = std::min( x/2, Row.mChromaWidth-1 );
+		switch ( LAYOUT )
+		{
+			case TLayout::Planar:
+				Luma = Row.mLuma[x];
+				ChromaU = Row.mChromaU[ChromaX];
+				ChromaV = Row.mChromaV[ChromaX];
+				break;
+				
+			case TLayout::Interleaved:
+				Luma = Row.mLuma[x];
+				ChromaU = Row.mChromaU[ChromaX*2];
+				ChromaV = Row.mChromaV[ChromaX*2];
+				break;
+				
+			case TLayout::Yuyv:
+				Luma = Row.mLuma[x*2];
+				ChromaU = Row.mLuma[ChromaX*4+1];
+				ChromaV = Row.mLuma[ChromaX*4+3];
+				break;
+				
+			case TLayout::Uyvy:
+				Luma = Row.mLuma[x*2+1];
+				ChromaU = Row.mLuma[ChromaX*4+0];
+				ChromaV = Row.mLuma[ChromaX*4+2];
+				break;
+		}
+	}
+	
+	template<TLayout::Type LAYOUT,int CHANNELS,bool BGR>
+	void			ConvertRow_Plain(const TRow& Row,uint8* Rgb,size_t FirstX,size_t Width,const TCoefficients& Coefficients)
+	{
+		for ( size_t x=FirstX;	x<Width;	x++ )
+		{
+			int Luma,ChromaU,ChromaV;
+			GetYuv<LAYOUT>( Row, x, Luma, ChromaU, ChromaV );
+			
+			int y = (Luma - Coefficients.mLumaOffset) * Coefficients.mLumaScale + FixedRound;
+			int u = ChromaU - 128;
+			int v = ChromaV - 128;
+			
+			uint8* Pixel = &Rgb[x*CHANNELS];
+			Pixel[BGR ? 2 : 0] = ClampFixed( y + v * Coefficients.mVRed );
+			Pixel[1] = ClampFixed( y + u * Coefficients.mUGreen + v * Coefficients.mVGreen );
+			Pixel[BGR ? 0 : 2] = ClampFixed( y + u * Coefficients.mUBlue );
+			if ( CHANNELS == 4 )
+				Pixel[3] = 255;
+		}
+	}
+	
+	template<TLayout::Type LAYOUT,int CHANNELS,bool BGR>
+	void			ConvertRow_Plain(const TRow& Row,uint8* Rgb,size_t Width,const TCoefficients& Coefficients)
+	{
+		ConvertRow_Plain<LAYOUT,CHANNELS,BGR>( Row, Rgb, 0, Width, Coefficients );
+	}
 }
-#endif
 
-#if defined(SOY_OPENCL)
-bool TPixels::Set(const msa::OpenCLImage& PixelsConst,SoyOpenClKernel& Kernel)
-{
-	if ( !Kernel.IsValid() )
-		return false;
 
-	return Set( PixelsConst, Kernel.GetQueue() );
+#if defined(SOY_SIMD_SSE2)
+namespace Yuv
+{
+	inline int		LoadInt32(const uint8* Data)
+	{
+		int Value;
+		memcpy( &Value, Data, sizeof(Value) );
+		return Value;
+	}
+	
+	//	load 8 pixels as 16 bit luma, u and v lanes (chroma duplicated for each pixel pair)
+	template<TLayout::Type LAYOUT>
+	inline void		Load8_Sse2(const TRow& Row,size_t x,__m128i& Luma,__m128i& ChromaU,__m128i& ChromaV)
+	{
+		auto Zero = _mm_setzero_si128();
+		switch ( LAYOUT )
+		{
+			case TLayout::Planar:
+			{
+				Luma = _mm_unpacklo_epi8( _mm_loadl_epi64( reinterpret_cast<const __m128i*>( Row.mLuma + x ) ), Zero );
+				auto u = _mm_unpacklo_epi8( _mm_cvtsi32_si128( LoadInt32( Row.mChromaU + x/2 ) ), Zero );
+				auto v = _mm_unpacklo_epi8( _mm_cvtsi32_si128( LoadInt32( Row.mChromaV + x/2 ) ), Zero );
+				ChromaU = _mm_unpacklo_epi16( u, u );
+				ChromaV = _mm_unpacklo_epi16( v, v );
+				break;
+			}
+			
+			case TLayout::Interleaved:
+			{
+				Luma = _mm_unpacklo_epi8( _mm_loadl_epi64( reinterpret_cast<const __m128i*>( Row.mLuma + x ) ), Zero );
+				auto uv = _mm_unpacklo_epi8( _mm_loadl_epi64( reinterpret_cast<const __m128i*>( Row.mChromaU + x ) ), Zero );
+				ChromaU = _mm_shufflehi_epi16( _mm_shufflelo_epi16( uv, _MM_SHUFFLE(2,2,0,0) ), _MM_SHUFFLE(2,2,0,0) );
+				ChromaV = _mm_shufflehi_epi16( _mm_shufflelo_epi16( uv, _MM_SHUFFLE(3,3,1,1) ), _MM_SHUFFLE(3,3,1,1) );
+				break;
+			}
+			
+			case TLayout::Yuyv:
+			case TLayout::Uyvy:
+			{
+				auto Packed = _mm_loadu_si128( reinterpret_cast<const __m128i*>( Row.mLuma + x*2 ) );
+				auto LowBytes = _mm_and_si128( Packed, _mm_set1_epi16(0xff) );
+				auto HighBytes = _mm_srli_epi16( Packed, 8 );
+				Luma = (LAYOUT == TLayout::Yuyv) ? LowBytes : HighBytes;
+				auto uv = (LAYOUT == TLayout::Yuyv) ? HighBytes : LowBytes;
+				ChromaU = _mm_shufflehi_epi16( _mm_shufflelo_epi16( uv, _MM_SHUFFLE(2,2,0,0) ), _MM_SHUFFLE(2,2,0,0) );
+				ChromaV = _mm_shufflehi_epi16( _mm_shufflelo_epi16( uv, _MM_SHUFFLE(3,3,1,1) ), _MM_SHUFFLE(3,3,1,1) );
+				break;
+			}
+		}
+	}
+	
+	//	(a*ca + b*cb + round) >> shift for 8 lanes, saturated to 16 bit
+	inline __m128i	MulAdd_Sse2(__m128i a,__m128i b,__m128i Coefficients,__m128i Bias)
+	{
+		auto Low = _mm_add_epi32( _mm_madd_epi16( _mm_unpacklo_epi16( a, b ), Coefficients ), Bias );
+		auto High = _mm_add_epi32( _mm_madd_epi16( _mm_unpackhi_epi16( a, b ), Coefficients ), Bias );
+		return _mm_packs_epi32( _mm_srai_epi32( Low, FixedShift ), _mm_srai_epi32( High, FixedShift ) );
+	}
+	
+	template<TLayout::Type LAYOUT,int CHANNELS,bool BGR>
+	void			ConvertRow_Sse2(const TRow& Row,uint8* Rgb,size_t Width,const TCoefficients& Coefficients)
+	{
+		auto Zero = _mm_setzero_si128();
+		auto Round = _mm_set1_epi32( FixedRound );
+		auto LumaOffset = _mm_set1_epi16( Coefficients.mLumaOffset );
+		auto ChromaOffset = _mm_set1_epi16( 128 );
+		auto Red = _mm_set_epi16( Coefficients.mVRed, Coefficients.mLumaScale, Coefficients.mVRed, Coefficients.mLumaScale, Coefficients.mVRed, Coefficients.mLumaScale, Coefficients.mVRed, Coefficients.mLumaScale );
+		auto GreenU = _mm_set_epi16( Coefficients.mUGreen, Coefficients.mLumaScale, Coefficients.mUGreen, Coefficients.mLumaScale, Coefficients.mUGreen, Coefficients.mLumaScale, Coefficients.mUGreen, Coefficients.mLumaScale );
+		auto GreenV = _mm_set_epi16( 0, Coefficients.mVGreen, 0, Coefficients.mVGreen, 0, Coefficients.mVGreen, 0, Coefficients.mVGreen );
+		auto Blue = _mm_set_epi16( Coefficients.mUBlue, Coefficients.mLumaScale, Coefficients.mUBlue, Coefficients.mLumaScale, Coefficients.mUBlue, Coefficients.mLumaScale, Coefficients.mUBlue, Coefficients.mLumaScale );
+		auto Alpha = _mm_set1_epi8( static_cast<char>(0xff) );
+		
+		size_t x = 0;
+		for ( ;	x+8<=Width;	x+=8 )
+		{
+			__m128i y,u,v;
+			Load8_Sse2<LAYOUT>( Row, x, y, u, v );
+			y = _mm_sub_epi16( y, LumaOffset );
+			u = _mm_sub_epi16( u, ChromaOffset );
+			v = _mm_sub_epi16( v, ChromaOffset );
+			
+			//	green is y*scale + u*ug + v*vg, so do the v part seperately with the round, then add it as the bias
+			auto GreenVLow = _mm_add_epi32( _mm_madd_epi16( _mm_unpacklo_epi16( v, Zero ), GreenV ), Round );
+			auto GreenVHigh = _mm_add_epi32( _mm_madd_epi16( _mm_unpackhi_epi16( v, Zero ), GreenV ), Round );
+			auto GreenLow = _mm_add_epi32( _mm_madd_epi16( _mm_unpacklo_epi16( y, u ), GreenU ), GreenVLow );
+			auto GreenHigh = _mm_add_epi32( _mm_madd_epi16( _mm_unpackhi_epi16( y, u ), GreenU ), GreenVHigh );
+			
+			auto r16 = MulAdd_Sse2( y, v, Red, Round );
+			auto g16 = _mm_packs_epi32( _mm_srai_epi32( GreenLow, FixedShift ), _mm_srai_epi32( GreenHigh, FixedShift ) );
+			auto b16 = MulAdd_Sse2( y, u, Blue, Round );
+			
+			auto r8 = _mm_packus_epi16( BGR ? b16 : r16, Zero );
+			auto g8 = _mm_packus_epi16( g16, Zero );
+			auto b8 = _mm_packus_epi16( BGR ? r16 : b16, Zero );
+			
+			auto rg = _mm_unpacklo_epi8( r8, g8 );
+			auto ba = _mm_unpacklo_epi8( b8, Alpha );
+			auto Rgba0 = _mm_unpacklo_epi16( rg, ba );
+			auto Rgba1 = _mm_unpackhi_epi16( rg, ba );
+			
+			uint8* Dst = &Rgb[x*CHANNELS];
+			if ( CHANNELS == 4 )
+			{
+				_mm_storeu_si128( reinterpret_cast<__m128i*>( Dst ), Rgba0 );
+				_mm_storeu_si128( reinterpret_cast<__m128i*>( Dst+16 ), Rgba1 );
+			}
+			else
+			{
+				uint8 Rgba[32];
+				_mm_storeu_si128( reinterpret_cast<__m128i*>( Rgba ), Rgba0 );
+				_mm_storeu_si128( reinterpret_cast<__m128i*>( Rgba+16 ), Rgba1 );
+				for ( int p=0;	p<8;	p++ )
+				{
+					Dst[p*3+0] = Rgba[p*4+0];
+					Dst[p*3+1] = Rgba[p*4+1];
+					Dst[p*3+2] = Rgba[p*4+2];
+				}
+			}
+		}
+		
+		ConvertRow_Plain<LAYOUT,CHANNELS,BGR>( Row, Rgb, x, Width, Coefficients );
+	}
 }
 #endif
 
 
-#if defined(SOY_OPENCL)
-bool TPixels::Set(const msa::OpenCLImage& PixelsConst,cl_command_queue Queue)
+#if defined(SOY_SIMD_AVX2)
+namespace Yuv
 {
-	if ( !Queue )
-		return false;
-
-	uint8 Channels = PixelsConst.getDepth();
-	auto& Pixels = const_cast<msa::OpenCLImage&>( PixelsConst );
-	//	clformat is either RGBA(4 chan) or A/LUM(1 chan)
-	if ( Channels != 1 && Channels != 4 )
+	//	duplicate 8 u8's into 16 u16 lanes
+	SOY_SIMD_AVX2_FUNCTION inline __m256i	DuplicateChroma8_Avx2(const uint8* Chroma)
 	{
-		assert( false );
-		Clear();
-		return false;
+		auto c = _mm_unpacklo_epi8( _mm_loadl_epi64( reinterpret_cast<const __m128i*>( Chroma ) ), _mm_setzero_si128() );
+		auto Low = _mm_unpacklo_epi16( c, c );
+		auto High = _mm_unpackhi_epi16( c, c );
+		return _mm256_inserti128_si256( _mm256_castsi128_si256( Low ), High, 1 );
 	}
 	
-	mMeta.DumbSetWidth( Pixels.getWidth() );
-	mMeta.DumbSetFormat( SoyPixelsFormat::GetFormatFromChannelCount( Channels ) );
-	int Alloc = GetWidth() * GetChannels() * Pixels.getHeight();
-	if ( !mPixels.SetSize( Alloc, false, true ) )
-		return false;
-
-	bool Blocking = true;
-	if ( !Pixels.read( Queue, mPixels.GetArray(), Blocking ) )
+	//	load 16 pixels as 16 bit luma, u and v lanes
+	template<TLayout::Type LAYOUT>
+	SOY_SIMD_AVX2_FUNCTION inline void		Load16_Avx2(const TRow& Row,size_t x,__m256i& Luma,__m256i& ChromaU,__m256i& ChromaV)
 	{
-		Clear();
-		return false;
+		switch ( LAYOUT )
+		{
+			case TLayout::Planar:
+			{
+				Luma = _mm256_cvtepu8_epi16( _mm_loadu_si128( reinterpret_cast<const __m128i*>( Row.mLuma + x ) ) );
+				ChromaU = DuplicateChroma8_Avx2( Row.mChromaU + x/2 );
+				ChromaV = DuplicateChroma8_Avx2( Row.mChromaV + x/2 );
+				break;
+			}
+				
+			case TLayout::Interleaved:
+			{
+				Luma = _mm256_cvtepu8_epi16( _mm_loadu_si128( reinterpret_cast<const __m128i*>( Row.mLuma + x ) ) );
+				auto uv = _mm256_cvtepu8_epi16( _mm_loadu_si128( reinterpret_cast<const __m128i*>( Row.mChromaU + x ) ) );
+				ChromaU = _mm256_shufflehi_epi16( _mm256_shufflelo_epi16( uv, _MM_SHUFFLE(2,2,0,0) ), _MM_SHUFFLE(2,2,0,0) );
+				ChromaV = _mm256_shufflehi_epi16( _mm256_shufflelo_epi16( uv, _MM_SHUFFLE(3,3,1,1) ), _MM_SHUFFLE(3,3,1,1) );
+				break;
+			}
+				
+			case TLayout::Yuyv:
+			case TLayout::Uyvy:
+			{
+				auto Packed = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( Row.mLuma + x*2 ) );
+				auto LowBytes = _mm256_and_si256( Packed, _mm256_set1_epi16(0xff) );
+				auto HighBytes = _mm256_srli_epi16( Packed, 8 );
+				Luma = (LAYOUT == TLayout::Yuyv) ? LowBytes : HighBytes;
+				auto uv = (LAYOUT == TLayout::Yuyv) ? HighBytes : LowBytes;
+				ChromaU = _mm256_shufflehi_epi16( _mm256_shufflelo_epi16( uv, _MM_SHUFFLE(2,2,0,0) ), _MM_SHUFFLE(2,2,0,0) );
+				ChromaV = _mm256_shufflehi_epi16( _mm256_shufflelo_epi16( uv, _MM_SHUFFLE(3,3,1,1) ), _MM_SHUFFLE(3,3,1,1) );
+				break;
+			}
+		}
+	}
+	
+	//	a in the low 16 bits, b in the high, to match unpacklo(a,b)
+	SOY_SIMD_AVX2_FUNCTION inline __m256i	SetPair_Avx2(sint16 a,sint16 b)
+	{
+		auto Pair = static_cast<uint32>( static_cast<uint16>(a) ) | ( static_cast<uint32>( static_cast<uint16>(b) ) << 16 );
+		return _mm256_set1_epi32( static_cast<int>( Pair ) );
+	}
+	
+	SOY_SIMD_AVX2_FUNCTION inline __m256i	PackFixed_Avx2(__m256i Low,__m256i High)
+	{
+		return _mm256_packs_epi32( _mm256_srai_epi32( Low, FixedShift ), _mm256_srai_epi32( High, FixedShift ) );
 	}
+	
+	//	gr: unpack/madd/pack all work within 128 bit lanes, and undo each other, so pixel order is maintained until the final interleave
+	template<TLayout::Type LAYOUT,int CHANNELS,bool BGR>
+	SOY_SIMD_AVX2_FUNCTION void	ConvertRow_Avx2(const TRow& Row,uint8* Rgb,size_t Width,const TCoefficients& Coefficients)
+	{
+		auto Zero = _mm256_setzero_si256();
+		auto Round = _mm256_set1_epi32( FixedRound );
+		auto LumaOffset = _mm256_set1_epi16( Coefficients.mLumaOffset );
+		auto ChromaOffset = _mm256_set1_epi16( 128 );
+		auto Red = SetPair_Avx2( Coefficients.mLumaScale, Coefficients.mVRed );
+		auto GreenU = SetPair_Avx2( Coefficients.mLumaScale, Coefficients.mUGreen );
+		auto GreenV = SetPair_Avx2( Coefficients.mVGreen, 0 );
+		auto Blue = SetPair_Avx2( Coefficients.mLumaScale, Coefficients.mUBlue );
+		auto Alpha = _mm256_set1_epi8( static_cast<char>(0xff) );
+
+		size_t x = 0;
+		for ( ;	x+16<=Width;	x+=16 )
+		{
+			__m256i y,u,v;
+			Load16_Avx2<LAYOUT>( Row, x, y, u, v );
+			y = _mm256_sub_epi16( y, LumaOffset );
+			u = _mm256_sub_epi16( u, ChromaOffset );
+			v = _mm256_sub_epi16( v, ChromaOffset );
+			
+			auto RedLow = _mm256_add_epi32( _mm256_madd_epi16( _mm256_unpacklo_epi16( y, v ), Red ), Round );
+			auto RedHigh = _mm256_add_epi32( _mm256_madd_epi16( _mm256_unpackhi_epi16( y, v ), Red ), Round );
+			auto GreenLow = _mm256_add_epi32( _mm256_madd_epi16( _mm256_unpacklo_epi16( y, u ), GreenU ), _mm256_madd_epi16( _mm256_unpacklo_epi16( v, Zero ), GreenV ) );
+			auto GreenHigh = _mm256_add_epi32( _mm256_madd_epi16( _mm256_unpackhi_epi16( y, u ), GreenU ), _mm256_madd_epi16( _mm256_unpackhi_epi16( v, Zero ), GreenV ) );
+			auto BlueLow = _mm256_add_epi32( _mm256_madd_epi16( _mm256_unpacklo_epi16( y, u ), Blue ), Round );
+			auto BlueHigh = _mm256_add_epi32( _mm256_madd_epi16( _mm256_unpackhi_epi16( y, u ), Blue ), Round );
+			GreenLow = _mm256_add_epi32( GreenLow, Round );
+			GreenHigh = _mm256_add_epi32( GreenHigh, Round );
+			
+			auto r16 = PackFixed_Avx2( RedLow, RedHigh );
+			auto g16 = PackFixed_Avx2( GreenLow, GreenHigh );
+			auto b16 = PackFixed_Avx2( BlueLow, BlueHigh );
 
-	//	check for corruption as there is no size checking in the read :/
-	mPixels.GetHeap().Debug_Validate( mPixels.GetArray() );
-	return true;
+			auto r8 = _mm256_packus_epi16( BGR ? b16 : r16, Zero );
+			auto g8 = _mm256_packus_epi16( g16, Zero );
+			auto b8 = _mm256_packus_epi16( BGR ? r16 : b16, Zero );
+			
+			auto rg = _mm256_unpacklo_epi8( r8, g8 );
+			auto ba = _mm256_unpacklo_epi8( b8, Alpha );
+			auto Low = _mm256_unpacklo_epi16( rg, ba );		//	pixels 0-3, 8-11
+			auto High = _mm256_unpackhi_epi16( rg, ba );	//	pixels 4-7, 12-15
+			auto Rgba0 = _mm256_permute2x128_si256( Low, High, 0x20 );
+			auto Rgba1 = _mm256_permute2x128_si256( Low, High, 0x31 );
+
+			uint8* Dst = &Rgb[x*CHANNELS];
+			if ( CHANNELS == 4 )
+			{
+				_mm256_storeu_si256( reinterpret_cast<__m256i*>( Dst ), Rgba0 );
+				_mm256_storeu_si256( reinterpret_cast<__m256i*>( Dst+32 ), Rgba1 );
+			}
+			else
+			{
+				uint8 Rgba[64];
+				_mm256_storeu_si256( reinterpret_cast<__m256i*>( Rgba ), Rgba0 );
+				_mm256_storeu_si256( reinterpret_cast<__m256i*>( Rgba+32 ), Rgba1 );
+				for ( int p=0;	p<16;	p++ )
+				{
+					Dst[p*3+0] = Rgba[p*4+0];
+					Dst[p*3+1] = Rgba[p*4+1];
+					Dst[p*3+2] = Rgba[p*4+2];
+				}
+			}
+		}
+		
+		ConvertRow_Plain<LAYOUT,CHANNELS,BGR>( Row, Rgb, x, Width, Coefficients );
+	}
 }
 #endif
 
 
-
-void SoyPixelsImpl::Init(size_t Width, size_t Height, size_t Channels)
-{
-	auto Format = SoyPixelsFormat::GetFormatFromChannelCount( Channels );
-	Init( Width, Height, Format );
-}
-
-void SoyPixelsImpl::Init(size_t Width, size_t Height,SoyPixelsFormat::Type Format)
+namespace Yuv
 {
-	Init( SoyPixelsMeta( Width, Height, Format ) );
+	template<TLayout::Type LAYOUT,int CHANNELS,bool BGR>
+	TRowFunction	GetRowFunction()
+	{
+		auto Simd = SoySimd::GetEnabled();
+#if defined(SOY_SIMD_AVX2)
+		if ( Simd >= SoySimd::Avx2 )
+			return ConvertRow_Avx2<LAYOUT,CHANNELS,BGR>;
+#endif
+#if defined(SOY_SIMD_SSE2)
+		if ( Simd >= SoySimd::Sse2 )
+			return ConvertRow_Sse2<LAYOUT,CHANNELS,BGR>;
+#endif
+		return ConvertRow_Plain<LAYOUT,CHANNELS,BGR>;
+	}
+	
+	template<TLayout::Type LAYOUT>
+	TRowFunction	GetRowFunction(SoyPixelsFormat::Type RgbFormat)
+	{
+		switch ( RgbFormat )
+		{
+			case SoyPixelsFormat::RGB:	return GetRowFunction<LAYOUT,3,false>();
+			case SoyPixelsFormat::BGR:	return GetRowFunction<LAYOUT,3,true>();
+			case SoyPixelsFormat::RGBA:	return GetRowFunction<LAYOUT,4,false>();
+			case SoyPixelsFormat::BGRA:	return GetRowFunction<LAYOUT,4,true>();
+			default:
+				break;
+		}
+		
+		std::stringstream Error;
+		Error << "No yuv conversion to " << RgbFormat;
+		throw Soy::AssertException( Error.str() );
+	}
 }
 
 
-void SoyPixelsImpl::Init(const SoyPixelsMeta& Meta)
+Yuv::TRowFunction Yuv::GetRowFunction(TLayout::Type Layout,SoyPixelsFormat::Type RgbFormat)
 {
-	auto Width = Meta.GetWidth();
-	auto Height = Meta.GetHeight();
-	auto Format = Meta.GetFormat();
-	
-	//	alloc
-	GetMeta().DumbSetWidth( Width );
-	GetMeta().DumbSetHeight( Height );
-	GetMeta().DumbSetFormat( Format );
-	auto Alloc = GetMeta().GetDataSize();
-	auto& Pixels = GetPixelsArray();
-	Pixels.SetSize( Alloc, false );
+	switch ( Layout )
+	{
+		case TLayout::Planar:		return GetRowFunction<TLayout::Planar>( RgbFormat );
+		case TLayout::Interleaved:	return GetRowFunction<TLayout::Interleaved>( RgbFormat );
+		case TLayout::Yuyv:			return GetRowFunction<TLayout::Yuyv>( RgbFormat );
+		case TLayout::Uyvy:			return GetRowFunction<TLayout::Uyvy>( RgbFormat );
+	}
+	throw Soy::AssertException("Unhandled yuv layout");
 }
 
 
-void SoyPixelsImpl::Clear(bool Dealloc)
+void Yuv::ConvertToRgb(const TImage& Image,uint8* Rgb,size_t RgbStride,SoyPixelsFormat::Type RgbFormat,SoyYuvMatrix::Type Matrix,size_t FirstRow,size_t RowCount)
 {
-	//	gr: leaving format as it might be useful as ghost meta
-	//GetMeta().DumbSetFormat( SoyPixelsFormat::Invalid );
-	GetMeta().DumbSetWidth( 0 );
-	auto& Pixels = GetPixelsArray();
-	Pixels.Clear( Dealloc );
-
-	Soy::Assert( GetHeight() == 0, "Height should be 0 after clear");
-	Soy::Assert( !IsValid(), "should be invalid after clear");
+	auto RowFunction = GetRowFunction( Image.mLayout, RgbFormat );
+	TCoefficients Coefficients( Image.mVideoRange, Matrix );
+	
+	for ( size_t y=FirstRow;	y<FirstRow+RowCount;	y++ )
+	{
+		auto Row = Image.GetRow( y );
+		RowFunction( Row, Rgb + ((y-FirstRow)*RgbStride), Image.mWidth, Coefficients );
+	}
 }
 
 
-bool SoyPixelsImpl::GetRawSoyPixels(ArrayBridge<char>& RawData) const
+namespace Yuv
 {
-	if ( !IsValid() )
-		return false;
+	template<int CHANNELS,bool BGR>
+	inline void		GetRgb(const uint8* Rgb,size_t x,int& Red,int& Green,int& Blue)
+	{
+		auto* Pixel = &Rgb[x*CHANNELS];
+		Red = Pixel[BGR ? 2 : 0];
+		Green = Pixel[1];
+		Blue = Pixel[BGR ? 0 : 2];
+	}
+	
+	template<int CHANNELS,bool BGR>
+	inline uint8	GetLuma(const uint8* Rgb,size_t x,const TRgbCoefficients& Coefficients)
+	{
+		int r,g,b;
+		GetRgb<CHANNELS,BGR>( Rgb, x, r, g, b );
+		return ClampFixed( r * Coefficients.mLumaRed + g * Coefficients.mLumaGreen + b * Coefficients.mLumaBlue + Coefficients.mLumaBias );
+	}
+	
+	//	FirstX must be even
+	template<TLayout::Type LAYOUT,int CHANNELS,bool BGR>
+	void			ConvertFromRgbRow_Plain(const uint8* Rgb0,const uint8* Rgb1,uint8* Luma0,uint8* Luma1,uint8* ChromaU,uint8* ChromaV,size_t FirstX,size_t Width,const TRgbCoefficients& Coefficients)
+	{
+		for ( size_t x=FirstX;	x<Width;	x++ )
+		{
+			Luma0[x] = GetLuma<CHANNELS,BGR>( Rgb0, x, Coefficients );
+			if ( Rgb1 )
+				Luma1[x] = GetLuma<CHANNELS,BGR>( Rgb1, x, Coefficients );
+		}
+		
+		if ( !Rgb1 )
+			return;
+		
+		//	chroma from the sum of each whole 2x2 block
+		const size_t ChromaStep = (LAYOUT == TLayout::Interleaved) ? 2 : 1;
+		for ( size_t x=FirstX;	x+1<Width;	x+=2 )
+		{
+			int r[4],g[4],b[4];
+			GetRgb<CHANNELS,BGR>( Rgb0, x+0, r[0], g[0], b[0] );
+			GetRgb<CHANNELS,BGR>( Rgb0, x+1, r[1], g[1], b[1] );
+			GetRgb<CHANNELS,BGR>( Rgb1, x+0, r[2], g[2], b[2] );
+			GetRgb<CHANNELS,BGR>( Rgb1, x+1, r[3], g[3], b[3] );
+			int Red = r[0] + r[1] + r[2] + r[3];
+			int Green = g[0] + g[1] + g[2] + g[3];
+			int Blue = b[0] + b[1] + b[2] + b[3];
+			
+			int u = Red * Coefficients.mURed + Green * Coefficients.mUGreen + Blue * Coefficients.mUBlue + Coefficients.mChromaBias;
+			int v = Red * Coefficients.mVRed + Green * Coefficients.mVGreen + Blue * Coefficients.mVBlue + Coefficients.mChromaBias;
+			ChromaU[(x/2)*ChromaStep] = ClampFixed( u >> 2 );
+			ChromaV[(x/2)*ChromaStep] = ClampFixed( v >> 2 );
+		}
+	}
+	
+	template<TLayout::Type LAYOUT,int CHANNELS,bool BGR>
+	void			ConvertFromRgbRow_Plain(const uint8* Rgb0,const uint8* Rgb1,uint8* Luma0,uint8* Luma1,uint8* ChromaU,uint8* ChromaV,size_t Width,const TRgbCoefficients& Coefficients)
+	{
+		ConvertFromRgbRow_Plain<LAYOUT,CHANNELS,BGR>( Rgb0, Rgb1, Luma0, Luma1, ChromaU, ChromaV, 0, Width, Coefficients );
+	}
+}
 
-	//	write header/meta
-	auto& Pixels = GetPixelsArray();
-	auto& Meta = GetMeta();
+
+#if defined(SOY_SIMD_SSE2)
+namespace Yuv
+{
+	//	load 8 pixels into 16 bit r, g & b lanes
+	template<int CHANNELS,bool BGR>
+	inline void		LoadRgb8_Sse2(const uint8* Rgb,__m128i& Red,__m128i& Green,__m128i& Blue)
+	{
+		__m128i Pixels0,Pixels1;
+		if ( CHANNELS == 4 )
+		{
+			Pixels0 = _mm_loadu_si128( reinterpret_cast<const __m128i*>( Rgb ) );
+			Pixels1 = _mm_loadu_si128( reinterpret_cast<const __m128i*>( Rgb+16 ) );
+		}
+		else
+		{
+			//	no 3 byte shuffle in sse2, so expand to 4
+			uint8 Rgba[32];
+			for ( int p=0;	p<8;	p++ )
+			{
+				Rgba[p*4+0] = Rgb[p*3+0];
+				Rgba[p*4+1] = Rgb[p*3+1];
+				Rgba[p*4+2] = Rgb[p*3+2];
+				Rgba[p*4+3] = 0;
+			}
+			Pixels0 = _mm_loadu_si128( reinterpret_cast<const __m128i*>( Rgba ) );
+			Pixels1 = _mm_loadu_si128( reinterpret_cast<const __m128i*>( Rgba+16 ) );
+		}
+		
+		auto Mask = _mm_set1_epi32( 0xff );
+		auto Channel0 = _mm_packs_epi32( _mm_and_si128( Pixels0, Mask ), _mm_and_si128( Pixels1, Mask ) );
+		auto Channel1 = _mm_packs_epi32( _mm_and_si128( _mm_srli_epi32( Pixels0, 8 ), Mask ), _mm_and_si128( _mm_srli_epi32( Pixels1, 8 ), Mask ) );
+		auto Channel2 = _mm_packs_epi32( _mm_and_si128( _mm_srli_epi32( Pixels0, 16 ), Mask ), _mm_and_si128( _mm_srli_epi32( Pixels1, 16 ), Mask ) );
+		Red = BGR ? Channel2 : Channel0;
+		Green = Channel1;
+		Blue = BGR ? Channel0 : Channel2;
+	}
 	
-	//	alloc all data in one go (need this for memfiles!)
-	//	gr: previously we APPENDED data. now clear. Has this broken anything?
-	RawData.Clear(false);
-	RawData.Reserve( sizeof(SoyPixelsMeta) + Pixels.GetDataSize() );
+	//	(a*ca + b*cb) + (c*cc) + bias, >> shift, for 8 16bit lanes
+	inline __m128i	Dot3_Sse2(__m128i a,__m128i b,__m128i c,__m128i abCoefficients,__m128i cCoefficients,__m128i Bias,int Shift)
+	{
+		auto Zero = _mm_setzero_si128();
+		auto Low = _mm_add_epi32( _mm_madd_epi16( _mm_unpacklo_epi16( a, b ), abCoefficients ), _mm_madd_epi16( _mm_unpacklo_epi16( c, Zero ), cCoefficients ) );
+		auto High = _mm_add_epi32( _mm_madd_epi16( _mm_unpackhi_epi16( a, b ), abCoefficients ), _mm_madd_epi16( _mm_unpackhi_epi16( c, Zero ), cCoefficients ) );
+		Low = _mm_srai_epi32( _mm_add_epi32( Low, Bias ), Shift );
+		High = _mm_srai_epi32( _mm_add_epi32( High, Bias ), Shift );
+		return _mm_packs_epi32( Low, High );
+	}
 	
-	if ( !RawData.PushBackReinterpret( Meta ) )
-		return false;
+	//	sum of horizontal pairs of two rows, for 16 pixels -> 8 lanes
+	inline __m128i	SumBlocks_Sse2(__m128i Row0a,__m128i Row1a,__m128i Row0b,__m128i Row1b)
+	{
+		auto One = _mm_set1_epi16( 1 );
+		auto a = _mm_madd_epi16( _mm_add_epi16( Row0a, Row1a ), One );
+		auto b = _mm_madd_epi16( _mm_add_epi16( Row0b, Row1b ), One );
+		return _mm_packs_epi32( a, b );
+	}
 	
-	//	gr: not sure how safe this is... vtables etc...
-	auto& CastArray = *reinterpret_cast<ArrayInterface<uint8>*>( &RawData );
-	if ( !CastArray.PushBackArray( Pixels ) )
-	//if ( !RawData.PushBackArray( Pixels ) )
-		return false;
+	inline __m128i	SetPair_Sse2(sint16 a,sint16 b)
+	{
+		return _mm_set_epi16( b, a, b, a, b, a, b, a );
+	}
 	
-	return true;
+	template<TLayout::Type LAYOUT,int CHANNELS,bool BGR>
+	void			ConvertFromRgbRow_Sse2(const uint8* Rgb0,const uint8* Rgb1,uint8* Luma0,uint8* Luma1,uint8* ChromaU,uint8* ChromaV,size_t Width,const TRgbCoefficients& Coefficients)
+	{
+		//	last row of odd heights is luma only
+		if ( !Rgb1 )
+		{
+			ConvertFromRgbRow_Plain<LAYOUT,CHANNELS,BGR>( Rgb0, Rgb1, Luma0, Luma1, ChromaU, ChromaV, 0, Width, Coefficients );
+			return;
+		}
+		
+		auto LumaRG = SetPair_Sse2( Coefficients.mLumaRed, Coefficients.mLumaGreen );
+		auto LumaB = SetPair_Sse2( Coefficients.mLumaBlue, 0 );
+		auto LumaBias = _mm_set1_epi32( Coefficients.mLumaBias );
+		auto URG = SetPair_Sse2( Coefficients.mURed, Coefficients.mUGreen );
+		auto UB = SetPair_Sse2( Coefficients.mUBlue, 0 );
+		auto VRG = SetPair_Sse2( Coefficients.mVRed, Coefficients.mVGreen );
+		auto VB = SetPair_Sse2( Coefficients.mVBlue, 0 );
+		auto ChromaBias = _mm_set1_epi32( Coefficients.mChromaBias );
+		auto Zero = _mm_setzero_si128();
+
+		size_t x = 0;
+		for ( ;	x+16<=Width;	x+=16 )
+		{
+			__m128i r0a,g0a,b0a,r0b,g0b,b0b;
+			__m128i r1a,g1a,b1a,r1b,g1b,b1b;
+			LoadRgb8_Sse2<CHANNELS,BGR>( Rgb0 + x*CHANNELS, r0a, g0a, b0a );
+			LoadRgb8_Sse2<CHANNELS,BGR>( Rgb0 + (x+8)*CHANNELS, r0b, g0b, b0b );
+			LoadRgb8_Sse2<CHANNELS,BGR>( Rgb1 + x*CHANNELS, r1a, g1a, b1a );
+			LoadRgb8_Sse2<CHANNELS,BGR>( Rgb1 + (x+8)*CHANNELS, r1b, g1b, b1b );
+			
+			auto Luma0a = Dot3_Sse2( r0a, g0a, b0a, LumaRG, LumaB, LumaBias, FixedShift );
+			auto Luma0b = Dot3_Sse2( r0b, g0b, b0b, LumaRG, LumaB, LumaBias, FixedShift );
+			auto Luma1a = Dot3_Sse2( r1a, g1a, b1a, LumaRG, LumaB, LumaBias, FixedShift );
+			auto Luma1b = Dot3_Sse2( r1b, g1b, b1b, LumaRG, LumaB, LumaBias, FixedShift );
+			_mm_storeu_si128( reinterpret_cast<__m128i*>( Luma0 + x ), _mm_packus_epi16( Luma0a, Luma0b ) );
+			_mm_storeu_si128( reinterpret_cast<__m128i*>( Luma1 + x ), _mm_packus_epi16( Luma1a, Luma1b ) );
+			
+			auto Red = SumBlocks_Sse2( r0a, r1a, r0b, r1b );
+			auto Green = SumBlocks_Sse2( g0a, g1a, g0b, g1b );
+			auto Blue = SumBlocks_Sse2( b0a, b1a, b0b, b1b );
+			auto u = _mm_packus_epi16( Dot3_Sse2( Red, Green, Blue, URG, UB, ChromaBias, FixedShift+2 ), Zero );
+			auto v = _mm_packus_epi16( Dot3_Sse2( Red, Green, Blue, VRG, VB, ChromaBias, FixedShift+2 ), Zero );
+			
+			if ( LAYOUT == TLayout::Interleaved )
+			{
+				_mm_storeu_si128( reinterpret_cast<__m128i*>( ChromaU + x ), _mm_unpacklo_epi8( u, v ) );
+			}
+			else
+			{
+				_mm_storel_epi64( reinterpret_cast<__m128i*>( ChromaU + x/2 ), u );
+				_mm_storel_epi64( reinterpret_cast<__m128i*>( ChromaV + x/2 ), v );
+			}
+		}
+		
+		ConvertFromRgbRow_Plain<LAYOUT,CHANNELS,BGR>( Rgb0, Rgb1, Luma0, Luma1, ChromaU, ChromaV, x, Width, Coefficients );
+	}
 }
+#endif
 
 
-bool SoyPixelsImpl::SetRawSoyPixels(const ArrayBridge<char>& RawData)
+namespace Yuv
 {
-	int HeaderSize = sizeof(SoyPixelsMeta);
-	if ( RawData.GetDataSize() < HeaderSize )
-		return false;
-	auto& Header = *reinterpret_cast<const SoyPixelsMeta*>( RawData.GetArray() );
-	if ( !Header.IsValid() )
-		return false;
+	template<TLayout::Type LAYOUT,int CHANNELS,bool BGR>
+	TFromRgbRowFunction	GetFromRgbRowFunction()
+	{
+#if defined(SOY_SIMD_SSE2)
+		if ( SoySimd::IsEnabled( SoySimd::Sse2 ) )
+			return ConvertFromRgbRow_Sse2<LAYOUT,CHANNELS,BGR>;
+#endif
+		return ConvertFromRgbRow_Plain<LAYOUT,CHANNELS,BGR>;
+	}
+	
+	template<TLayout::Type LAYOUT>
+	TFromRgbRowFunction	GetFromRgbRowFunction(SoyPixelsFormat::Type RgbFormat)
+	{
+		switch ( RgbFormat )
+		{
+			case SoyPixelsFormat::RGB:	return GetFromRgbRowFunction<LAYOUT,3,false>();
+			case SoyPixelsFormat::BGR:	return GetFromRgbRowFunction<LAYOUT,3,true>();
+			case SoyPixelsFormat::RGBA:	return GetFromRgbRowFunction<LAYOUT,4,false>();
+			case SoyPixelsFormat::BGRA:	return GetFromRgbRowFunction<LAYOUT,4,true>();
+			default:
+				break;
+		}
+		
+		std::stringstream Error;
+		Error << "No yuv conversion from " << RgbFormat;
+		throw Soy::AssertException( Error.str() );
+	}
+}
 
-	//	rest of the data as an array
-	const size_t PixelDataSize = RawData.GetDataSize()-HeaderSize;
-	auto* RawData8 = reinterpret_cast<const uint8*>(RawData.GetArray());
-	auto Pixels = GetRemoteArray( RawData8+HeaderSize, PixelDataSize );
+
+Yuv::TFromRgbRowFunction Yuv::GetFromRgbRowFunction(TLayout::Type Layout,SoyPixelsFormat::Type RgbFormat)
+{
+	switch ( Layout )
+	{
+		case TLayout::Planar:		return GetFromRgbRowFunction<TLayout::Planar>( RgbFormat );
+		case TLayout::Interleaved:	return GetFromRgbRowFunction<TLayout::Interleaved>( RgbFormat );
+		default:
+			break;
+	}
+	throw Soy::AssertException("Rgb to yuv only supports planar & interleaved(bi-planar) layouts");
+}
+
+
+void Yuv::ConvertFromRgb(const uint8* Rgb,size_t RgbStride,SoyPixelsFormat::Type RgbFormat,const TImage& Image,SoyYuvMatrix::Type Matrix,size_t FirstRow,size_t RowCount)
+{
+	Soy::Assert( (FirstRow % 2) == 0, "Rgb to yuv must start on an even row");
+	auto RowFunction = GetFromRgbRowFunction( Image.mLayout, RgbFormat );
+	TRgbCoefficients Coefficients( Image.mVideoRange, Matrix );
+	auto ChromaRows = Image.mHeight / 2;
 	
-	//	todo: verify size! (alignment!)
-	GetMeta() = Header;
-	GetPixelsArray().Clear(false);
-	GetPixelsArray().PushBackArray( Pixels );
+	for ( size_t y=FirstRow;	y<FirstRow+RowCount;	y+=2 )
+	{
+		bool HasChroma = (y/2) < ChromaRows;
+		auto* Rgb0 = Rgb + ((y-FirstRow)*RgbStride);
+		auto* Luma0 = Image.mLuma + (y*Image.mLumaStride);
+		const uint8* Rgb1 = HasChroma ? Rgb0 + RgbStride : nullptr;
+		uint8* Luma1 = HasChroma ? Luma0 + Image.mLumaStride : nullptr;
+		uint8* ChromaU = HasChroma ? Image.mChromaU + ((y/2)*Image.mChromaStride) : nullptr;
+		uint8* ChromaV = HasChroma ? Image.mChromaV + ((y/2)*Image.mChromaStride) : nullptr;
+		RowFunction( Rgb0, Rgb1, Luma0, Luma1, ChromaU, ChromaV, Image.mWidth, Coefficients );
+	}
+}
 
-	if ( !IsValid() )
-		return false;
+void ConvertFormat_YuvToRgb(const TConvertBuffers& Buffers,size_t FirstRow,size_t RowCount)
+{
+	//	gr: TImage is writable for the rgb->yuv direction, we only read from it here
+	Yuv::TImage YuvImage( Buffers.mSrcMeta, const_cast<uint8*>( Buffers.mSrc ), Buffers.mSrcSize );
+	Yuv::ConvertToRgb( YuvImage, Buffers.GetDstRow(FirstRow), Buffers.mDstMeta.GetRowPitch(), Buffers.mDstMeta.GetFormat(), Buffers.mYuvMatrix, FirstRow, RowCount );
+}
 
-	return true;
+void ConvertFormat_RgbToYuv(const TConvertBuffers& Buffers,size_t FirstRow,size_t RowCount)
+{
+	Yuv::TImage YuvImage( Buffers.mDstMeta, Buffers.mDst, Buffers.mDstSize );
+	Yuv::ConvertFromRgb( Buffers.GetSrcRow(FirstRow), Buffers.mSrcMeta.GetRowPitch(), Buffers.mSrcMeta.GetFormat(), YuvImage, Buffers.mYuvMatrix, FirstRow, RowCount );
 }
 
 
 
-bool SoyPixelsImpl::GetPng(ArrayBridge<char>& PngData) const
+TSoyPixelsFloatParams::TSoyPixelsFloatParams(float Scale,float Bias)
 {
-	//	remove need for Png. Isn't this deprecated anyway
-#if defined(TARGET_PS4)
-	return false;
-#else
-	//	if non-supported PNG colour format, then convert to one that is
-	auto PngColourType = TPng::GetColourType( GetFormat() );
-	if ( PngColourType == TPng::TColour::Invalid )
+	for ( int c=0;	c<4;	c++ )
 	{
-		//	do conversion here
-		SoyPixels OtherFormat;
-		OtherFormat.Copy( *this );
-		auto NewFormat = SoyPixelsFormat::RGB;
+		mScale[c] = Scale;
+		mBias[c] = Bias;
+	}
+}
+
+
+TSoyPixelsFloatParams TSoyPixelsFloatParams::GetNormalised(const float (&Mean)[4],const float (&StdDev)[4])
+{
+	TSoyPixelsFloatParams Params;
+	for ( int c=0;	c<4;	c++ )
+	{
+		Soy::Assert( StdDev[c] != 0, "Normalised float params need a non-zero StdDev" );
+		Params.mScale[c] = 1.0f / ( 255.0f * StdDev[c] );
+		Params.mBias[c] = -Mean[c] / StdDev[c];
+	}
+	return Params;
+}
+
+
+namespace SoyPixelsFloat
+{
+	//	per-value multiply & add, value i is channel i%Channels. 48 lanes lines up with 16 values at a time for 1-4 channels
+	class TLanes
+	{
+	public:
+		static const size_t	LaneCount = 48;
 		
-		//	gr: this conversion should be done in soypixels, with a list of compatible output formats
-		switch ( GetFormat() )
+	public:
+		TLanes(const TConvertBuffers& Buffers,size_t Channels,bool ToByte);
+		
+		float	mScale[LaneCount];
+		float	mBias[LaneCount];
+	};
+	
+	//	round to nearest even, with infinities, nans & denormals. from https://gist.github.com/rygorous/2156668
+	uint16		FloatToHalf(float Value);
+	float		HalfToFloat(uint16 Value);
+	
+	void		ByteToFloatRow(const uint8* Src,float* Dst,size_t Count,const TLanes& Lanes);
+	void		FloatToByteRow(const float* Src,uint8* Dst,size_t Count,const TLanes& Lanes);
+	void		FloatToHalfRow(const float* Src,uint16* Dst,size_t Count);
+	void		HalfToFloatRow(const uint16* Src,float* Dst,size_t Count);
+}
+
+
+SoyPixelsFloat::TLanes::TLanes(const TConvertBuffers& Buffers,size_t Channels,bool ToByte)
+{
+	TSoyPixelsFloatParams DefaultParams;
+	auto& Params = Buffers.mFloatParams ? *Buffers.mFloatParams : DefaultParams;
+	for ( size_t i=0;	i<LaneCount;	i++ )
+	{
+		auto c = i % Channels;
+		mScale[i] = ToByte ? 1.0f / Params.mScale[c] : Params.mScale[c];
+		mBias[i] = ToByte ? -Params.mBias[c] / Params.mScale[c] : Params.mBias[c];
+	}
+}
+
+
+uint16 SoyPixelsFloat::FloatToHalf(float Value)
+{
+	const uint32 Infinity32 = 255 << 23;
+	const uint32 Max16 = (127 + 16) << 23;		//	everything this big or bigger is infinity
+	const uint32 MinNormal16 = (127 - 14) << 23;
+	const uint32 DenormalMagic = ((127 - 15) + (23 - 10) + 1) << 23;
+	
+	uint32 f;
+	memcpy( &f, &Value, sizeof(f) );
+	uint32 Sign = f & 0x80000000u;
+	f ^= Sign;
+	
+	uint32 Half;
+	if ( f >= Max16 )
+	{
+		Half = ( f > Infinity32 ) ? 0x7e00 : 0x7c00;
+	}
+	else if ( f < MinNormal16 )
+	{
+		//	let the fpu do the denormal rounding
+		float Magic;
+		memcpy( &Magic, &DenormalMagic, sizeof(Magic) );
+		float Shifted;
+		memcpy( &Shifted, &f, sizeof(Shifted) );
+		Shifted += Magic;
+		memcpy( &Half, &Shifted, sizeof(Half) );
+		Half -= DenormalMagic;
+	}
+	else
+	{
+		uint32 MantissaOdd = (f >> 13) & 1;
+		f += ( uint32(15 - 127) << 23 ) + 0xfff;
+		f += MantissaOdd;
+		Half = f >> 13;
+	}
+	
+	return static_cast<uint16>( Half | (Sign >> 16) );
+}
+
+
+float SoyPixelsFloat::HalfToFloat(uint16 Value)
+{
+	const uint32 ShiftedExponent = 0x7c00 << 13;
+	const uint32 DenormalMagic = 113 << 23;
+	
+	uint32 f = (Value & 0x7fff) << 13;
+	uint32 Exponent = ShiftedExponent & f;
+	f += (127 - 15) << 23;
+	
+	if ( Exponent == ShiftedExponent )
+	{
+		//	inf/nan
+		f += (128 - 16) << 23;
+	}
+	else if ( Exponent == 0 )
+	{
+		//	denormal, renormalise
+		f += 1 << 23;
+		float Magic;
+		memcpy( &Magic, &DenormalMagic, sizeof(Magic) );
+		float Float;
+		memcpy( &Float, &f, sizeof(Float) );
+		Float -= Magic;
+		memcpy( &f, &Float, sizeof(f) );
+	}
+	
+	f |= uint32(Value & 0x8000) << 16;
+	float Float;
+	memcpy( &Float, &f, sizeof(Float) );
+	return Float;
+}
+
+
+void SoyPixelsFloat::ByteToFloatRow(const uint8* Src,float* Dst,size_t Count,const TLanes& Lanes)
+{
+	size_t i = 0;
+#if defined(SOY_SIMD_SSE2)
+	if ( SoySimd::IsEnabled( SoySimd::Sse2 ) )
+	{
+		auto Zero = _mm_setzero_si128();
+		for ( ;	i+16<=Count;	i+=16 )
 		{
-			//case SoyPixelsFormat::KinectDepth:	NewFormat = SoyPixelsFormat::Greyscale;	break;
-			case SoyPixelsFormat::BGRA:			NewFormat = SoyPixelsFormat::RGBA;	break;
-			default:break;
+			auto Lane = i % TLanes::LaneCount;
+			auto Bytes = _mm_loadu_si128( reinterpret_cast<const __m128i*>( &Src[i] ) );
+			auto Low = _mm_unpacklo_epi8( Bytes, Zero );
+			auto High = _mm_unpackhi_epi8( Bytes, Zero );
+			__m128i Ints[4] = { _mm_unpacklo_epi16( Low, Zero ), _mm_unpackhi_epi16( Low, Zero ), _mm_unpacklo_epi16( High, Zero ), _mm_unpackhi_epi16( High, Zero ) };
+			for ( int v=0;	v<4;	v++ )
+			{
+				auto Floats = _mm_cvtepi32_ps( Ints[v] );
+				Floats = _mm_mul_ps( Floats, _mm_loadu_ps( &Lanes.mScale[Lane+v*4] ) );
+				Floats = _mm_add_ps( Floats, _mm_loadu_ps( &Lanes.mBias[Lane+v*4] ) );
+				_mm_storeu_ps( &Dst[i+v*4], Floats );
+			}
 		}
+	}
+#endif
+	for ( ;	i<Count;	i++ )
+	{
+		auto Lane = i % TLanes::LaneCount;
+		Dst[i] = ( Src[i] * Lanes.mScale[Lane] ) + Lanes.mBias[Lane];
+	}
+}
 
-		//	new format MUST be compatible or we'll get stuck in a loop
-		if ( TPng::GetColourType( NewFormat ) == TPng::TColour::Invalid )
+
+void SoyPixelsFloat::FloatToByteRow(const float* Src,uint8* Dst,size_t Count,const TLanes& Lanes)
+{
+	size_t i = 0;
+#if defined(SOY_SIMD_SSE2)
+	if ( SoySimd::IsEnabled( SoySimd::Sse2 ) )
+	{
+		auto Zero = _mm_setzero_ps();
+		auto Max = _mm_set1_ps( 255.0f );
+		for ( ;	i+16<=Count;	i+=16 )
 		{
-			assert( false );
-			return false;
+			auto Lane = i % TLanes::LaneCount;
+			__m128i Ints[4];
+			for ( int v=0;	v<4;	v++ )
+			{
+				auto Floats = _mm_loadu_ps( &Src[i+v*4] );
+				Floats = _mm_mul_ps( Floats, _mm_loadu_ps( &Lanes.mScale[Lane+v*4] ) );
+				Floats = _mm_add_ps( Floats, _mm_loadu_ps( &Lanes.mBias[Lane+v*4] ) );
+				//	clamp before converting, out of range floats convert to INT_MIN. max returns the 2nd operand for nan, so nan becomes 0
+				Floats = _mm_min_ps( _mm_max_ps( Floats, Zero ), Max );
+				Ints[v] = _mm_cvtps_epi32( Floats );
+			}
+			auto Low = _mm_packs_epi32( Ints[0], Ints[1] );
+			auto High = _mm_packs_epi32( Ints[2], Ints[3] );
+			_mm_storeu_si128( reinterpret_cast<__m128i*>( &Dst[i] ), _mm_packus_epi16( Low, High ) );
 		}
+	}
+#endif
+	for ( ;	i<Count;	i++ )
+	{
+		auto Lane = i % TLanes::LaneCount;
+		auto Value = ( Src[i] * Lanes.mScale[Lane] ) + Lanes.mBias[Lane];
+		//	nan fails both, and ends up 0
+		Dst[i] = ( Value >= 255.0f ) ? 255 : ( Value > 0.0f ) ? static_cast<uint8>( Value + 0.5f ) : 0;
+	}
+}
+
+
+void SoyPixelsFloat::FloatToHalfRow(const float* Src,uint16* Dst,size_t Count)
+{
+	size_t i = 0;
+#if defined(SOY_SIMD_SSE2)
+	if ( SoySimd::IsEnabled( SoySimd::Sse2 ) )
+	{
+		//	same as FloatToHalf, 4 at a time
+		auto SignMask = _mm_set1_epi32( 0x80000000u );
+		auto Max16 = _mm_set1_epi32( (127 + 16) << 23 );
+		auto NanBit = _mm_set1_epi32( 0x200 );
+		auto Infinity16 = _mm_set1_epi32( 0x7c00 );
+		auto MinNormal16 = _mm_set1_epi32( (127 - 14) << 23 );
+		auto DenormalMagic = _mm_set1_epi32( ((127 - 15) + (23 - 10) + 1) << 23 );
+		auto NormalBias = _mm_set1_epi32( 0xfff - ((127 - 15) << 23) );
 		
-		//	attempt conversion
-		OtherFormat.SetFormat( NewFormat );
+		auto ToHalf = [&](__m128 Floats)
+		{
+			auto Sign = _mm_and_ps( _mm_castsi128_ps( SignMask ), Floats );
+			auto Abs = _mm_xor_ps( Floats, Sign );
+			auto AbsInt = _mm_castps_si128( Abs );
+			
+			auto IsNan = _mm_castps_si128( _mm_cmpunord_ps( Abs, Abs ) );
+			auto IsRegular = _mm_cmpgt_epi32( Max16, AbsInt );
+			auto InfOrNan = _mm_or_si128( _mm_and_si128( IsNan, NanBit ), Infinity16 );
+			auto IsDenormal = _mm_cmpgt_epi32( MinNormal16, AbsInt );
+			
+			auto Denormal = _mm_sub_epi32( _mm_castps_si128( _mm_add_ps( Abs, _mm_castsi128_ps( DenormalMagic ) ) ), DenormalMagic );
+			
+			auto MantissaOdd = _mm_srai_epi32( _mm_slli_epi32( AbsInt, 31 - 13 ), 31 );
+			auto Normal = _mm_srli_epi32( _mm_sub_epi32( _mm_add_epi32( AbsInt, NormalBias ), MantissaOdd ), 13 );
+			
+			auto NonSpecial = _mm_or_si128( _mm_and_si128( Denormal, IsDenormal ), _mm_andnot_si128( IsDenormal, Normal ) );
+			auto Joined = _mm_or_si128( _mm_and_si128( NonSpecial, IsRegular ), _mm_andnot_si128( IsRegular, InfOrNan ) );
+			auto Half = _mm_or_si128( Joined, _mm_srli_epi32( _mm_castps_si128( Sign ), 16 ) );
+			
+			//	sign extend so the signed pack doesn't saturate negative halves
+			return _mm_srai_epi32( _mm_slli_epi32( Half, 16 ), 16 );
+		};
 		
-		return OtherFormat.GetPng( PngData );
+		for ( ;	i+8<=Count;	i+=8 )
+		{
+			auto Low = ToHalf( _mm_loadu_ps( &Src[i] ) );
+			auto High = ToHalf( _mm_loadu_ps( &Src[i+4] ) );
+			_mm_storeu_si128( reinterpret_cast<__m128i*>( &Dst[i] ), _mm_packs_epi32( Low, High ) );
+		}
 	}
+#endif
+	for ( ;	i<Count;	i++ )
+		Dst[i] = FloatToHalf( Src[i] );
+}
 
-	//	http://stackoverflow.com/questions/7942635/write-png-quickly
 
-	//\211 P N G \r \n \032 \n (89 50 4E 47 0D 0A 1A 0A
-	//uint8 Magic[] = { 137, 80, 78, 71, 13, 10, 26, 10 };
-	BufferArray<char,8> Magic;
-	TPng::GetMagic( GetArrayBridge(Magic) );
-	char IHDR[] = { 73, 72, 68, 82 };	//'I', 'H', 'D', 'R'
-	const char IEND[] = { 73, 69, 78, 68 }; //("IEND")
-	const char IDAT[] = { 73, 68, 65, 84 };// ("IDAT")
+void SoyPixelsFloat::HalfToFloatRow(const uint16* Src,float* Dst,size_t Count)
+{
+	size_t i = 0;
+#if defined(SOY_SIMD_SSE2)
+	if ( SoySimd::IsEnabled( SoySimd::Sse2 ) )
+	{
+		//	scale the exponent up with a multiply, which handles denormals, then patch in inf/nan & sign
+		auto Zero = _mm_setzero_si128();
+		auto NoSignMask = _mm_set1_epi32( 0x7fff );
+		auto Magic = _mm_castsi128_ps( _mm_set1_epi32( (254 - 15) << 23 ) );
+		auto MaxFinite = _mm_set1_epi32( 0x7bff );
+		auto InfNanExponent = _mm_set1_epi32( 255 << 23 );
+		
+		auto ToFloat = [&](__m128i Half)
+		{
+			auto ExponentMantissa = _mm_and_si128( NoSignMask, Half );
+			auto Sign = _mm_slli_epi32( _mm_xor_si128( Half, ExponentMantissa ), 16 );
+			auto Scaled = _mm_mul_ps( _mm_castsi128_ps( _mm_slli_epi32( ExponentMantissa, 13 ) ), Magic );
+			auto WasInfNan = _mm_and_si128( _mm_cmpgt_epi32( ExponentMantissa, MaxFinite ), InfNanExponent );
+			return _mm_or_ps( Scaled, _mm_castsi128_ps( _mm_or_si128( Sign, WasInfNan ) ) );
+		};
+		
+		for ( ;	i+8<=Count;	i+=8 )
+		{
+			auto Halfs = _mm_loadu_si128( reinterpret_cast<const __m128i*>( &Src[i] ) );
+			_mm_storeu_ps( &Dst[i], ToFloat( _mm_unpacklo_epi16( Halfs, Zero ) ) );
+			_mm_storeu_ps( &Dst[i+4], ToFloat( _mm_unpackhi_epi16( Halfs, Zero ) ) );
+		}
+	}
+#endif
+	for ( ;	i<Count;	i++ )
+		Dst[i] = HalfToFloat( Src[i] );
+}
 
-	//	write header chunk
-	uint32 Width = size_cast<uint32>(GetWidth());
-	uint32 Height = size_cast<uint32>(GetHeight());
-	uint8 BitDepth = GetBitDepth();
-	uint8 ColourType = PngColourType;
-	assert( PngColourType != TPng::TColour::Invalid );
-	uint8 Compression = TPng::TCompression::DEFLATE;
-	uint8 Filter = TPng::TFilter::None;
-	uint8 Interlace = TPng::TInterlace::None;
-	Array<char> Header;
-	Header.PushBackArray( IHDR );
-	Header.PushBackReinterpretReverse( Width );
-	Header.PushBackReinterpretReverse( Height );
-	Header.PushBack( BitDepth );
-	Header.PushBack( ColourType );
-	Header.PushBack( Compression );
-	Header.PushBack( Filter );
-	Header.PushBack( Interlace );
 
-	//	write data chunks
-	Array<char> PixelData;
-	PixelData.PushBackArray( IDAT );
-	if ( !TPng::GetPngData( PixelData, *this, static_cast<TPng::TCompression::Type>(Compression) ) )
+void ConvertFormat_ByteToFloat(const TConvertBuffers& Buffers,size_t FirstRow,size_t RowCount)
+{
+	auto Channels = Buffers.mSrcMeta.GetChannels();
+	auto Count = Buffers.mSrcMeta.GetWidth() * Channels;
+	SoyPixelsFloat::TLanes Lanes( Buffers, Channels, false );
+	for ( size_t y=FirstRow;	y<FirstRow+RowCount;	y++ )
+		SoyPixelsFloat::ByteToFloatRow( Buffers.GetSrcRow(y), reinterpret_cast<float*>( Buffers.GetDstRow(y) ), Count, Lanes );
+}
+
+void ConvertFormat_FloatToByte(const TConvertBuffers& Buffers,size_t FirstRow,size_t RowCount)
+{
+	auto Channels = Buffers.mSrcMeta.GetChannels();
+	auto Count = Buffers.mSrcMeta.GetWidth() * Channels;
+	SoyPixelsFloat::TLanes Lanes( Buffers, Channels, true );
+	for ( size_t y=FirstRow;	y<FirstRow+RowCount;	y++ )
+		SoyPixelsFloat::FloatToByteRow( reinterpret_cast<const float*>( Buffers.GetSrcRow(y) ), Buffers.GetDstRow(y), Count, Lanes );
+}
+
+void ConvertFormat_FloatToHalf(const TConvertBuffers& Buffers,size_t FirstRow,size_t RowCount)
+{
+	auto Count = Buffers.mSrcMeta.GetWidth() * Buffers.mSrcMeta.GetChannels();
+	for ( size_t y=FirstRow;	y<FirstRow+RowCount;	y++ )
+		SoyPixelsFloat::FloatToHalfRow( reinterpret_cast<const float*>( Buffers.GetSrcRow(y) ), reinterpret_cast<uint16*>( Buffers.GetDstRow(y) ), Count );
+}
+
+void ConvertFormat_HalfToFloat(const TConvertBuffers& Buffers,size_t FirstRow,size_t RowCount)
+{
+	auto Count = Buffers.mSrcMeta.GetWidth() * Buffers.mSrcMeta.GetChannels();
+	for ( size_t y=FirstRow;	y<FirstRow+RowCount;	y++ )
+		SoyPixelsFloat::HalfToFloatRow( reinterpret_cast<const uint16*>( Buffers.GetSrcRow(y) ), reinterpret_cast<float*>( Buffers.GetDstRow(y) ), Count );
+}
+
+//	bytes <-> half go through a small float buffer, so the full size float image never exists
+void ConvertFormat_ByteToHalf(const TConvertBuffers& Buffers,size_t FirstRow,size_t RowCount)
+{
+	auto Channels = Buffers.mSrcMeta.GetChannels();
+	auto Count = Buffers.mSrcMeta.GetWidth() * Channels;
+	SoyPixelsFloat::TLanes Lanes( Buffers, Channels, false );
+	float Floats[SoyPixelsFloat::TLanes::LaneCount*4];
+	for ( size_t y=FirstRow;	y<FirstRow+RowCount;	y++ )
+	{
+		auto* Src = Buffers.GetSrcRow(y);
+		auto* Dst = reinterpret_cast<uint16*>( Buffers.GetDstRow(y) );
+		for ( size_t i=0;	i<Count;	i+=sizeofarray(Floats) )
+		{
+			auto ChunkCount = std::min( sizeofarray(Floats), Count-i );
+			SoyPixelsFloat::ByteToFloatRow( &Src[i], Floats, ChunkCount, Lanes );
+			SoyPixelsFloat::FloatToHalfRow( Floats, &Dst[i], ChunkCount );
+		}
+	}
+}
+
+void ConvertFormat_HalfToByte(const TConvertBuffers& Buffers,size_t FirstRow,size_t RowCount)
+{
+	auto Channels = Buffers.mSrcMeta.GetChannels();
+	auto Count = Buffers.mSrcMeta.GetWidth() * Channels;
+	SoyPixelsFloat::TLanes Lanes( Buffers, Channels, true );
+	float Floats[SoyPixelsFloat::TLanes::LaneCount*4];
+	for ( size_t y=FirstRow;	y<FirstRow+RowCount;	y++ )
+	{
+		auto* Src = reinterpret_cast<const uint16*>( Buffers.GetSrcRow(y) );
+		auto* Dst = Buffers.GetDstRow(y);
+		for ( size_t i=0;	i<Count;	i+=sizeofarray(Floats) )
+		{
+			auto ChunkCount = std::min( sizeofarray(Floats), Count-i );
+			SoyPixelsFloat::HalfToFloatRow( &Src[i], Floats, ChunkCount );
+			SoyPixelsFloat::FloatToByteRow( Floats, &Dst[i], ChunkCount, Lanes );
+		}
+	}
+}
+
+namespace TConvertSource
+{
+	enum Type
+	{
+		InPlace,	//	conversion can read & write the same buffer
+		Copy,		//	conversion reads from planes it would overwrite, so needs an untouched copy of the source
+	};
+}
+
+class TConvertFunc
+{
+public:
+	typedef void(*TFunction)(const TConvertBuffers& Buffers,size_t FirstRow,size_t RowCount);
+	
+public:
+	TConvertFunc() :
+		mFunction		( nullptr ),
+		mSource			( TConvertSource::InPlace ),
+		mRowAlignment	( 1 )
+	{
+	}
+
+	TConvertFunc(SoyPixelsFormat::Type SrcFormat,SoyPixelsFormat::Type DestFormat,TFunction Func,TConvertSource::Type Source=TConvertSource::InPlace,size_t RowAlignment=1) :
+		mSrcFormat		( SrcFormat ),
+		mDestFormat		( DestFormat ),
+		mFunction		( Func ),
+		mSource			( Source ),
+		mRowAlignment	( RowAlignment )
+	{
+	}
+
+	inline bool		operator==(const std::tuple<SoyPixelsFormat::Type,SoyPixelsFormat::Type>& SrcToDestFormat) const
+	{
+		return (std::get<0>( SrcToDestFormat )==mSrcFormat) && (std::get<1>( SrcToDestFormat )==mDestFormat);
+	}
+	
+	void			Run(ArrayInterface<uint8>& Pixels,SoyPixelsMeta& Meta,SoyYuvMatrix::Type YuvMatrix) const;	//	in-place
+	void			Run(const TConvertBuffers& Buffers) const;
+
+	SoyPixelsFormat::Type	mSrcFormat;
+	SoyPixelsFormat::Type	mDestFormat;
+	TFunction				mFunction;
+	TConvertSource::Type	mSource;
+	size_t					mRowAlignment;	//	bands must start on a multiple of this (eg. 2 for rows sharing 420 chroma)
+};
+
+
+void TConvertFunc::Run(ArrayInterface<uint8>& Pixels,SoyPixelsMeta& Meta,SoyYuvMatrix::Type YuvMatrix) const
+{
+	SoyPixelsMeta NewMeta( Meta.GetWidth(), Meta.GetHeight(), mDestFormat );
+	auto Height = Meta.GetHeight();
+	auto OldSize = Meta.GetDataSize();
+	auto NewSize = NewMeta.GetDataSize();
+	Soy::Assert( Pixels.GetDataSize() >= OldSize, "Pixel data smaller than meta" );
+	
+	//	bands run at the same time, so if rows move they would overwrite rows another band hasn't read yet
+	bool Parallel = SoyPixelsParallel::GetBandCount( Height, mRowAlignment ) > 1;
+	bool InPlace = ( mSource == TConvertSource::InPlace ) && ( !Parallel || OldSize == NewSize );
+	
+	Array<uint8> SrcCopy;
+	if ( !InPlace )
+	{
+		SrcCopy.SetSize( OldSize );
+		memcpy( SrcCopy.GetArray(), Pixels.GetArray(), OldSize );
+	}
+	
+	//	grow before converting, shrink after
+	if ( !InPlace || NewSize > OldSize )
+		Pixels.SetSize( NewSize, InPlace );
+
+	TConvertBuffers Buffers;
+	Buffers.mSrc = InPlace ? Pixels.GetArray() : SrcCopy.GetArray();
+	Buffers.mSrcSize = OldSize;
+	Buffers.mSrcMeta = Meta;
+	Buffers.mDst = Pixels.GetArray();
+	Buffers.mDstSize = NewSize;
+	Buffers.mDstMeta = NewMeta;
+	Buffers.mYuvMatrix = YuvMatrix;
+	Run( Buffers );
+	
+	if ( NewSize < OldSize )
+		Pixels.SetSize( NewSize );
+	Meta = NewMeta;
+}
+
+
+void TConvertFunc::Run(const TConvertBuffers& Buffers) const
+{
+	auto Function = mFunction;
+	auto ConvertBand = [&Buffers,Function](size_t FirstRow,size_t RowCount)
+	{
+		Function( Buffers, FirstRow, RowCount );
+	};
+	SoyPixelsParallel::ForEachRowBand( Buffers.mSrcMeta.GetHeight(), mRowAlignment, ConvertBand );
+}
+
+
+TConvertFunc gConversionFuncs[] =
+{
+	TConvertFunc( SoyPixelsFormat::KinectDepth, SoyPixelsFormat::FreenectDepth10bit, ConvertDepth16 ),
+	TConvertFunc( SoyPixelsFormat::KinectDepth, SoyPixelsFormat::FreenectDepth11bit, ConvertDepth16 ),
+	TConvertFunc( SoyPixelsFormat::KinectDepth, SoyPixelsFormat::FreenectDepthmm, ConvertDepth16 ),
+	TConvertFunc( SoyPixelsFormat::FreenectDepth10bit, SoyPixelsFormat::FreenectDepthmm, ConvertDepth16 ),
+	TConvertFunc( SoyPixelsFormat::FreenectDepth10bit, SoyPixelsFormat::FreenectDepth11bit, ConvertDepth16 ),
+	TConvertFunc( SoyPixelsFormat::FreenectDepth10bit, SoyPixelsFormat::KinectDepth, ConvertDepth16 ),
+	TConvertFunc( SoyPixelsFormat::FreenectDepth11bit, SoyPixelsFormat::FreenectDepthmm, ConvertDepth16 ),
+	TConvertFunc( SoyPixelsFormat::FreenectDepth11bit, SoyPixelsFormat::FreenectDepth10bit, ConvertDepth16 ),
+	TConvertFunc( SoyPixelsFormat::FreenectDepth11bit, SoyPixelsFormat::KinectDepth, ConvertDepth16 ),
+	TConvertFunc( SoyPixelsFormat::FreenectDepthmm, SoyPixelsFormat::FreenectDepth10bit, ConvertDepth16 ),
+	TConvertFunc( SoyPixelsFormat::FreenectDepthmm, SoyPixelsFormat::FreenectDepth11bit, ConvertDepth16 ),
+	TConvertFunc( SoyPixelsFormat::FreenectDepthmm, SoyPixelsFormat::KinectDepth, ConvertDepth16 ),
+	TConvertFunc( SoyPixelsFormat::KinectDepth, SoyPixelsFormat::RGB, DepthToGreyOrRgb, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::KinectDepth, SoyPixelsFormat::RGBA, DepthToGreyOrRgb, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::KinectDepth, SoyPixelsFormat::Greyscale, DepthToGreyOrRgb, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::FreenectDepth10bit, SoyPixelsFormat::RGB, DepthToGreyOrRgb, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::FreenectDepth10bit, SoyPixelsFormat::RGBA, DepthToGreyOrRgb, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::FreenectDepth10bit, SoyPixelsFormat::Greyscale, DepthToGreyOrRgb, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::FreenectDepth11bit, SoyPixelsFormat::RGB, DepthToGreyOrRgb, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::FreenectDepth11bit, SoyPixelsFormat::RGBA, DepthToGreyOrRgb, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::FreenectDepth11bit, SoyPixelsFormat::Greyscale, DepthToGreyOrRgb, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::FreenectDepthmm, SoyPixelsFormat::RGB, DepthToGreyOrRgb, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::FreenectDepthmm, SoyPixelsFormat::RGBA, DepthToGreyOrRgb, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::FreenectDepthmm, SoyPixelsFormat::Greyscale, DepthToGreyOrRgb, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::BGR, SoyPixelsFormat::Greyscale, ConvertFormat_RGBAToGreyscale ),
+	TConvertFunc( SoyPixelsFormat::BGRA, SoyPixelsFormat::Greyscale, ConvertFormat_RGBAToGreyscale ),
+	TConvertFunc( SoyPixelsFormat::RGBA, SoyPixelsFormat::Greyscale, ConvertFormat_RGBAToGreyscale ),
+	TConvertFunc( SoyPixelsFormat::RGB, SoyPixelsFormat::Greyscale, ConvertFormat_RGBAToGreyscale ),
+	TConvertFunc( SoyPixelsFormat::BGRA, SoyPixelsFormat::RGBA, ConvertFormat_BgrToRgb ),
+	TConvertFunc( SoyPixelsFormat::BGR, SoyPixelsFormat::RGB, ConvertFormat_BgrToRgb ),
+	TConvertFunc( SoyPixelsFormat::RGBA, SoyPixelsFormat::BGRA, ConvertFormat_BgrToRgb ),
+	TConvertFunc( SoyPixelsFormat::RGB, SoyPixelsFormat::BGR, ConvertFormat_BgrToRgb ),
+	TConvertFunc( SoyPixelsFormat::RGB, SoyPixelsFormat::RGBA, ConvertFormat_RgbToRgba ),
+	TConvertFunc( SoyPixelsFormat::RGB, SoyPixelsFormat::BGRA, ConvertFormat_RemapChannels, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::RGB, SoyPixelsFormat::ARGB, ConvertFormat_RemapChannels, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::BGR, SoyPixelsFormat::RGBA, ConvertFormat_RemapChannels, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::BGR, SoyPixelsFormat::BGRA, ConvertFormat_RemapChannels, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::BGR, SoyPixelsFormat::ARGB, ConvertFormat_RemapChannels, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::RGBA, SoyPixelsFormat::RGB, ConvertFormat_RemapChannels ),
+	TConvertFunc( SoyPixelsFormat::RGBA, SoyPixelsFormat::BGR, ConvertFormat_RemapChannels ),
+	TConvertFunc( SoyPixelsFormat::RGBA, SoyPixelsFormat::ARGB, ConvertFormat_RemapChannels ),
+	TConvertFunc( SoyPixelsFormat::BGRA, SoyPixelsFormat::RGB, ConvertFormat_RemapChannels ),
+	TConvertFunc( SoyPixelsFormat::BGRA, SoyPixelsFormat::BGR, ConvertFormat_RemapChannels ),
+	TConvertFunc( SoyPixelsFormat::BGRA, SoyPixelsFormat::ARGB, ConvertFormat_RemapChannels ),
+	TConvertFunc( SoyPixelsFormat::ARGB, SoyPixelsFormat::RGB, ConvertFormat_RemapChannels ),
+	TConvertFunc( SoyPixelsFormat::ARGB, SoyPixelsFormat::BGR, ConvertFormat_RemapChannels ),
+	TConvertFunc( SoyPixelsFormat::ARGB, SoyPixelsFormat::RGBA, ConvertFormat_RemapChannels ),
+	TConvertFunc( SoyPixelsFormat::ARGB, SoyPixelsFormat::BGRA, ConvertFormat_RemapChannels ),
+	TConvertFunc( SoyPixelsFormat::Greyscale, SoyPixelsFormat::RGB, ConvertFormat_GreyscaleToRgb ),
+	TConvertFunc( SoyPixelsFormat::Greyscale, SoyPixelsFormat::RGBA, ConvertFormat_GreyscaleToRgba ),
+	TConvertFunc( SoyPixelsFormat::Greyscale, SoyPixelsFormat::Float1, ConvertFormat_ByteToFloat, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::Float1, SoyPixelsFormat::Greyscale, ConvertFormat_FloatToByte ),
+	TConvertFunc( SoyPixelsFormat::Greyscale, SoyPixelsFormat::Half1, ConvertFormat_ByteToHalf, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::Half1, SoyPixelsFormat::Greyscale, ConvertFormat_HalfToByte ),
+	TConvertFunc( SoyPixelsFormat::Float1, SoyPixelsFormat::Half1, ConvertFormat_FloatToHalf ),
+	TConvertFunc( SoyPixelsFormat::Half1, SoyPixelsFormat::Float1, ConvertFormat_HalfToFloat, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::GreyscaleAlpha, SoyPixelsFormat::Float2, ConvertFormat_ByteToFloat, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::Float2, SoyPixelsFormat::GreyscaleAlpha, ConvertFormat_FloatToByte ),
+	TConvertFunc( SoyPixelsFormat::GreyscaleAlpha, SoyPixelsFormat::Half2, ConvertFormat_ByteToHalf, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::Half2, SoyPixelsFormat::GreyscaleAlpha, ConvertFormat_HalfToByte ),
+	TConvertFunc( SoyPixelsFormat::Float2, SoyPixelsFormat::Half2, ConvertFormat_FloatToHalf ),
+	TConvertFunc( SoyPixelsFormat::Half2, SoyPixelsFormat::Float2, ConvertFormat_HalfToFloat, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::RGB, SoyPixelsFormat::Float3, ConvertFormat_ByteToFloat, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::Float3, SoyPixelsFormat::RGB, ConvertFormat_FloatToByte ),
+	TConvertFunc( SoyPixelsFormat::RGB, SoyPixelsFormat::Half3, ConvertFormat_ByteToHalf, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::Half3, SoyPixelsFormat::RGB, ConvertFormat_HalfToByte ),
+	TConvertFunc( SoyPixelsFormat::Float3, SoyPixelsFormat::Half3, ConvertFormat_FloatToHalf ),
+	TConvertFunc( SoyPixelsFormat::Half3, SoyPixelsFormat::Float3, ConvertFormat_HalfToFloat, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::RGBA, SoyPixelsFormat::Float4, ConvertFormat_ByteToFloat, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::Float4, SoyPixelsFormat::RGBA, ConvertFormat_FloatToByte ),
+	TConvertFunc( SoyPixelsFormat::RGBA, SoyPixelsFormat::Half4, ConvertFormat_ByteToHalf, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::Half4, SoyPixelsFormat::RGBA, ConvertFormat_HalfToByte ),
+	TConvertFunc( SoyPixelsFormat::Float4, SoyPixelsFormat::Half4, ConvertFormat_FloatToHalf ),
+	TConvertFunc( SoyPixelsFormat::Half4, SoyPixelsFormat::Float4, ConvertFormat_HalfToFloat, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::Yuv_8_88_Full, SoyPixelsFormat::RGB, ConvertFormat_YuvToRgb, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::Yuv_8_88_Full, SoyPixelsFormat::RGBA, ConvertFormat_YuvToRgb, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::Yuv_8_88_Full, SoyPixelsFormat::BGRA, ConvertFormat_YuvToRgb, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::Yuv_8_88_Full, SoyPixelsFormat::BGR, ConvertFormat_YuvToRgb, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::Yuv_8_88_Ntsc, SoyPixelsFormat::RGB, ConvertFormat_YuvToRgb, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::Yuv_8_88_Ntsc, SoyPixelsFormat::RGBA, ConvertFormat_YuvToRgb, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::Yuv_8_88_Ntsc, SoyPixelsFormat::BGRA, ConvertFormat_YuvToRgb, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::Yuv_8_88_Ntsc, SoyPixelsFormat::BGR, ConvertFormat_YuvToRgb, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::Yuv_8_88_Smptec, SoyPixelsFormat::RGB, ConvertFormat_YuvToRgb, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::Yuv_8_88_Smptec, SoyPixelsFormat::RGBA, ConvertFormat_YuvToRgb, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::Yuv_8_88_Smptec, SoyPixelsFormat::BGRA, ConvertFormat_YuvToRgb, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::Yuv_8_88_Smptec, SoyPixelsFormat::BGR, ConvertFormat_YuvToRgb, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::Yuv_8_8_8_Full, SoyPixelsFormat::RGB, ConvertFormat_YuvToRgb, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::Yuv_8_8_8_Full, SoyPixelsFormat::RGBA, ConvertFormat_YuvToRgb, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::Yuv_8_8_8_Full, SoyPixelsFormat::BGRA, ConvertFormat_YuvToRgb, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::Yuv_8_8_8_Full, SoyPixelsFormat::BGR, ConvertFormat_YuvToRgb, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::Yuv_8_8_8_Ntsc, SoyPixelsFormat::RGB, ConvertFormat_YuvToRgb, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::Yuv_8_8_8_Ntsc, SoyPixelsFormat::RGBA, ConvertFormat_YuvToRgb, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::Yuv_8_8_8_Ntsc, SoyPixelsFormat::BGRA, ConvertFormat_YuvToRgb, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::Yuv_8_8_8_Ntsc, SoyPixelsFormat::BGR, ConvertFormat_YuvToRgb, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::Yuv_8_8_8_Smptec, SoyPixelsFormat::RGB, ConvertFormat_YuvToRgb, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::Yuv_8_8_8_Smptec, SoyPixelsFormat::RGBA, ConvertFormat_YuvToRgb, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::Yuv_8_8_8_Smptec, SoyPixelsFormat::BGRA, ConvertFormat_YuvToRgb, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::Yuv_8_8_8_Smptec, SoyPixelsFormat::BGR, ConvertFormat_YuvToRgb, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::YYuv_8888_Full, SoyPixelsFormat::RGB, ConvertFormat_YuvToRgb, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::YYuv_8888_Full, SoyPixelsFormat::RGBA, ConvertFormat_YuvToRgb, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::YYuv_8888_Full, SoyPixelsFormat::BGRA, ConvertFormat_YuvToRgb, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::YYuv_8888_Full, SoyPixelsFormat::BGR, ConvertFormat_YuvToRgb, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::YYuv_8888_Ntsc, SoyPixelsFormat::RGB, ConvertFormat_YuvToRgb, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::YYuv_8888_Ntsc, SoyPixelsFormat::RGBA, ConvertFormat_YuvToRgb, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::YYuv_8888_Ntsc, SoyPixelsFormat::BGRA, ConvertFormat_YuvToRgb, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::YYuv_8888_Ntsc, SoyPixelsFormat::BGR, ConvertFormat_YuvToRgb, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::YYuv_8888_Smptec, SoyPixelsFormat::RGB, ConvertFormat_YuvToRgb, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::YYuv_8888_Smptec, SoyPixelsFormat::RGBA, ConvertFormat_YuvToRgb, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::YYuv_8888_Smptec, SoyPixelsFormat::BGRA, ConvertFormat_YuvToRgb, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::YYuv_8888_Smptec, SoyPixelsFormat::BGR, ConvertFormat_YuvToRgb, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::uyvy, SoyPixelsFormat::RGB, ConvertFormat_YuvToRgb, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::uyvy, SoyPixelsFormat::RGBA, ConvertFormat_YuvToRgb, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::uyvy, SoyPixelsFormat::BGRA, ConvertFormat_YuvToRgb, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::uyvy, SoyPixelsFormat::BGR, ConvertFormat_YuvToRgb, TConvertSource::Copy ),
+	TConvertFunc( SoyPixelsFormat::RGB, SoyPixelsFormat::Yuv_8_88_Full, ConvertFormat_RgbToYuv, TConvertSource::Copy, 2 ),
+	TConvertFunc( SoyPixelsFormat::RGBA, SoyPixelsFormat::Yuv_8_88_Full, ConvertFormat_RgbToYuv, TConvertSource::Copy, 2 ),
+	TConvertFunc( SoyPixelsFormat::BGRA, SoyPixelsFormat::Yuv_8_88_Full, ConvertFormat_RgbToYuv, TConvertSource::Copy, 2 ),
+	TConvertFunc( SoyPixelsFormat::BGR, SoyPixelsFormat::Yuv_8_88_Full, ConvertFormat_RgbToYuv, TConvertSource::Copy, 2 ),
+	TConvertFunc( SoyPixelsFormat::RGB, SoyPixelsFormat::Yuv_8_88_Ntsc, ConvertFormat_RgbToYuv, TConvertSource::Copy, 2 ),
+	TConvertFunc( SoyPixelsFormat::RGBA, SoyPixelsFormat::Yuv_8_88_Ntsc, ConvertFormat_RgbToYuv, TConvertSource::Copy, 2 ),
+	TConvertFunc( SoyPixelsFormat::BGRA, SoyPixelsFormat::Yuv_8_88_Ntsc, ConvertFormat_RgbToYuv, TConvertSource::Copy, 2 ),
+	TConvertFunc( SoyPixelsFormat::BGR, SoyPixelsFormat::Yuv_8_88_Ntsc, ConvertFormat_RgbToYuv, TConvertSource::Copy, 2 ),
+	TConvertFunc( SoyPixelsFormat::RGB, SoyPixelsFormat::Yuv_8_88_Smptec, ConvertFormat_RgbToYuv, TConvertSource::Copy, 2 ),
+	TConvertFunc( SoyPixelsFormat::RGBA, SoyPixelsFormat::Yuv_8_88_Smptec, ConvertFormat_RgbToYuv, TConvertSource::Copy, 2 ),
+	TConvertFunc( SoyPixelsFormat::BGRA, SoyPixelsFormat::Yuv_8_88_Smptec, ConvertFormat_RgbToYuv, TConvertSource::Copy, 2 ),
+	TConvertFunc( SoyPixelsFormat::BGR, SoyPixelsFormat::Yuv_8_88_Smptec, ConvertFormat_RgbToYuv, TConvertSource::Copy, 2 ),
+	TConvertFunc( SoyPixelsFormat::RGB, SoyPixelsFormat::Yuv_8_8_8_Full, ConvertFormat_RgbToYuv, TConvertSource::Copy, 2 ),
+	TConvertFunc( SoyPixelsFormat::RGBA, SoyPixelsFormat::Yuv_8_8_8_Full, ConvertFormat_RgbToYuv, TConvertSource::Copy, 2 ),
+	TConvertFunc( SoyPixelsFormat::BGRA, SoyPixelsFormat::Yuv_8_8_8_Full, ConvertFormat_RgbToYuv, TConvertSource::Copy, 2 ),
+	TConvertFunc( SoyPixelsFormat::BGR, SoyPixelsFormat::Yuv_8_8_8_Full, ConvertFormat_RgbToYuv, TConvertSource::Copy, 2 ),
+	TConvertFunc( SoyPixelsFormat::RGB, SoyPixelsFormat::Yuv_8_8_8_Ntsc, ConvertFormat_RgbToYuv, TConvertSource::Copy, 2 ),
+	TConvertFunc( SoyPixelsFormat::RGBA, SoyPixelsFormat::Yuv_8_8_8_Ntsc, ConvertFormat_RgbToYuv, TConvertSource::Copy, 2 ),
+	TConvertFunc( SoyPixelsFormat::BGRA, SoyPixelsFormat::Yuv_8_8_8_Ntsc, ConvertFormat_RgbToYuv, TConvertSource::Copy, 2 ),
+	TConvertFunc( SoyPixelsFormat::BGR, SoyPixelsFormat::Yuv_8_8_8_Ntsc, ConvertFormat_RgbToYuv, TConvertSource::Copy, 2 ),
+	TConvertFunc( SoyPixelsFormat::RGB, SoyPixelsFormat::Yuv_8_8_8_Smptec, ConvertFormat_RgbToYuv, TConvertSource::Copy, 2 ),
+	TConvertFunc( SoyPixelsFormat::RGBA, SoyPixelsFormat::Yuv_8_8_8_Smptec, ConvertFormat_RgbToYuv, TConvertSource::Copy, 2 ),
+	TConvertFunc( SoyPixelsFormat::BGRA, SoyPixelsFormat::Yuv_8_8_8_Smptec, ConvertFormat_RgbToYuv, TConvertSource::Copy, 2 ),
+	TConvertFunc( SoyPixelsFormat::BGR, SoyPixelsFormat::Yuv_8_8_8_Smptec, ConvertFormat_RgbToYuv, TConvertSource::Copy, 2 ),
+};
+
+
+//	palettised images are sized by their palette, so can't go through the fixed-size conversions above
+class TPalettisedConvertFunc
+{
+public:
+	typedef void(*TFunction)(SoyPixelsImpl& Dst,const SoyPixelsImpl& Src);
+	
+public:
+	TPalettisedConvertFunc(SoyPixelsFormat::Type SrcFormat,SoyPixelsFormat::Type DestFormat,TFunction Func) :
+		mSrcFormat		( SrcFormat ),
+		mDestFormat		( DestFormat ),
+		mFunction		( Func )
+	{
+	}
+	
+	inline bool		operator==(const std::tuple<SoyPixelsFormat::Type,SoyPixelsFormat::Type>& SrcToDestFormat) const
+	{
+		return (std::get<0>( SrcToDestFormat )==mSrcFormat) && (std::get<1>( SrcToDestFormat )==mDestFormat);
+	}
+	
+	SoyPixelsFormat::Type	mSrcFormat;
+	SoyPixelsFormat::Type	mDestFormat;
+	TFunction				mFunction;
+};
+
+void ConvertFormat_Quantise(SoyPixelsImpl& Dst,const SoyPixelsImpl& Src)
+{
+	SoyPixelsFormat::Quantise( Dst, Src );
+}
+
+TPalettisedConvertFunc gPalettisedConversionFuncs[] =
+{
+	TPalettisedConvertFunc( SoyPixelsFormat::Palettised_RGB_8, SoyPixelsFormat::RGB, SoyPixelsFormat::ExpandPalettised ),
+	TPalettisedConvertFunc( SoyPixelsFormat::Palettised_RGB_8, SoyPixelsFormat::RGBA, SoyPixelsFormat::ExpandPalettised ),
+	TPalettisedConvertFunc( SoyPixelsFormat::Palettised_RGB_8, SoyPixelsFormat::BGRA, SoyPixelsFormat::ExpandPalettised ),
+	TPalettisedConvertFunc( SoyPixelsFormat::Palettised_RGBA_8, SoyPixelsFormat::RGB, SoyPixelsFormat::ExpandPalettised ),
+	TPalettisedConvertFunc( SoyPixelsFormat::Palettised_RGBA_8, SoyPixelsFormat::RGBA, SoyPixelsFormat::ExpandPalettised ),
+	TPalettisedConvertFunc( SoyPixelsFormat::Palettised_RGBA_8, SoyPixelsFormat::BGRA, SoyPixelsFormat::ExpandPalettised ),
+	TPalettisedConvertFunc( SoyPixelsFormat::RGB, SoyPixelsFormat::Palettised_RGBA_8, ConvertFormat_Quantise ),
+	TPalettisedConvertFunc( SoyPixelsFormat::RGBA, SoyPixelsFormat::Palettised_RGBA_8, ConvertFormat_Quantise ),
+};
+
+
+//	gr: formats without a direct conversion go via the cheapest chain of conversions in the table.
+//		cost of a step is the bytes per pixel it reads & writes.
+//		intermediate formats that throw away something both ends keep (colour, alpha, chroma
+//		resolution, precision) are never used, bytes per pixel would make them look cheap
+//		if every intermediate format is packed, steps are fused and run a strip of rows at a time
+//		so the intermediate images never exist
+class TConvertPlan
+{
+public:
+	static const size_t			FusedStripRows = 16;
+
+public:
+	TConvertPlan(SoyPixelsFormat::Type SrcFormat,SoyPixelsFormat::Type DstFormat);
+	
+	static std::shared_ptr<TConvertPlan>	Get(SoyPixelsFormat::Type SrcFormat,SoyPixelsFormat::Type DstFormat);	//	cached per format pair
+	static float			GetBytesPerPixel(SoyPixelsFormat::Type Format);
+	static bool				IsRowIndependent(SoyPixelsFormat::Type Format);		//	rows can be converted without the rest of the image
+	static bool				IsLossyIntermediate(SoyPixelsFormat::Type SrcFormat,SoyPixelsFormat::Type Intermediate,SoyPixelsFormat::Type DstFormat);
+	
+	bool					IsValid() const		{	return !mSteps.IsEmpty();	}
+	bool					CanFuse() const;
+	void					Run(const TConvertBuffers& Buffers) const;
+	
+	//	fused plans can be run a strip of rows at a time by the caller
+	size_t					GetRowAlignment() const;
+	size_t					GetStripRows() const;
+	size_t					GetStripsSize(size_t Width) const;	//	scratch RunStrip needs for intermediate formats
+	void					RunStrip(const TConvertBuffers& Buffers,size_t FirstRow,size_t RowCount,uint8* Strips) const;
+
+private:
+	void					RunSteps(const TConvertBuffers& Buffers) const;
+	void					RunFused(const TConvertBuffers& Buffers) const;
+	
+public:
+	Array<const TConvertFunc*>	mSteps;
+};
+
+
+namespace SoyPixelsConvertPlan
+{
+	std::mutex		gPlansLock;
+	std::map<std::tuple<SoyPixelsFormat::Type,SoyPixelsFormat::Type>,std::shared_ptr<TConvertPlan>>	gPlans;
+}
+
+
+TConvertPlan::TConvertPlan(SoyPixelsFormat::Type SrcFormat,SoyPixelsFormat::Type DstFormat)
+{
+	auto ConversionFuncs = GetRemoteArray( gConversionFuncs );
+	
+	//	a direct conversion always wins
+	auto* Direct = GetArrayBridge(ConversionFuncs).Find( std::make_tuple( SrcFormat, DstFormat ) );
+	if ( Direct )
+	{
+		mSteps.PushBack( Direct );
+		return;
+	}
+	
+	//	costs are positive, so just relax edges until nothing gets cheaper
+	std::map<SoyPixelsFormat::Type,float> Costs;
+	std::map<SoyPixelsFormat::Type,const TConvertFunc*> Via;
+	Costs[SrcFormat] = 0.f;
+	bool Changed = true;
+	while ( Changed )
+	{
+		Changed = false;
+		for ( size_t f=0;	f<ConversionFuncs.GetSize();	f++ )
+		{
+			auto& Func = ConversionFuncs[f];
+			auto From = Costs.find( Func.mSrcFormat );
+			if ( From == Costs.end() )
+				continue;
+			if ( Func.mDestFormat != DstFormat && IsLossyIntermediate( SrcFormat, Func.mDestFormat, DstFormat ) )
+				continue;
+			
+			auto Cost = From->second + GetBytesPerPixel( Func.mSrcFormat ) + GetBytesPerPixel( Func.mDestFormat );
+			auto To = Costs.find( Func.mDestFormat );
+			if ( To != Costs.end() && To->second <= Cost )
+				continue;
+			
+			Costs[Func.mDestFormat] = Cost;
+			Via[Func.mDestFormat] = &Func;
+			Changed = true;
+		}
+	}
+	
+	if ( Via.find( DstFormat ) == Via.end() )
+		return;
+	
+	//	walk back to the source
+	Array<const TConvertFunc*> ReverseSteps;
+	for ( auto Format=DstFormat;	Format!=SrcFormat;	)
+	{
+		auto* Step = Via[Format];
+		ReverseSteps.PushBack( Step );
+		Format = Step->mSrcFormat;
+	}
+	for ( ssize_t s=ReverseSteps.GetSize()-1;	s>=0;	s-- )
+		mSteps.PushBack( ReverseSteps[s] );
+}
+
+
+std::shared_ptr<TConvertPlan> TConvertPlan::Get(SoyPixelsFormat::Type SrcFormat,SoyPixelsFormat::Type DstFormat)
+{
+	std::lock_guard<std::mutex> Lock( SoyPixelsConvertPlan::gPlansLock );
+	auto& Plan = SoyPixelsConvertPlan::gPlans[std::make_tuple( SrcFormat, DstFormat )];
+	if ( !Plan )
+		Plan.reset( new TConvertPlan( SrcFormat, DstFormat ) );
+	return Plan;
+}
+
+
+float TConvertPlan::GetBytesPerPixel(SoyPixelsFormat::Type Format)
+{
+	//	probe an image so multi-plane formats are counted correctly
+	SoyPixelsMeta Meta( 16, 16, Format );
+	return Meta.GetDataSize() / static_cast<float>( 16*16 );
+}
+
+
+namespace SoyPixelsConvertPlan
+{
+	bool	HasColour(SoyPixelsFormat::Type Format);
+	bool	HasAlpha(SoyPixelsFormat::Type Format);
+	bool	IsReducedColour(SoyPixelsFormat::Type Format);	//	subsampled chroma or palettised
+	size_t	GetPrecision(SoyPixelsFormat::Type Format);		//	bytes per channel, without throwing for formats IsFloatChannel() doesn't know
+}
+
+
+bool SoyPixelsConvertPlan::HasColour(SoyPixelsFormat::Type Format)
+{
+	switch ( Format )
+	{
+		case SoyPixelsFormat::RGB:
+		case SoyPixelsFormat::RGBA:
+		case SoyPixelsFormat::ARGB:
+		case SoyPixelsFormat::BGRA:
+		case SoyPixelsFormat::BGR:
+		case SoyPixelsFormat::Float3:
+		case SoyPixelsFormat::Float4:
+		case SoyPixelsFormat::Half3:
+		case SoyPixelsFormat::Half4:
+		case SoyPixelsFormat::Palettised_RGB_8:
+		case SoyPixelsFormat::Palettised_RGBA_8:
+			return true;
+			
+		default:
+			return Yuv::IsYuvFormat( Format );
+	}
+}
+
+
+bool SoyPixelsConvertPlan::HasAlpha(SoyPixelsFormat::Type Format)
+{
+	switch ( Format )
+	{
+		case SoyPixelsFormat::GreyscaleAlpha:
+		case SoyPixelsFormat::RGBA:
+		case SoyPixelsFormat::ARGB:
+		case SoyPixelsFormat::BGRA:
+		case SoyPixelsFormat::Float2:
+		case SoyPixelsFormat::Float4:
+		case SoyPixelsFormat::Half2:
+		case SoyPixelsFormat::Half4:
+		case SoyPixelsFormat::Palettised_RGBA_8:
+			return true;
+			
+		default:
+			return false;
+	}
+}
+
+
+bool SoyPixelsConvertPlan::IsReducedColour(SoyPixelsFormat::Type Format)
+{
+	switch ( Format )
+	{
+		case SoyPixelsFormat::Yuv_844_Full:
+		case SoyPixelsFormat::Yuv_844_Ntsc:
+		case SoyPixelsFormat::Yuv_844_Smptec:
+		case SoyPixelsFormat::ChromaUV_8_8:
+		case SoyPixelsFormat::ChromaUV_88:
+		case SoyPixelsFormat::ChromaU_8:
+		case SoyPixelsFormat::ChromaV_8:
+		case SoyPixelsFormat::ChromaUV_44:
+		case SoyPixelsFormat::Palettised_RGB_8:
+		case SoyPixelsFormat::Palettised_RGBA_8:
+			return true;
+			
+		default:
+			return Yuv::IsYuvFormat( Format );
+	}
+}
+
+
+size_t SoyPixelsConvertPlan::GetPrecision(SoyPixelsFormat::Type Format)
+{
+	switch ( Format )
+	{
+		case SoyPixelsFormat::Float1:
+		case SoyPixelsFormat::Float2:
+		case SoyPixelsFormat::Float3:
+		case SoyPixelsFormat::Float4:
+			return 4;
+			
+		case SoyPixelsFormat::Half1:
+		case SoyPixelsFormat::Half2:
+		case SoyPixelsFormat::Half3:
+		case SoyPixelsFormat::Half4:
+			return 2;
+			
+		default:
+			return 1;
+	}
+}
+
+
+bool TConvertPlan::IsLossyIntermediate(SoyPixelsFormat::Type SrcFormat,SoyPixelsFormat::Type Intermediate,SoyPixelsFormat::Type DstFormat)
+{
+	using namespace SoyPixelsConvertPlan;
+	
+	//	eg. RGBA -> Greyscale -> BGRA
+	if ( HasColour( SrcFormat ) && HasColour( DstFormat ) && !HasColour( Intermediate ) )
+		return true;
+	
+	//	eg. RGBA -> RGB -> Float4
+	if ( HasAlpha( SrcFormat ) && HasAlpha( DstFormat ) && !HasAlpha( Intermediate ) )
+		return true;
+	
+	//	eg. RGBA -> Yuv_8_88 -> BGR
+	if ( IsReducedColour( Intermediate ) && !IsReducedColour( SrcFormat ) && !IsReducedColour( DstFormat ) )
+		return true;
+	
+	//	eg. Float3 -> RGB -> Float4
+	auto IntermediatePrecision = GetPrecision( Intermediate );
+	if ( IntermediatePrecision < GetPrecision( SrcFormat ) && IntermediatePrecision < GetPrecision( DstFormat ) )
+		return true;
+	
+	return false;
+}
+
+
+bool TConvertPlan::IsRowIndependent(SoyPixelsFormat::Type Format)
+{
+	if ( Yuv::IsYuvFormat( Format ) )
 		return false;
+	
+	SoyPixelsMeta Meta( 16, 16, Format );
+	return Meta.GetDataSize() == Meta.GetRowDataSize() * Meta.GetHeight();
+}
+
+
+bool TConvertPlan::CanFuse() const
+{
+	for ( size_t s=1;	s<mSteps.GetSize();	s++ )
+	{
+		if ( !IsRowIndependent( mSteps[s]->mSrcFormat ) )
+			return false;
+	}
+	return true;
+}
+
+
+void TConvertPlan::Run(const TConvertBuffers& Buffers) const
+{
+	if ( mSteps.GetSize() == 1 )
+	{
+		mSteps[0]->Run( Buffers );
+		return;
+	}
+	
+	if ( CanFuse() )
+		RunFused( Buffers );
+	else
+		RunSteps( Buffers );
+}
+
+
+void TConvertPlan::RunSteps(const TConvertBuffers& Buffers) const
+{
+	auto Width = Buffers.mSrcMeta.GetWidth();
+	auto Height = Buffers.mSrcMeta.GetHeight();
+	
+	Array<uint8> Intermediate[2];
+	TConvertBuffers Step = Buffers;
+	for ( size_t s=0;	s<mSteps.GetSize();	s++ )
+	{
+		bool Last = ( s == mSteps.GetSize()-1 );
+		if ( !Last )
+		{
+			auto& DstArray = Intermediate[s%2];
+			Step.mDstMeta = SoyPixelsMeta( Width, Height, mSteps[s]->mDestFormat );
+			DstArray.SetSize( Step.mDstMeta.GetDataSize(), false );
+			Step.mDst = DstArray.GetArray();
+			Step.mDstSize = DstArray.GetDataSize();
+			Step.mDstFirstRow = 0;
+		}
+		else
+		{
+			Step.mDst = Buffers.mDst;
+			Step.mDstSize = Buffers.mDstSize;
+			Step.mDstMeta = Buffers.mDstMeta;
+			Step.mDstFirstRow = Buffers.mDstFirstRow;
+		}
+		
+		mSteps[s]->Run( Step );
+		
+		Step.mSrc = Step.mDst;
+		Step.mSrcSize = Step.mDstSize;
+		Step.mSrcMeta = Step.mDstMeta;
+		Step.mSrcFirstRow = Step.mDstFirstRow;
+	}
+}
+
+
+size_t TConvertPlan::GetRowAlignment() const
+{
+	size_t RowAlignment = 1;
+	for ( size_t s=0;	s<mSteps.GetSize();	s++ )
+		RowAlignment = std::max( RowAlignment, mSteps[s]->mRowAlignment );
+	return RowAlignment;
+}
+
+
+size_t TConvertPlan::GetStripRows() const
+{
+	//	strips must start on a row every step can start on
+	auto RowAlignment = GetRowAlignment();
+	return ((FusedStripRows + RowAlignment - 1) / RowAlignment) * RowAlignment;
+}
+
+
+size_t TConvertPlan::GetStripsSize(size_t Width) const
+{
+	size_t StripsSize = 0;
+	for ( size_t s=0;	s+1<mSteps.GetSize();	s++ )
+		StripsSize += SoyPixelsMeta( Width, GetStripRows(), mSteps[s]->mDestFormat ).GetDataSize();
+	return StripsSize;
+}
+
+
+void TConvertPlan::RunStrip(const TConvertBuffers& Buffers,size_t FirstRow,size_t RowCount,uint8* Strips) const
+{
+	auto Width = Buffers.mSrcMeta.GetWidth();
+	auto Height = Buffers.mSrcMeta.GetHeight();
+	auto StripRows = GetStripRows();
+	
+	TConvertBuffers Step = Buffers;
+	for ( size_t s=0;	s<mSteps.GetSize();	s++ )
+	{
+		bool Last = ( s == mSteps.GetSize()-1 );
+		if ( !Last )
+		{
+			//	intermediate strips are packed one after another
+			Step.mDstMeta = SoyPixelsMeta( Width, Height, mSteps[s]->mDestFormat );
+			Step.mDst = Strips;
+			Step.mDstSize = Step.mDstMeta.GetRowDataSize() * StripRows;
+			Step.mDstFirstRow = FirstRow;
+			Strips += Step.mDstSize;
+		}
+		else
+		{
+			Step.mDst = Buffers.mDst;
+			Step.mDstSize = Buffers.mDstSize;
+			Step.mDstMeta = Buffers.mDstMeta;
+			Step.mDstFirstRow = Buffers.mDstFirstRow;
+		}
+		
+		mSteps[s]->mFunction( Step, FirstRow, RowCount );
+		
+		Step.mSrc = Step.mDst;
+		Step.mSrcSize = Step.mDstSize;
+		Step.mSrcMeta = Step.mDstMeta;
+		Step.mSrcFirstRow = Step.mDstFirstRow;
+	}
+}
+
+
+void TConvertPlan::RunFused(const TConvertBuffers& Buffers) const
+{
+	auto Width = Buffers.mSrcMeta.GetWidth();
+	auto Height = Buffers.mSrcMeta.GetHeight();
+	auto StripRows = GetStripRows();
+	auto StripsSize = GetStripsSize( Width );
+
+	auto ConvertBand = [&](size_t FirstRow,size_t RowCount)
+	{
+		Array<uint8> Strips;
+		Strips.SetSize( StripsSize, false );
+		
+		for ( size_t StripFirstRow=FirstRow;	StripFirstRow<FirstRow+RowCount;	StripFirstRow+=StripRows )
+		{
+			auto StripRowCount = std::min( StripRows, FirstRow+RowCount-StripFirstRow );
+			RunStrip( Buffers, StripFirstRow, StripRowCount, Strips.GetArray() );
+		}
+	};
+	SoyPixelsParallel::ForEachRowBand( Height, GetRowAlignment(), ConvertBand );
+}
+
+
+void SoyPixelsImpl::Convert(const SoyPixelsImpl& Src,SoyPixelsImpl& Dst,SoyYuvMatrix::Type YuvMatrix)
+{
+	TSoyPixelsFloatParams FloatParams;
+	Convert( Src, Dst, FloatParams, YuvMatrix );
+}
+
+
+void SoyPixelsImpl::Convert(const SoyPixelsImpl& Src,SoyPixelsImpl& Dst,const TSoyPixelsFloatParams& FloatParams,SoyYuvMatrix::Type YuvMatrix)
+{
+	if ( !Src.IsValid() )
+		throw Soy::AssertException("Convert source pixels are not valid");
+	
+	auto SrcFormat = Src.GetFormat();
+	auto DstFormat = Dst.GetFormat();
+	if ( !SoyPixelsFormat::IsValid( DstFormat ) )
+	{
+		std::stringstream Error;
+		Error << "Convert destination needs a format, " << Dst.GetMeta() << " isn't valid";
+		throw Soy::AssertException(Error.str());
+	}
+	
+	auto PalettisedFuncs = GetRemoteArray( gPalettisedConversionFuncs );
+	auto* PalettisedFunc = GetArrayBridge(PalettisedFuncs).Find( std::make_tuple( SrcFormat, DstFormat ) );
+	if ( PalettisedFunc )
+	{
+		PalettisedFunc->mFunction( Dst, Src );
+		return;
+	}
+	
+	//	size a growable destination to match, fixed (remote) arrays will throw if they're too small
+	//	a destination that's already the right size keeps its row pitch
+	bool SameSize = ( Dst.GetWidth() == Src.GetWidth() && Dst.GetHeight() == Src.GetHeight() );
+	SoyPixelsMeta DstMeta = SameSize ? Dst.GetMeta() : SoyPixelsMeta( Src.GetWidth(), Src.GetHeight(), DstFormat );
+	if ( !SameSize || Dst.GetPixelsArray().GetDataSize() < DstMeta.GetDataSize() )
+		Dst.Init( DstMeta );
+	
+	auto& SrcArray = Src.GetPixelsArray();
+	auto& DstArray = Dst.GetPixelsArray();
+	if ( SrcArray.GetArray() == DstArray.GetArray() )
+		throw Soy::AssertException("Convert source and destination share pixels, use SetFormat to convert in place");
+	if ( DstArray.GetDataSize() < DstMeta.GetDataSize() )
+	{
+		std::stringstream Error;
+		Error << "Convert destination is " << DstArray.GetDataSize() << " bytes, " << DstMeta << " needs " << DstMeta.GetDataSize();
+		throw Soy::AssertException(Error.str());
+	}
+
+	if ( SrcFormat == DstFormat )
+	{
+		//	gr: not Copy(), that works in channels per pixel which planar formats don't have
+		if ( Src.GetMeta() == DstMeta )
+		{
+			memcpy( DstArray.GetArray(), SrcArray.GetArray(), DstMeta.GetDataSize() );
+			return;
+		}
+		
+		//	different padding, copy rows of each plane
+		SoyPixelsPlanes SrcPlanes( Src );
+		SoyPixelsPlanes DstPlanes( Dst );
+		for ( size_t p=0;	p<SrcPlanes.GetPlaneCount();	p++ )
+		{
+			auto& SrcPlane = SrcPlanes[p];
+			auto& DstPlane = DstPlanes[p];
+			auto RowSize = SrcPlane.GetMeta().GetRowDataSize();
+			for ( size_t y=0;	y<SrcPlane.GetHeight();	y++ )
+				memcpy( &DstPlane.GetPixelPtr(0,y,0), &SrcPlane.GetPixelPtr(0,y,0), RowSize );
+		}
+		return;
+	}
+
+	auto Plan = TConvertPlan::Get( SrcFormat, DstFormat );
+	if ( !Plan->IsValid() )
+	{
+		std::stringstream Error;
+		Error << "No soypixel conversion from " << SrcFormat << " to " << DstFormat;
+		throw Soy::AssertException(Error.str());
+	}
+	
+	std::stringstream TimerName;
+	TimerName << "SoyPixel::Convert( " << SrcFormat << " to " << DstFormat << " )";
+	Soy::TScopeTimerPrint Timer( TimerName.str().c_str(), 5 );
+	
+	//	separate buffers, so every conversion can run straight into the destination
+	TConvertBuffers Buffers;
+	Buffers.mSrc = SrcArray.GetArray();
+	Buffers.mSrcSize = Src.GetMeta().GetDataSize();
+	Buffers.mSrcMeta = Src.GetMeta();
+	Buffers.mDst = DstArray.GetArray();
+	Buffers.mDstSize = DstMeta.GetDataSize();
+	Buffers.mDstMeta = DstMeta;
+	Buffers.mYuvMatrix = YuvMatrix;
+	Buffers.mFloatParams = &FloatParams;
+	Plan->Run( Buffers );
+}
+
+
+void SoyPixelsImpl::SetFormat(SoyPixelsFormat::Type Format,SoyYuvMatrix::Type YuvMatrix)
+{
+	auto OldFormat = GetFormat();
+	if ( !SoyPixelsFormat::IsValid( Format ) )
+	{
+		std::stringstream Error;
+		Error << "Trying to change to " << Format << " (invalid)";
+		throw Soy::AssertException(Error.str());
+	}
+
+	if ( OldFormat == Format )
+		return;
+	if ( !IsValid() )
+		throw Soy::AssertException("Pixels are not valid");
+	
+	//	palettised images change size with their palette, so convert from a copy
+	auto PalettisedFuncs = GetRemoteArray( gPalettisedConversionFuncs );
+	auto* PalettisedFunc = GetArrayBridge(PalettisedFuncs).Find( std::make_tuple( OldFormat, Format ) );
+	if ( PalettisedFunc )
+	{
+		SoyPixels Src;
+		Src.Copy( *this );
+		GetMeta().DumbSetFormat( Format );
+		GetMeta().DumbSetRowPitch( 0 );
+		PalettisedFunc->mFunction( *this, Src );
+		return;
+	}
+	
+	//	in-place conversions expect packed rows
+	Pack();
+
+	auto& PixelsArray = GetPixelsArray();
+	auto ConversionFuncs = GetRemoteArray( gConversionFuncs );
+	auto* ConversionFunc = GetArrayBridge(ConversionFuncs).Find( std::make_tuple( OldFormat, Format ) );
+	if ( ConversionFunc )
+	{
+		std::stringstream TimerName;
+		TimerName << "SoyPixel::SetFormat( " << OldFormat << " to " << Format << " )";
+		Soy::TScopeTimerPrint Timer( TimerName.str().c_str(), 5 );
+
+		ConversionFunc->Run( PixelsArray, GetMeta(), YuvMatrix );
+		return;
+	}
+	
+	//	no direct conversion, convert from a copy via intermediate formats
+	auto Plan = TConvertPlan::Get( OldFormat, Format );
+	if ( Plan->IsValid() )
+	{
+		std::stringstream TimerName;
+		TimerName << "SoyPixel::SetFormat( " << OldFormat << " to " << Format << " ) in " << Plan->mSteps.GetSize() << " steps";
+		Soy::TScopeTimerPrint Timer( TimerName.str().c_str(), 5 );
+		
+		SoyPixels Src;
+		Src.Copy( *this );
+		SoyPixelsMeta NewMeta( GetWidth(), GetHeight(), Format );
+		Init( NewMeta );
+		Convert( Src, *this, YuvMatrix );
+		return;
+	}
+	
+
+	if ( GetFormat() == SoyPixelsFormat::KinectDepth && Format == SoyPixelsFormat::Greyscale )
+	{
+		ConvertFormat_KinectDepthToGreyscale( PixelsArray, GetMeta(), Format );
+		return;
+	}
+
+	if ( GetFormat() == SoyPixelsFormat::KinectDepth && Format == SoyPixelsFormat::GreyscaleAlpha )
+	{
+		ConvertFormat_KinectDepthToGreyscale( PixelsArray, GetMeta(), Format );
+		return;
+	}
+
+	//	see if we can use of simple channel-count change
+	bool UseOfPixels = false;
+	UseOfPixels |= ( GetFormat() == SoyPixelsFormat::RGB && Format == SoyPixelsFormat::RGBA );
+	UseOfPixels |= ( GetFormat() == SoyPixelsFormat::RGBA && Format == SoyPixelsFormat::RGB );
+	//UseOfPixels |= ( GetFormat() == SoyPixelsFormat::BGRA && Format == SoyPixelsFormat::BGR );
+	UseOfPixels |= ( GetFormat() == SoyPixelsFormat::RGBA && Format == SoyPixelsFormat::Greyscale );
+	UseOfPixels |= ( GetFormat() == SoyPixelsFormat::RGB && Format == SoyPixelsFormat::Greyscale );
+	
+	//	report missing, but desired conversions
+	std::stringstream Error;
+	Error << "No soypixel conversion from " << OldFormat << " to " << Format;
+	throw Soy::AssertException(Error.str());
+}
+
+#if defined(SOY_OPENCL)
+bool TPixels::SetChannels(uint8 Channels,SoyOpenClManager& OpenClManager,const ofColour& FillerColour)
+{
+	clSetPixelParams Params = _clSetPixelParams();
+	Params.mDefaultColour = ofToCl_Rgba_int4( FillerColour );
+	return SetChannels( Channels, OpenClManager, Params );
+}
+#endif
+
+#if defined(SOY_OPENCL)
+bool TPixels::SetChannels(uint8 Channels,SoyOpenClManager& OpenClManager,const clSetPixelParams& Params)
+{
+	if ( Channels < 1 )
+		return false;
+
+	//	skip if no change in channels, unless we have other options
+	if ( Channels == GetChannels() )
+		return true;
+
+	if ( !IsValid() )
+		return false;
+
+	//	use the lovely fast shader!
+	//	non-shader version takes about 340ms for 1080p
+	ClShaderSetPixelChannels Shader( OpenClManager );
+	if ( !Shader.Run( *this, Channels, Params ) )
+		return false;
+	return true;
+}
+#endif
+
+	
+#if defined(SOY_OPENCL)
+bool TPixels::RgbaToHsla(SoyOpenClManager& OpenClManager,std::shared_ptr<SoyClDataBuffer>& Hsla) const
+{
+	if ( !IsValid() )
+		return false;
+
+	ClShaderRgbaToHsla Shader( OpenClManager );
+	if ( !Shader.Run( *this, Hsla ) )
+		return false;
+
+	return true;
+}
+#endif
+
+#if defined(SOY_OPENCL)
+bool TPixels::RgbaToHsla(SoyOpenClManager& OpenClManager,std::shared_ptr<msa::OpenCLImage>& Hsla) const
+{
+	if ( !IsValid() )
+		return false;
+
+	ClShaderRgbaToHsla Shader( OpenClManager );
+	if ( !Shader.Run( *this, Hsla ) )
+		return false;
+
+	return true;
+}
+#endif
+
+#if defined(SOY_OPENCL)
+bool TPixels::RgbaToHsla(SoyOpenClManager& OpenClManager)
+{
+	if ( !IsValid() )
+		return false;
+
+	ClShaderRgbaToHsla Shader( OpenClManager );
+	if ( !Shader.Run( *this ) )
+		return false;
+	return true;
+}
+#endif
+
+#if defined(SOY_OPENCL)
+bool TPixels::Set(const msa::OpenCLImage& PixelsConst,SoyOpenClKernel& Kernel)
+{
+	if ( !Kernel.IsValid() )
+		return false;
+
+	return Set( PixelsConst, Kernel.GetQueue() );
+}
+#endif
+
+
+#if defined(SOY_OPENCL)
+bool TPixels::Set(const msa::OpenCLImage& PixelsConst,cl_command_queue Queue)
+{
+	if ( !Queue )
+		return false;
+
+	uint8 Channels = PixelsConst.getDepth();
+	auto& Pixels = const_cast<msa::OpenCLImage&>( PixelsConst );
+	//	clformat is either RGBA(4 chan) or A/LUM(1 chan)
+	if ( Channels != 1 && Channels != 4 )
+	{
+		assert( false );
+		Clear();
+		return false;
+	}
+	
+	mMeta.DumbSetWidth( Pixels.getWidth() );
+	mMeta.DumbSetFormat( SoyPixelsFormat::GetFormatFromChannelCount( Channels ) );
+	int Alloc = GetWidth() * GetChannels() * Pixels.getHeight();
+	if ( !mPixels.SetSize( Alloc, false, true ) )
+		return false;
+
+	bool Blocking = true;
+	if ( !Pixels.read( Queue, mPixels.GetArray(), Blocking ) )
+	{
+		Clear();
+		return false;
+	}
+
+	//	check for corruption as there is no size checking in the read :/
+	mPixels.GetHeap().Debug_Validate( mPixels.GetArray() );
+	return true;
+}
+#endif
+
+
+
+void SoyPixelsImpl::Init(size_t Width, size_t Height, size_t Channels)
+{
+	auto Format = SoyPixelsFormat::GetFormatFromChannelCount( Channels );
+	Init( Width, Height, Format );
+}
+
+void SoyPixelsImpl::Init(size_t Width, size_t Height,SoyPixelsFormat::Type Format)
+{
+	Init( SoyPixelsMeta( Width, Height, Format ) );
+}
+
+
+void SoyPixelsImpl::Init(const SoyPixelsMeta& Meta)
+{
+	auto Width = Meta.GetWidth();
+	auto Height = Meta.GetHeight();
+	auto Format = Meta.GetFormat();
+	
+	//	alloc
+	GetMeta().DumbSetWidth( Width );
+	GetMeta().DumbSetHeight( Height );
+	GetMeta().DumbSetFormat( Format );
+	GetMeta().DumbSetRowPitch( Meta.IsPacked() ? 0 : Meta.GetRowPitch() );
+	auto Alloc = GetMeta().GetDataSize();
+	auto& Pixels = GetPixelsArray();
+	Pixels.SetSize( Alloc, false );
+}
+
+
+void SoyPixelsImpl::Clear(bool Dealloc)
+{
+	//	gr: leaving format as it might be useful as ghost meta
+	//GetMeta().DumbSetFormat( SoyPixelsFormat::Invalid );
+	GetMeta().DumbSetWidth( 0 );
+	GetMeta().DumbSetRowPitch( 0 );
+	auto& Pixels = GetPixelsArray();
+	Pixels.Clear( Dealloc );
+
+	Soy::Assert( GetHeight() == 0, "Height should be 0 after clear");
+	Soy::Assert( !IsValid(), "should be invalid after clear");
+}
+
+
+namespace SoyPixelsRaw
+{
+	//	raw data starts with the SoyPixelsMeta layout from before it had a row pitch, so
+	//	memfiles from older builds still read. Rows are always packed
+	class THeader
+	{
+	public:
+		SoyPixelsFormat::Type	mFormat;
+		size_t					mWidth;
+		size_t					mHeight;
+	};
+}
+
+
+bool SoyPixelsImpl::GetRawSoyPixels(ArrayBridge<char>& RawData) const
+{
+	if ( !IsValid() )
+		return false;
+
+	//	header has no room for a row pitch
+	if ( !GetMeta().IsPacked() )
+	{
+		SoyPixels Packed;
+		Packed.Copy( *this );
+		Packed.Pack();
+		return Packed.GetRawSoyPixels( RawData );
+	}
+	
+	//	write header/meta
+	auto& Pixels = GetPixelsArray();
+	auto& Meta = GetMeta();
+	SoyPixelsRaw::THeader Header;
+	Header.mFormat = Meta.GetFormat();
+	Header.mWidth = Meta.GetWidth();
+	Header.mHeight = Meta.GetHeight();
+	
+	//	alloc all data in one go (need this for memfiles!)
+	//	gr: previously we APPENDED data. now clear. Has this broken anything?
+	RawData.Clear(false);
+	RawData.Reserve( sizeof(Header) + Pixels.GetDataSize() );
+	
+	if ( !RawData.PushBackReinterpret( Header ) )
+		return false;
+	
+	//	gr: not sure how safe this is... vtables etc...
+	auto& CastArray = *reinterpret_cast<ArrayInterface<uint8>*>( &RawData );
+	if ( !CastArray.PushBackArray( Pixels ) )
+	//if ( !RawData.PushBackArray( Pixels ) )
+		return false;
+	
+	return true;
+}
+
+
+bool SoyPixelsImpl::SetRawSoyPixels(const ArrayBridge<char>& RawData)
+{
+	int HeaderSize = sizeof(SoyPixelsRaw::THeader);
+	if ( RawData.GetDataSize() < HeaderSize )
+		return false;
+	auto& RawHeader = *reinterpret_cast<const SoyPixelsRaw::THeader*>( RawData.GetArray() );
+	SoyPixelsMeta Header( RawHeader.mWidth, RawHeader.mHeight, RawHeader.mFormat );
+	if ( !Header.IsValid() )
+		return false;
+
+	//	rest of the data as an array
+	const size_t PixelDataSize = RawData.GetDataSize()-HeaderSize;
+	auto* RawData8 = reinterpret_cast<const uint8*>(RawData.GetArray());
+	auto Pixels = GetRemoteArray( RawData8+HeaderSize, PixelDataSize );
+	
+	//	todo: verify size! (alignment!)
+	GetMeta() = Header;
+	GetPixelsArray().Clear(false);
+	GetPixelsArray().PushBackArray( Pixels );
+
+	if ( !IsValid() )
+		return false;
+
+	return true;
+}
+
+
+
+bool SoyPixelsImpl::GetPng(ArrayBridge<char>& PngData) const
+{
+	return GetPng( PngData, TPng::TEncodeParams() );
+}
+
+
+bool SoyPixelsImpl::GetPng(ArrayBridge<char>& PngData,const TPng::TEncodeParams& Params) const
+{
+	//	remove need for Png. Isn't this deprecated anyway
+#if defined(TARGET_PS4)
+	return false;
+#else
+	//	png rows are packed
+	if ( !GetMeta().IsPacked() )
+	{
+		SoyPixels Packed;
+		Packed.Copy( *this );
+		Packed.Pack();
+		return Packed.GetPng( PngData, Params );
+	}
+	
+	//	if non-supported PNG colour format, then convert to one that is
+	auto PngColourType = TPng::GetColourType( GetFormat() );
+	if ( PngColourType == TPng::TColour::Invalid )
+	{
+		//	do conversion here
+		SoyPixels OtherFormat;
+		OtherFormat.Copy( *this );
+		auto NewFormat = SoyPixelsFormat::RGB;
+		
+		//	gr: this conversion should be done in soypixels, with a list of compatible output formats
+		switch ( GetFormat() )
+		{
+			//case SoyPixelsFormat::KinectDepth:	NewFormat = SoyPixelsFormat::Greyscale;	break;
+			case SoyPixelsFormat::BGRA:			NewFormat = SoyPixelsFormat::RGBA;	break;
+			default:break;
+		}
+
+		//	new format MUST be compatible or we'll get stuck in a loop
+		if ( TPng::GetColourType( NewFormat ) == TPng::TColour::Invalid )
+		{
+			assert( false );
+			return false;
+		}
+		
+		//	attempt conversion
+		OtherFormat.SetFormat( NewFormat );
+		
+		return OtherFormat.GetPng( PngData, Params );
+	}
+
+	//	http://stackoverflow.com/questions/7942635/write-png-quickly
+
+	//\211 P N G \r \n \032 \n (89 50 4E 47 0D 0A 1A 0A
+	//uint8 Magic[] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+	BufferArray<char,8> Magic;
+	TPng::GetMagic( GetArrayBridge(Magic) );
+	char IHDR[] = { 73, 72, 68, 82 };	//'I', 'H', 'D', 'R'
+	const char IEND[] = { 73, 69, 78, 68 }; //("IEND")
+	const char IDAT[] = { 73, 68, 65, 84 };// ("IDAT")
+
+	//	write header chunk
+	uint32 Width = size_cast<uint32>(GetWidth());
+	uint32 Height = size_cast<uint32>(GetHeight());
+	uint8 BitDepth = GetBitDepth();
+	uint8 ColourType = PngColourType;
+	assert( PngColourType != TPng::TColour::Invalid );
+	uint8 Compression = TPng::TCompression::DEFLATE;
+	uint8 Filter = TPng::TFilter::None;
+	uint8 Interlace = TPng::TInterlace::None;
+	Array<char> Header;
+	Header.PushBackArray( IHDR );
+	Header.PushBackReinterpretReverse( Width );
+	Header.PushBackReinterpretReverse( Height );
+	Header.PushBack( BitDepth );
+	Header.PushBack( ColourType );
+	Header.PushBack( Compression );
+	Header.PushBack( Filter );
+	Header.PushBack( Interlace );
+
+	//	write data chunks
+	Array<char> PixelData;
+	PixelData.PushBackArray( IDAT );
+	if ( !TPng::GetPngData( PixelData, *this, static_cast<TPng::TCompression::Type>(Compression), Params ) )
+		return false;
+
+	//	write Tail chunks
+	Array<char> Tail;
+	Tail.PushBackArray( IEND );
+
+	//	put it all together!
+	PngData.Reserve( Header.GetDataSize() + 12 );
+	PngData.Reserve( PixelData.GetDataSize() + 12 );
+	PngData.Reserve( Tail.GetDataSize() + 12 );
+
+	uint32 HeaderLength = size_cast<uint32>( Header.GetDataSize() - sizeofarray(IHDR) );
+	assert( HeaderLength == 13 );
+	uint32 HeaderCrc = Soy::GetCrc32( GetArrayBridge(Header) );
+	PngData.PushBackArray( Magic );
+	PngData.PushBackReinterpretReverse( HeaderLength );
+	PngData.PushBackArray( Header );
+	PngData.PushBackReinterpretReverse( HeaderCrc );
+
+	uint32 PixelDataLength = size_cast<uint32>( PixelData.GetDataSize() - sizeofarray(IDAT) );
+	uint32 PixelDataCrc = Soy::GetCrc32( GetArrayBridge(PixelData) );
+	PngData.PushBackReinterpretReverse( PixelDataLength );
+	PngData.PushBackArray( PixelData );
+	PngData.PushBackReinterpretReverse( PixelDataCrc );
+
+	uint32 TailLength = size_cast<uint32>( Tail.GetDataSize() - sizeofarray(IEND) );
+	uint32 TailCrc = Soy::GetCrc32( GetArrayBridge(Tail) );
+	assert( TailCrc == 0xAE426082 );
+	PngData.PushBackReinterpretReverse( TailLength );
+	PngData.PushBackArray( Tail );
+	PngData.PushBackReinterpretReverse( TailCrc );
+	
+	return true;
+#endif
+}
+
+
+
+size_t SoyPixelsImpl::GetIndex(size_t x,size_t y,size_t ChannelOffset) const
+{
+	auto w = GetWidth();
+	auto h = GetHeight();
+	auto ChannelCount = GetChannels();
+	if ( x >= w || y >= h || ChannelOffset >= ChannelCount )
+	{
+		std::stringstream Error;
+		Error << "Pixel OOB x=" << x << '/' << w << " y=" << y << '/' << h << " ch=" << ChannelOffset << '/' << ChannelCount;
+		throw Soy::AssertException( Error.str() );
+	}
+	
+	auto Index = y * GetMeta().GetRowPitch();
+	Index += x * ChannelCount;
+	Index += ChannelOffset;
+	return Index;
+}
+
+uint8& SoyPixelsImpl::GetPixelPtr(size_t x,size_t y,size_t ChannelOffset)
+{
+	auto Index = GetIndex( x, y, ChannelOffset );
+	auto& Pixels = GetPixelsArray();
+	auto* PixelsPtr = Pixels.GetArray();
+	return PixelsPtr[Index];
+}
+
+const uint8& SoyPixelsImpl::GetPixelPtr(size_t x,size_t y,size_t ChannelOffset) const
+{
+	auto Index = GetIndex( x, y, ChannelOffset );
+	auto& Pixels = GetPixelsArray();
+	auto* PixelsPtr = Pixels.GetArray();
+	return PixelsPtr[Index];
+}
+
+uint8 SoyPixelsImpl::GetPixel(size_t x,size_t y,size_t Channel) const
+{
+	return GetPixelPtr( x, y, Channel );
+}
+
+vec2x<uint8> SoyPixelsImpl::GetPixel2(size_t x,size_t y) const
+{
+	auto ChannelCount = GetChannels();
+	Soy::Assert( ChannelCount >= 2, "Accessing channel OOB");
+	auto* Pixel = &GetPixelPtr( x, y, 0 );
+	return vec2x<uint8>( Pixel[0], Pixel[1] );
+}
+
+vec3x<uint8> SoyPixelsImpl::GetPixel3(size_t x,size_t y) const
+{
+	auto ChannelCount = GetChannels();
+	Soy::Assert( ChannelCount >= 3, "Accessing channel OOB");
+	auto* Pixel = &GetPixelPtr( x, y, 0 );
+	return vec3x<uint8>( Pixel[0], Pixel[1], Pixel[2] );
+}
+
+vec4x<uint8> SoyPixelsImpl::GetPixel4(size_t x,size_t y) const
+{
+	auto ChannelCount = GetChannels();
+	Soy::Assert( ChannelCount >= 4, "Accessing channel OOB");
+	auto* Pixel = &GetPixelPtr( x, y, 0 );
+	return vec4x<uint8>( Pixel[0], Pixel[1], Pixel[2], Pixel[3] );
+}
+
+void SoyPixelsImpl::SetPixel(size_t x,size_t y,size_t Channel,uint8 Component)
+{
+	auto& Pixel = GetPixelPtr( x, y, Channel );
+	Pixel = Component;
+}
+
+void SoyPixelsImpl::SetPixel(size_t x,size_t y,const vec2x<uint8>& Colour)
+{
+	auto ChannelCount = GetChannels();
+	Soy::Assert( ChannelCount >= 2, "Accessing channel OOB");
+
+	auto* Pixel = &GetPixelPtr( x, y, 0 );
+	Pixel[0] = Colour.x;
+	Pixel[1] = Colour.y;
+}
+
+void SoyPixelsImpl::SetPixel(size_t x,size_t y,const vec3x<uint8>& Colour)
+{
+	auto ChannelCount = GetChannels();
+	Soy::Assert( ChannelCount >= 3, "Accessing channel OOB");
+	
+	auto* Pixel = &GetPixelPtr( x, y, 0 );
+	Pixel[0] = Colour.x;
+	Pixel[1] = Colour.y;
+	Pixel[2] = Colour.z;
+}
+
+void SoyPixelsImpl::SetPixel(size_t x,size_t y,const vec4x<uint8>& Colour)
+{
+	auto ChannelCount = GetChannels();
+	Soy::Assert( ChannelCount >= 4, "Accessing channel OOB");
+
+	auto* Pixel = &GetPixelPtr( x, y, 0 );
+	Pixel[0] = Colour.x;
+	Pixel[1] = Colour.y;
+	Pixel[2] = Colour.z;
+	Pixel[3] = Colour.w;
+}
+
+
+void SoyPixelsImpl::ResizeClip(size_t Width,size_t Height)
+{
+	Pack();
+	auto& Pixels = GetPixelsArray();
+	auto Channels = GetChannels();
+	//	we'll get stuck in loops if stride is zero
+	Channels = std::max<uint8_t>( Channels, 1 );
+	
+	//	simply add/remove rows
+	if ( Height > GetHeight() )
+	{
+		auto RowBytes = Channels * GetWidth();
+		RowBytes *= Height - GetHeight();
+		Pixels.PushBlock( RowBytes );
+		GetMeta().DumbSetHeight( Height );
+	}
+	else if ( Height < GetHeight() )
+	{
+		auto RowBytes = Channels * GetWidth();
+		RowBytes *= GetHeight() - Height;
+		Pixels.SetSize( Pixels.GetDataSize() - RowBytes );
+		GetMeta().DumbSetHeight( Height );
+	}
+	
+	//	insert/remove data on the end of each row
+	if ( Width > GetWidth() )
+	{//	todo: prealloc!
+		//	working backwards makes it easy & fast
+		auto Stride = Channels * GetWidth();
+		auto ColBytes = Channels * (Width - GetWidth());
+		for ( ssize_t p=Pixels.GetDataSize();	p>=0;	p-=Stride )
+			Pixels.InsertBlock( p, ColBytes );
+		GetMeta().DumbSetWidth( Width );
+	}
+	else if ( Width < GetWidth() )
+	{
+		//	working backwards makes it easy & fast
+		auto Stride = Channels * GetWidth();
+		auto ColBytes = Channels * (GetWidth() - Width);
+		for ( ssize_t p=Pixels.GetDataSize()-ColBytes;	p>=0;	p-=Stride )
+			Pixels.RemoveBlock( p, ColBytes );
+		GetMeta().DumbSetWidth( Width );
+	}
+	
+	if ( Height != GetHeight() || Width != GetWidth() )
+	{
+		std::stringstream Error;
+		Error << "Wrong height(" << Height << " not " << GetHeight() << ") width (" << Width << " not " << GetWidth() << ") after " << __func__;
+		throw Soy::AssertException( Error.str() );
+	}
+}
+
+void SoyPixelsMeta::SplitPlanes(size_t PixelDataSize,ArrayBridge<std::tuple<size_t,size_t,SoyPixelsMeta>>&& PlaneOffsetSizeAndMetas,const ArrayInterface<uint8>* Data) const
+{
+	//	get the mid-formats
+	auto& ThisMeta = *this;
+	BufferArray<SoyPixelsMeta,10> Formats;
+	ThisMeta.GetPlanes( GetArrayBridge(Formats), Data );
+
+	//	gr: error is only built when something is wrong, this is called per-frame
+	auto GetError = [&](size_t DataOffset)
+	{
+		std::stringstream Error;
+		Error << "Split pixel planes (" << ThisMeta << " -> " << Soy::StringJoin( GetArrayBridge(Formats), "," ) << ") but data hasn't aligned after split; ";
+		size_t Offset = SoyPixelsFormat::GetHeaderSize( ThisMeta.GetFormat() );
+		for ( size_t p=0;	p<Formats.GetSize();	p++ )
+		{
+			auto PlaneDataSize = Formats[p].GetDataSize();
+			Error << "#" << p << "/" << Formats.GetSize() << " " << Formats[p] << " = " << PlaneDataSize << " bytes; ";
+			Offset += PlaneDataSize;
+			if ( Offset > PixelDataSize )
+				break;
+		}
+		Error << "total " << DataOffset << " out of " << PixelDataSize << " bytes";
+		return Error.str();
+	};
+	
+	size_t DataOffset = SoyPixelsFormat::GetHeaderSize( ThisMeta.GetFormat() );
+	for ( int p=0;	p<Formats.GetSize();	p++ )
+	{
+		auto PlaneMeta = Formats[p];
+		auto PlaneDataOffset = DataOffset;
+		auto PlaneDataSize = PlaneMeta.GetDataSize();
+
+		auto PlaneOffsetSizeAndMeta = std::make_tuple( PlaneDataOffset, PlaneDataSize, PlaneMeta );
+		DataOffset += PlaneDataSize;
+
+		//	check for overflow
+		if ( DataOffset > PixelDataSize )
+			throw Soy::AssertException( GetError( DataOffset ) );
+
+		PlaneOffsetSizeAndMetas.PushBack(PlaneOffsetSizeAndMeta);
+	}
+
+	//	error, but don't fail if underrun. overrun should be caught in the loop
+	static bool ThrowOnUnderflow = false;
+	static bool ThrowOnOverflow = true;
+	if ( DataOffset < PixelDataSize && ThrowOnUnderflow )
+	{
+		throw Soy::AssertException( GetError( DataOffset ) );
+	}
+	else if ( DataOffset > PixelDataSize && ThrowOnOverflow )
+	{
+		throw Soy::AssertException( GetError( DataOffset ) );
+	}
+	else if ( DataOffset != PixelDataSize )
+	{
+		std::Debug << GetError( DataOffset ) << std::endl;
+	}
+}
+
+void SoyPixelsImpl::SplitPlanes(ArrayBridge<std::shared_ptr<SoyPixelsImpl>>&& Planes) const
+{
+	//	get the plane layouts
+	auto& ThisMeta = GetMeta();
+	auto& ThisArray = GetPixelsArray();
+	auto PixelDataSize = ThisArray.GetDataSize();
+	BufferArray<std::tuple<size_t,size_t,SoyPixelsMeta>,10> PlaneOffsetSizeAndMetas;
+	ThisMeta.SplitPlanes( PixelDataSize, GetArrayBridge(PlaneOffsetSizeAndMetas), &ThisArray );
+	
+	//	make up the remote pixels
+	for ( int p=0;	p<PlaneOffsetSizeAndMetas.GetSize();	p++ )
+	{
+		auto& PlaneOffsetSizeAndMeta = PlaneOffsetSizeAndMetas[p];
+		auto PlaneDataOffset = std::get<0>( PlaneOffsetSizeAndMeta );
+		auto PlaneDataSize = std::get<1>( PlaneOffsetSizeAndMeta );
+		auto PlaneMeta = std::get<2>( PlaneOffsetSizeAndMeta );
+		auto* PlaneData = ThisArray.GetArray() + PlaneDataOffset;
+
+		//	lets allow const use of this func. But SoyPixelsRemote may need a non-mutable version?
+		auto* PlaneDataMutable = const_cast<uint8_t*>(PlaneData);
+		std::shared_ptr<SoyPixelsRemote> Pixels(new SoyPixelsRemote( PlaneDataMutable, PlaneDataSize, PlaneMeta ) );
+		Planes.PushBack(Pixels);
+	}
+}
+
+
+SoyPixelsPlanes::SoyPixelsPlanes(const SoyPixelsImpl& Pixels) :
+	mPlaneCount	( 0 )
+{
+	auto& Meta = Pixels.GetMeta();
+	auto& PixelsArray = Pixels.GetPixelsArray();
+	BufferArray<std::tuple<size_t,size_t,SoyPixelsMeta>,MaxPlanes> PlaneOffsetSizeAndMetas;
+	Meta.SplitPlanes( PixelsArray.GetDataSize(), GetArrayBridge(PlaneOffsetSizeAndMetas), &PixelsArray );
+	
+	//	same const-use as SplitPlanes()
+	auto* Data = const_cast<uint8*>( PixelsArray.GetArray() );
+	for ( size_t p=0;	p<PlaneOffsetSizeAndMetas.GetSize();	p++ )
+	{
+		auto& PlaneOffsetSizeAndMeta = PlaneOffsetSizeAndMetas[p];
+		auto PlaneDataOffset = std::get<0>( PlaneOffsetSizeAndMeta );
+		auto PlaneDataSize = std::get<1>( PlaneOffsetSizeAndMeta );
+		auto& PlaneMeta = std::get<2>( PlaneOffsetSizeAndMeta );
+		
+		mPlanes[p] = SoyPixelsRemote( Data + PlaneDataOffset, PlaneDataSize, PlaneMeta );
+		mPlaneOffsets[p] = PlaneDataOffset;
+		mPlaneCount++;
+	}
+}
+
+SoyPixelsRemote& SoyPixelsPlanes::GetPlane(size_t Index)
+{
+	if ( Index >= mPlaneCount )
+	{
+		std::stringstream Error;
+		Error << "Plane " << Index << "/" << mPlaneCount << " out of range";
+		throw Soy::AssertException( Error.str() );
+	}
+	return mPlanes[Index];
+}
+
+const SoyPixelsRemote& SoyPixelsPlanes::GetPlane(size_t Index) const
+{
+	return const_cast<SoyPixelsPlanes&>(*this).GetPlane( Index );
+}
+
+size_t SoyPixelsPlanes::GetPlaneOffset(size_t Index) const
+{
+	GetPlane( Index );
+	return mPlaneOffsets[Index];
+}
+
+
+template<size_t COMPONENTS>
+void SetPixelComponents(ArrayInterface<uint8>& Pixels,const ArrayBridge<uint8>& Components)
+{
+	BufferArray<uint8,COMPONENTS> BufferComponents;
+	for ( int i=0;	i<COMPONENTS;	i++ )
+	{
+		if ( i < Components.GetSize() )
+			BufferComponents.PushBack( Components[i] );
+		else
+			BufferComponents.PushBack( 255 );
+	}
+	
+	for ( int p=0;	p<Pixels.GetSize();	p++ )
+	{
+		Pixels[p] = BufferComponents[p%COMPONENTS];
+	}
+	
+}
+
+void SoyPixelsImpl::SetPixels(const ArrayBridge<uint8>& Components)
+{
+	if ( !IsValid() )
+		return;
+	
+	Pack();
+	auto& Pixels = GetPixelsArray();
+	
+	switch ( GetChannels() )
+	{
+		case 1:	SetPixelComponents<1>( Pixels, Components );	return;
+		case 2:	SetPixelComponents<2>( Pixels, Components );	return;
+		case 3:	SetPixelComponents<3>( Pixels, Components );	return;
+		case 4:	SetPixelComponents<4>( Pixels, Components );	return;
+		case 5:	SetPixelComponents<5>( Pixels, Components );	return;
+	};
+}
+
+vec2f SoyPixelsImpl::GetUv(size_t PixelIndex) const
+{
+	auto xy = GetXy( PixelIndex );
+	float u = xy.x / static_cast<float>( GetWidth() );
+	float v = xy.y / static_cast<float>( GetHeight() );
+	return vec2f( u, v );
+}
+
+vec2x<size_t> SoyPixelsImpl::GetXy(size_t PixelIndex) const
+{
+	auto x = PixelIndex % GetWidth();
+	auto y = PixelIndex / GetWidth();
+	return vec2x<size_t>( x, y );
+}
+
+void SoyPixelsImpl::ResizeFastSample(size_t NewWidth, size_t NewHeight)
+{
+	//	copy old data
+	Pack();
+	SoyPixels Old;
+	Old.Copy(*this);
+	
+	auto& New = *this;
+	auto NewChannelCount = GetChannels();
+	//	resize buffer
+	ResizeClip( NewWidth, NewHeight );
+	
+	auto OldHeight = Old.GetHeight();
+	auto OldWidth = Old.GetWidth();
+	auto OldChannelCount = Old.GetChannels();
+	auto MinChannelCount = std::min( OldChannelCount, NewChannelCount );
+	
+	auto& OldPixelsArray = Old.GetPixelsArray();
+	auto& NewPixelsArray = New.GetPixelsArray();
+	
+	auto* OldPixels = OldPixelsArray.GetArray();
+	auto* NewPixels = NewPixelsArray.GetArray();
+
+	for ( int ny=0;	ny<NewHeight;	ny++ )
+	{
+		float yf = ny/static_cast<float>(NewHeight);
+		int oy = static_cast<int>(OldHeight * yf);
+
+		auto OldLineSize = OldWidth * OldChannelCount;
+		auto NewLineSize = NewWidth * NewChannelCount;
+//#define SAFE_RESIZE
+#if defined(SAFE_RESIZE)
+		auto OldRow = GetRemoteArray( &OldPixels[oy*OldLineSize], OldLineSize );
+		auto NewRow = GetRemoteArray( &NewPixels[ny*NewLineSize], NewLineSize );
+#else
+		auto OldRow = &OldPixels[oy*OldLineSize];
+		auto NewRow = &NewPixels[ny*NewLineSize];
+#endif
+		for ( int nx=0;	nx<NewWidth;	nx++ )
+		{
+			float xf = nx / static_cast<float>(NewWidth);
+			int ox = static_cast<int>(OldWidth * xf);
+			auto* OldPixel = &OldRow[ox*OldChannelCount];
+			auto* NewPixel = &NewRow[nx*NewChannelCount];
+
+			memcpy( NewPixel, OldPixel, MinChannelCount );
+		}
+	}
+	
+	assert( NewHeight == GetHeight() );
+	assert( NewWidth == GetWidth() );
+}
+
+
+//	gr: separable resampling. For each destination row, the contributing source rows are filtered into one
+//		source-width row (vertical pass), which is then filtered across (horizontal pass) straight into the
+//		destination, so there's no intermediate image and bands of destination rows are independent.
+//		weights are 14 bit fixed point so the plain c and simd paths give identical results
+namespace SoyPixelsResize
+{
+	const int	WeightShift = 14;
+	const int	WeightRound = 1 << (WeightShift-1);
+	
+	class TWeights;
+	class TRowBuffers;
+	class TResampler;
+	
+	typedef void(*TVerticalFunction)(const uint8* const* Rows,const sint16* Weights,size_t WeightCount,uint8* Dst,size_t RowBytes);
+	typedef void(*THorizontalFunction)(const uint8* Src,uint8* Dst,const TWeights& Weights,size_t Width);
+	
+	float		GetFilterSupport(SoyPixelsResizeFilter::Type Filter);
+	float		GetFilterWeight(SoyPixelsResizeFilter::Type Filter,float x);
+	bool		CanFilter(SoyPixelsFormat::Type Format);	//	every byte is an independent 8 bit channel
+	bool		CanSample(SoyPixelsFormat::Type Format);	//	whole pixels can be picked (nearest)
+	
+	TVerticalFunction	GetVerticalFunction();
+	THorizontalFunction	GetHorizontalFunction(size_t Channels);
+	
+	inline uint8	ClampWeighted(int Sum)	{	return static_cast<uint8>( std::clamped<int>( Sum >> WeightShift, 0, 255 ) );	}
+}
 
-	//	write Tail chunks
-	Array<char> Tail;
-	Tail.PushBackArray( IEND );
 
-	//	put it all together!
-	PngData.Reserve( Header.GetDataSize() + 12 );
-	PngData.Reserve( PixelData.GetDataSize() + 12 );
-	PngData.Reserve( Tail.GetDataSize() + 12 );
+//	contributing source pixels & weights for each destination pixel along one axis.
+//	weights are padded with zeros to an even count so simd can do them in pairs
+class SoyPixelsResize::TWeights
+{
+public:
+	TWeights(size_t SrcSize,size_t DstSize,SoyPixelsResizeFilter::Type Filter);
+	
+	const sint16*	GetWeights(size_t DstIndex) const	{	return &mWeights[DstIndex*mStride];	}
+	
+public:
+	Array<size_t>	mFirst;		//	first source pixel for each destination pixel
+	Array<size_t>	mCount;		//	number of source pixels (before padding)
+	Array<sint16>	mWeights;	//	mStride weights per destination pixel
+	size_t			mStride;
+};
 
-	uint32 HeaderLength = size_cast<uint32>( Header.GetDataSize() - sizeofarray(IHDR) );
-	assert( HeaderLength == 13 );
-	uint32 HeaderCrc = Soy::GetCrc32( GetArrayBridge(Header) );
-	PngData.PushBackArray( Magic );
-	PngData.PushBackReinterpretReverse( HeaderLength );
-	PngData.PushBackArray( Header );
-	PngData.PushBackReinterpretReverse( HeaderCrc );
 
-	uint32 PixelDataLength = size_cast<uint32>( PixelData.GetDataSize() - sizeofarray(IDAT) );
-	uint32 PixelDataCrc = Soy::GetCrc32( GetArrayBridge(PixelData) );
-	PngData.PushBackReinterpretReverse( PixelDataLength );
-	PngData.PushBackArray( PixelData );
-	PngData.PushBackReinterpretReverse( PixelDataCrc );
+//	per-thread working memory
+class SoyPixelsResize::TRowBuffers
+{
+public:
+	Array<uint8>		mColumn;	//	vertically filtered row, before it's filtered across
+	Array<const uint8*>	mRows;		//	contributing source rows
+};
 
-	uint32 TailLength = size_cast<uint32>( Tail.GetDataSize() - sizeofarray(IEND) );
-	uint32 TailCrc = Soy::GetCrc32( GetArrayBridge(Tail) );
-	assert( TailCrc == 0xAE426082 );
-	PngData.PushBackReinterpretReverse( TailLength );
-	PngData.PushBackArray( Tail );
-	PngData.PushBackReinterpretReverse( TailCrc );
+
+//	resamples a rect of a (single plane) image, a destination row at a time
+class SoyPixelsResize::TResampler
+{
+public:
+	TResampler(const SoyPixelsImpl& Src,const Soy::Rectx<size_t>& SrcRect,size_t DstWidth,size_t DstHeight,SoyPixelsResizeFilter::Type Filter,bool Flip);
 	
-	return true;
-#endif
-}
+	void			ResampleRow(size_t DstRow,uint8* Dst,TRowBuffers& Buffers) const;
+	void			Resample(SoyPixelsImpl& Dst) const;		//	all rows, in bands
+	
+private:
+	SoyPixelsResizeFilter::Type	mFilter;
+	bool						mFlip;
+	Soy::Rectx<size_t>			mSrcRect;
+	size_t						mDstWidth;
+	size_t						mDstHeight;
+	size_t						mPixelSize;
+	size_t						mSrcRowSize;
+	const uint8*				mSrcPixels;
+	
+	Array<size_t>				mNearestX;
+	std::shared_ptr<TWeights>	mHorizontal;
+	std::shared_ptr<TWeights>	mVertical;
+	TVerticalFunction			mVerticalFunction;
+	THorizontalFunction			mHorizontalFunction;
+};
 
 
+std::map<SoyPixelsResizeFilter::Type,std::string> SoyPixelsResizeFilter::EnumMap =
+{
+	{ SoyPixelsResizeFilter::Invalid,	"Invalid"	},
+	{ SoyPixelsResizeFilter::Nearest,	"Nearest"	},
+	{ SoyPixelsResizeFilter::Bilinear,	"Bilinear"	},
+	{ SoyPixelsResizeFilter::Bicubic,	"Bicubic"	},
+	{ SoyPixelsResizeFilter::Lanczos,	"Lanczos"	},
+	{ SoyPixelsResizeFilter::Area,		"Area"	},
+};
 
-size_t SoyPixelsImpl::GetIndex(size_t x,size_t y,size_t ChannelOffset) const
+
+float SoyPixelsResize::GetFilterSupport(SoyPixelsResizeFilter::Type Filter)
 {
-	auto w = GetWidth();
-	auto h = GetHeight();
-	auto ChannelCount = GetChannels();
-	if ( x >= w || y >= h || ChannelOffset >= ChannelCount )
+	switch ( Filter )
 	{
-		std::stringstream Error;
-		Error << "Pixel OOB x=" << x << '/' << w << " y=" << y << '/' << h << " ch=" << ChannelOffset << '/' << ChannelCount;
-		throw Soy::AssertException( Error.str() );
+		case SoyPixelsResizeFilter::Bilinear:	return 1.f;
+		case SoyPixelsResizeFilter::Bicubic:	return 2.f;
+		case SoyPixelsResizeFilter::Lanczos:	return 3.f;
+		default:
+			break;
 	}
 	
-	auto Index = y * (w*ChannelCount);
-	Index += x * ChannelCount;
-	Index += ChannelOffset;
-	return Index;
+	std::stringstream Error;
+	Error << __func__ << " not implemented for " << Filter;
+	throw Soy::AssertException( Error.str() );
 }
 
-uint8& SoyPixelsImpl::GetPixelPtr(size_t x,size_t y,size_t ChannelOffset)
-{
-	auto Index = GetIndex( x, y, ChannelOffset );
-	auto& Pixels = GetPixelsArray();
-	auto* PixelsPtr = Pixels.GetArray();
-	return PixelsPtr[Index];
-}
 
-const uint8& SoyPixelsImpl::GetPixelPtr(size_t x,size_t y,size_t ChannelOffset) const
+float SoyPixelsResize::GetFilterWeight(SoyPixelsResizeFilter::Type Filter,float x)
 {
-	auto Index = GetIndex( x, y, ChannelOffset );
-	auto& Pixels = GetPixelsArray();
-	auto* PixelsPtr = Pixels.GetArray();
-	return PixelsPtr[Index];
+	x = fabsf( x );
+	switch ( Filter )
+	{
+		case SoyPixelsResizeFilter::Bilinear:
+			return ( x < 1.f ) ? 1.f - x : 0.f;
+			
+		case SoyPixelsResizeFilter::Bicubic:
+		{
+			//	catmull-rom (a=-0.5)
+			const float a = -0.5f;
+			if ( x < 1.f )
+				return ((a+2.f)*x - (a+3.f))*x*x + 1.f;
+			if ( x < 2.f )
+				return ((a*x - 5.f*a)*x + 8.f*a)*x - 4.f*a;
+			return 0.f;
+		}
+			
+		case SoyPixelsResizeFilter::Lanczos:
+		{
+			const float Lobes = 3.f;
+			if ( x >= Lobes )
+				return 0.f;
+			if ( x < 1e-6f )
+				return 1.f;
+			float px = PIf * x;
+			return ( sinf(px) / px ) * ( sinf(px/Lobes) / (px/Lobes) );
+		}
+			
+		default:
+			break;
+	}
+	
+	std::stringstream Error;
+	Error << __func__ << " not implemented for " << Filter;
+	throw Soy::AssertException( Error.str() );
 }
 
-uint8 SoyPixelsImpl::GetPixel(size_t x,size_t y,size_t Channel) const
-{
-	return GetPixelPtr( x, y, Channel );
-}
 
-vec2x<uint8> SoyPixelsImpl::GetPixel2(size_t x,size_t y) const
+SoyPixelsResize::TWeights::TWeights(size_t SrcSize,size_t DstSize,SoyPixelsResizeFilter::Type Filter) :
+	mStride	( 0 )
 {
-	auto ChannelCount = GetChannels();
-	Soy::Assert( ChannelCount >= 2, "Accessing channel OOB");
-	auto* Pixel = &GetPixelPtr( x, y, 0 );
-	return vec2x<uint8>( Pixel[0], Pixel[1] );
+	auto Scale = SrcSize / static_cast<float>( DstSize );
+	
+	//	area is only different when shrinking, otherwise blend like opencv
+	if ( Filter == SoyPixelsResizeFilter::Area && Scale <= 1.f )
+		Filter = SoyPixelsResizeFilter::Bilinear;
+	
+	//	widen the filter when shrinking so every source pixel contributes
+	auto FilterScale = std::max( 1.f, Scale );
+	auto Support = ( Filter == SoyPixelsResizeFilter::Area ) ? 0.f : GetFilterSupport( Filter ) * FilterScale;
+	
+	Array<float> FloatWeights;
+	Array<float> PixelWeights;
+	for ( size_t d=0;	d<DstSize;	d++ )
+	{
+		PixelWeights.Clear();
+		size_t First = 0;
+		
+		if ( Filter == SoyPixelsResizeFilter::Area )
+		{
+			//	weight is how much of each source pixel the destination pixel covers
+			auto Start = d * Scale;
+			auto End = std::min( (d+1) * Scale, static_cast<float>(SrcSize) );
+			First = static_cast<size_t>( Start );
+			for ( auto s=First;	s<SrcSize && s<End;	s++ )
+			{
+				auto Cover = std::min( End, s+1.f ) - std::max( Start, static_cast<float>(s) );
+				PixelWeights.PushBack( std::max( 0.f, Cover ) );
+			}
+		}
+		else
+		{
+			auto Center = (d + 0.5f) * Scale;
+			auto Min = std::max( 0, static_cast<int>( Center - Support + 0.5f ) );
+			auto Max = std::min( static_cast<int>(SrcSize), static_cast<int>( Center + Support + 0.5f ) );
+			First = Min;
+			for ( auto s=Min;	s<Max;	s++ )
+				PixelWeights.PushBack( GetFilterWeight( Filter, (s - Center + 0.5f) / FilterScale ) );
+		}
+		
+		if ( PixelWeights.IsEmpty() )
+		{
+			First = std::min( First, SrcSize-1 );
+			PixelWeights.PushBack( 1.f );
+		}
+		
+		mFirst.PushBack( First );
+		mCount.PushBack( PixelWeights.GetSize() );
+		mStride = std::max<size_t>( mStride, PixelWeights.GetSize() );
+		FloatWeights.PushBackArray( PixelWeights );
+	}
+	mStride += mStride % 2;
+	
+	//	normalise & convert to fixed point, putting any rounding error on the biggest weight so they always sum to 1
+	mWeights.SetSize( DstSize * mStride );
+	mWeights.SetAll( 0 );
+	size_t FloatIndex = 0;
+	for ( size_t d=0;	d<DstSize;	d++ )
+	{
+		auto Count = mCount[d];
+		auto* Weights = &FloatWeights[FloatIndex];
+		FloatIndex += Count;
+		
+		float Total = 0.f;
+		for ( size_t w=0;	w<Count;	w++ )
+			Total += Weights[w];
+		if ( Total == 0.f )
+			Total = 1.f;
+		
+		auto* Fixed = &mWeights[d*mStride];
+		int FixedTotal = 0;
+		size_t Biggest = 0;
+		for ( size_t w=0;	w<Count;	w++ )
+		{
+			Fixed[w] = static_cast<sint16>( floorf( (Weights[w] / Total) * (1<<WeightShift) + 0.5f ) );
+			FixedTotal += Fixed[w];
+			if ( Fixed[w] > Fixed[Biggest] )
+				Biggest = w;
+		}
+		Fixed[Biggest] += (1<<WeightShift) - FixedTotal;
+	}
 }
 
-vec3x<uint8> SoyPixelsImpl::GetPixel3(size_t x,size_t y) const
-{
-	auto ChannelCount = GetChannels();
-	Soy::Assert( ChannelCount >= 3, "Accessing channel OOB");
-	auto* Pixel = &GetPixelPtr( x, y, 0 );
-	return vec3x<uint8>( Pixel[0], Pixel[1], Pixel[2] );
-}
 
-vec4x<uint8> SoyPixelsImpl::GetPixel4(size_t x,size_t y) const
+bool SoyPixelsResize::CanFilter(SoyPixelsFormat::Type Format)
 {
-	auto ChannelCount = GetChannels();
-	Soy::Assert( ChannelCount >= 4, "Accessing channel OOB");
-	auto* Pixel = &GetPixelPtr( x, y, 0 );
-	return vec4x<uint8>( Pixel[0], Pixel[1], Pixel[2], Pixel[3] );
+	switch ( Format )
+	{
+		case SoyPixelsFormat::Greyscale:
+		case SoyPixelsFormat::Luma_Ntsc:
+		case SoyPixelsFormat::Luma_Smptec:
+		case SoyPixelsFormat::GreyscaleAlpha:
+		case SoyPixelsFormat::RGB:
+		case SoyPixelsFormat::BGR:
+		case SoyPixelsFormat::RGBA:
+		case SoyPixelsFormat::BGRA:
+		case SoyPixelsFormat::ARGB:
+		case SoyPixelsFormat::ChromaUV_88:
+		case SoyPixelsFormat::ChromaU_8:
+		case SoyPixelsFormat::ChromaV_8:
+			return true;
+			
+		default:
+			return false;
+	}
 }
 
-void SoyPixelsImpl::SetPixel(size_t x,size_t y,size_t Channel,uint8 Component)
+
+bool SoyPixelsResize::CanSample(SoyPixelsFormat::Type Format)
 {
-	auto& Pixel = GetPixelPtr( x, y, Channel );
-	Pixel = Component;
+	if ( CanFilter( Format ) )
+		return true;
+	
+	switch ( Format )
+	{
+		case SoyPixelsFormat::KinectDepth:
+		case SoyPixelsFormat::FreenectDepth10bit:
+		case SoyPixelsFormat::FreenectDepth11bit:
+		case SoyPixelsFormat::FreenectDepthmm:
+		case SoyPixelsFormat::Float1:
+		case SoyPixelsFormat::Float2:
+		case SoyPixelsFormat::Float3:
+		case SoyPixelsFormat::Float4:
+		case SoyPixelsFormat::Half1:
+		case SoyPixelsFormat::Half2:
+		case SoyPixelsFormat::Half3:
+		case SoyPixelsFormat::Half4:
+			return true;
+			
+		default:
+			return false;
+	}
 }
 
-void SoyPixelsImpl::SetPixel(size_t x,size_t y,const vec2x<uint8>& Colour)
-{
-	auto ChannelCount = GetChannels();
-	Soy::Assert( ChannelCount >= 2, "Accessing channel OOB");
 
-	auto* Pixel = &GetPixelPtr( x, y, 0 );
-	Pixel[0] = Colour.x;
-	Pixel[1] = Colour.y;
+namespace SoyPixelsResize
+{
+	void	FilterVertical_Plain(const uint8* const* Rows,const sint16* Weights,size_t WeightCount,uint8* Dst,size_t First,size_t RowBytes)
+	{
+		for ( size_t i=First;	i<RowBytes;	i++ )
+		{
+			int Sum = WeightRound;
+			for ( size_t k=0;	k<WeightCount;	k++ )
+				Sum += Rows[k][i] * Weights[k];
+			Dst[i] = ClampWeighted( Sum );
+		}
+	}
+	
+	void	FilterVertical_Plain(const uint8* const* Rows,const sint16* Weights,size_t WeightCount,uint8* Dst,size_t RowBytes)
+	{
+		FilterVertical_Plain( Rows, Weights, WeightCount, Dst, 0, RowBytes );
+	}
+	
+	template<int CHANNELS>
+	void	FilterHorizontal_Plain(const uint8* Src,uint8* Dst,const TWeights& Weights,size_t Width)
+	{
+		for ( size_t x=0;	x<Width;	x++ )
+		{
+			auto* Pixels = &Src[Weights.mFirst[x]*CHANNELS];
+			auto* PixelWeights = Weights.GetWeights(x);
+			auto Count = Weights.mCount[x];
+			
+			int Sum[CHANNELS];
+			for ( int c=0;	c<CHANNELS;	c++ )
+				Sum[c] = WeightRound;
+			for ( size_t k=0;	k<Count;	k++ )
+				for ( int c=0;	c<CHANNELS;	c++ )
+					Sum[c] += Pixels[k*CHANNELS+c] * PixelWeights[k];
+			for ( int c=0;	c<CHANNELS;	c++ )
+				Dst[x*CHANNELS+c] = ClampWeighted( Sum[c] );
+		}
+	}
 }
 
-void SoyPixelsImpl::SetPixel(size_t x,size_t y,const vec3x<uint8>& Colour)
+
+#if defined(SOY_SIMD_SSE2)
+namespace SoyPixelsResize
 {
-	auto ChannelCount = GetChannels();
-	Soy::Assert( ChannelCount >= 3, "Accessing channel OOB");
+	inline __m128i	GetWeightPair_Sse2(sint16 a,sint16 b)
+	{
+		auto Pair = static_cast<uint32>( static_cast<uint16>(a) ) | ( static_cast<uint32>( static_cast<uint16>(b) ) << 16 );
+		return _mm_set1_epi32( static_cast<int>(Pair) );
+	}
 	
-	auto* Pixel = &GetPixelPtr( x, y, 0 );
-	Pixel[0] = Colour.x;
-	Pixel[1] = Colour.y;
-	Pixel[2] = Colour.z;
+	//	16 bytes at a time, two source rows per madd
+	void	FilterVertical_Sse2(const uint8* const* Rows,const sint16* Weights,size_t WeightCount,uint8* Dst,size_t RowBytes)
+	{
+		auto Zero = _mm_setzero_si128();
+		auto Round = _mm_set1_epi32( WeightRound );
+		size_t i = 0;
+		for ( ;	i+16<=RowBytes;	i+=16 )
+		{
+			auto Sum0 = Round;
+			auto Sum1 = Round;
+			auto Sum2 = Round;
+			auto Sum3 = Round;
+			for ( size_t k=0;	k<WeightCount;	k+=2 )
+			{
+				auto a = _mm_loadu_si128( reinterpret_cast<const __m128i*>( Rows[k] + i ) );
+				auto b = _mm_loadu_si128( reinterpret_cast<const __m128i*>( Rows[k+1] + i ) );
+				auto Pair = GetWeightPair_Sse2( Weights[k], Weights[k+1] );
+				auto Lo = _mm_unpacklo_epi8( a, b );
+				auto Hi = _mm_unpackhi_epi8( a, b );
+				Sum0 = _mm_add_epi32( Sum0, _mm_madd_epi16( _mm_unpacklo_epi8( Lo, Zero ), Pair ) );
+				Sum1 = _mm_add_epi32( Sum1, _mm_madd_epi16( _mm_unpackhi_epi8( Lo, Zero ), Pair ) );
+				Sum2 = _mm_add_epi32( Sum2, _mm_madd_epi16( _mm_unpacklo_epi8( Hi, Zero ), Pair ) );
+				Sum3 = _mm_add_epi32( Sum3, _mm_madd_epi16( _mm_unpackhi_epi8( Hi, Zero ), Pair ) );
+			}
+			Sum0 = _mm_srai_epi32( Sum0, WeightShift );
+			Sum1 = _mm_srai_epi32( Sum1, WeightShift );
+			Sum2 = _mm_srai_epi32( Sum2, WeightShift );
+			Sum3 = _mm_srai_epi32( Sum3, WeightShift );
+			auto Packed = _mm_packus_epi16( _mm_packs_epi32( Sum0, Sum1 ), _mm_packs_epi32( Sum2, Sum3 ) );
+			_mm_storeu_si128( reinterpret_cast<__m128i*>( Dst + i ), Packed );
+		}
+		
+		FilterVertical_Plain( Rows, Weights, WeightCount, Dst, i, RowBytes );
+	}
+	
+	template<int CHANNELS>
+	inline __m128i	LoadPixel_Sse2(const uint8* Pixel)
+	{
+		uint32 Value = 0;
+		memcpy( &Value, Pixel, CHANNELS );
+		return _mm_cvtsi32_si128( static_cast<int>(Value) );
+	}
+	
+	//	one pixel (up to 4 channels) at a time, two source pixels per madd
+	template<int CHANNELS>
+	void	FilterHorizontal_Sse2(const uint8* Src,uint8* Dst,const TWeights& Weights,size_t Width)
+	{
+		auto Zero = _mm_setzero_si128();
+		auto Round = _mm_set1_epi32( WeightRound );
+		for ( size_t x=0;	x<Width;	x++ )
+		{
+			auto* Pixels = &Src[Weights.mFirst[x]*CHANNELS];
+			auto* PixelWeights = Weights.GetWeights(x);
+			auto Count = Weights.mCount[x];
+			
+			auto Sum = Round;
+			size_t k = 0;
+			for ( ;	k+1<Count;	k+=2 )
+			{
+				auto a = LoadPixel_Sse2<CHANNELS>( Pixels + k*CHANNELS );
+				auto b = LoadPixel_Sse2<CHANNELS>( Pixels + (k+1)*CHANNELS );
+				auto ab = _mm_unpacklo_epi8( _mm_unpacklo_epi8( a, b ), Zero );
+				Sum = _mm_add_epi32( Sum, _mm_madd_epi16( ab, GetWeightPair_Sse2( PixelWeights[k], PixelWeights[k+1] ) ) );
+			}
+			if ( k < Count )
+			{
+				auto a = LoadPixel_Sse2<CHANNELS>( Pixels + k*CHANNELS );
+				auto a0 = _mm_unpacklo_epi8( _mm_unpacklo_epi8( a, Zero ), Zero );
+				Sum = _mm_add_epi32( Sum, _mm_madd_epi16( a0, GetWeightPair_Sse2( PixelWeights[k], 0 ) ) );
+			}
+			
+			Sum = _mm_srai_epi32( Sum, WeightShift );
+			auto Packed = _mm_packus_epi16( _mm_packs_epi32( Sum, Sum ), Zero );
+			auto Value = static_cast<uint32>( _mm_cvtsi128_si32( Packed ) );
+			memcpy( Dst + x*CHANNELS, &Value, CHANNELS );
+		}
+	}
 }
+#endif
 
-void SoyPixelsImpl::SetPixel(size_t x,size_t y,const vec4x<uint8>& Colour)
-{
-	auto ChannelCount = GetChannels();
-	Soy::Assert( ChannelCount >= 4, "Accessing channel OOB");
 
-	auto* Pixel = &GetPixelPtr( x, y, 0 );
-	Pixel[0] = Colour.x;
-	Pixel[1] = Colour.y;
-	Pixel[2] = Colour.z;
-	Pixel[3] = Colour.w;
+SoyPixelsResize::TVerticalFunction SoyPixelsResize::GetVerticalFunction()
+{
+#if defined(SOY_SIMD_SSE2)
+	if ( SoySimd::IsEnabled( SoySimd::Sse2 ) )
+		return FilterVertical_Sse2;
+#endif
+	return FilterVertical_Plain;
 }
 
 
-void SoyPixelsImpl::ResizeClip(size_t Width,size_t Height)
+SoyPixelsResize::THorizontalFunction SoyPixelsResize::GetHorizontalFunction(size_t Channels)
 {
-	auto& Pixels = GetPixelsArray();
-	auto Channels = GetChannels();
-	//	we'll get stuck in loops if stride is zero
-	Channels = std::max<uint8_t>( Channels, 1 );
-	
-	//	simply add/remove rows
-	if ( Height > GetHeight() )
+#if defined(SOY_SIMD_SSE2)
+	if ( SoySimd::IsEnabled( SoySimd::Sse2 ) )
 	{
-		auto RowBytes = Channels * GetWidth();
-		RowBytes *= Height - GetHeight();
-		Pixels.PushBlock( RowBytes );
-		GetMeta().DumbSetHeight( Height );
+		switch ( Channels )
+		{
+			case 1:	return FilterHorizontal_Sse2<1>;
+			case 2:	return FilterHorizontal_Sse2<2>;
+			case 3:	return FilterHorizontal_Sse2<3>;
+			case 4:	return FilterHorizontal_Sse2<4>;
+			default:	break;
+		}
 	}
-	else if ( Height < GetHeight() )
+#endif
+	switch ( Channels )
 	{
-		auto RowBytes = Channels * GetWidth();
-		RowBytes *= GetHeight() - Height;
-		Pixels.SetSize( Pixels.GetDataSize() - RowBytes );
-		GetMeta().DumbSetHeight( Height );
+		case 1:	return FilterHorizontal_Plain<1>;
+		case 2:	return FilterHorizontal_Plain<2>;
+		case 3:	return FilterHorizontal_Plain<3>;
+		case 4:	return FilterHorizontal_Plain<4>;
+		default:	break;
 	}
 	
-	//	insert/remove data on the end of each row
-	if ( Width > GetWidth() )
-	{//	todo: prealloc!
-		//	working backwards makes it easy & fast
-		auto Stride = Channels * GetWidth();
-		auto ColBytes = Channels * (Width - GetWidth());
-		for ( ssize_t p=Pixels.GetDataSize();	p>=0;	p-=Stride )
-			Pixels.InsertBlock( p, ColBytes );
-		GetMeta().DumbSetWidth( Width );
-	}
-	else if ( Width < GetWidth() )
+	std::stringstream Error;
+	Error << "No resize filter for " << Channels << " channels";
+	throw Soy::AssertException( Error.str() );
+}
+
+
+SoyPixelsResize::TResampler::TResampler(const SoyPixelsImpl& Src,const Soy::Rectx<size_t>& SrcRect,size_t DstWidth,size_t DstHeight,SoyPixelsResizeFilter::Type Filter,bool Flip) :
+	mFilter		( Filter ),
+	mFlip		( Flip ),
+	mSrcRect	( SrcRect ),
+	mDstWidth	( DstWidth ),
+	mDstHeight	( DstHeight ),
+	mPixelSize	( Src.GetMeta().GetPixelDataSize() ),
+	mSrcRowSize	( Src.GetMeta().GetRowPitch() ),
+	mSrcPixels	( Src.GetPixelsArray().GetArray() )
+{
+	auto Format = Src.GetFormat();
+	if ( mSrcRect.x + mSrcRect.w > Src.GetWidth() || mSrcRect.y + mSrcRect.h > Src.GetHeight() || mSrcRect.w == 0 || mSrcRect.h == 0 )
 	{
-		//	working backwards makes it easy & fast
-		auto Stride = Channels * GetWidth();
-		auto ColBytes = Channels * (GetWidth() - Width);
-		for ( ssize_t p=Pixels.GetDataSize()-ColBytes;	p>=0;	p-=Stride )
-			Pixels.RemoveBlock( p, ColBytes );
-		GetMeta().DumbSetWidth( Width );
+		std::stringstream Error;
+		Error << "Resample rect " << mSrcRect << " isn't inside " << Src.GetMeta();
+		throw Soy::AssertException( Error.str() );
 	}
 	
-	if ( Height != GetHeight() || Width != GetWidth() )
+	if ( mFilter == SoyPixelsResizeFilter::Nearest )
+	{
+		if ( !CanSample( Format ) )
+		{
+			std::stringstream Error;
+			Error << "Cannot resize " << Format << " pixels";
+			throw Soy::AssertException( Error.str() );
+		}
+		
+		//	sample the source pixel under the center of each destination pixel
+		for ( size_t x=0;	x<mDstWidth;	x++ )
+			mNearestX.PushBack( mSrcRect.x + std::min( mSrcRect.w-1, ((2*x+1) * mSrcRect.w) / (2*mDstWidth) ) );
+		return;
+	}
+	
+	if ( !CanFilter( Format ) )
 	{
 		std::stringstream Error;
-		Error << "Wrong height(" << Height << " not " << GetHeight() << ") width (" << Width << " not " << GetWidth() << ") after " << __func__;
+		Error << "Cannot filter " << Format << " pixels with " << Filter << ", try " << SoyPixelsResizeFilter::Nearest;
 		throw Soy::AssertException( Error.str() );
 	}
+	
+	mHorizontal.reset( new TWeights( mSrcRect.w, mDstWidth, mFilter ) );
+	mVertical.reset( new TWeights( mSrcRect.h, mDstHeight, mFilter ) );
+	mVerticalFunction = GetVerticalFunction();
+	mHorizontalFunction = GetHorizontalFunction( Src.GetChannels() );
 }
 
-void SoyPixelsMeta::SplitPlanes(size_t PixelDataSize,ArrayBridge<std::tuple<size_t,size_t,SoyPixelsMeta>>&& PlaneOffsetSizeAndMetas,const ArrayInterface<uint8>* Data) const
-{
-	//	get the mid-formats
-	auto& ThisMeta = *this;
-	BufferArray<SoyPixelsMeta,10> Formats;
-	ThisMeta.GetPlanes( GetArrayBridge(Formats), Data );
 
-	//	build error as we go in case we assert mid-way
-	std::stringstream Error;
-	Error << "Split pixel planes (" << ThisMeta << " -> " << Soy::StringJoin( GetArrayBridge(Formats), "," ) << ") but data hasn't aligned after split; ";
+void SoyPixelsResize::TResampler::ResampleRow(size_t DstRow,uint8* Dst,TRowBuffers& Buffers) const
+{
+	if ( mFlip )
+		DstRow = (mDstHeight-1) - DstRow;
 
-	size_t DataOffset = SoyPixelsFormat::GetHeaderSize( ThisMeta.GetFormat() );
-	for ( int p=0;	p<Formats.GetSize();	p++ )
+	if ( mFilter == SoyPixelsResizeFilter::Nearest )
 	{
-		auto PlaneMeta = Formats[p];
-		auto PlaneDataOffset = DataOffset;
-		auto PlaneDataSize = PlaneMeta.GetDataSize();
+		auto SrcY = mSrcRect.y + std::min( mSrcRect.h-1, ((2*DstRow+1) * mSrcRect.h) / (2*mDstHeight) );
+		auto* SrcRow = mSrcPixels + (SrcY * mSrcRowSize);
+		for ( size_t x=0;	x<mDstWidth;	x++ )
+			memcpy( Dst + (x*mPixelSize), SrcRow + (mNearestX[x]*mPixelSize), mPixelSize );
+		return;
+	}
+	
+	auto& Vertical = *mVertical;
+	auto ColumnSize = mSrcRect.w * mPixelSize;
+	bool SameWidth = ( mSrcRect.w == mDstWidth );
+	if ( !SameWidth && Buffers.mColumn.GetSize() < ColumnSize )
+		Buffers.mColumn.SetSize( ColumnSize );
+	Buffers.mRows.SetSize( Vertical.mStride );
+	
+	//	padding rows have zero weight, so just repeat the last one
+	auto First = mSrcRect.y + Vertical.mFirst[DstRow];
+	auto Count = Vertical.mCount[DstRow];
+	auto* SrcColumn = mSrcPixels + (mSrcRect.x * mPixelSize);
+	for ( size_t k=0;	k<Vertical.mStride;	k++ )
+		Buffers.mRows[k] = SrcColumn + ( (First + std::min( k, Count-1 )) * mSrcRowSize );
+	
+	auto* Column = SameWidth ? Dst : Buffers.mColumn.GetArray();
+	mVerticalFunction( Buffers.mRows.GetArray(), Vertical.GetWeights(DstRow), Vertical.mStride, Column, ColumnSize );
+	if ( !SameWidth )
+		mHorizontalFunction( Column, Dst, *mHorizontal, mDstWidth );
+}
 
-		auto PlaneOffsetSizeAndMeta = std::make_tuple( PlaneDataOffset, PlaneDataSize, PlaneMeta );
-		DataOffset += PlaneDataSize;
 
-		Error << "#" << p << "/" << Formats.GetSize() << " " << PlaneMeta << " = " << PlaneDataSize << " bytes; ";
-		//	check for overflow
-		Soy::Assert( DataOffset <= PixelDataSize, Error.str() );
+void SoyPixelsResize::TResampler::Resample(SoyPixelsImpl& Dst) const
+{
+	if ( Dst.GetWidth() != mDstWidth || Dst.GetHeight() != mDstHeight )
+		throw Soy::AssertException("Resample destination is the wrong size");
+	
+	auto DstRowSize = Dst.GetMeta().GetRowPitch();
+	auto* DstPixels = Dst.GetPixelsArray().GetArray();
+	auto ResampleBand = [&](size_t FirstRow,size_t RowCount)
+	{
+		TRowBuffers Buffers;
+		for ( size_t y=FirstRow;	y<FirstRow+RowCount;	y++ )
+			ResampleRow( y, DstPixels + (y * DstRowSize), Buffers );
+	};
+	SoyPixelsParallel::ForEachRowBand( mDstHeight, 1, ResampleBand );
+}
 
-		PlaneOffsetSizeAndMetas.PushBack(PlaneOffsetSizeAndMeta);
-	}
 
-	//	error, but don't fail if underrun. overrun should be caught in the loop
-	Error << "total " << DataOffset << " out of " << PixelDataSize << " bytes";
-	static bool ThrowOnUnderflow = false;
-	static bool ThrowOnOverflow = true;
-	if ( DataOffset < PixelDataSize && ThrowOnUnderflow )
+void SoyPixelsImpl::Resize(const SoyPixelsImpl& Src,SoyPixelsImpl& Dst,SoyPixelsResizeFilter::Type Filter)
+{
+	if ( !Src.IsValid() )
+		throw Soy::AssertException("Resize source pixels are not valid");
+	if ( !Dst.IsValid() )
+		throw Soy::AssertException("Resize destination needs a size & format");
+	if ( Src.GetFormat() != Dst.GetFormat() )
 	{
+		std::stringstream Error;
+		Error << "Resize cannot change format from " << Src.GetFormat() << " to " << Dst.GetFormat() << ", Convert first";
 		throw Soy::AssertException( Error.str() );
 	}
-	else if ( DataOffset > PixelDataSize && ThrowOnOverflow )
+	
+	switch ( Src.GetFormat() )
+	{
+		case SoyPixelsFormat::Palettised_RGB_8:
+		case SoyPixelsFormat::Palettised_RGBA_8:
+		{
+			std::stringstream Error;
+			Error << "Cannot resize " << Src.GetFormat() << " pixels";
+			throw Soy::AssertException( Error.str() );
+		}
+		default:
+			break;
+	}
+	
+	//	size a growable destination, fixed (remote) arrays must already be big enough
+	auto DstMeta = Dst.GetMeta();
+	if ( Dst.GetPixelsArray().GetDataSize() < DstMeta.GetDataSize() )
+		Dst.Init( DstMeta );
+	if ( Dst.GetPixelsArray().GetDataSize() < DstMeta.GetDataSize() )
 	{
+		std::stringstream Error;
+		Error << "Resize destination is " << Dst.GetPixelsArray().GetDataSize() << " bytes, " << DstMeta << " needs " << DstMeta.GetDataSize();
 		throw Soy::AssertException( Error.str() );
 	}
-	else if ( DataOffset != PixelDataSize )
+	if ( Src.GetPixelsArray().GetArray() == Dst.GetPixelsArray().GetArray() )
+		throw Soy::AssertException("Resize source and destination share pixels");
+
+	std::stringstream TimerName;
+	TimerName << "SoyPixels::Resize( " << Src.GetMeta() << " to " << DstMeta << " " << Filter << " )";
+	Soy::TScopeTimerPrint Timer( TimerName.str().c_str(), 5 );
+
+	//	planes (eg. luma & chroma) are resized independently
+	SoyPixelsPlanes SrcPlanes( Src );
+	SoyPixelsPlanes DstPlanes( Dst );
+	if ( SrcPlanes.GetPlaneCount() != DstPlanes.GetPlaneCount() )
+		throw Soy::AssertException("Resize source & destination have different plane counts");
+	
+	for ( size_t p=0;	p<SrcPlanes.GetPlaneCount();	p++ )
 	{
-		std::Debug << Error.str() << std::endl;
+		auto& SrcPlane = SrcPlanes[p];
+		auto& DstPlane = DstPlanes[p];
+		if ( SrcPlane.GetFormat() != DstPlane.GetFormat() )
+			throw Soy::AssertException("Resize planes must be the same format");
+		
+		Soy::Rectx<size_t> SrcRect( 0, 0, SrcPlane.GetWidth(), SrcPlane.GetHeight() );
+		SoyPixelsResize::TResampler Resampler( SrcPlane, SrcRect, DstPlane.GetWidth(), DstPlane.GetHeight(), Filter, false );
+		Resampler.Resample( DstPlane );
 	}
 }
 
-void SoyPixelsImpl::SplitPlanes(ArrayBridge<std::shared_ptr<SoyPixelsImpl>>&& Planes) const
+
+void SoyPixelsImpl::Resize(size_t Width,size_t Height,SoyPixelsResizeFilter::Type Filter)
 {
-	//	get the plane layouts
-	auto& ThisMeta = GetMeta();
-	auto& ThisArray = GetPixelsArray();
-	auto PixelDataSize = ThisArray.GetDataSize();
-	BufferArray<std::tuple<size_t,size_t,SoyPixelsMeta>,10> PlaneOffsetSizeAndMetas;
-	ThisMeta.SplitPlanes( PixelDataSize, GetArrayBridge(PlaneOffsetSizeAndMetas), &ThisArray );
+	if ( Width == GetWidth() && Height == GetHeight() )
+		return;
 	
-	//	make up the remote pixels
-	for ( int p=0;	p<PlaneOffsetSizeAndMetas.GetSize();	p++ )
-	{
-		auto& PlaneOffsetSizeAndMeta = PlaneOffsetSizeAndMetas[p];
-		auto PlaneDataOffset = std::get<0>( PlaneOffsetSizeAndMeta );
-		auto PlaneDataSize = std::get<1>( PlaneOffsetSizeAndMeta );
-		auto PlaneMeta = std::get<2>( PlaneOffsetSizeAndMeta );
-		auto* PlaneData = ThisArray.GetArray() + PlaneDataOffset;
-
-		//	lets allow const use of this func. But SoyPixelsRemote may need a non-mutable version?
-		auto* PlaneDataMutable = const_cast<uint8_t*>(PlaneData);
-		std::shared_ptr<SoyPixelsRemote> Pixels(new SoyPixelsRemote( PlaneDataMutable, PlaneDataSize, PlaneMeta ) );
-		Planes.PushBack(Pixels);
-	}
+	//	gr: to avoid this copy, resize into another image with the static version
+	SoyPixels Old;
+	Old.Copy( *this );
+	Init( SoyPixelsMeta( Width, Height, GetFormat() ) );
+	Resize( Old, *this, Filter );
 }
 
 
-template<size_t COMPONENTS>
-void SetPixelComponents(ArrayInterface<uint8>& Pixels,const ArrayBridge<uint8>& Components)
+void SoyPixelsImpl::Transform(const SoyPixelsImpl& Src,SoyPixelsImpl& Dst,const TPixelsTransform& Transform)
 {
-	BufferArray<uint8,COMPONENTS> BufferComponents;
-	for ( int i=0;	i<COMPONENTS;	i++ )
+	if ( !Src.IsValid() )
+		throw Soy::AssertException("Transform source pixels are not valid");
+	
+	auto SrcFormat = Src.GetFormat();
+	auto SrcRect = Transform.mSourceRect;
+	if ( SrcRect.w == 0 || SrcRect.h == 0 )
+		SrcRect = Soy::Rectx<size_t>( 0, 0, Src.GetWidth(), Src.GetHeight() );
+	auto DstWidth = Transform.mWidth ? Transform.mWidth : SrcRect.w;
+	auto DstHeight = Transform.mHeight ? Transform.mHeight : SrcRect.h;
+	auto DstFormat = SoyPixelsFormat::IsValid( Transform.mFormat ) ? Transform.mFormat : SrcFormat;
+	SoyPixelsMeta DstMeta( DstWidth, DstHeight, DstFormat );
+	//	keep the destination's row padding
+	if ( Dst.GetWidth() == DstWidth && Dst.GetHeight() == DstHeight && Dst.GetFormat() == DstFormat )
+		DstMeta = Dst.GetMeta();
+	
+	if ( !( Dst.GetMeta() == DstMeta ) || Dst.GetPixelsArray().GetDataSize() < DstMeta.GetDataSize() )
 	{
-		if ( i < Components.GetSize() )
-			BufferComponents.PushBack( Components[i] );
-		else
-			BufferComponents.PushBack( 255 );
+		if ( !Transform.mAllowRealloc )
+		{
+			std::stringstream Error;
+			Error << "Transform to " << DstMeta << " needs to realloc " << Dst.GetMeta() << " but !AllowRealloc";
+			throw Soy::AssertException( Error.str() );
+		}
+		Dst.Init( DstMeta );
 	}
+	if ( Dst.GetPixelsArray().GetDataSize() < DstMeta.GetDataSize() )
+	{
+		std::stringstream Error;
+		Error << "Transform destination is " << Dst.GetPixelsArray().GetDataSize() << " bytes, " << DstMeta << " needs " << DstMeta.GetDataSize();
+		throw Soy::AssertException( Error.str() );
+	}
+	if ( Src.GetPixelsArray().GetArray() == Dst.GetPixelsArray().GetArray() )
+		throw Soy::AssertException("Transform source and destination share pixels");
+
+	std::stringstream TimerName;
+	TimerName << "SoyPixels::Transform( " << Src.GetMeta() << " " << SrcRect << " to " << DstMeta << " )";
+	Soy::TScopeTimerPrint Timer( TimerName.str().c_str(), 5 );
 	
-	for ( int p=0;	p<Pixels.GetSize();	p++ )
+	std::shared_ptr<TConvertPlan> Plan;
+	if ( SrcFormat != DstFormat )
 	{
-		Pixels[p] = BufferComponents[p%COMPONENTS];
+		Plan = TConvertPlan::Get( SrcFormat, DstFormat );
+		if ( !Plan->IsValid() )
+		{
+			std::stringstream Error;
+			Error << "No soypixel conversion from " << SrcFormat << " to " << DstFormat;
+			throw Soy::AssertException( Error.str() );
+		}
 	}
 	
-}
-
-void SoyPixelsImpl::SetPixels(const ArrayBridge<uint8>& Components)
-{
-	if ( !IsValid() )
+	//	packed sources are cropped & scaled a strip of rows at a time, and each strip converted straight into the destination
+	if ( TConvertPlan::IsRowIndependent( SrcFormat ) && ( !Plan || Plan->CanFuse() ) )
+	{
+		SoyPixelsResize::TResampler Resampler( Src, SrcRect, DstWidth, DstHeight, Transform.mFilter, Transform.mFlip );
+		if ( !Plan )
+		{
+			Resampler.Resample( Dst );
+			return;
+		}
+		
+		SoyPixelsMeta StripMeta( DstWidth, DstHeight, SrcFormat );
+		auto StripRows = Plan->GetStripRows();
+		auto StripRowSize = StripMeta.GetRowDataSize();
+		auto StripsSize = Plan->GetStripsSize( DstWidth );
+		
+		TConvertBuffers Buffers;
+		Buffers.mSrcMeta = StripMeta;
+		Buffers.mSrcSize = StripRowSize * StripRows;
+		Buffers.mDst = Dst.GetPixelsArray().GetArray();
+		Buffers.mDstSize = DstMeta.GetDataSize();
+		Buffers.mDstMeta = DstMeta;
+		Buffers.mYuvMatrix = Transform.mYuvMatrix;
+		
+		auto TransformBand = [&](size_t FirstRow,size_t RowCount)
+		{
+			Array<uint8> Strip;
+			Array<uint8> Strips;
+			Strip.SetSize( Buffers.mSrcSize, false );
+			Strips.SetSize( StripsSize, false );
+			SoyPixelsResize::TRowBuffers RowBuffers;
+			
+			TConvertBuffers StripBuffers = Buffers;
+			StripBuffers.mSrc = Strip.GetArray();
+			for ( size_t StripFirstRow=FirstRow;	StripFirstRow<FirstRow+RowCount;	StripFirstRow+=StripRows )
+			{
+				auto StripRowCount = std::min( StripRows, FirstRow+RowCount-StripFirstRow );
+				for ( size_t y=0;	y<StripRowCount;	y++ )
+					Resampler.ResampleRow( StripFirstRow+y, Strip.GetArray() + (y*StripRowSize), RowBuffers );
+				
+				StripBuffers.mSrcFirstRow = StripFirstRow;
+				Plan->RunStrip( StripBuffers, StripFirstRow, StripRowCount, Strips.GetArray() );
+			}
+		};
+		SoyPixelsParallel::ForEachRowBand( DstHeight, Plan->GetRowAlignment(), TransformBand );
 		return;
+	}
 	
-	auto& Pixels = GetPixelsArray();
+	//	planar sources resample each plane (at the destination size, so cheap when shrinking) then convert
+	SoyPixels Resampled;
+	SoyPixelsImpl* ResampleDst = &Dst;
+	if ( Plan )
+	{
+		Resampled.Init( SoyPixelsMeta( DstWidth, DstHeight, SrcFormat ) );
+		ResampleDst = &Resampled;
+	}
 	
-	switch ( GetChannels() )
+	SoyPixelsPlanes SrcPlanes( Src );
+	SoyPixelsPlanes DstPlanes( *ResampleDst );
+	if ( SrcPlanes.GetPlaneCount() != DstPlanes.GetPlaneCount() )
+		throw Soy::AssertException("Transform source & destination have different plane counts");
+	
+	for ( size_t p=0;	p<SrcPlanes.GetPlaneCount();	p++ )
 	{
-		case 1:	SetPixelComponents<1>( Pixels, Components );	return;
-		case 2:	SetPixelComponents<2>( Pixels, Components );	return;
-		case 3:	SetPixelComponents<3>( Pixels, Components );	return;
-		case 4:	SetPixelComponents<4>( Pixels, Components );	return;
-		case 5:	SetPixelComponents<5>( Pixels, Components );	return;
-	};
-}
-
-vec2f SoyPixelsImpl::GetUv(size_t PixelIndex) const
-{
-	auto xy = GetXy( PixelIndex );
-	float u = xy.x / static_cast<float>( GetWidth() );
-	float v = xy.y / static_cast<float>( GetHeight() );
-	return vec2f( u, v );
+		auto& SrcPlane = SrcPlanes[p];
+		auto& DstPlane = DstPlanes[p];
+		
+		//	scale the rect to this plane (eg. half size chroma)
+		auto PlaneWidth = SrcPlane.GetWidth();
+		auto PlaneHeight = SrcPlane.GetHeight();
+		auto Left = (SrcRect.x * PlaneWidth) / Src.GetWidth();
+		auto Top = (SrcRect.y * PlaneHeight) / Src.GetHeight();
+		auto Right = ( (SrcRect.x + SrcRect.w) * PlaneWidth + Src.GetWidth()-1 ) / Src.GetWidth();
+		auto Bottom = ( (SrcRect.y + SrcRect.h) * PlaneHeight + Src.GetHeight()-1 ) / Src.GetHeight();
+		Soy::Rectx<size_t> PlaneRect( Left, Top, Right-Left, Bottom-Top );
+		
+		SoyPixelsResize::TResampler Resampler( SrcPlane, PlaneRect, DstPlane.GetWidth(), DstPlane.GetHeight(), Transform.mFilter, Transform.mFlip );
+		Resampler.Resample( DstPlane );
+	}
+	
+	if ( Plan )
+		Convert( Resampled, Dst, Transform.mYuvMatrix );
 }
 
-vec2x<size_t> SoyPixelsImpl::GetXy(size_t PixelIndex) const
-{
-	auto x = PixelIndex % GetWidth();
-	auto y = PixelIndex / GetWidth();
-	return vec2x<size_t>( x, y );
-}
 
-void SoyPixelsImpl::ResizeFastSample(size_t NewWidth, size_t NewHeight)
+void SoyPixelsImpl::Flip()
 {
-	//	copy old data
-	SoyPixels Old;
-	Old.Copy(*this);
-	
-	auto& New = *this;
-	auto NewChannelCount = GetChannels();
-	//	resize buffer
-	ResizeClip( NewWidth, NewHeight );
-	
-	auto OldHeight = Old.GetHeight();
-	auto OldWidth = Old.GetWidth();
-	auto OldChannelCount = Old.GetChannels();
-	auto MinChannelCount = std::min( OldChannelCount, NewChannelCount );
-	
-	auto& OldPixelsArray = Old.GetPixelsArray();
-	auto& NewPixelsArray = New.GetPixelsArray();
+	if ( !IsValid() )
+		return;
 	
-	auto* OldPixels = OldPixelsArray.GetArray();
-	auto* NewPixels = NewPixelsArray.GetArray();
-
-	for ( int ny=0;	ny<NewHeight;	ny++ )
+	//	swap rows in place, each plane flips on its own
+	SoyPixelsPlanes Planes( *this );
+	for ( size_t p=0;	p<Planes.GetPlaneCount();	p++ )
 	{
-		float yf = ny/static_cast<float>(NewHeight);
-		int oy = static_cast<int>(OldHeight * yf);
-
-		auto OldLineSize = OldWidth * OldChannelCount;
-		auto NewLineSize = NewWidth * NewChannelCount;
-//#define SAFE_RESIZE
-#if defined(SAFE_RESIZE)
-		auto OldRow = GetRemoteArray( &OldPixels[oy*OldLineSize], OldLineSize );
-		auto NewRow = GetRemoteArray( &NewPixels[ny*NewLineSize], NewLineSize );
-#else
-		auto OldRow = &OldPixels[oy*OldLineSize];
-		auto NewRow = &NewPixels[ny*NewLineSize];
-#endif
-		for ( int nx=0;	nx<NewWidth;	nx++ )
+		auto& Plane = Planes[p];
+		auto RowSize = Plane.GetMeta().GetRowDataSize();
+		auto RowPitch = Plane.GetMeta().GetRowPitch();
+		auto Height = Plane.GetHeight();
+		auto* Pixels = Plane.GetPixelsArray().GetArray();
+		auto FlipBand = [=](size_t FirstRow,size_t RowCount)
 		{
-			float xf = nx / static_cast<float>(NewWidth);
-			int ox = static_cast<int>(OldWidth * xf);
-			auto* OldPixel = &OldRow[ox*OldChannelCount];
-			auto* NewPixel = &NewRow[nx*NewChannelCount];
-
-			memcpy( NewPixel, OldPixel, MinChannelCount );
-		}
+			for ( size_t y=FirstRow;	y<FirstRow+RowCount;	y++ )
+				SoyPixelsRemap::SwapRows( &Pixels[y*RowPitch], &Pixels[(Height-1-y)*RowPitch], RowSize );
+		};
+		SoyPixelsParallel::ForEachRowBand( Height/2, 1, FlipBand );
 	}
-	
-	assert( NewHeight == GetHeight() );
-	assert( NewWidth == GetWidth() );
 }
 
 
-void SoyPixelsImpl::Flip()
+void SoyPixelsImpl::Pack()
 {
-	if ( !IsValid() )
+	auto& Meta = GetMeta();
+	if ( Meta.IsPacked() )
 		return;
 	
-	//	buffer a line so we don't need to realloc for the temp line
-	auto LineSize = GetWidth() * GetChannels();
-	Array<char> TempLine( size_cast<size_t>(LineSize) );
+	//	rows only move down, so copy top to bottom, plane by plane
+	BufferArray<SoyPixelsMeta,4> Planes;
+	Meta.GetPlanes( GetArrayBridge(Planes) );
 	auto* Pixels = GetPixelsArray().GetArray();
-	
-	auto Height = GetHeight();
-	for ( int y=0;	y<Height/2;	y++ )
+	size_t SrcOffset = 0;
+	size_t DstOffset = 0;
+	for ( size_t p=0;	p<Planes.GetSize();	p++ )
 	{
-		//	swap lines
-		int TopY = y;
-		ssize_t BottomY = (Height-1) - y;
-
-		auto* TopRow = &Pixels[TopY * LineSize];
-		auto* BottomRow = &Pixels[BottomY  * LineSize];
-		memcpy( TempLine.GetArray(), TopRow, LineSize );
-		memcpy( TopRow, BottomRow, LineSize );
-		memcpy( BottomRow, TempLine.GetArray(), LineSize );
+		auto& Plane = Planes[p];
+		auto RowSize = Plane.GetRowDataSize();
+		auto RowPitch = Plane.GetRowPitch();
+		for ( size_t y=0;	y<Plane.GetHeight();	y++ )
+			memmove( Pixels + DstOffset + (y*RowSize), Pixels + SrcOffset + (y*RowPitch), RowSize );
+		SrcOffset += RowPitch * Plane.GetHeight();
+		DstOffset += RowSize * Plane.GetHeight();
 	}
+	
+	Meta.DumbSetRowPitch( 0 );
+	//	fixed (remote) arrays just keep the spare bytes on the end
+	auto& PixelsArray = GetPixelsArray();
+	PixelsArray.SetSize( Meta.GetDataSize(), true, true );
 }
 
 
@@ -1966,16 +5938,16 @@ void SoyPixelsImpl::Copy(const SoyPixelsImpl& That,const TSoyPixelsCopyParams& P
 	if ( That.GetPixelsArray().GetArray() == This.GetPixelsArray().GetArray() )
 		return;
 
-	bool Flip = Params.mFlipDestination||Params.mFlipSource;
+	bool Flip = Params.mFlipDestination != Params.mFlipSource;
 
 	//	simple copy if we can realloc
 	if ( Params.mAllowRealloc )
 	{
-		if ( Flip )
-			std::Debug << "SoyPixelsImpl::Copy realloc copy, flip ignored" << std::endl;
-
 		This.GetMeta() = That.GetMeta();
 		This.GetPixelsArray().Copy( That.GetPixelsArray() );
+		//	gr: planar formats can't flip rows as they copy
+		if ( Flip )
+			This.Flip();
 		return;
 	}
 
@@ -1986,8 +5958,9 @@ void SoyPixelsImpl::Copy(const SoyPixelsImpl& That,const TSoyPixelsCopyParams& P
 	auto ThisChannels = This.GetMeta().GetChannels();
 	auto ThatChannels = That.GetMeta().GetChannels();
 
-	//	not allowed to realloc, so require components to match
-	if ( That.GetMeta().GetFormat() != This.GetMeta().GetFormat() )
+	//	not allowed to realloc, so components need to match, or be remapped as we go
+	TSoyPixelsChannelMap ChannelMap = Params.mChannelMap;
+	if ( That.GetMeta().GetFormat() != This.GetMeta().GetFormat() || ChannelMap.IsValid() )
 	{
 		if ( !Params.mAllowComponentSwizzle )
 		{
@@ -1995,14 +5968,22 @@ void SoyPixelsImpl::Copy(const SoyPixelsImpl& That,const TSoyPixelsCopyParams& P
 			Error << "Cannot copy " << That.GetMeta() << " into " << This.GetMeta() << " because !AllowComponentSwizzle";
 			throw Soy::AssertException( Error.str() );
 		}
-
-		//	we can swizzle, but require components to match
-		if ( ThisChannels != ThatChannels )
+		
+		if ( !ChannelMap.IsValid() )
+			ChannelMap = TSoyPixelsChannelMap::Get( That.GetFormat(), This.GetFormat() );
+		
+		//	formats we can't name channels for are copied as-is if the components line up
+		if ( !ChannelMap.IsValid() && ThisChannels == ThatChannels )
+			ChannelMap = TSoyPixelsChannelMap();
+		else if ( !ChannelMap.IsValid() || ChannelMap.mCount != ThisChannels )
 		{
 			std::stringstream Error;
-			Error << "Cannot copy " << That.GetMeta() << " into " << This.GetMeta() << " with swizzle because channel counts don't match";
+			Error << "Cannot copy " << That.GetMeta() << " into " << This.GetMeta() << " with swizzle because channels don't match";
 			throw Soy::AssertException( Error.str() );
 		}
+		
+		if ( ChannelMap.IsIdentity( ThatChannels ) )
+			ChannelMap = TSoyPixelsChannelMap();
 	}
 
 	//	global rejection for height difference
@@ -2016,48 +5997,68 @@ void SoyPixelsImpl::Copy(const SoyPixelsImpl& That,const TSoyPixelsCopyParams& P
 		}
 	}
 
-	if ( ThisWidth == ThatWidth && !Flip )
+	if ( ThisWidth == ThatWidth && !Flip && !ChannelMap.IsValid() && This.GetMeta().IsPacked() && That.GetMeta().IsPacked() )
 	{
 		auto* This00 = &This.GetPixelPtr( 0, 0, 0 );
 		auto* That00 = &That.GetPixelPtr( 0, 0, 0 );
 
 		auto Stride = ThisChannels * ThisWidth;
 		auto Height = std::min( ThisHeight, ThatHeight );
-		auto CopyLength = Stride * Height;
 
-		//std::Debug << __func__ << " full copy stride=" << Stride << " Height=" << Height << " " << CopyLength << std::endl;
+		//std::Debug << __func__ << " full copy stride=" << Stride << " Height=" << Height << std::endl;
 
-		memcpy( This00, That00, CopyLength );
+		auto CopyBand = [=](size_t FirstRow,size_t RowCount)
+		{
+			memcpy( This00 + (FirstRow*Stride), That00 + (FirstRow*Stride), RowCount*Stride );
+		};
+		SoyPixelsParallel::ForEachRowBand( Height, 1, CopyBand );
 	}
 	else
 	{
-		//	slow path where widths doesn't align
-		if ( !Params.mAllowWidthClip )
+		//	slow path where widths or row pitches don't align
+		if ( !Params.mAllowWidthClip && ThisWidth != ThatWidth )
 		{
 			std::stringstream Error;
 			Error << "Cannot copy " << That.GetMeta() << " into " << This.GetMeta() << " widths don't align";
 			throw Soy::AssertException( Error.str() );
 		}
 
-		//	copy row by row
+		//	copy (flip and remap) row by row
 		auto CopyWidth = std::min( ThisWidth, ThatWidth );
 		auto CopyHeight = std::min( ThisHeight, ThatHeight );
 		
-		auto ThisStride = ThisChannels * ThisWidth;
-		auto ThatStride = ThatChannels * ThatWidth;
-		auto CopyStride = std::min( ThisStride, ThatStride );
+		auto ThisStride = This.GetMeta().GetRowPitch();
+		auto ThatStride = That.GetMeta().GetRowPitch();
+		auto CopyStride = std::min( This.GetMeta().GetRowDataSize(), That.GetMeta().GetRowDataSize() );
 		auto* This00 = &This.GetPixelPtr( 0, 0, 0 );
 		auto* That00 = &That.GetPixelPtr( 0, 0, 0 );
-		for ( int y=0;	y<CopyHeight;	y++ )
+		auto FlipDestination = Params.mFlipDestination;
+		auto FlipSource = Params.mFlipSource;
+		
+		std::shared_ptr<SoyPixelsRemap::TRemapper> Remapper;
+		if ( ChannelMap.IsValid() )
 		{
-			auto ThisY = Params.mFlipDestination ? (ThisHeight-1-y) : y;
-			auto ThatY = Params.mFlipSource ? (ThatHeight-1-y) : y;
-			//std::Debug << __func__ << " scanlinecopy row y=" << y << " ThatStride=" << ThatStride << " ThisStride=" << ThisStride << " CopyStride=" << CopyStride << std::endl;
-
-			auto* Src = &That00[ThatStride * ThatY];
-			auto* Dst = &This00[ThisStride * ThisY];
-			memcpy( Dst, Src, CopyStride );
+			bool Stream = This.GetMeta().GetDataSize() >= SoyPixelsRemap::StreamMinBytes;
+			Remapper.reset( new SoyPixelsRemap::TRemapper( ChannelMap, ThatChannels, Stream ) );
 		}
+		
+		auto CopyBand = [=](size_t FirstRow,size_t RowCount)
+		{
+			for ( size_t y=FirstRow;	y<FirstRow+RowCount;	y++ )
+			{
+				auto ThisY = FlipDestination ? (ThisHeight-1-y) : y;
+				auto ThatY = FlipSource ? (ThatHeight-1-y) : y;
+				//std::Debug << __func__ << " scanlinecopy row y=" << y << " ThatStride=" << ThatStride << " ThisStride=" << ThisStride << " CopyStride=" << CopyStride << std::endl;
+
+				auto* Src = &That00[ThatStride * ThatY];
+				auto* Dst = &This00[ThisStride * ThisY];
+				if ( Remapper )
+					Remapper->RemapRow( Src, Dst, CopyWidth );
+				else
+					memcpy( Dst, Src, CopyStride );
+			}
+		};
+		SoyPixelsParallel::ForEachRowBand( CopyHeight, 1, CopyBand );
 	}
 }
 
@@ -2066,8 +6067,7 @@ void SoyPixelsImpl::PrintPixels(const std::string& Prefix,std::ostream& Stream,b
 {
 	auto Meta = GetMeta();
 	Stream << Prefix << " " << Meta << std::endl;
-	auto ComponentCount = GetChannels();
-	auto Stride = ComponentCount * Meta.GetWidth();
+	auto Stride = Meta.GetRowPitch();
 	auto* Pixels = GetPixelsArray().GetArray();
 	
 	for ( int p=0;	p<Meta.GetDataSize();	p++ )
@@ -2099,8 +6099,44 @@ size_t SoyPixelsMeta::GetDataSize() const
 	return TotalDataSize;
 }
 
+size_t SoyPixelsMeta::GetPackedRowPitch() const
+{
+	if ( SoyPixelsFormat::GetHeaderSize( mFormat ) != 0 )
+	{
+		std::stringstream Error;
+		Error << mFormat << " doesn't support row padding";
+		throw Soy::AssertException( Error.str() );
+	}
+	
+	//	planar formats use the first plane's rows
+	BufferArray<SoyPixelsFormat::Type,4> PlaneFormats;
+	SoyPixelsFormat::GetFormatPlanes( mFormat, GetArrayBridge(PlaneFormats) );
+	return SoyPixelsMeta( mWidth, mHeight, PlaneFormats[0] ).GetRowDataSize();
+}
+
+void SoyPixelsMeta::SetRowPitch(size_t RowPitch)
+{
+	if ( RowPitch == 0 )
+	{
+		mRowPitch = 0;
+		return;
+	}
+	
+	auto PackedRowPitch = GetPackedRowPitch();
+	if ( RowPitch < PackedRowPitch )
+	{
+		std::stringstream Error;
+		Error << "Row pitch " << RowPitch << " is smaller than a row of " << *this << " (" << PackedRowPitch << ")";
+		throw Soy::AssertException( Error.str() );
+	}
+	
+	//	store packed as zero so metas compare equal
+	mRowPitch = ( RowPitch == PackedRowPitch ) ? 0 : RowPitch;
+}
+
 void SoyPixelsMeta::GetPlanes(ArrayBridge<SoyPixelsMeta>&& Planes,const ArrayInterface<uint8>* Data) const
 {
+	auto FirstPlane = Planes.GetSize();
 	switch ( GetFormat() )
 	{
 		case SoyPixelsFormat::Yuv_8_88_Full:
@@ -2188,5 +6224,13 @@ void SoyPixelsMeta::GetPlanes(ArrayBridge<SoyPixelsMeta>&& Planes,const ArrayInt
 			Planes.PushBack( *this );
 			break;
 	};
+	
+	//	padding applies to every plane, in proportion to its row size (eg. I420 chroma rows have half the luma pitch)
+	if ( mRowPitch != 0 && Planes.GetSize() - FirstPlane > 1 )
+	{
+		auto FirstRowSize = Planes[FirstPlane].GetRowDataSize();
+		for ( auto p=FirstPlane;	p<Planes.GetSize();	p++ )
+			Planes[p].SetRowPitch( (mRowPitch * Planes[p].GetRowDataSize()) / FirstRowSize );
+	}
 }
 
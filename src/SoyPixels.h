@@ -10,7 +10,10 @@
 class SoyPixelsMeta;
 class SoyPixelsImpl;
 class TStreamBuffer;
-
+namespace TPng
+{
+	class TEncodeParams;
+}
 
 
 namespace SoyPixelsFormat
@@ -117,6 +120,12 @@ namespace SoyPixelsFormat
 		Float3,
 		Float4,
 		
+		//	16 bit (ieee half) floats, half the size of Float1..4
+		Half1,
+		Half2,
+		Half3,
+		Half4,
+		
 		
 		//	shorthand names
 		//	http://www.fourcc.org/yuv.php
@@ -130,7 +139,8 @@ namespace SoyPixelsFormat
 
 	//	gr: consider changing this to either Type, Bytes per channel or bits per channel to handle 16 bit better
 	bool			IsFloatChannel(Type Format);
-	inline size_t	GetBytesPerChannel(Type Format)		{	return IsFloatChannel(Format) ? 4 : 1;	}
+	bool			IsHalfChannel(Type Format);
+	inline size_t	GetBytesPerChannel(Type Format)		{	return IsFloatChannel(Format) ? 4 : IsHalfChannel(Format) ? 2 : 1;	}
 	
 	size_t			GetChannelCount(Type Format);
 	Type			GetFormatFromChannelCount(size_t ChannelCount);
@@ -147,6 +157,8 @@ namespace SoyPixelsFormat
 
 	//	merge index & palette into Paletteised_8_8
 	void			MakePaletteised(SoyPixelsImpl& PalettisedImage,const SoyPixelsImpl& IndexedImage,const SoyPixelsImpl& Palette,uint8 TransparentIndex);
+	void			ExpandPalettised(SoyPixelsImpl& Image,const SoyPixelsImpl& PalettisedImage);	//	to Image's format; RGB, RGBA or BGRA
+	void			Quantise(SoyPixelsImpl& PalettisedImage,const SoyPixelsImpl& Image,size_t MaxColours=256);	//	median-cut an RGB/RGBA image to Palettised_RGBA_8
 
 	//	get alternatives of formats
 	Type			GetYuvFull(Type Format);
@@ -154,13 +166,119 @@ namespace SoyPixelsFormat
 	Type			GetYuvSmptec(Type Format);
 	Type			ChangeYuvColourRange(Type Format,Type YuvColourRange);
 	Type			GetFloatFormat(Type Format);
+	Type			GetHalfFormat(Type Format);
 	Type			GetByteFormat(Type Format);
 	
 	DECLARE_SOYENUM( SoyPixelsFormat );
 };
 
 
+//	matrix used when converting between yuv and rgb. The range (full/ntsc/smptec) is part of the pixel format
+namespace SoyYuvMatrix
+{
+	enum Type
+	{
+		Invalid,
+		Bt601,		//	SD video & jpeg
+		Bt709,		//	HD video
+	};
+
+	//	luma weights of red & blue (green is the remainder)
+	void	GetLumaWeights(Type Matrix,float& Kr,float& Kb);
+	
+	DECLARE_SOYENUM( SoyYuvMatrix );
+};
+
+
+//	filters for SoyPixelsImpl::Resize
+namespace SoyPixelsResizeFilter
+{
+	enum Type
+	{
+		Invalid,
+		Nearest,	//	also works for 16 bit depth & float formats
+		Bilinear,
+		Bicubic,	//	catmull-rom
+		Lanczos,	//	3 lobes
+		Area,		//	average of the covered source pixels, best for shrinking (bilinear when growing)
+	};
+	
+	DECLARE_SOYENUM( SoyPixelsResizeFilter );
+};
+
+
+//	SetFormat & Copy can split images into bands of rows and run them on a shared thread pool
+class TSoyPixelsParallelParams
+{
+public:
+	TSoyPixelsParallelParams() :
+		mEnabled		( false ),
+		mMinRowsPerTask	( 64 ),
+		mMaxTasks		( 0 )
+	{
+	}
+	
+	bool	mEnabled;
+	size_t	mMinRowsPerTask;	//	images need at least 2x this many rows before they're split
+	size_t	mMaxTasks;			//	0 = one per cpu core
+};
+
+//	how byte channels map to float & half channels, per channel; Float = (Byte * mScale) + mBias. Defaults to 0..1
+//	going back to bytes does the inverse, and clamps
+class TSoyPixelsFloatParams
+{
+public:
+	explicit TSoyPixelsFloatParams(float Scale=1.0f/255.0f,float Bias=0.0f);
+	
+	//	(0..1 - Mean) / StdDev, as most ml models expect
+	static TSoyPixelsFloatParams	GetNormalised(const float (&Mean)[4],const float (&StdDev)[4]);
+	
+public:
+	float	mScale[4];
+	float	mBias[4];
+};
+
+namespace SoyPixelsParallel
+{
+	void						SetParams(const TSoyPixelsParallelParams& Params);
+	TSoyPixelsParallelParams	GetParams();
+	size_t						GetBandCount(size_t RowCount,size_t RowAlignment=1);
+
+	//	run Function over bands of rows (each starting on a multiple of RowAlignment) and block until they're all done.
+	//	Small images (or calls from a pool thread) run on the calling thread
+	void						ForEachRowBand(size_t RowCount,size_t RowAlignment,std::function<void(size_t FirstRow,size_t RowCount)> Function);
+}
+
+
 //	gr: move all the pixels stuff into a namespace!
+//	which source channel each destination channel comes from, eg. ARGB to RGBA is 1,2,3,0
+class TSoyPixelsChannelMap
+{
+public:
+	static const size_t	MaxChannels = 4;
+	static const int	Fill = -1;		//	destination channel is set to mFillValue (eg. new alpha)
+	
+public:
+	TSoyPixelsChannelMap() :
+		mCount		( 0 ),
+		mFillValue	( 255 )
+	{
+	}
+	TSoyPixelsChannelMap(std::initializer_list<int> SourceChannels,uint8 FillValue=255);
+	
+	//	match channels by name (rgba, bgra, argb...). Invalid if there's no simple remap (eg. rgb to greyscale)
+	static TSoyPixelsChannelMap	Get(SoyPixelsFormat::Type Source,SoyPixelsFormat::Type Destination);
+	
+	bool		IsValid() const							{	return mCount > 0;	}
+	bool		IsIdentity(size_t SourceChannels) const;
+
+public:
+	size_t		mCount;				//	destination channels
+	int			mSource[MaxChannels];
+	uint8		mFillValue;
+};
+
+
 class TSoyPixelsCopyParams
 {
 public:
@@ -191,6 +309,44 @@ public:
 	bool	mAllowComponentSwizzle;	//	allow BGRA to go into RGBA
 	bool	mFlipSource;
 	bool	mFlipDestination;
+	TSoyPixelsChannelMap	mChannelMap;	//	explicit remap when not reallocing (eg. drop alpha), otherwise worked out from the formats
+};
+
+
+//	crop, scale, flip & change format, run in one pass over the destination rows
+class TPixelsTransform
+{
+public:
+	TPixelsTransform() :
+		mWidth			( 0 ),
+		mHeight			( 0 ),
+		mFormat			( SoyPixelsFormat::Invalid ),
+		mFilter			( SoyPixelsResizeFilter::Bilinear ),
+		mYuvMatrix		( SoyYuvMatrix::Bt601 ),
+		mFlip			( false ),
+		mAllowRealloc	( true )
+	{
+	}
+	//	flip & realloc behave like Copy()
+	explicit TPixelsTransform(const TSoyPixelsCopyParams& Params) :
+		mWidth			( 0 ),
+		mHeight			( 0 ),
+		mFormat			( SoyPixelsFormat::Invalid ),
+		mFilter			( SoyPixelsResizeFilter::Bilinear ),
+		mYuvMatrix		( SoyYuvMatrix::Bt601 ),
+		mFlip			( Params.mFlipSource != Params.mFlipDestination ),
+		mAllowRealloc	( Params.mAllowRealloc )
+	{
+	}
+	
+	Soy::Rectx<size_t>			mSourceRect;	//	zero size = whole source
+	size_t						mWidth;			//	zero = source rect size
+	size_t						mHeight;
+	SoyPixelsFormat::Type		mFormat;		//	invalid = source format
+	SoyPixelsResizeFilter::Type	mFilter;
+	SoyYuvMatrix::Type			mYuvMatrix;
+	bool						mFlip;			//	vertically
+	bool						mAllowRealloc;	//	otherwise destination must already be the output size & format
 };
 
 
@@ -202,14 +358,18 @@ public:
 	SoyPixelsMeta() :
 		mFormat		( SoyPixelsFormat::Invalid ),
 		mWidth		( 0 ),
-		mHeight		( 0 )
+		mHeight		( 0 ),
+		mRowPitch	( 0 )
 	{
 	}
-	SoyPixelsMeta(size_t Width,size_t Height,SoyPixelsFormat::Type Format) :
-		mWidth	( Width ),
-		mHeight	( Height ),
-		mFormat	( Format )
+	SoyPixelsMeta(size_t Width,size_t Height,SoyPixelsFormat::Type Format,size_t RowPitch=0) :
+		mWidth		( Width ),
+		mHeight		( Height ),
+		mFormat		( Format ),
+		mRowPitch	( 0 )
 	{
+		if ( RowPitch != 0 )
+			SetRowPitch( RowPitch );
 	}
 	
 	bool			IsValid() const					{	return (mWidth>0) && (mHeight>0) && SoyPixelsFormat::IsValid(mFormat);	}
@@ -226,6 +386,9 @@ public:
 	SoyPixelsFormat::Type	GetFormat() const		{	return mFormat;	}
 	uint8_t			GetPixelDataSize() const		{	return GetChannels() * GetBytesPerChannel();	}
 	size_t			GetRowDataSize() const			{	return GetPixelDataSize() * GetWidth();	}
+	size_t			GetRowPitch() const				{	return mRowPitch ? mRowPitch : GetRowDataSize();	}	//	bytes from one row to the next (of the first plane for planar formats)
+	bool			IsPacked() const				{	return mRowPitch == 0;	}
+	void			SetRowPitch(size_t RowPitch);	//	0 = packed. throws if smaller than a row
 	void			GetPlanes(ArrayBridge<SoyPixelsMeta>&& PlaneFormats,const ArrayInterface<uint8>* Data=nullptr) const;	//	extract multiple plane formats where applicable (returns self if one plane)
 	void			SplitPlanes(size_t PixelDataSize,ArrayBridge<std::tuple<size_t,size_t,SoyPixelsMeta>>&& PlaneOffsetSizeAndMetas,const ArrayInterface<uint8>* Data=nullptr) const;	//	get all the plane split info, asserts if data doesn't align
 
@@ -234,12 +397,14 @@ public:
 	void			DumbSetChannels(size_t Channels)	{	mFormat = SoyPixelsFormat::GetFormatFromChannelCount(Channels);	}
 	void			DumbSetWidth(size_t Width)		{	mWidth = Width;	}
 	void			DumbSetHeight(size_t Height)	{	mHeight = Height;	}
+	void			DumbSetRowPitch(size_t RowPitch)	{	mRowPitch = RowPitch;	}
 
 	bool			operator==(const SoyPixelsMeta& that) const
 	{
 		return this->mWidth == that.mWidth &&
 		this->mHeight == that.mHeight &&
-		this->mFormat == that.mFormat;
+		this->mFormat == that.mFormat &&
+		this->mRowPitch == that.mRowPitch;
 	}
 	bool			operator!=(const SoyPixelsMeta& that) const
 	{
@@ -247,13 +412,15 @@ public:
 	}
 	
 private:
-	size_t			GetSelfDataSize() const			{	return GetHeight() * GetWidth() * GetChannels() * GetBytesPerChannel();	}
+	size_t			GetSelfDataSize() const			{	return GetHeight() * GetRowPitch();	}
+	size_t			GetPackedRowPitch() const;
 
 protected:
 	//	gr: assuming we will always have a length of data so we can determine height/stride
 	SoyPixelsFormat::Type	mFormat;
 	size_t					mWidth;
 	size_t					mHeight;
+	size_t					mRowPitch;	//	0 when rows are packed
 };
 DECLARE_NONCOMPLEX_TYPE( SoyPixelsMeta );
 
@@ -280,12 +447,14 @@ public:
 	uint8			GetChannels() const				{	return size_cast<uint8>( GetMeta().GetChannels() );	}
 	size_t			GetWidth() const				{	return GetMeta().GetWidth();	}
 	size_t			GetHeight() const				{	return GetMeta().GetHeight();	}
-	size_t			GetRowPitchBytes() const		{	return sizeof(uint8) * GetChannels() * GetWidth();	}
+	size_t			GetRowPitchBytes() const		{	return GetMeta().GetRowPitch();	}
 	SoyPixelsFormat::Type	GetFormat() const		{	return GetMeta().GetFormat();	}
 	void			PrintPixels(const std::string& Prefix,std::ostream& Stream,bool Hex,const char* PixelSuffix) const;
 
 	bool			GetPng(ArrayBridge<char>&& PngData) const	{	return GetPng( PngData );	}
 	bool			GetPng(ArrayBridge<char>& PngData) const;
+	bool			GetPng(ArrayBridge<char>&& PngData,const TPng::TEncodeParams& Params) const	{	return GetPng( PngData, Params );	}
+	bool			GetPng(ArrayBridge<char>& PngData,const TPng::TEncodeParams& Params) const;
 	bool			GetRawSoyPixels(ArrayBridge<char>& RawData) const;
 	bool			GetRawSoyPixels(ArrayBridge<char>&& RawData) const	{	return GetRawSoyPixels( RawData );	}
 
@@ -306,17 +475,25 @@ public:
 	vec2x<size_t>	GetXy(size_t PixelIndex) const;
 	size_t			GetIndex(size_t x,size_t y,size_t ChannelOffset=0) const;	//	throws if OOB
 
-	void			SetFormat(SoyPixelsFormat::Type Format);
+	void			SetFormat(SoyPixelsFormat::Type Format,SoyYuvMatrix::Type YuvMatrix=SoyYuvMatrix::Bt601);
+	//	convert into Dst's format without touching Src. Dst is resized to match unless it's fixed (eg. SoyPixelsRemote), in which case it must be big enough
+	static void		Convert(const SoyPixelsImpl& Src,SoyPixelsImpl& Dst,SoyYuvMatrix::Type YuvMatrix=SoyYuvMatrix::Bt601);
+	static void		Convert(const SoyPixelsImpl& Src,SoyPixelsImpl& Dst,const TSoyPixelsFloatParams& FloatParams,SoyYuvMatrix::Type YuvMatrix=SoyYuvMatrix::Bt601);
 	void			SetChannels(uint8 Channels);
 	bool			SetRawSoyPixels(const ArrayBridge<char>& RawData);
 	bool			SetRawSoyPixels(const ArrayBridge<char>&& RawData)	{	return SetRawSoyPixels( RawData );	}
 
 	void			ResizeClip(size_t Width,size_t Height);
 	void			ResizeFastSample(size_t Width,size_t Height);
+	void			Resize(size_t Width,size_t Height,SoyPixelsResizeFilter::Type Filter);
+	//	resample into Dst's dimensions, which must be the same format. Planar formats resize each plane
+	static void		Resize(const SoyPixelsImpl& Src,SoyPixelsImpl& Dst,SoyPixelsResizeFilter::Type Filter);
+	static void		Transform(const SoyPixelsImpl& Src,SoyPixelsImpl& Dst,const TPixelsTransform& Transform);
 	
 	void			Flip();
+	void			Pack();				//	remove row padding in place
 
-	//	split these pixels into multiple pixels if there are multiple planes
+	//	split these pixels into multiple pixels if there are multiple planes. Allocates, use SoyPixelsPlanes on hot paths
 	void			SplitPlanes(ArrayBridge<std::shared_ptr<SoyPixelsImpl>>&& Planes) const;
 	
 	inline bool		operator==(const SoyPixelsImpl& that) const		{	return this == &that;	}
@@ -405,9 +582,10 @@ public:
 	{
 		*this = that;
 	}
-	explicit SoyPixelsRemote(uint8* Array, size_t Width, size_t Height, size_t DataSize, SoyPixelsFormat::Type Format) :
+	//	RowPitch lets us wrap padded rows (eg. from a decoder or mapped texture) without repacking
+	explicit SoyPixelsRemote(uint8* Array, size_t Width, size_t Height, size_t DataSize, SoyPixelsFormat::Type Format,size_t RowPitch=0) :
 		mArray			(Array, DataSize),
-		mMutableMeta	(Width, Height, Format),
+		mMutableMeta	(Width, Height, Format, RowPitch),
 		mMeta			( mMutableMeta ),
 		mArrayBridge	(mArray)
 	{
@@ -466,6 +644,34 @@ private:
 
 
 
+//	non-owning view of each plane (eg. luma & chroma) of some pixels.
+//	Unlike SoyPixelsImpl::SplitPlanes this doesn't allocate, so it can be made on the stack every frame.
+//	The parent pixels must outlive the view
+class SoyPixelsPlanes
+{
+public:
+	static const size_t	MaxPlanes = 4;
+	
+public:
+	explicit SoyPixelsPlanes(const SoyPixelsImpl& Pixels);
+	
+	size_t					GetPlaneCount() const					{	return mPlaneCount;	}
+	SoyPixelsRemote&		GetPlane(size_t Index);
+	const SoyPixelsRemote&	GetPlane(size_t Index) const;
+	size_t					GetPlaneOffset(size_t Index) const;		//	bytes from the start of the parent's data
+	size_t					GetPlaneRowPitch(size_t Index) const	{	return GetPlane(Index).GetRowPitchBytes();	}
+	
+	SoyPixelsRemote&		operator[](size_t Index)				{	return GetPlane(Index);	}
+	const SoyPixelsRemote&	operator[](size_t Index) const			{	return GetPlane(Index);	}
+
+private:
+	size_t					mPlaneCount;
+	size_t					mPlaneOffsets[MaxPlanes];
+	SoyPixelsRemote			mPlanes[MaxPlanes];
+};
+
+
+
 //	like SoyPixelsRemote but modifies underlying array
 template<typename TARRAY>
 class SoyPixelsBridge : public SoyPixelsImpl
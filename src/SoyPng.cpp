@@ -3,6 +3,9 @@
 #include "SoyDebug.h"
 #include "SoyPng.h"
 #include "RemoteArray.h"
+#include "SoyStream.h"
+#include <map>
+#include <mutex>
 
 
 
@@ -151,26 +154,46 @@ bool TPng::ReadHeader(SoyPixelsImpl& Pixels,THeader& Header,ArrayBridge<char>& D
 	return true;
 }
 
-/*
- //	from http://lpi.googlecode.com/svn/trunk/lodepng.cpp
-static void filterScanline(unsigned char* out, const unsigned char* scanline, const unsigned char* prevline,
-                           size_t length, size_t bytewidth, unsigned char filterType)
+//	from http://lpi.googlecode.com/svn/trunk/lodepng.cpp
+static uint8 paethPredictor(int a,int b,int c)
+{
+	int pa = std::abs( b - c );
+	int pb = std::abs( a - c );
+	int pc = std::abs( a + b - c - c );
+	
+	if ( pc < pa && pc < pb )
+		return static_cast<uint8>(c);
+	else if ( pb < pa )
+		return static_cast<uint8>(b);
+	else
+		return static_cast<uint8>(a);
+}
+
+//	prevline is null for the first row
+//	bytewidth is used for filtering, is 1 when bpp < 8, number of bytes per pixel otherwise
+static void filterScanline(uint8* out,const uint8* scanline,const uint8* prevline,size_t length,size_t bytewidth,TPng::TFilterNone_ScanlineFilter::Type filterType)
 {
 	size_t i;
 	switch(filterType)
 	{
-	
-		case 2: //Up
+		case TPng::TFilterNone_ScanlineFilter::None:
+			memcpy( out, scanline, length );
+			break;
+		case TPng::TFilterNone_ScanlineFilter::Sub:
+			for(i = 0; i < bytewidth; i++) out[i] = scanline[i];
+			for(i = bytewidth; i < length; i++) out[i] = scanline[i] - scanline[i - bytewidth];
+			break;
+		case TPng::TFilterNone_ScanlineFilter::Up:
 			if(prevline)
 			{
 				for(i = 0; i < length; i++) out[i] = scanline[i] - prevline[i];
 			}
 			else
 			{
-				for(i = 0; i < length; i++) out[i] = scanline[i];
+				memcpy( out, scanline, length );
 			}
 			break;
-		case 3: //Average
+		case TPng::TFilterNone_ScanlineFilter::Average:
 			if(prevline)
 			{
 				for(i = 0; i < bytewidth; i++) out[i] = scanline[i] - prevline[i] / 2;
@@ -181,8 +204,8 @@ static void filterScanline(unsigned char* out, const unsigned char* scanline, co
 				for(i = 0; i < bytewidth; i++) out[i] = scanline[i];
 				for(i = bytewidth; i < length; i++) out[i] = scanline[i] - scanline[i - bytewidth] / 2;
 			}
-			break
-		case 4: //Paeth
+			break;
+		case TPng::TFilterNone_ScanlineFilter::Paeth:
 			if(prevline)
 			{
 				//paethPredictor(0, prevline[i], 0) is always prevline[i]
@@ -199,10 +222,59 @@ static void filterScanline(unsigned char* out, const unsigned char* scanline, co
 				for(i = bytewidth; i < length; i++) out[i] = (scanline[i] - scanline[i - bytewidth]);
 			}
 			break;
-		default: return; //unexisting filter type given
+		default:
+			throw Soy::AssertException("Unhandled png scanline filter");
 	}
 }
- */
+
+//	libpng's heuristic; treat the filtered bytes as signed and sum the magnitudes, smaller tends to deflate better.
+//	gives up once we've passed the best cost so far
+static size_t GetFilteredScanlineCost(const uint8* Filtered,size_t Length,size_t BestCost)
+{
+	size_t Cost = 0;
+	for ( size_t i=0;	i<Length;	i++ )
+	{
+		Cost += std::abs( static_cast<int>( static_cast<int8_t>(Filtered[i]) ) );
+		if ( Cost >= BestCost )
+			break;
+	}
+	return Cost;
+}
+
+//	filter with each type and keep whichever is cheapest. returns the filter used
+static TPng::TFilterNone_ScanlineFilter::Type filterScanlineAdaptive(uint8* out,const uint8* scanline,const uint8* prevline,size_t length,size_t bytewidth,ArrayBridge<uint8>&& Scratch)
+{
+	static const TPng::TFilterNone_ScanlineFilter::Type Filters[] =
+	{
+		TPng::TFilterNone_ScanlineFilter::None,
+		TPng::TFilterNone_ScanlineFilter::Sub,
+		TPng::TFilterNone_ScanlineFilter::Up,
+		TPng::TFilterNone_ScanlineFilter::Average,
+		TPng::TFilterNone_ScanlineFilter::Paeth,
+	};
+	
+	//	alternate between out and scratch so the best so far is never overwritten
+	Scratch.SetSize( length );
+	uint8* Best = nullptr;
+	uint8* Candidate = out;
+	auto BestFilter = TPng::TFilterNone_ScanlineFilter::None;
+	size_t BestCost = std::numeric_limits<size_t>::max();
+	for ( auto Filter : Filters )
+	{
+		filterScanline( Candidate, scanline, prevline, length, bytewidth, Filter );
+		auto Cost = GetFilteredScanlineCost( Candidate, length, BestCost );
+		if ( Cost >= BestCost )
+			continue;
+		BestCost = Cost;
+		BestFilter = Filter;
+		Best = Candidate;
+		Candidate = (Candidate == out) ? Scratch.GetArray() : out;
+	}
+	
+	if ( Best != out )
+		memcpy( out, Best, length );
+	return BestFilter;
+}
 
 bool DeFilterScanline(TPng::TFilterNone_ScanlineFilter::Type Filter,const ArrayBridge<uint8>&& Scanline,int ByteWidth,ArrayBridge<uint8>& DeFilteredData,std::stringstream& Error)
 {
@@ -285,112 +357,543 @@ bool TPng::ReadTail(SoyPixelsImpl& Pixels,ArrayBridge<char>& Data,std::stringstr
 }
 
 
-bool TPng::GetPngData(Array<char>& PngData,const SoyPixelsImpl& Image,TCompression::Type Compression)
+//	inverse of filterScanline, precon is the previous de-filtered row (null for the first row)
+static void unfilterScanline(uint8* recon,const uint8* scanline,const uint8* precon,size_t bytewidth,TPng::TFilterNone_ScanlineFilter::Type filterType,size_t length)
+{
+	size_t i;
+	switch(filterType)
+	{
+		case TPng::TFilterNone_ScanlineFilter::None:
+			memcpy( recon, scanline, length );
+			break;
+		case TPng::TFilterNone_ScanlineFilter::Sub:
+			for(i = 0; i < bytewidth; i++) recon[i] = scanline[i];
+			for(i = bytewidth; i < length; i++) recon[i] = scanline[i] + recon[i - bytewidth];
+			break;
+		case TPng::TFilterNone_ScanlineFilter::Up:
+			if(precon)
+			{
+				for(i = 0; i < length; i++) recon[i] = scanline[i] + precon[i];
+			}
+			else
+			{
+				memcpy( recon, scanline, length );
+			}
+			break;
+		case TPng::TFilterNone_ScanlineFilter::Average:
+			if(precon)
+			{
+				for(i = 0; i < bytewidth; i++) recon[i] = scanline[i] + precon[i] / 2;
+				for(i = bytewidth; i < length; i++) recon[i] = scanline[i] + ((recon[i - bytewidth] + precon[i]) / 2);
+			}
+			else
+			{
+				for(i = 0; i < bytewidth; i++) recon[i] = scanline[i];
+				for(i = bytewidth; i < length; i++) recon[i] = scanline[i] + recon[i - bytewidth] / 2;
+			}
+			break;
+		case TPng::TFilterNone_ScanlineFilter::Paeth:
+			if(precon)
+			{
+				for(i = 0; i < bytewidth; i++) recon[i] = scanline[i] + precon[i];
+				for(i = bytewidth; i < length; i++) recon[i] = scanline[i] + paethPredictor(recon[i - bytewidth], precon[i], precon[i - bytewidth]);
+			}
+			else
+			{
+				for(i = 0; i < bytewidth; i++) recon[i] = scanline[i];
+				for(i = bytewidth; i < length; i++) recon[i] = scanline[i] + recon[i - bytewidth];
+			}
+			break;
+		default:
+			throw Soy::AssertException("Unhandled png scanline filter");
+	}
+}
+
+
+TPng::TStreamDecoder::TStreamDecoder(SoyPixelsImpl& Pixels) :
+	mPixels				( Pixels ),
+	mState				( TDecodeState::Signature ),
+	mChunkRemaining		( 0 ),
+	mInflateFinished	( false ),
+	mRowFilled			( 0 ),
+	mRowsDecoded		( 0 )
+{
+	memset( mChunkType, 0, sizeof(mChunkType) );
+}
+
+
+bool TPng::TStreamDecoder::Decode(TStreamBuffer& Buffer)
+{
+	if ( IsFinished() )
+		return true;
+	
+	//	take everything in one go; popping in slices would shuffle the rest of the buffer down each time
+	Array<uint8> Data;
+	auto DataSize = Buffer.GetBufferedSize();
+	if ( DataSize > 0 && !Buffer.Pop( DataSize, GetArrayBridge(Data) ) )
+		throw Soy::AssertException("Failed to pop png data from stream");
+	
+	auto Used = Decode( Data.GetArray(), Data.GetDataSize() );
+	
+	//	leave whatever follows the png for the next reader
+	if ( Used < Data.GetDataSize() )
+	{
+		auto Remaining = GetRemoteArray( Data.GetArray() + Used, Data.GetDataSize() - Used );
+		Buffer.UnPop( GetArrayBridge(Remaining) );
+	}
+	
+	if ( !IsFinished() && Buffer.HasEndOfStream() && Buffer.IsEmpty() )
+		throw Soy::AssertException("Stream ended before png was complete");
+	
+	return IsFinished();
+}
+
+
+size_t TPng::TStreamDecoder::Decode(const uint8* Data,size_t DataSize)
+{
+	size_t Used = 0;
+	
+	//	accumulate a fixed size field, returns true when it's complete
+	auto FillField = [&](size_t FieldSize)
+	{
+		auto Needed = FieldSize - mField.GetSize();
+		auto Copy = std::min( Needed, DataSize - Used );
+		auto Part = GetRemoteArray( Data + Used, Copy );
+		mField.PushBackArray( Part );
+		Used += Copy;
+		return mField.GetSize() == FieldSize;
+	};
+	auto ReadFieldUint32 = [&](size_t Offset)
+	{
+		return (static_cast<uint32>(mField[Offset+0]) << 24) | (static_cast<uint32>(mField[Offset+1]) << 16) | (static_cast<uint32>(mField[Offset+2]) << 8) | (static_cast<uint32>(mField[Offset+3]) << 0);
+	};
+	
+	while ( Used < DataSize && mState != TDecodeState::Finished )
+	{
+		switch ( mState )
+		{
+			case TDecodeState::Signature:
+			{
+				if ( !FillField(8) )
+					break;
+				BufferArray<char,8> Magic;
+				GetMagic( GetArrayBridge(Magic) );
+				if ( memcmp( Magic.GetArray(), mField.GetArray(), 8 ) != 0 )
+					throw Soy::AssertException("Data is not a png");
+				mField.Clear();
+				mState = TDecodeState::ChunkHeader;
+				break;
+			}
+				
+			case TDecodeState::ChunkHeader:
+			{
+				if ( !FillField(8) )
+					break;
+				mChunkRemaining = ReadFieldUint32(0);
+				memcpy( mChunkType, &mField[4], sizeof(mChunkType) );
+				mField.Clear();
+				OnChunkStart();
+				mState = mChunkRemaining > 0 ? TDecodeState::ChunkData : TDecodeState::ChunkCrc;
+				break;
+			}
+				
+			case TDecodeState::ChunkData:
+			{
+				auto Size = std::min( mChunkRemaining, DataSize - Used );
+				OnChunkData( Data + Used, Size );
+				Used += Size;
+				mChunkRemaining -= Size;
+				if ( mChunkRemaining == 0 )
+					mState = TDecodeState::ChunkCrc;
+				break;
+			}
+				
+			case TDecodeState::ChunkCrc:
+			{
+				if ( !FillField(4) )
+					break;
+				auto Crc = ReadFieldUint32(0);
+				mField.Clear();
+				mState = TDecodeState::ChunkHeader;
+				OnChunkEnd( Crc );
+				break;
+			}
+				
+			default:
+				throw Soy::AssertException("Png decoder in unknown state");
+		}
+	}
+	
+	return Used;
+}
+
+
+static bool IsChunkType(const char* ChunkType,const char* Match)
+{
+	return memcmp( ChunkType, Match, 4 ) == 0;
+}
+
+
+void TPng::TStreamDecoder::OnChunkStart()
+{
+	mChunkCrc.Reset();
+	mChunkCrc.AddData( reinterpret_cast<const uint8*>(mChunkType), sizeof(mChunkType) );
+	mChunkData.Clear();
+	
+	if ( IsChunkType( mChunkType, "IHDR" ) )
+	{
+		Soy::Assert( !HasHeader(), "Png has multiple header chunks" );
+		Soy::Assert( mChunkRemaining == 13, "Png header chunk is the wrong size" );
+		return;
+	}
+	
+	if ( IsChunkType( mChunkType, "IDAT" ) || IsChunkType( mChunkType, "IEND" ) )
+	{
+		Soy::Assert( HasHeader(), "Png data before header chunk" );
+		return;
+	}
+	
+	//	ancillary chunks (lower case first letter) can be skipped, critical ones we don't know about (eg. palette) can't
+	bool Critical = (mChunkType[0] & (1<<5)) == 0;
+	if ( Critical )
+	{
+		std::stringstream Error;
+		Error << "Unsupported png chunk " << std::string( mChunkType, sizeof(mChunkType) );
+		throw Soy::AssertException( Error.str() );
+	}
+}
+
+
+void TPng::TStreamDecoder::OnChunkData(const uint8* Data,size_t DataSize)
+{
+	mChunkCrc.AddData( Data, DataSize );
+	
+	if ( IsChunkType( mChunkType, "IHDR" ) )
+	{
+		auto DataArray = GetRemoteArray( reinterpret_cast<const char*>(Data), DataSize );
+		mChunkData.PushBackArray( DataArray );
+	}
+	else if ( IsChunkType( mChunkType, "IDAT" ) )
+	{
+		Inflate( Data, DataSize );
+	}
+}
+
+
+void TPng::TStreamDecoder::OnChunkEnd(uint32 Crc)
+{
+	if ( mChunkCrc.GetCrc32() != Crc )
+	{
+		std::stringstream Error;
+		Error << "Png chunk " << std::string( mChunkType, sizeof(mChunkType) ) << " crc mismatch";
+		throw Soy::AssertException( Error.str() );
+	}
+	
+	if ( IsChunkType( mChunkType, "IHDR" ) )
+	{
+		OnHeaderChunk();
+	}
+	else if ( IsChunkType( mChunkType, "IEND" ) )
+	{
+		if ( mRowsDecoded != mPixels.GetHeight() )
+		{
+			std::stringstream Error;
+			Error << "Png ended after " << mRowsDecoded << "/" << mPixels.GetHeight() << " rows";
+			throw Soy::AssertException( Error.str() );
+		}
+		mState = TDecodeState::Finished;
+	}
+}
+
+
+void TPng::TStreamDecoder::OnHeaderChunk()
+{
+	std::stringstream Error;
+	auto HeaderData = GetArrayBridge( mChunkData );
+	if ( !ReadHeader( mPixels, mHeader, HeaderData, Error ) )
+		throw Soy::AssertException( Error.str() );
+	mChunkData.Clear();
+	
+	mInflater.reset( new mz_stream, [](mz_stream* Stream)
+	{
+		mz_inflateEnd( Stream );
+		delete Stream;
+	});
+	memset( mInflater.get(), 0, sizeof(mz_stream) );
+	auto Result = mz_inflateInit( mInflater.get() );
+	Soy::Assert( Result == MZ_OK, "Failed to initialise png inflater" );
+	
+	auto Stride = mPixels.GetChannels() * mPixels.GetWidth();
+	mRow.SetSize( Stride + 1 );
+	mRowFilled = 0;
+}
+
+
+void TPng::TStreamDecoder::Inflate(const uint8* Data,size_t DataSize)
+{
+	//	trailing bytes after the end of the deflate stream are ignored
+	if ( mInflateFinished )
+		return;
+	
+	auto& Stream = *mInflater;
+	Stream.next_in = Data;
+	Stream.avail_in = size_cast<unsigned int>(DataSize);
+	
+	while ( true )
+	{
+		Stream.next_out = mRow.GetArray() + mRowFilled;
+		Stream.avail_out = size_cast<unsigned int>( mRow.GetDataSize() - mRowFilled );
+		auto Result = mz_inflate( &Stream, MZ_NO_FLUSH );
+		mRowFilled = mRow.GetDataSize() - Stream.avail_out;
+		
+		bool RowComplete = ( Stream.avail_out == 0 );
+		if ( RowComplete )
+		{
+			OnRowInflated();
+			mRowFilled = 0;
+		}
+		
+		if ( Result == MZ_STREAM_END )
+		{
+			mInflateFinished = true;
+			break;
+		}
+		
+		//	no progress, needs more input
+		if ( Result == MZ_BUF_ERROR )
+			break;
+		
+		if ( Result != MZ_OK )
+		{
+			std::stringstream Error;
+			Error << "Error decompressing PNG data (" << mz_error(Result) << ")";
+			throw Soy::AssertException( Error.str() );
+		}
+		
+		//	miniz returns after draining its window even when there's more input, so only stop once it's all used
+		if ( !RowComplete && Stream.avail_in == 0 )
+			break;
+	}
+}
+
+
+void TPng::TStreamDecoder::OnRowInflated()
+{
+	auto y = mRowsDecoded;
+	Soy::Assert( y < mPixels.GetHeight(), "Png has more data than rows" );
+	
+	auto Filter = static_cast<TFilterNone_ScanlineFilter::Type>( mRow[0] );
+	auto Stride = mRow.GetDataSize() - 1;
+	auto ByteWidth = mPixels.GetChannels();
+	auto Pitch = mPixels.GetRowPitchBytes();
+	auto* Row = mPixels.GetPixelsArray().GetArray() + (y * Pitch);
+	const uint8* PrevRow = (y > 0) ? Row - Pitch : nullptr;
+	unfilterScanline( Row, mRow.GetArray()+1, PrevRow, ByteWidth, Filter, Stride );
+	mRowsDecoded++;
+}
+
+
+//	largest block a stored deflate block can hold
+static const size_t StoredBlockSize = 0xffff;
+
+static int GetMinizStrategy(TPng::TStrategy::Type Strategy)
+{
+	switch ( Strategy )
+	{
+		case TPng::TStrategy::Default:		return MZ_DEFAULT_STRATEGY;
+		case TPng::TStrategy::Filtered:		return MZ_FILTERED;
+		case TPng::TStrategy::Rle:			return MZ_RLE;
+		case TPng::TStrategy::HuffmanOnly:	return MZ_HUFFMAN_ONLY;
+		default:
+			throw Soy::AssertException("Unhandled png deflate strategy");
+	}
+}
+
+
+//	zlib header; deflate, 32k window, no dictionary. (Cmf*256+Flg) must be a multiple of 31
+static const uint8 ZlibCmf = 0x78;
+static const uint8 ZlibFlg = 0x01;
+
+
+//	filter rows [FirstRow,FirstRow+RowCount) into their place in the framed buffer; each row is prefixed with its filter code
+static void FilterRows(Array<uint8>& FilteredPixels,const SoyPixelsImpl& Image,const TPng::TEncodeParams& Params,size_t FirstRow,size_t RowCount)
+{
+	auto& OrigPixels = Image.GetPixelsArray();
+	auto Stride = Image.GetChannels()*Image.GetWidth();
+	auto ByteWidth = std::max<size_t>( 1, Image.GetChannels() * Image.GetBitDepth() / 8 );
+	Array<uint8> Scratch;
+	for ( size_t y=FirstRow;	y<FirstRow+RowCount;	y++ )
+	{
+		//	the filters use the unfiltered row above, so always read from the original pixels
+		auto* Row = &OrigPixels[y*Stride];
+		auto* PrevRow = (y > 0) ? Row - Stride : nullptr;
+		auto* FilteredRow = &FilteredPixels[y*(Stride+1)];
+		auto Filter = Params.mFilter;
+		if ( Params.IsAdaptiveFilter() )
+			Filter = filterScanlineAdaptive( FilteredRow+1, Row, PrevRow, Stride, ByteWidth, GetArrayBridge(Scratch) );
+		else
+			filterScanline( FilteredRow+1, Row, PrevRow, Stride, ByteWidth, Filter );
+		FilteredRow[0] = Filter;
+	}
+}
+
+
+//	raw (headerless) deflate of one strip. All but the last strip end on a full flush, which byte-aligns the output
+//	and drops the dictionary, so strips can be concatenated into one stream
+static void DeflateStrip(Array<char>& Output,const uint8* Data,size_t DataSize,const TPng::TEncodeParams& Params,bool LastStrip)
+{
+	mz_stream Stream;
+	memset( &Stream, 0, sizeof(Stream) );
+	auto Result = mz_deflateInit2( &Stream, Params.mCompressionLevel, MZ_DEFLATED, -MZ_DEFAULT_WINDOW_BITS, 9, GetMinizStrategy(Params.mStrategy) );
+	Soy::Assert( Result == MZ_OK, "mz compression init failed" );
+
+	//	bound doesn't include the empty stored block a flush writes
+	auto Allocated = mz_deflateBound( &Stream, size_cast<mz_ulong>(DataSize) ) + 16;
+	Output.SetSize( Allocated );
+	Stream.next_in = Data;
+	Stream.avail_in = size_cast<unsigned int>(DataSize);
+	Stream.next_out = reinterpret_cast<unsigned char*>( Output.GetArray() );
+	Stream.avail_out = size_cast<unsigned int>(Allocated);
+	Result = mz_deflate( &Stream, LastStrip ? MZ_FINISH : MZ_FULL_FLUSH );
+	auto Used = Stream.total_out;
+	bool AllInput = Stream.avail_in == 0;
+	mz_deflateEnd( &Stream );
+
+	Soy::Assert( Result == (LastStrip ? MZ_STREAM_END : MZ_OK) && AllInput, "mz strip compression failed" );
+	Output.SetSize( Used );
+}
+
+
+class TDeflateStrip
+{
+public:
+	TDeflateStrip() :
+		mDataSize	( 0 )
+	{
+	}
+	
+	Array<char>		mData;
+	TAdler32		mAdler;
+	size_t			mDataSize;	//	uncompressed
+};
+
+
+//	filter & deflate bands of rows on the SoyPixelsParallel pool, then stitch them into one zlib stream
+static void GetParallelDeflateData(Array<char>& PngData,Array<uint8>& FilteredPixels,const SoyPixelsImpl& Image,const TPng::TEncodeParams& Params)
+{
+	auto Height = Image.GetHeight();
+	auto FilteredStride = Image.GetChannels()*Image.GetWidth() + 1;
+	std::mutex StripsLock;
+	std::map<size_t,std::shared_ptr<TDeflateStrip>> Strips;
+	
+	SoyPixelsParallel::ForEachRowBand( Height, 1, [&](size_t FirstRow,size_t RowCount)
+	{
+		FilterRows( FilteredPixels, Image, Params, FirstRow, RowCount );
+		
+		auto Strip = std::make_shared<TDeflateStrip>();
+		auto* Data = FilteredPixels.GetArray() + (FirstRow * FilteredStride);
+		Strip->mDataSize = RowCount * FilteredStride;
+		bool LastStrip = (FirstRow + RowCount) == Height;
+		DeflateStrip( Strip->mData, Data, Strip->mDataSize, Params, LastStrip );
+		Strip->mAdler.AddData( Data, Strip->mDataSize );
+		
+		std::lock_guard<std::mutex> Lock( StripsLock );
+		Strips[FirstRow] = Strip;
+	});
+	
+	size_t TotalSize = 6;
+	for ( auto& Strip : Strips )
+		TotalSize += Strip.second->mData.GetDataSize();
+	PngData.Reserve( TotalSize );
+	
+	PngData.PushBack( ZlibCmf );
+	PngData.PushBack( ZlibFlg );
+	uint32 Adler = TAdler32().GetAdler32();
+	for ( auto& Strip : Strips )
+	{
+		PngData.PushBackArray( Strip.second->mData );
+		Adler = TAdler32::Combine( Adler, Strip.second->mAdler.GetAdler32(), Strip.second->mDataSize );
+	}
+	PngData.PushBackReinterpretReverse( Adler );
+}
+
+
+bool TPng::GetPngData(Array<char>& PngData,const SoyPixelsImpl& Image,TCompression::Type Compression,const TEncodeParams& Params)
 {
 	if ( Compression == TCompression::DEFLATE )
 	{
-		//	we need to add a filter value at the start of each row, so calculate all the byte indexes
-		auto& OrigPixels = Image.GetPixelsArray();
-		Array<uint8> FilteredPixels;
-		FilteredPixels.Reserve( OrigPixels.GetDataSize() + Image.GetHeight() );
-		FilteredPixels.PushBackArray( OrigPixels );
+		//	each row is prefixed with its filter code, write every row once straight into a presized buffer
 		auto Stride = Image.GetChannels()*Image.GetWidth();
-		for ( ssize_t i=OrigPixels.GetSize()-Stride;	i>=0;	i-=Stride )
+		auto Height = Image.GetHeight();
+		Array<uint8> FilteredPixels;
+		FilteredPixels.SetSize( (Stride+1) * Height );
+		
+
+		//	split into strips which are filtered & deflated concurrently
+		auto StripCount = Params.mParallel && Params.mCompressionLevel > 0 ? SoyPixelsParallel::GetBandCount( Height ) : 1;
+		if ( StripCount > 1 )
 		{
-			//	insert filter value/code
-			static char FilterValue = TFilterNone_ScanlineFilter::None;
-			auto* RowStart = FilteredPixels.InsertBlock(i,1);
-			RowStart[0] = FilterValue;
+			GetParallelDeflateData( PngData, FilteredPixels, Image, Params );
+			return true;
+		}
+		
+		FilterRows( FilteredPixels, Image, Params, 0, Height );
+
+		//	miniz's level 0 still runs the data through the whole matcher, so write stored blocks ourselves
+		if ( Params.mCompressionLevel == 0 )
+		{
+			PngData.Reserve( FilteredPixels.GetDataSize() + 6 + (FilteredPixels.GetDataSize()/StoredBlockSize+1)*5 );
+			PngData.PushBack( ZlibCmf );
+			PngData.PushBack( ZlibFlg );
+			
+			size_t FirstByte = 0;
+			do
+			{
+				auto BlockSize = std::min( StoredBlockSize, FilteredPixels.GetDataSize()-FirstByte );
+				bool LastBlock = (FirstByte + BlockSize) == FilteredPixels.GetDataSize();
+				auto Block = GetRemoteArray( FilteredPixels.GetArray() + FirstByte, BlockSize );
+				if ( !GetDeflateData( PngData, GetArrayBridge(Block), LastBlock, size_cast<int>(StoredBlockSize) ) )
+					return false;
+				FirstByte += BlockSize;
+			}
+			while ( FirstByte < FilteredPixels.GetDataSize() );
+			
+			TAdler32 Adler;
+			Adler.AddData( FilteredPixels.GetArray(), FilteredPixels.GetDataSize() );
+			PngData.PushBackReinterpretReverse( Adler.GetAdler32() );
+			return true;
 		}
 
 		//	use miniz to compress with deflate
-		auto CompressionLevel = MZ_NO_COMPRESSION;
+		auto CompressionLevel = Params.mCompressionLevel;
 		std::stringstream Debug_TimerName;
 		Debug_TimerName << "Deflate compression; " << Soy::FormatSizeBytes(FilteredPixels.GetDataSize()) << ". Compression level: " << CompressionLevel;
 		ofScopeTimerWarning DeflateCompressTimer( Debug_TimerName.str().c_str(), 3 );
 	
-		auto DefAllocated = static_cast<mz_ulong>( 1.2f * FilteredPixels.GetDataSize() );
-		mz_ulong DefUsed = DefAllocated;
-		auto* DefData = PngData.PushBlock(DefAllocated);
+		mz_stream Stream;
+		memset( &Stream, 0, sizeof(Stream) );
+		auto Result = mz_deflateInit2( &Stream, CompressionLevel, MZ_DEFLATED, MZ_DEFAULT_WINDOW_BITS, 9, GetMinizStrategy(Params.mStrategy) );
+		if ( !Soy::Assert( Result == MZ_OK, "mz compression init failed" ) )
+			return false;
+
 		auto DecompressedSize = size_cast<mz_ulong>(FilteredPixels.GetDataSize());
-		auto Result = mz_compress2( reinterpret_cast<Byte*>(DefData), &DefUsed, FilteredPixels.GetArray(), DecompressedSize, CompressionLevel );
-		if ( !Soy::Assert( Result == MZ_OK, "mz compression failed" ) )
+		auto DefAllocated = mz_deflateBound( &Stream, DecompressedSize );
+		auto* DefData = PngData.PushBlock( size_cast<int>(DefAllocated) );
+		Stream.next_in = FilteredPixels.GetArray();
+		Stream.avail_in = size_cast<unsigned int>(DecompressedSize);
+		Stream.next_out = reinterpret_cast<unsigned char*>(DefData);
+		Stream.avail_out = size_cast<unsigned int>(DefAllocated);
+		Result = mz_deflate( &Stream, MZ_FINISH );
+		auto DefUsed = Stream.total_out;
+		mz_deflateEnd( &Stream );
+		if ( !Soy::Assert( Result == MZ_STREAM_END, "mz compression failed" ) )
 			return false;
 		if ( !Soy::Assert( DefUsed <= DefAllocated, "miniz compressed reported that it used more memory than we had allocated" ) )
 			return false;
 		//	trim data
-		auto Overflow = DefAllocated - size_cast<int>(DefUsed);
+		auto Overflow = DefAllocated - DefUsed;
 		PngData.SetSize( PngData.GetSize() - Overflow );
 		return true;
-
-		/*
-
-
-		//	split into sections of 64k bytes
-		static int WindowSizeShift = 1;
-		//	gr: windowsize is just for decoder?
-//		http://www.libpng.org/pub/png/spec/1.2/PNG-Compression.html
-		//If the data to be compressed contains 16384 bytes or fewer, the encoder can set the window size by rounding up to a power of 2 (256 minimum). This decreases the memory required not only for encoding but also for decoding, without adversely affecting the compression ratio.
-		static int WindowSize = 65535;//32768;
-		//int WindowSize = (1 << (WindowSizeShift+8))-minus;
-		Array<char> DeflateData;
-		bool BlockCountOverflow = (FilteredPixels.GetDataSize() % WindowSize) > 0;
-		int BlockCount = (FilteredPixels.GetDataSize() / WindowSize) + BlockCountOverflow;
-		assert( BlockCount > 0 );
-		DeflateData.Reserve( FilteredPixels.GetSize() + (BlockCount*10) );
-		for ( int b=0;	b<BlockCount;	b++ )
-		{
-			int FirstPixel = b*WindowSize;
-			const int PixelCount = ofMin( WindowSize, FilteredPixels.GetDataSize()-FirstPixel );
-			bool LastBlock = (b==BlockCount-1);
-			auto BlockPixelData = GetRemoteArray( &FilteredPixels[FirstPixel], PixelCount, PixelCount );
-			if ( !GetDeflateData( DeflateData, GetArrayBridge(BlockPixelData), LastBlock, WindowSize ) )
-				return false;
-		}
-
-		//	write deflate data and decompressed checksum
-		static uint8 CompressionMethod = 8;	//	deflate
-		static uint8 CInfo = WindowSizeShift;	//	
-		uint8 Cmf = 0;
-		Cmf |= CompressionMethod << 0;
-		Cmf |= CInfo << 4;
-		
-		static uint8 fcheck = 0;
-		static uint8 fdict = 0;
-		static uint8 flevel = 0;
-		uint8 Flg = 0;
-
-		//	The FCHECK value must be such that CMF and FLG, when viewed as
-        //	a 16-bit unsigned integer stored in MSB order (CMF*256 + FLG),
-        //	is a multiple of 31.
-		int Checksum = (Cmf * 256) + Flg;
-		if ( Checksum % 31 != 0 )
-		{
-			fcheck = 31 - (Checksum % 31);
-			Checksum = (Cmf * 256) + (Flg|fcheck);
-			assert( Checksum % 31 == 0 );
-		}
-		assert( fcheck < (1<<5) );
-		//if ( Checksum == 0 )
-		//	fcheck = 31;
-
-		Flg |= fcheck << 0;
-		Flg |= fdict << 5;
-		Flg |= flevel << 6;
-	
-		PngData.Reserve( DeflateData.GetSize() + 6 );
-		PngData.PushBack( Cmf );
-		PngData.PushBack( Flg );
-		if ( Flg & 1<<5 )	//	fdict, bit 5
-		{
-			uint32 Dict = 0;
-			PngData.PushBack( Dict );
-		}
-		PngData.PushBackArray( DeflateData );
-		uint32 DecompressedCrc = GetArrayBridge(OrigPixels).GetCrc32();
-		PngData.PushBackReinterpretReverse( DecompressedCrc );
-		return true;
-		*/
 	}
 	else
 	{
@@ -416,20 +919,18 @@ bool TPng::GetDeflateData(Array<char>& DeflateData,const ArrayBridge<uint8>& Pix
 
 	//	http://en.wikipedia.org/wiki/DEFLATE
 	//	http://www.ietf.org/rfc/rfc1951.txt
+	//	stored block; BFINAL bit, BTYPE 00, then little endian LEN & its ones' complement NLEN
 	uint8 Header = 0x0;
 	if ( LastBlock )
 		Header |= 1<<0;
 	uint16 Len = size_cast<uint16>(PixelBlock.GetDataSize());
-	uint16 NLen = 0;	//	compliment
+	uint16 NLen = ~Len;
 
 	DeflateData.PushBack( Header );
-	static bool reverse = false;
-	if ( reverse)
-		DeflateData.PushBackReinterpretReverse( Len );
-	else
-		DeflateData.PushBackReinterpret( Len );
-	if ( sizeof(Len)==2 )
-		DeflateData.PushBackReinterpret( NLen );
+	DeflateData.PushBack( static_cast<char>( Len & 0xff ) );
+	DeflateData.PushBack( static_cast<char>( Len >> 8 ) );
+	DeflateData.PushBack( static_cast<char>( NLen & 0xff ) );
+	DeflateData.PushBack( static_cast<char>( NLen >> 8 ) );
 	DeflateData.PushBackArray( PixelBlock );
 	return true;
 }
@@ -2,6 +2,8 @@
 
 
 class SoyPixelsImpl;
+class TStreamBuffer;
+struct mz_stream_s;
 
 
 namespace TPng
@@ -44,6 +46,40 @@ namespace TPng
 			None = 0,
 		};};
 	
+	//	deflate match strategy (maps to zlib's strategies)
+	namespace TStrategy { enum Type
+		{
+			Default,		//	normal lz matching
+			Filtered,		//	favour literals over short matches, suits filtered scanlines
+			Rle,			//	only match runs of the previous byte. fast, good for flat images
+			HuffmanOnly,	//	no matching at all
+		};};
+	
+	//	encoder settings. Filter Invalid chooses the best scanline filter per row
+	class TEncodeParams
+	{
+	public:
+		TEncodeParams(int CompressionLevel=6,TStrategy::Type Strategy=TStrategy::Filtered,TFilterNone_ScanlineFilter::Type Filter=TFilterNone_ScanlineFilter::Invalid) :
+			mCompressionLevel	( CompressionLevel ),
+			mStrategy			( Strategy ),
+			mFilter				( Filter ),
+			mParallel			( true )
+		{
+		}
+		
+		static TEncodeParams	Store()		{	return TEncodeParams( 0, TStrategy::Default, TFilterNone_ScanlineFilter::None );	}	//	uncompressed, as big as the pixels
+		static TEncodeParams	Fast()		{	return TEncodeParams( 1, TStrategy::Rle, TFilterNone_ScanlineFilter::Up );	}
+		static TEncodeParams	Small()		{	return TEncodeParams( 9, TStrategy::Filtered );	}
+		
+		bool				IsAdaptiveFilter() const	{	return mFilter == TFilterNone_ScanlineFilter::Invalid;	}
+		
+	public:
+		int									mCompressionLevel;	//	0 (store) - 9 (smallest)
+		TStrategy::Type						mStrategy;
+		TFilterNone_ScanlineFilter::Type	mFilter;
+		bool								mParallel;			//	filter & deflate strips of rows concurrently when SoyPixelsParallel is enabled. Slightly bigger output
+	};
+	
 	//	gr: integrate this into TSerialisation! no excuse not to. Export/ImportNative() or something
 	//	gr: these are the bits that are needed outside of SoyPixels
 	class THeader
@@ -62,6 +98,53 @@ namespace TPng
 		TInterlace::Type	mInterlace;
 	};
 	
+	namespace TDecodeState { enum Type
+		{
+			Signature,
+			ChunkHeader,
+			ChunkData,
+			ChunkCrc,
+			Finished,
+		};};
+	
+	//	resumable decoder; feed it data as it arrives and rows are inflated, de-filtered and written straight into
+	//	the pixels. Only holds the inflate window and one filtered row, never the whole file.
+	//	Supports what we write; 8 bit greyscale/rgb(a), not interlaced
+	class TStreamDecoder
+	{
+	public:
+		TStreamDecoder(SoyPixelsImpl& Pixels);
+		
+		bool			Decode(TStreamBuffer& Buffer);	//	consumes everything buffered. returns true once the image is complete, throws on bad or truncated data
+		bool			HasHeader() const		{	return mHeader.IsValid();	}
+		bool			IsFinished() const		{	return mState == TDecodeState::Finished;	}
+		size_t			GetRowsDecoded() const	{	return mRowsDecoded;	}
+		
+	private:
+		size_t			Decode(const uint8* Data,size_t DataSize);	//	returns bytes used, anything after IEND is left alone
+		void			OnChunkStart();
+		void			OnChunkData(const uint8* Data,size_t DataSize);
+		void			OnChunkEnd(uint32 Crc);
+		void			OnHeaderChunk();
+		void			Inflate(const uint8* Data,size_t DataSize);
+		void			OnRowInflated();
+		
+	private:
+		SoyPixelsImpl&					mPixels;
+		THeader							mHeader;
+		TDecodeState::Type				mState;
+		Array<uint8>					mField;			//	signature/chunk header/crc being accumulated
+		char							mChunkType[4];
+		size_t							mChunkRemaining;
+		TCrc32							mChunkCrc;
+		Array<char>						mChunkData;		//	only kept for chunks we need whole (header)
+		std::shared_ptr<mz_stream_s>	mInflater;
+		bool							mInflateFinished;
+		Array<uint8>					mRow;			//	filter code + filtered row
+		size_t							mRowFilled;
+		size_t							mRowsDecoded;
+	};
+	
 	void		GetMagic(ArrayBridge<char>&& Magic);
 	bool		CheckMagic(TArrayReader& ArrayReader);
 	bool		CheckMagic(ArrayBridge<char>&& PngData);
@@ -69,7 +152,7 @@ namespace TPng
 	TColour::Type			GetColourType(SoyPixelsFormat::Type Format);
 	SoyPixelsFormat::Type	GetPixelFormatType(TColour::Type Format);
 	
-	bool		GetPngData(Array<char>& PngData,const SoyPixelsImpl& Image,TCompression::Type Compression);
+	bool		GetPngData(Array<char>& PngData,const SoyPixelsImpl& Image,TCompression::Type Compression,const TEncodeParams& Params=TEncodeParams());
 	bool		GetDeflateData(Array<char>& ChunkData,const ArrayBridge<uint8>& PixelBlock,bool LastBlock,int WindowSize);
 	
 	bool		ReadHeader(SoyPixelsImpl& Pixels,THeader& Header,ArrayBridge<char>& Data,std::stringstream& Error);
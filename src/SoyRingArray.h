@@ -3,6 +3,7 @@
 #include "Array.hpp"
 #include "HeapArray.hpp"
 #include "RemoteArray.h"
+#include <atomic>
 
 //	gr: adapt this to
 //	a) have an array interface so we can use it as an arraybridge
@@ -42,6 +43,186 @@ private:
 };
 
 
+//	lock-free ring for exactly one producer thread (Push) and one consumer thread (Pop/Peek). Fixed capacity, Push fails when full
+template<typename TYPE>
+class TSpscRingArray
+{
+public:
+	TSpscRingArray(size_t Capacity) :
+		mHead	( 0 ),
+		mTail	( 0 )
+	{
+		//	one slot is always empty so full and empty can be told apart
+		mBuffer.SetSize( Capacity+1 );
+	}
+	
+	//	producer
+	bool		Push(const TYPE& Element);
+	
+	//	consumer
+	bool		Pop(TYPE& Element);
+	TYPE*		Peek();
+	
+	//	any thread, but only a snapshot
+	size_t		GetSize() const;
+	bool		IsEmpty() const		{	return mHead.load() == mTail.load();	}
+	size_t		GetCapacity() const	{	return mBuffer.GetSize()-1;	}
+
+private:
+	size_t		GetNext(size_t Index) const	{	return (Index+1 >= mBuffer.GetSize()) ? 0 : Index+1;	}
+	
+private:
+	std::atomic<size_t>	mHead;		//	end of used ring (where to push to), only written by the producer
+	std::atomic<size_t>	mTail;		//	start of used ring (where to pop from), only written by the consumer
+	Array<TYPE>			mBuffer;
+};
+
+
+template<typename TYPE>
+inline bool TSpscRingArray<TYPE>::Push(const TYPE& Element)
+{
+	auto Head = mHead.load( std::memory_order_relaxed );
+	auto Next = GetNext( Head );
+	if ( Next == mTail.load( std::memory_order_acquire ) )
+		return false;
+	
+	mBuffer[Head] = Element;
+	mHead.store( Next, std::memory_order_release );
+	return true;
+}
+
+template<typename TYPE>
+inline bool TSpscRingArray<TYPE>::Pop(TYPE& Element)
+{
+	auto Tail = mTail.load( std::memory_order_relaxed );
+	if ( Tail == mHead.load( std::memory_order_acquire ) )
+		return false;
+	
+	//	reset the slot so it doesn't hold on to anything (eg. shared_ptr's) until it's overwritten
+	Element = mBuffer[Tail];
+	mBuffer[Tail] = TYPE();
+	mTail.store( GetNext( Tail ), std::memory_order_release );
+	return true;
+}
+
+template<typename TYPE>
+inline TYPE* TSpscRingArray<TYPE>::Peek()
+{
+	auto Tail = mTail.load( std::memory_order_relaxed );
+	if ( Tail == mHead.load( std::memory_order_acquire ) )
+		return nullptr;
+	return &mBuffer[Tail];
+}
+
+template<typename TYPE>
+inline size_t TSpscRingArray<TYPE>::GetSize() const
+{
+	auto Head = mHead.load( std::memory_order_acquire );
+	auto Tail = mTail.load( std::memory_order_acquire );
+	return (Head >= Tail) ? (Head - Tail) : (mBuffer.GetSize() - Tail + Head);
+}
+
+
+
+//	ring kept sorted by LESS (equal elements stay in the order they were inserted). Not threadsafe.
+//	inserting in (or near) order only moves the few elements after it, popping from the front is O(1) and nothing reallocates once it's grown
+template<typename TYPE,typename LESS>
+class TSortedRingArray
+{
+public:
+	TSortedRingArray(size_t InitialCapacity=8) :
+		mStart	( 0 ),
+		mCount	( 0 ),
+		mBuffer	( std::max<size_t>( InitialCapacity, 1 ) )
+	{
+	}
+	
+	size_t			GetSize() const							{	return mCount;	}
+	bool			IsEmpty() const							{	return mCount == 0;	}
+	TYPE&			operator[](size_t Index)				{	return mBuffer[GetBufferIndex(Index)];	}
+	const TYPE&		operator[](size_t Index) const			{	return mBuffer[GetBufferIndex(Index)];	}
+	
+	void			Insert(const TYPE& Element);
+	void			PopFront(size_t Count=1);
+	void			Clear()									{	PopFront( mCount );	mStart = 0;	}
+	
+private:
+	size_t			GetBufferIndex(size_t Index) const
+	{
+		auto BufferIndex = mStart + Index;
+		return (BufferIndex >= mBuffer.size()) ? BufferIndex - mBuffer.size() : BufferIndex;
+	}
+	void			Grow();
+	
+private:
+	size_t				mStart;		//	buffer index of the first element
+	size_t				mCount;
+	std::vector<TYPE>	mBuffer;
+};
+
+
+template<typename TYPE,typename LESS>
+inline void TSortedRingArray<TYPE,LESS>::Insert(const TYPE& Element)
+{
+	if ( mCount == mBuffer.size() )
+		Grow();
+	
+	LESS Less;
+	
+	//	usual case, belongs at the back
+	auto& Slot = (*this)[mCount];
+	if ( mCount == 0 || !Less( Element, (*this)[mCount-1] ) )
+	{
+		Slot = Element;
+		mCount++;
+		return;
+	}
+	
+	//	find the first element that goes after this one
+	size_t Low = 0;
+	size_t High = mCount;
+	while ( Low < High )
+	{
+		auto Middle = Low + (High-Low)/2;
+		if ( Less( Element, (*this)[Middle] ) )
+			High = Middle;
+		else
+			Low = Middle+1;
+	}
+	
+	//	shuffle everything after it back one
+	for ( auto i=mCount;	i>Low;	i-- )
+		(*this)[i] = std::move( (*this)[i-1] );
+	(*this)[Low] = Element;
+	mCount++;
+}
+
+template<typename TYPE,typename LESS>
+inline void TSortedRingArray<TYPE,LESS>::PopFront(size_t Count)
+{
+	Count = std::min( Count, mCount );
+	
+	//	reset the slots so they don't hold on to anything (eg. shared_ptr's) until they're overwritten
+	for ( size_t i=0;	i<Count;	i++ )
+		(*this)[i] = TYPE();
+	
+	mStart = GetBufferIndex( Count );
+	mCount -= Count;
+}
+
+template<typename TYPE,typename LESS>
+inline void TSortedRingArray<TYPE,LESS>::Grow()
+{
+	std::vector<TYPE> NewBuffer( mBuffer.size() * 2 );
+	for ( size_t i=0;	i<mCount;	i++ )
+		NewBuffer[i] = std::move( (*this)[i] );
+	
+	mBuffer.swap( NewBuffer );
+	mStart = 0;
+}
+
+
+
 template<typename TYPE>
 inline bool RingArray<TYPE>::ResizeBuffer(size_t NewSize)
 {
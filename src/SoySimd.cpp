@@ -0,0 +1,115 @@
+#include "SoySimd.h"
+#include <atomic>
+
+#if defined(SOY_SIMD_SSE2)
+	#if defined(_MSC_VER)
+		#include <intrin.h>
+		#include <immintrin.h>
+	#else
+		#include <cpuid.h>
+	#endif
+#endif
+
+
+std::map<SoySimd::Type,std::string> SoySimd::EnumMap =
+{
+	{ SoySimd::Invalid,	"Invalid"	},
+	{ SoySimd::None,	"None"	},
+	{ SoySimd::Sse2,	"Sse2"	},
+	{ SoySimd::Ssse3,	"Ssse3"	},
+	{ SoySimd::Avx2,	"Avx2"	},
+};
+
+
+namespace SoySimd
+{
+	Type					DetectSupported();
+	std::atomic<int>		gMaxEnabled( Avx2 );
+}
+
+
+#if defined(SOY_SIMD_SSE2)
+static void Cpuid(int Leaf,int Registers[4])
+{
+#if defined(_MSC_VER)
+	__cpuidex( Registers, Leaf, 0 );
+#else
+	unsigned int a=0,b=0,c=0,d=0;
+	__cpuid_count( Leaf, 0, a, b, c, d );
+	Registers[0] = a;
+	Registers[1] = b;
+	Registers[2] = c;
+	Registers[3] = d;
+#endif
+}
+
+//	os has enabled saving of the ymm registers
+static uint64 GetXcr0()
+{
+#if defined(_MSC_VER)
+	return _xgetbv(0);
+#else
+	uint32 Low = 0;
+	uint32 High = 0;
+	__asm__ __volatile__ ( "xgetbv" : "=a"(Low), "=d"(High) : "c"(0) );
+	return (static_cast<uint64>(High) << 32) | Low;
+#endif
+}
+#endif
+
+
+SoySimd::Type SoySimd::DetectSupported()
+{
+#if defined(SOY_SIMD_SSE2)
+	int Registers[4] = {0};
+	Cpuid( 0, Registers );
+	auto MaxLeaf = Registers[0];
+
+	Cpuid( 1, Registers );
+	bool Sse2 = (Registers[3] & (1<<26)) != 0;
+	bool Ssse3 = (Registers[2] & (1<<9)) != 0;
+	bool OsXSave = (Registers[2] & (1<<27)) != 0;
+	bool Avx = (Registers[2] & (1<<28)) != 0;
+	if ( !Sse2 )
+		return None;
+	if ( !Ssse3 )
+		return SoySimd::Sse2;
+
+	if ( MaxLeaf < 7 || !OsXSave || !Avx )
+		return SoySimd::Ssse3;
+
+	//	xmm & ymm state must both be enabled by the os
+	if ( (GetXcr0() & 0x6) != 0x6 )
+		return SoySimd::Ssse3;
+
+	Cpuid( 7, Registers );
+	bool Avx2 = (Registers[1] & (1<<5)) != 0;
+	return Avx2 ? SoySimd::Avx2 : SoySimd::Ssse3;
+#else
+	return None;
+#endif
+}
+
+
+SoySimd::Type SoySimd::GetSupported()
+{
+	static Type Supported = DetectSupported();
+	return Supported;
+}
+
+
+SoySimd::Type SoySimd::GetEnabled()
+{
+	auto Supported = GetSupported();
+	auto Max = static_cast<Type>( gMaxEnabled.load() );
+	return (Max < Supported) ? Max : Supported;
+}
+
+
+void SoySimd::SetMaxEnabled(Type Max)
+{
+	if ( Max == Invalid )
+		Max = None;
+	gMaxEnabled = Max;
+}
+
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "SoyTypes.h"
+#include "SoyEnum.h"
+
+
+//	gr: x86 targets (windows, osx, ps4) can always assume sse2, arm (ios, android) falls back to plain c
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define SOY_SIMD_SSE2
+#endif
+
+//	ssse3 & avx2 code is always compiled in on x86 (regardless of the arch settings of the project)
+//	and only executed if the cpu & os report support at runtime
+#if defined(SOY_SIMD_SSE2)
+	#define SOY_SIMD_SSSE3
+	#define SOY_SIMD_AVX2
+	#if defined(_MSC_VER)
+		#define SOY_SIMD_SSSE3_FUNCTION
+		#define SOY_SIMD_AVX2_FUNCTION
+	#else
+		#define SOY_SIMD_SSSE3_FUNCTION	__attribute__((target("ssse3")))
+		#define SOY_SIMD_AVX2_FUNCTION	__attribute__((target("avx2")))
+	#endif
+#endif
+
+
+namespace SoySimd
+{
+	//	ordered, so a higher value implies support for the lower ones
+	enum Type
+	{
+		Invalid,
+		None,		//	plain c
+		Sse2,
+		Ssse3,		//	pshufb
+		Avx2,
+	};
+
+	Type	GetSupported();				//	best instruction set the cpu (and os) supports, probed once
+	Type	GetEnabled();				//	best instruction set we're allowed to use
+	void	SetMaxEnabled(Type Max);	//	force a lower path, for testing & profiling
+
+	inline bool	IsEnabled(Type InstructionSet)	{	return GetEnabled() >= InstructionSet;	}
+
+	DECLARE_SOYENUM( SoySimd );
+}
+
@@ -3,7 +3,7 @@
 
 TEST(SoyTimeStreamio)
 {
-	SoyTime One(1ull);
+	SoyTime One( std::chrono::milliseconds(1) );
 	
 	std::stringstream String;
 	String << One;
@@ -18,6 +18,10 @@ TEST(SoyTimeStreamio)
 
 #include <SoyPixels.h>
 #include <SoyPng.h>
+#include <SoyImage.h>
+#include <SoySimd.h>
+#include <SoyStream.h>
+#include <SoyTestPattern.h>
 
 TEST(PngTypeTest)
 {
@@ -29,7 +33,7 @@ TEST(PngWriteRead)
 {
 	//	check we can read and write our own PNG's
 	SoyPixels Pixels;
-	CHECK( Pixels.Init( 32, 32, SoyPixelsFormat::RGB ) );
+	Pixels.Init( 32, 32, SoyPixelsFormat::RGB );
 	Array<char> PngData;
 	auto PngDataBridge = GetArrayBridge( PngData );
 	CHECK( Pixels.GetPng( PngDataBridge ) );
@@ -37,4 +41,1322 @@ TEST(PngWriteRead)
 	Png::Read( Pixels, PngDataBridge );
 }
 
+TEST(PngReadFailureKeepsPixels)
+{
+	//	a decode that fails part way mustn't leave the destination wiped or half written
+	SoyPixels Source;
+	Source.Init( 40, 30, SoyPixelsFormat::RGBA );
+	FillTestPattern( Source );
+	Array<char> PngData;
+	CHECK( Source.GetPng( GetArrayBridge(PngData) ) );
+	PngData.SetSize( PngData.GetSize()/2 );
+	
+	SoyPixels Existing;
+	Existing.Init( 7, 5, SoyPixelsFormat::RGB );
+	FillTestPattern( Existing );
+	SoyPixels Original;
+	Original.Copy( Existing );
+	CHECK_THROW( Png::Read( Existing, GetArrayBridge(PngData) ), Soy::AssertException );
+	CHECK( Existing.GetMeta() == Original.GetMeta() );
+	CHECK( memcmp( Existing.GetPixelsArray().GetArray(), Original.GetPixelsArray().GetArray(), Original.GetMeta().GetDataSize() ) == 0 );
+	
+	SoyPixels Empty;
+	CHECK_THROW( Png::Read( Empty, GetArrayBridge(PngData) ), Soy::AssertException );
+	CHECK( !Empty.IsValid() );
+}
+
+TEST(PngCompressionRoundTrip)
+{
+	//	every preset decodes back to the same pixels, and anything that compresses is smaller than storing
+	SoyPixels Pixels;
+	Pixels.Init( 257, 64, SoyPixelsFormat::RGBA );
+	FillTestPattern( Pixels );
+	auto& PixelsArray = Pixels.GetPixelsArray();
+	
+	TPng::TEncodeParams Presets[] = { TPng::TEncodeParams::Store(), TPng::TEncodeParams::Fast(), TPng::TEncodeParams(), TPng::TEncodeParams::Small() };
+	size_t StoreSize = 0;
+	for ( auto& Preset : Presets )
+	{
+		Array<char> PngData;
+		CHECK( Pixels.GetPng( GetArrayBridge(PngData), Preset ) );
+		
+		if ( StoreSize == 0 )
+			StoreSize = PngData.GetDataSize();
+		else
+			CHECK( PngData.GetDataSize() < StoreSize );
+		
+		SoyPixels Decoded;
+		Png::Read( Decoded, GetArrayBridge(PngData) );
+		CHECK( Decoded.GetMeta() == Pixels.GetMeta() );
+		auto& DecodedArray = Decoded.GetPixelsArray();
+		CHECK( DecodedArray.GetDataSize() == PixelsArray.GetDataSize() && memcmp( DecodedArray.GetArray(), PixelsArray.GetArray(), PixelsArray.GetDataSize() ) == 0 );
+	}
+}
+
+TEST(Adler32Combine)
+{
+	//	combining the checksums of any split has to match summing it all in one go, including empty halves and runs longer than the modulo
+	Array<uint8> Data;
+	Data.SetSize( TAdler32::Base + 3*TAdler32::MaxRun + 77 );
+	for ( size_t i=0;	i<Data.GetSize();	i++ )
+		Data[i] = static_cast<uint8>( (i*7919) ^ (i>>3) );
+	
+	TAdler32 Whole;
+	Whole.AddData( Data.GetArray(), Data.GetSize() );
+	
+	size_t Splits[] = { 0, 1, 255, TAdler32::MaxRun, TAdler32::Base, Data.GetSize()-1, Data.GetSize() };
+	for ( auto Split : Splits )
+	{
+		TAdler32 A;
+		A.AddData( Data.GetArray(), Split );
+		TAdler32 B;
+		B.AddData( Data.GetArray() + Split, Data.GetSize() - Split );
+		CHECK( TAdler32::Combine( A.GetAdler32(), B.GetAdler32(), Data.GetSize() - Split ) == Whole.GetAdler32() );
+	}
+}
+
+TEST(PngParallelRoundTrip)
+{
+	//	strips are filtered & deflated on the pool and stitched into one zlib stream with a combined checksum, which has to decode exactly
+	auto OldParams = SoyPixelsParallel::GetParams();
+	TSoyPixelsParallelParams Params;
+	Params.mEnabled = true;
+	Params.mMaxTasks = 7;
+	Params.mMinRowsPerTask = 16;
+	SoyPixelsParallel::SetParams( Params );
+	
+	SoyPixels Pixels;
+	Pixels.Init( 513, 301, SoyPixelsFormat::RGBA );
+	FillTestPattern( Pixels );
+	auto& PixelsArray = Pixels.GetPixelsArray();
+	CHECK( SoyPixelsParallel::GetBandCount( Pixels.GetHeight() ) > 1 );
+	
+	TPng::TEncodeParams Presets[] = { TPng::TEncodeParams::Fast(), TPng::TEncodeParams(), TPng::TEncodeParams::Small() };
+	for ( auto& Preset : Presets )
+	{
+		Array<char> PngData;
+		CHECK( Pixels.GetPng( GetArrayBridge(PngData), Preset ) );
+		
+		SoyPixels Decoded;
+		Png::Read( Decoded, GetArrayBridge(PngData) );
+		CHECK( Decoded.GetMeta() == Pixels.GetMeta() );
+		auto& DecodedArray = Decoded.GetPixelsArray();
+		CHECK( DecodedArray.GetDataSize() == PixelsArray.GetDataSize() && memcmp( DecodedArray.GetArray(), PixelsArray.GetArray(), PixelsArray.GetDataSize() ) == 0 );
+	}
+	SoyPixelsParallel::SetParams( OldParams );
+}
+
+TEST(PngEncodeScanlines)
+{
+	//	every row gets its own filter byte, so thin, tall and single pixel images have to survive framing
+	vec2x<size_t> Sizes[] = { vec2x<size_t>( 1, 1 ), vec2x<size_t>( 3, 2 ), vec2x<size_t>( 1, 300 ), vec2x<size_t>( 300, 1 ), vec2x<size_t>( 131, 97 ) };
+	for ( auto Size : Sizes )
+	{
+		SoyPixels Pixels;
+		Pixels.Init( Size.x, Size.y, SoyPixelsFormat::RGBA );
+		FillTestPattern( Pixels );
+		auto& PixelsArray = Pixels.GetPixelsArray();
+		
+		for ( auto Params : { TPng::TEncodeParams::Store(), TPng::TEncodeParams::Fast() } )
+		{
+			Array<char> PngData;
+			CHECK( Pixels.GetPng( GetArrayBridge(PngData), Params ) );
+			
+			SoyPixels Decoded;
+			Png::Read( Decoded, GetArrayBridge(PngData) );
+			CHECK( Decoded.GetMeta() == Pixels.GetMeta() );
+			auto& DecodedArray = Decoded.GetPixelsArray();
+			CHECK( DecodedArray.GetDataSize() == PixelsArray.GetDataSize() && memcmp( DecodedArray.GetArray(), PixelsArray.GetArray(), PixelsArray.GetDataSize() ) == 0 );
+		}
+	}
+}
+
+
+TEST(PngStreamDecode)
+{
+	//	data arriving in small pieces decodes to the same pixels, and bytes after the png are left for the next reader
+	SoyPixels Pixels;
+	Pixels.Init( 37, 23, SoyPixelsFormat::RGBA );
+	FillTestPattern( Pixels );
+	Array<char> PngData;
+	CHECK( Pixels.GetPng( GetArrayBridge(PngData), TPng::TEncodeParams::Fast() ) );
+	PngData.PushBack('X');
+	
+	SoyPixels Decoded;
+	TPng::TStreamDecoder Decoder( Decoded );
+	TStreamBuffer Buffer;
+	bool Finished = false;
+	for ( size_t Pos=0;	Pos<PngData.GetSize() && !Finished;	Pos+=7 )
+	{
+		auto Piece = GetRemoteArray( PngData.GetArray()+Pos, std::min<size_t>( 7, PngData.GetSize()-Pos ) );
+		Buffer.Push( GetArrayBridge(Piece) );
+		Finished = Decoder.Decode( Buffer );
+	}
+	CHECK( Finished );
+	CHECK( Decoded.GetMeta() == Pixels.GetMeta() );
+	CHECK( memcmp( Decoded.GetPixelsArray().GetArray(), Pixels.GetPixelsArray().GetArray(), Pixels.GetPixelsArray().GetDataSize() ) == 0 );
+	CHECK( Buffer.GetBufferedSize() == 1 );
+}
+
+TEST(PngStreamTruncated)
+{
+	//	a truncated stream waits for more data, until the stream ends, then throws. A bad crc throws straight away
+	SoyPixels Pixels;
+	Pixels.Init( 20, 20, SoyPixelsFormat::RGB );
+	FillTestPattern( Pixels );
+	Array<char> PngData;
+	CHECK( Pixels.GetPng( GetArrayBridge(PngData) ) );
+	
+	SoyPixels Decoded;
+	TPng::TStreamDecoder Decoder( Decoded );
+	TStreamBuffer Buffer;
+	auto Truncated = GetRemoteArray( PngData.GetArray(), PngData.GetSize()-20 );
+	Buffer.Push( GetArrayBridge(Truncated) );
+	CHECK( !Decoder.Decode( Buffer ) );
+	Buffer.PushEof();
+	CHECK_THROW( Decoder.Decode( Buffer ), Soy::AssertException );
+	
+	PngData[40] ^= 1;
+	SoyPixels Corrupt;
+	TPng::TStreamDecoder CorruptDecoder( Corrupt );
+	TStreamBuffer CorruptBuffer;
+	CorruptBuffer.Push( GetArrayBridge(PngData) );
+	CHECK_THROW( CorruptDecoder.Decode( CorruptBuffer ), Soy::AssertException );
+}
+
+
+TEST(YuvOddSizes)
+{
+	//	odd sizes re-use the last chroma sample. 1 pixel wide/high images have no chroma plane so should throw rather than read past it
+	vec2x<size_t> Sizes[] = { vec2x<size_t>( 2, 2 ), vec2x<size_t>( 3, 3 ), vec2x<size_t>( 9, 7 ), vec2x<size_t>( 33, 5 ) };
+	vec2x<size_t> NoChromaSizes[] = { vec2x<size_t>( 1, 1 ), vec2x<size_t>( 8, 1 ), vec2x<size_t>( 1, 8 ) };
+	SoyPixelsFormat::Type Formats[] = { SoyPixelsFormat::Yuv_8_88_Full, SoyPixelsFormat::Yuv_8_8_8_Full, SoyPixelsFormat::Yuv_8_88_Ntsc };
+	for ( auto Format : Formats )
+	{
+		for ( auto Size : Sizes )
+		{
+			SoyPixels Yuv;
+			Yuv.Init( SoyPixelsMeta( Size.x, Size.y, Format ) );
+			auto& YuvArray = Yuv.GetPixelsArray();
+			for ( size_t i=0;	i<YuvArray.GetSize();	i++ )
+				YuvArray[i] = 128;
+			
+			SoyPixels Rgb;
+			Rgb.Init( Size.x, Size.y, SoyPixelsFormat::RGB );
+			SoyPixelsImpl::Convert( Yuv, Rgb );
+			auto& RgbArray = Rgb.GetPixelsArray();
+			for ( size_t i=0;	i<RgbArray.GetSize();	i++ )
+				CHECK( RgbArray[i] == RgbArray[0] );
+		}
+		
+		for ( auto Size : NoChromaSizes )
+		{
+			SoyPixels Yuv;
+			Yuv.Init( SoyPixelsMeta( Size.x, Size.y, Format ) );
+			SoyPixels Rgb;
+			Rgb.Init( Size.x, Size.y, SoyPixelsFormat::RGB );
+			CHECK_THROW( SoyPixelsImpl::Convert( Yuv, Rgb ), Soy::AssertException );
+		}
+	}
+}
+
+
+TEST(RgbFamilyConversionsExact)
+{
+	//	swizzles and adding/dropping alpha must keep every channel, never going via greyscale or yuv
+	SoyPixelsFormat::Type Formats[] = { SoyPixelsFormat::RGB, SoyPixelsFormat::BGR, SoyPixelsFormat::RGBA, SoyPixelsFormat::BGRA, SoyPixelsFormat::ARGB };
+	const char* ChannelNames[] = { "rgb", "bgr", "rgba", "bgra", "argb" };
+	for ( size_t s=0;	s<sizeofarray(Formats);	s++ )
+	{
+		SoyPixels Src;
+		Src.Init( 37, 5, Formats[s] );
+		FillTestPattern( Src );
+		auto& SrcArray = Src.GetPixelsArray();
+		auto SrcChannels = Src.GetChannels();
+		
+		for ( size_t d=0;	d<sizeofarray(Formats);	d++ )
+		{
+			if ( s == d )
+				continue;
+			
+			SoyPixels Converted;
+			Converted.Init( 37, 5, Formats[d] );
+			SoyPixelsImpl::Convert( Src, Converted );
+			
+			SoyPixels InPlace;
+			InPlace.Copy( Src );
+			InPlace.SetFormat( Formats[d] );
+			CHECK( InPlace.GetFormat() == Formats[d] );
+			
+			auto& ConvertedArray = Converted.GetPixelsArray();
+			auto& InPlaceArray = InPlace.GetPixelsArray();
+			auto DstChannels = Converted.GetChannels();
+			CHECK( InPlaceArray.GetSize() == ConvertedArray.GetSize() );
+			for ( size_t p=0;	p<37*5;	p++ )
+			{
+				for ( size_t c=0;	c<DstChannels;	c++ )
+				{
+					auto* SrcChannel = strchr( ChannelNames[s], ChannelNames[d][c] );
+					uint8 Expected = SrcChannel ? SrcArray[(p*SrcChannels) + (SrcChannel-ChannelNames[s])] : 255;
+					CHECK_EQUAL( Expected, ConvertedArray[(p*DstChannels)+c] );
+					CHECK_EQUAL( Expected, InPlaceArray[(p*DstChannels)+c] );
+				}
+			}
+		}
+	}
+}
+
+
+TEST(ResizeExact)
+{
+	//	nearest picks the source pixel under each destination pixel's center, so odd sizes map 5->3 as 0,2,4 and 3->5 as 0,0,1,2,2
+	SoyPixels Src;
+	Src.Init( 5, 3, SoyPixelsFormat::RGB );
+	for ( size_t y=0;	y<Src.GetHeight();	y++ )
+		for ( size_t x=0;	x<Src.GetWidth();	x++ )
+			for ( size_t c=0;	c<3;	c++ )
+				Src.SetPixel( x, y, c, static_cast<uint8>( (y*16) + (x*2) + (c*100) ) );
+	
+	SoyPixels Nearest;
+	Nearest.Init( 3, 5, SoyPixelsFormat::RGB );
+	SoyPixelsImpl::Resize( Src, Nearest, SoyPixelsResizeFilter::Nearest );
+	size_t NearestX[] = { 0, 2, 4 };
+	size_t NearestY[] = { 0, 0, 1, 2, 2 };
+	for ( size_t y=0;	y<Nearest.GetHeight();	y++ )
+		for ( size_t x=0;	x<Nearest.GetWidth();	x++ )
+			for ( size_t c=0;	c<3;	c++ )
+				CHECK_EQUAL( Src.GetPixel( NearestX[x], NearestY[y], c ), Nearest.GetPixel( x, y, c ) );
+	
+	//	doubling with bilinear blends each source pixel 3/4 with 1/4 of its neighbour, clamped at the edges. multiples of 16 keep every blend exact
+	uint8 Grey[] = {	0,		64,		192,
+						128,	0,		64	};
+	SoyPixels GreySrc;
+	GreySrc.Init( 3, 2, SoyPixelsFormat::Greyscale );
+	for ( size_t i=0;	i<sizeofarray(Grey);	i++ )
+		GreySrc.GetPixelsArray()[i] = Grey[i];
+	
+	auto GetDoubled = [](size_t d,size_t SrcSize,size_t& Near,size_t& Far)
+	{
+		//	returns the 3/4 sample and the 1/4 sample
+		Near = d / 2;
+		auto Neighbour = static_cast<int>(Near) + ( ( d % 2 ) ? 1 : -1 );
+		Far = std::min<int>( std::max<int>( Neighbour, 0 ), static_cast<int>(SrcSize)-1 );
+	};
+	
+	SoyPixels Bilinear;
+	Bilinear.Init( 6, 4, SoyPixelsFormat::Greyscale );
+	SoyPixelsImpl::Resize( GreySrc, Bilinear, SoyPixelsResizeFilter::Bilinear );
+	for ( size_t y=0;	y<Bilinear.GetHeight();	y++ )
+	{
+		size_t NearY,FarY;
+		GetDoubled( y, GreySrc.GetHeight(), NearY, FarY );
+		for ( size_t x=0;	x<Bilinear.GetWidth();	x++ )
+		{
+			size_t NearX,FarX;
+			GetDoubled( x, GreySrc.GetWidth(), NearX, FarX );
+			auto Sample = [&](size_t sx,size_t sy)	{	return static_cast<int>( GreySrc.GetPixel( sx, sy, 0 ) );	};
+			auto Expected = ( 9*Sample(NearX,NearY) + 3*Sample(FarX,NearY) + 3*Sample(NearX,FarY) + Sample(FarX,FarY) ) / 16;
+			CHECK_EQUAL( Expected, static_cast<int>( Bilinear.GetPixel( x, y, 0 ) ) );
+		}
+	}
+	
+	//	same size is a straight copy whatever the filter
+	SoyPixels Same;
+	Same.Init( 5, 3, SoyPixelsFormat::RGB );
+	SoyPixelsImpl::Resize( Src, Same, SoyPixelsResizeFilter::Bilinear );
+	CHECK( memcmp( Same.GetPixelsArray().GetArray(), Src.GetPixelsArray().GetArray(), Src.GetPixelsArray().GetDataSize() ) == 0 );
+}
+
+
+TEST(TransformExact)
+{
+	SoyPixels Src;
+	Src.Init( 7, 5, SoyPixelsFormat::RGB );
+	for ( size_t y=0;	y<Src.GetHeight();	y++ )
+		for ( size_t x=0;	x<Src.GetWidth();	x++ )
+			for ( size_t c=0;	c<3;	c++ )
+				Src.SetPixel( x, y, c, static_cast<uint8>( (y*16) + (x*2) + (c*100) ) );
+	
+	//	odd crop, flipped, swizzled to bgr
+	TPixelsTransform CropFlip;
+	CropFlip.mSourceRect = Soy::Rectx<size_t>( 1, 2, 5, 3 );
+	CropFlip.mFlip = true;
+	CropFlip.mFormat = SoyPixelsFormat::BGR;
+	SoyPixels Cropped;
+	SoyPixelsImpl::Transform( Src, Cropped, CropFlip );
+	CHECK( Cropped.GetMeta() == SoyPixelsMeta( 5, 3, SoyPixelsFormat::BGR ) );
+	for ( size_t y=0;	y<Cropped.GetHeight();	y++ )
+		for ( size_t x=0;	x<Cropped.GetWidth();	x++ )
+			for ( size_t c=0;	c<3;	c++ )
+				CHECK_EQUAL( Src.GetPixel( 1+x, 2+(2-y), 2-c ), Cropped.GetPixel( x, y, c ) );
+	
+	//	crop and scale with nearest, to an existing padded destination which must keep its pitch
+	TPixelsTransform CropScale;
+	CropScale.mSourceRect = Soy::Rectx<size_t>( 2, 1, 5, 3 );
+	CropScale.mWidth = 3;
+	CropScale.mHeight = 5;
+	CropScale.mFilter = SoyPixelsResizeFilter::Nearest;
+	CropScale.mAllowRealloc = false;
+	SoyPixels Scaled;
+	Scaled.Init( SoyPixelsMeta( 3, 5, SoyPixelsFormat::RGB, 3*3+5 ) );
+	SoyPixelsImpl::Transform( Src, Scaled, CropScale );
+	CHECK_EQUAL( 3*3+5, Scaled.GetMeta().GetRowPitch() );
+	size_t NearestX[] = { 0, 2, 4 };
+	size_t NearestY[] = { 0, 0, 1, 2, 2 };
+	for ( size_t y=0;	y<Scaled.GetHeight();	y++ )
+		for ( size_t x=0;	x<Scaled.GetWidth();	x++ )
+			for ( size_t c=0;	c<3;	c++ )
+				CHECK_EQUAL( Src.GetPixel( 2+NearestX[x], 1+NearestY[y], c ), Scaled.GetPixel( x, y, c ) );
+	
+	//	a crop outside the source, or a destination that needs reallocating, throws
+	TPixelsTransform Outside;
+	Outside.mSourceRect = Soy::Rectx<size_t>( 3, 0, 5, 5 );
+	SoyPixels OutsideDst;
+	CHECK_THROW( SoyPixelsImpl::Transform( Src, OutsideDst, Outside ), Soy::AssertException );
+	
+	TPixelsTransform NoRealloc;
+	NoRealloc.mAllowRealloc = false;
+	SoyPixels WrongSize;
+	WrongSize.Init( 3, 3, SoyPixelsFormat::RGB );
+	CHECK_THROW( SoyPixelsImpl::Transform( Src, WrongSize, NoRealloc ), Soy::AssertException );
+}
+
+
+TEST(PixelsPlanesLayout)
+{
+	//	planes point straight into the parent's data, packed or with every plane's rows padded in proportion to the luma pitch
+	struct TPlaneLayout
+	{
+		SoyPixelsFormat::Type	mFormat;
+		size_t					mWidth;
+		size_t					mHeight;
+		size_t					mRowPitch;
+		size_t					mOffset;
+	};
+	struct TLayout
+	{
+		SoyPixelsMeta			mMeta;
+		size_t					mPlaneCount;
+		TPlaneLayout			mPlanes[3];
+	};
+	TLayout Layouts[] =
+	{
+		{	SoyPixelsMeta( 10, 6, SoyPixelsFormat::Yuv_8_8_8_Full ),		3,	{	{ SoyPixelsFormat::Luma_Full, 10, 6, 10, 0 },	{ SoyPixelsFormat::ChromaU_8, 5, 3, 5, 60 },	{ SoyPixelsFormat::ChromaV_8, 5, 3, 5, 75 }	}	},
+		{	SoyPixelsMeta( 10, 6, SoyPixelsFormat::Yuv_8_8_8_Full, 16 ),	3,	{	{ SoyPixelsFormat::Luma_Full, 10, 6, 16, 0 },	{ SoyPixelsFormat::ChromaU_8, 5, 3, 8, 96 },	{ SoyPixelsFormat::ChromaV_8, 5, 3, 8, 120 }	}	},
+		{	SoyPixelsMeta( 10, 6, SoyPixelsFormat::Yuv_8_88_Full ),			2,	{	{ SoyPixelsFormat::Luma_Full, 10, 6, 10, 0 },	{ SoyPixelsFormat::ChromaUV_88, 5, 3, 10, 60 }	}	},
+		{	SoyPixelsMeta( 10, 6, SoyPixelsFormat::Yuv_8_88_Full, 16 ),		2,	{	{ SoyPixelsFormat::Luma_Full, 10, 6, 16, 0 },	{ SoyPixelsFormat::ChromaUV_88, 5, 3, 16, 96 }	}	},
+	};
+	
+	for ( auto& Layout : Layouts )
+	{
+		SoyPixels Pixels;
+		Pixels.Init( Layout.mMeta );
+		SoyPixelsPlanes Planes( Pixels );
+		CHECK_EQUAL( Layout.mPlaneCount, Planes.GetPlaneCount() );
+		if ( Planes.GetPlaneCount() != Layout.mPlaneCount )
+			continue;
+		
+		auto* ParentData = Pixels.GetPixelsArray().GetArray();
+		for ( size_t p=0;	p<Planes.GetPlaneCount();	p++ )
+		{
+			auto& Expected = Layout.mPlanes[p];
+			auto& Plane = Planes[p];
+			CHECK( Plane.GetFormat() == Expected.mFormat );
+			CHECK_EQUAL( Expected.mWidth, Plane.GetWidth() );
+			CHECK_EQUAL( Expected.mHeight, Plane.GetHeight() );
+			CHECK_EQUAL( Expected.mRowPitch, Planes.GetPlaneRowPitch(p) );
+			CHECK_EQUAL( Expected.mOffset, Planes.GetPlaneOffset(p) );
+			CHECK( Plane.GetPixelsArray().GetArray() == ParentData + Expected.mOffset );
+			CHECK_EQUAL( Expected.mRowPitch * Expected.mHeight, Plane.GetPixelsArray().GetDataSize() );
+			
+			//	writing the last pixel of a plane lands in the parent
+			auto LastX = Expected.mWidth-1;
+			auto LastY = Expected.mHeight-1;
+			Plane.SetPixel( LastX, LastY, 0, static_cast<uint8>( 200 + p ) );
+			CHECK_EQUAL( 200 + p, ParentData[Expected.mOffset + (LastY*Expected.mRowPitch) + (LastX*Plane.GetChannels())] );
+		}
+		
+		auto& LastPlane = Layout.mPlanes[Layout.mPlaneCount-1];
+		CHECK_EQUAL( LastPlane.mOffset + (LastPlane.mRowPitch*LastPlane.mHeight), Pixels.GetPixelsArray().GetDataSize() );
+		CHECK_THROW( Planes.GetPlane( Layout.mPlaneCount ), Soy::AssertException );
+	}
+}
+
+
+static bool IsSamePackedPixels(const SoyPixelsImpl& a,const SoyPixelsImpl& b)
+{
+	SoyPixels PackedA;
+	PackedA.Copy( a );
+	PackedA.Pack();
+	SoyPixels PackedB;
+	PackedB.Copy( b );
+	PackedB.Pack();
+	if ( !( PackedA.GetMeta() == PackedB.GetMeta() ) )
+		return false;
+	return memcmp( PackedA.GetPixelsArray().GetArray(), PackedB.GetPixelsArray().GetArray(), PackedA.GetMeta().GetDataSize() ) == 0;
+}
+
+
+TEST(PitchConversions)
+{
+	//	converting padded rows, into a destination with different padding, must match converting the packed pixels, and leave the destination's padding alone
+	SoyPixelsFormat::Type Formats[] = { SoyPixelsFormat::Greyscale, SoyPixelsFormat::RGB, SoyPixelsFormat::RGBA, SoyPixelsFormat::BGRA, SoyPixelsFormat::Nv12, SoyPixelsFormat::I420 };
+	const uint8 PaddingValue = 0xcd;
+	for ( auto SrcFormat : Formats )
+	{
+		SoyPixels Packed;
+		Packed.Init( SoyPixelsMeta( 30, 20, SrcFormat ) );
+		//	planar formats have no channel count, so fill bytes
+		auto& PackedArray = Packed.GetPixelsArray();
+		for ( size_t i=0;	i<PackedArray.GetSize();	i++ )
+			PackedArray[i] = static_cast<uint8>( (i*37) + (i/7) );
+		
+		SoyPixels Padded;
+		Padded.Init( SoyPixelsMeta( 30, 20, SrcFormat, 128 ) );
+		Padded.GetPixelsArray().SetAll( PaddingValue );
+		SoyPixelsImpl::Convert( Packed, Padded );
+		CHECK_EQUAL( 128, Padded.GetMeta().GetRowPitch() );
+		CHECK( IsSamePackedPixels( Packed, Padded ) );
+		
+		for ( auto DstFormat : Formats )
+		{
+			SoyPixels Expected;
+			Expected.Init( SoyPixelsMeta( 30, 20, DstFormat ) );
+			SoyPixelsImpl::Convert( Packed, Expected );
+			
+			SoyPixels PaddedToPacked;
+			PaddedToPacked.Init( SoyPixelsMeta( 30, 20, DstFormat ) );
+			SoyPixelsImpl::Convert( Padded, PaddedToPacked );
+			CHECK( PaddedToPacked.GetMeta().IsPacked() );
+			CHECK( IsSamePackedPixels( Expected, PaddedToPacked ) );
+			
+			SoyPixels PaddedToPadded;
+			PaddedToPadded.Init( SoyPixelsMeta( 30, 20, DstFormat, 160 ) );
+			PaddedToPadded.GetPixelsArray().SetAll( PaddingValue );
+			SoyPixelsImpl::Convert( Padded, PaddedToPadded );
+			CHECK_EQUAL( 160, PaddedToPadded.GetMeta().GetRowPitch() );
+			CHECK( IsSamePackedPixels( Expected, PaddedToPadded ) );
+			
+			SoyPixelsPlanes Planes( PaddedToPadded );
+			for ( size_t p=0;	p<Planes.GetPlaneCount();	p++ )
+			{
+				auto& PlaneMeta = Planes[p].GetMeta();
+				auto* PlaneData = Planes[p].GetPixelsArray().GetArray();
+				for ( size_t y=0;	y<PlaneMeta.GetHeight();	y++ )
+					for ( auto x=PlaneMeta.GetRowDataSize();	x<PlaneMeta.GetRowPitch();	x++ )
+						CHECK_EQUAL( PaddingValue, PlaneData[(y*PlaneMeta.GetRowPitch())+x] );
+			}
+		}
+	}
+}
+
+
+TEST(RawSoyPixelsHeader)
+{
+	//	raw header keeps the pre-row-pitch meta layout, and padded rows are packed on the way out
+	struct TLegacyMeta
+	{
+		SoyPixelsFormat::Type	mFormat;
+		size_t					mWidth;
+		size_t					mHeight;
+	};
+	
+	const size_t Width = 5;
+	const size_t Height = 3;
+	const size_t RowPitch = 24;
+	uint8 PaddedData[RowPitch*Height];
+	for ( size_t i=0;	i<sizeofarray(PaddedData);	i++ )
+		PaddedData[i] = static_cast<uint8>( i );
+	SoyPixelsRemote Padded( PaddedData, Width, Height, sizeof(PaddedData), SoyPixelsFormat::RGB, RowPitch );
+	
+	Array<char> RawData;
+	CHECK( Padded.GetRawSoyPixels( GetArrayBridge(RawData) ) );
+	CHECK_EQUAL( sizeof(TLegacyMeta) + (Width*3*Height), RawData.GetDataSize() );
+	auto& Header = *reinterpret_cast<const TLegacyMeta*>( RawData.GetArray() );
+	CHECK( Header.mFormat == SoyPixelsFormat::RGB );
+	CHECK_EQUAL( Width, Header.mWidth );
+	CHECK_EQUAL( Height, Header.mHeight );
+	
+	SoyPixels Read;
+	CHECK( Read.SetRawSoyPixels( GetArrayBridge(RawData) ) );
+	CHECK( Read.GetMeta() == SoyPixelsMeta( Width, Height, SoyPixelsFormat::RGB ) );
+	for ( size_t y=0;	y<Height;	y++ )
+		CHECK( memcmp( &Read.GetPixelsArray()[y*Width*3], &PaddedData[y*RowPitch], Width*3 ) == 0 );
+}
+
+
+TEST(ParallelManyBands)
+{
+	//	far more bands than pool threads, so bands queue up and finish while we're waiting on them.
+	//	the results have to match converting on one thread, and we can't return while a band still references our stack
+	SoyPixels Src;
+	Src.Init( 61, 64, SoyPixelsFormat::RGBA );
+	FillTestPattern( Src );
+	SoyPixels Serial;
+	Serial.Init( 61, 64, SoyPixelsFormat::Yuv_8_88_Full );
+	SoyPixelsImpl::Convert( Src, Serial );
+	
+	auto OldParams = SoyPixelsParallel::GetParams();
+	TSoyPixelsParallelParams Params;
+	Params.mEnabled = true;
+	Params.mMaxTasks = 32;
+	Params.mMinRowsPerTask = 1;
+	SoyPixelsParallel::SetParams( Params );
+	
+	for ( size_t i=0;	i<200;	i++ )
+	{
+		SoyPixels Parallel;
+		Parallel.Init( 61, 64, SoyPixelsFormat::Yuv_8_88_Full );
+		SoyPixelsImpl::Convert( Src, Parallel );
+		CHECK( memcmp( Parallel.GetPixelsArray().GetArray(), Serial.GetPixelsArray().GetArray(), Serial.GetPixelsArray().GetDataSize() ) == 0 );
+	}
+	SoyPixelsParallel::SetParams( OldParams );
+}
+
+
+TEST(SimdMatchesPlain)
+{
+	//	every vector path has to give the same bytes as plain c, including the leftover pixels after the last full vector
+	using namespace SoyPixelsFormat;
+	std::pair<SoyPixelsFormat::Type,SoyPixelsFormat::Type> Conversions[] =
+	{
+		{ Yuv_8_88_Full, RGB },		{ Yuv_8_88_Ntsc, RGBA },	{ Yuv_8_8_8_Full, BGRA },	{ YYuv_8888_Full, RGB },	{ uyvy, RGBA },
+		{ RGB, Yuv_8_88_Full },		{ RGBA, Yuv_8_88_Ntsc },	{ BGRA, Yuv_8_8_8_Full },
+		{ RGBA, BGRA },				{ RGB, BGR },				{ RGBA, RGB },				{ RGB, RGBA },
+		{ RGB, Float3 },			{ Float4, RGBA },			{ Float3, Half3 },			{ Half4, Float4 },
+	};
+	size_t Widths[] = { 2, 3, 7, 15, 16, 17, 31, 32, 33, 63, 64, 65, 100 };
+	
+	auto Supported = SoySimd::GetSupported();
+	for ( auto& Conversion : Conversions )
+	{
+		for ( auto Width : Widths )
+		{
+			SoyPixels Src;
+			Src.Init( SoyPixelsMeta( Width, 4, Conversion.first ) );
+			auto& SrcArray = Src.GetPixelsArray();
+			for ( size_t i=0;	i<SrcArray.GetSize();	i++ )
+				SrcArray[i] = static_cast<uint8>( (i*7919) >> 3 );
+			//	keep float & half sources to sensible values
+			if ( Conversion.first == Float4 || Conversion.first == Float3 )
+			{
+				auto* Floats = reinterpret_cast<float*>( SrcArray.GetArray() );
+				for ( size_t i=0;	i<SrcArray.GetDataSize()/sizeof(float);	i++ )
+					Floats[i] = ( (i*31) % 300 ) / 256.f - 0.1f;
+			}
+			if ( Conversion.first == Half4 )
+			{
+				auto* Halfs = reinterpret_cast<uint16*>( SrcArray.GetArray() );
+				for ( size_t i=0;	i<SrcArray.GetDataSize()/sizeof(uint16);	i++ )
+					Halfs[i] = static_cast<uint16>( 0x3000 + (i*37) % 0x1000 );
+			}
+			
+			SoyPixels Plain;
+			Plain.Init( SoyPixelsMeta( Width, 4, Conversion.second ) );
+			SoySimd::SetMaxEnabled( SoySimd::None );
+			SoyPixelsImpl::Convert( Src, Plain );
+			auto& PlainArray = Plain.GetPixelsArray();
+			
+			for ( auto Simd=SoySimd::Sse2;	Simd<=Supported;	Simd=static_cast<SoySimd::Type>(Simd+1) )
+			{
+				SoyPixels Vector;
+				Vector.Init( SoyPixelsMeta( Width, 4, Conversion.second ) );
+				SoySimd::SetMaxEnabled( Simd );
+				SoyPixelsImpl::Convert( Src, Vector );
+				auto& VectorArray = Vector.GetPixelsArray();
+				bool Match = memcmp( VectorArray.GetArray(), PlainArray.GetArray(), PlainArray.GetDataSize() ) == 0;
+				if ( !Match )
+					std::Debug << Conversion.first << "->" << Conversion.second << " width " << Width << " differs with " << Simd << std::endl;
+				CHECK( Match );
+			}
+		}
+	}
+	
+	//	flip is done in the copy
+	for ( auto Width : Widths )
+	{
+		SoyPixels Src;
+		Src.Init( Width, 5, RGBA );
+		FillTestPattern( Src );
+		TSoyPixelsCopyParams FlipParams;
+		FlipParams.mFlipDestination = true;
+		
+		SoyPixels Plain;
+		SoySimd::SetMaxEnabled( SoySimd::None );
+		Plain.Copy( Src, FlipParams );
+		SoyPixels Vector;
+		SoySimd::SetMaxEnabled( Supported );
+		Vector.Copy( Src, FlipParams );
+		CHECK( memcmp( Vector.GetPixelsArray().GetArray(), Plain.GetPixelsArray().GetArray(), Plain.GetPixelsArray().GetDataSize() ) == 0 );
+	}
+	SoySimd::SetMaxEnabled( Supported );
+}
+
+
+TEST(PaletteRoundTrip)
+{
+	//	no more colours than palette entries should come back exactly, alpha included,
+	//	even when the colours are only 1 apart
+	auto RoundTrip = [](size_t ColourCount)
+	{
+		SoyPixels Pixels;
+		Pixels.Init( 64, 64, SoyPixelsFormat::RGBA );
+		auto& PixelsArray = Pixels.GetPixelsArray();
+		for ( size_t p=0;	p<64*64;	p++ )
+		{
+			auto Colour = (p*7) % ColourCount;
+			PixelsArray[p*4+0] = static_cast<uint8>( 13 + Colour/2 );
+			PixelsArray[p*4+1] = static_cast<uint8>( 201 - Colour%2 );
+			PixelsArray[p*4+2] = static_cast<uint8>( 77 );
+			PixelsArray[p*4+3] = static_cast<uint8>( Colour );
+		}
+		
+		SoyPixels Palettised;
+		SoyPixelsFormat::Quantise( Palettised, Pixels, ColourCount );
+		CHECK( Palettised.GetFormat() == SoyPixelsFormat::Palettised_RGBA_8 );
+		
+		SoyPixels Expanded;
+		Expanded.Init( 64, 64, SoyPixelsFormat::RGBA );
+		SoyPixelsImpl::Convert( Palettised, Expanded );
+		CHECK( memcmp( PixelsArray.GetArray(), Expanded.GetPixelsArray().GetArray(), PixelsArray.GetDataSize() ) == 0 );
+	};
+	RoundTrip( 1 );
+	RoundTrip( 2 );
+	RoundTrip( 256 );
+	
+	//	too many colours, each palette entry is the average of the real colours mapped to it, so error stays small
+	SoyPixels Pixels;
+	Pixels.Init( 64, 64, SoyPixelsFormat::RGBA );
+	FillTestPattern( Pixels );
+	SoyPixels Palettised;
+	SoyPixelsFormat::Quantise( Palettised, Pixels, 16 );
+	SoyPixels Expanded;
+	Expanded.Init( 64, 64, SoyPixelsFormat::RGBA );
+	SoyPixelsImpl::Convert( Palettised, Expanded );
+	auto& PixelsArray = Pixels.GetPixelsArray();
+	auto& ExpandedArray = Expanded.GetPixelsArray();
+	uint64 TotalError = 0;
+	for ( size_t i=0;	i<PixelsArray.GetSize();	i++ )
+		TotalError += std::abs( PixelsArray[i] - ExpandedArray[i] );
+	CHECK( TotalError / PixelsArray.GetSize() <= 8 );
+}
+
+TEST(FloatPixelsRoundTrip)
+{
+	//	bytes survive going through normalised floats and halfs
+	SoyPixels Pixels;
+	Pixels.Init( 33, 9, SoyPixelsFormat::RGB );
+	auto& PixelsArray = Pixels.GetPixelsArray();
+	for ( size_t i=0;	i<PixelsArray.GetSize();	i++ )
+		PixelsArray[i] = static_cast<uint8>( i*7 );
+	
+	float Mean[4] = { 0.485f, 0.456f, 0.406f, 0 };
+	float StdDev[4] = { 0.229f, 0.224f, 0.225f, 1 };
+	auto Params = TSoyPixelsFloatParams::GetNormalised( Mean, StdDev );
+	
+	SoyPixels Floats;
+	Floats.Init( 33, 9, SoyPixelsFormat::Float3 );
+	SoyPixelsImpl::Convert( Pixels, Floats, Params );
+	auto* FloatData = reinterpret_cast<const float*>( Floats.GetPixelsArray().GetArray() );
+	CHECK_CLOSE( ( (PixelsArray[1]/255.0f) - Mean[1] ) / StdDev[1], FloatData[1], 0.0001f );
+	
+	SoyPixels Halfs;
+	Halfs.Init( 33, 9, SoyPixelsFormat::Half3 );
+	SoyPixelsImpl::Convert( Floats, Halfs );
+	
+	SoyPixels Bytes;
+	Bytes.Init( 33, 9, SoyPixelsFormat::RGB );
+	SoyPixelsImpl::Convert( Floats, Bytes, Params );
+	CHECK( memcmp( Bytes.GetPixelsArray().GetArray(), PixelsArray.GetArray(), PixelsArray.GetDataSize() ) == 0 );
+	
+	SoyPixels HalfBytes;
+	HalfBytes.Init( 33, 9, SoyPixelsFormat::RGB );
+	SoyPixelsImpl::Convert( Halfs, HalfBytes, Params );
+	auto& HalfBytesArray = HalfBytes.GetPixelsArray();
+	for ( size_t i=0;	i<PixelsArray.GetSize();	i++ )
+		CHECK( std::abs( PixelsArray[i] - HalfBytesArray[i] ) <= 1 );
+}
+
+#include <SoyMedia.h>
+
+TEST(PixelBufferManagerReorders)
+{
+	//	frames arrive in decode order (IPBB -> 1,4,2,3) and have to come out in presentation order, however deep the buffer
+	std::shared_ptr<TPixelBuffer> Pixels( new TDumbPixelBuffer() );
+	auto NoBlock = []	{	return false;	};
+	size_t FrameCount = 2000;
+	size_t Depths[] = { 1, 8, 512 };
+	for ( auto Depth : Depths )
+	{
+		TPixelBufferParams Params;
+		Params.mMaxBufferSize = Depth + 4;
+		Params.mMinBufferSize = 0;
+		Params.mAllowPushRejection = false;
+		TPixelBufferManager Frames( Params );
+		
+		size_t Popped = 0;
+		for ( size_t i=0;	i<FrameCount;	i++ )
+		{
+			size_t Reorder[] = { 0, 3, 1, 2 };
+			TPixelBufferFrame Frame;
+			Frame.mPixels = Pixels;
+			Frame.mTimestamp.mTime = 1 + (i/4)*4 + Reorder[i%4];
+			CHECK( Frames.PushPixelBuffer( Frame, NoBlock ) );
+			if ( i < Depth+3 )
+				continue;
+			
+			SoyTime Timestamp( std::chrono::milliseconds( Popped + 1 ) );
+			CHECK( Frames.PopPixelBuffer( Timestamp ) != nullptr );
+			Popped++;
+			CHECK( Timestamp.GetTime() == Popped );
+		}
+		CHECK( Popped == FrameCount - (Depth+3) );
+	}
+}
+
+TEST(MediaPacketPoolRecycles)
+{
+	//	a released packet comes back reset, but keeps its data allocation
+	TMediaPacketPool Pool;
+	const uint8* Data = nullptr;
+	{
+		auto Packet = Pool.Alloc();
+		Packet->mData.SetSize( 64*1024 );
+		Packet->mIsKeyFrame = true;
+		Packet->mTimecode.mTime = 100;
+		Data = Packet->mData.GetArray();
+	}
+	
+	auto Packet = Pool.Alloc();
+	CHECK( Packet->mData.IsEmpty() );
+	CHECK( !Packet->mIsKeyFrame );
+	CHECK( !Packet->mTimecode.IsValid() );
+	Packet->mData.SetSize( 32*1024 );
+	CHECK( Packet->mData.GetArray() == Data );
+}
+
+TEST(PixelBufferPoolRecycles)
+{
+	//	a dropped frame's storage is handed back out for the same meta, but not for a different one
+	TPixelBufferPool Pool;
+	SoyPixelsMeta Meta( 640, 480, SoyPixelsFormat::RGBA );
+	const uint8* Data = nullptr;
+	{
+		auto Buffer = Pool.Alloc( Meta );
+		Data = Buffer->mPixels.GetPixelsArray().GetArray();
+	}
+	
+	auto Other = Pool.Alloc( SoyPixelsMeta( 320, 240, SoyPixelsFormat::RGBA ) );
+	CHECK( Other->mPixels.GetPixelsArray().GetArray() != Data );
+	auto Buffer = Pool.Alloc( Meta );
+	CHECK( Buffer->mPixels.GetMeta() == Meta );
+	CHECK( Buffer->mPixels.GetPixelsArray().GetArray() == Data );
+}
+
+#include <SoyRingArray.h>
+#include <SoyJson.h>
+#include <thread>
+#include <atomic>
+
+static std::shared_ptr<TMediaPacket> MakeTestPacket(size_t DecodeTimeMs)
+{
+	std::shared_ptr<TMediaPacket> Packet( new TMediaPacket() );
+	Packet->mDecodeTimecode.mTime = DecodeTimeMs;
+	Packet->mTimecode.mTime = Packet->mDecodeTimecode.mTime;
+	Packet->mData.PushBack( 1 );
+	return Packet;
+}
+
+static Array<size_t> PopTestPackets(TMediaPacketBuffer& Buffer)
+{
+	Array<size_t> DecodeTimes;
+	while ( auto Packet = Buffer.PopPacket() )
+		DecodeTimes.PushBack( Packet->mDecodeTimecode.GetTime() );
+	return DecodeTimes;
+}
+
+static bool IsTestPacketOrder(const Array<size_t>& DecodeTimes,std::initializer_list<size_t> Expected)
+{
+	if ( DecodeTimes.GetSize() != Expected.size() )
+		return false;
+	return std::equal( Expected.begin(), Expected.end(), DecodeTimes.GetArray() );
+}
+
+//	meta is the only view of the buffers' counters
+template<typename BUFFER>
+static uint64 GetTestMetaValue(BUFFER& Buffer,const std::string& Key)
+{
+	TJsonWriter Json;
+	Buffer.GetMeta( "", Json );
+	Json.Close();
+	auto String = Json.GetString();
+	auto KeyPos = String.find( "\"" + Key + "\":" );
+	if ( KeyPos == std::string::npos )
+		return 0;
+	return std::stoull( String.substr( KeyPos + Key.length() + 3 ) );
+}
+
+TEST(SpscRingArray)
+{
+	TSpscRingArray<std::shared_ptr<int>> Ring( 3 );
+	CHECK( Ring.GetCapacity() == 3 );
+	CHECK( Ring.IsEmpty() );
+	
+	auto Value = std::make_shared<int>( 0 );
+	std::shared_ptr<int> Popped;
+	for ( int i=0;	i<10;	i++ )
+	{
+		//	fill to capacity, wrapping round the buffer
+		CHECK( Ring.Push( Value ) );
+		CHECK( Ring.Push( std::make_shared<int>( i ) ) );
+		CHECK( Ring.Push( Value ) );
+		CHECK( !Ring.Push( Value ) );
+		CHECK( Ring.GetSize() == 3 );
+		
+		CHECK( Ring.Pop( Popped ) && Popped == Value );
+		CHECK( Ring.Peek() && **Ring.Peek() == i );
+		CHECK( Ring.Pop( Popped ) && *Popped == i );
+		CHECK( Ring.Pop( Popped ) && Popped == Value );
+		CHECK( !Ring.Pop( Popped ) );
+		CHECK( Ring.Peek() == nullptr );
+		CHECK( Ring.IsEmpty() );
+	}
+	
+	//	popped slots don't keep anything alive
+	Popped.reset();
+	CHECK( Value.use_count() == 1 );
+}
+
+TEST(MediaPacketBufferSpsc)
+{
+	auto NoBlock = []	{	return false;	};
+	for ( auto SingleProducerConsumer : { false, true } )
+	{
+		TMediaPacketBuffer Buffer( 10, SingleProducerConsumer );
+		
+		//	an out of order packet falls back to sorting, then drains back to the ring
+		for ( auto Time : { 10, 20, 30, 25, 40 } )
+			Buffer.PushPacket( MakeTestPacket( Time ), NoBlock );
+		CHECK( Buffer.GetPacketCount() == 5 );
+		CHECK( IsTestPacketOrder( PopTestPackets( Buffer ), { 10, 20, 25, 30, 40 } ) );
+		CHECK( GetTestMetaValue( Buffer, "SortedFallbackCount" ) == (SingleProducerConsumer ? 1 : 0) );
+		
+		for ( auto Time : { 50, 60 } )
+			Buffer.PushPacket( MakeTestPacket( Time ), NoBlock );
+		Buffer.UnPopPacket( Buffer.PopPacket() );
+		Buffer.PushPacket( MakeTestPacket( 70 ), NoBlock );
+		CHECK( Buffer.GetPacketCount() == 3 );
+		CHECK( IsTestPacketOrder( PopTestPackets( Buffer ), { 50, 60, 70 } ) );
+		
+		//	flush while packets (and an unpopped one) are in the ring. Then everything after the seek is in order again
+		for ( auto Time : { 80, 90, 100 } )
+			Buffer.PushPacket( MakeTestPacket( Time ), NoBlock );
+		Buffer.UnPopPacket( Buffer.PopPacket() );
+		Buffer.FlushFrames( SoyTime( std::chrono::milliseconds(75) ) );
+		for ( auto Time : { 72, 73 } )
+			Buffer.PushPacket( MakeTestPacket( Time ), NoBlock );
+		CHECK( IsTestPacketOrder( PopTestPackets( Buffer ), { 72, 73 } ) );
+		CHECK( GetTestMetaValue( Buffer, "SortedFallbackCount" ) == (SingleProducerConsumer ? 1 : 0) );
+	}
+}
+
+TEST(MediaPacketBufferSpscThreaded)
+{
+	//	one thread pushing (with the odd pair swapped), one popping (and unpopping), through a small buffer so both block and the ring wraps
+	const size_t PacketCount = 50000;
+	for ( auto SingleProducerConsumer : { false, true } )
+	{
+		TMediaPacketBuffer Buffer( 8, SingleProducerConsumer );
+		std::atomic<bool> Running( true );
+		auto IsRunning = [&]	{	return Running.load();	};
+		std::thread Producer( [&]
+		{
+			for ( size_t i=1;	i<=PacketCount;	i++ )
+			{
+				auto Time = i;
+				if ( i % 1000 == 500 )
+					Time = i+1;
+				else if ( i % 1000 == 501 )
+					Time = i-1;
+				Buffer.PushPacket( MakeTestPacket( Time ), IsRunning );
+			}
+		});
+		
+		std::vector<bool> Seen( PacketCount+1, false );
+		size_t Popped = 0;
+		size_t Duplicates = 0;
+		auto Timeout = std::chrono::steady_clock::now() + std::chrono::seconds(20);
+		while ( Popped < PacketCount && std::chrono::steady_clock::now() < Timeout )
+		{
+			auto Packet = Buffer.PopPacket();
+			if ( !Packet )
+			{
+				std::this_thread::yield();
+				continue;
+			}
+			if ( Popped % 97 == 0 )
+			{
+				Buffer.UnPopPacket( Packet );
+				Packet = Buffer.PopPacket();
+			}
+			auto Time = Packet->mDecodeTimecode.GetTime();
+			if ( Seen[Time] )
+				Duplicates++;
+			Seen[Time] = true;
+			Popped++;
+		}
+		Running = false;
+		Buffer.WakeBlockedPush();
+		Producer.join();
+		
+		CHECK( Popped == PacketCount );
+		CHECK( Duplicates == 0 );
+		CHECK( !Buffer.HasPackets() );
+	}
+}
+
+TEST(PixelBufferManagerSpsc)
+{
+	std::shared_ptr<TPixelBuffer> Pixels( new TDumbPixelBuffer() );
+	auto NoBlock = []	{	return false;	};
+	auto Push = [&](TPixelBufferManager& Frames,size_t TimeMs)
+	{
+		TPixelBufferFrame Frame;
+		Frame.mPixels = Pixels;
+		Frame.mTimestamp.mTime = TimeMs;
+		return Frames.PushPixelBuffer( Frame, NoBlock );
+	};
+	auto PopAll = [](TPixelBufferManager& Frames)
+	{
+		Array<size_t> Times;
+		SoyTime Timestamp;
+		while ( Frames.PopPixelBuffer( Timestamp ) )
+			Times.PushBack( Timestamp.GetTime() );
+		return Times;
+	};
+	
+	TPixelBufferParams Params;
+	Params.mMaxBufferSize = 8;
+	Params.mMinBufferSize = 0;
+	Params.mAllowPushRejection = false;
+	Params.mPopFrameSync = false;
+	Params.mSingleProducerConsumer = true;
+	TPixelBufferManager Frames( Params );
+	
+	//	decode order falls back to sorting, then drains back to the ring
+	for ( auto Time : { 1, 4, 2, 3, 5 } )
+		CHECK( Push( Frames, Time ) );
+	CHECK( IsTestPacketOrder( PopAll( Frames ), { 1, 2, 3, 4, 5 } ) );
+	CHECK( GetTestMetaValue( Frames, "SortedFallbackCount" ) == 1 );
+	
+	//	flush while frames are in the ring
+	for ( auto Time : { 6, 7, 8 } )
+		CHECK( Push( Frames, Time ) );
+	CHECK( Frames.GetNextPixelBufferTime() == SoyTime( std::chrono::milliseconds(6) ) );
+	Frames.ReleaseFrames();
+	CHECK( Push( Frames, 3 ) );
+	CHECK( IsTestPacketOrder( PopAll( Frames ), { 3 } ) );
+	
+	//	full
+	for ( size_t Time=10;	Time<18;	Time++ )
+		CHECK( Push( Frames, Time ) );
+	CHECK( Frames.IsPixelBufferFull() );
+	CHECK( !Push( Frames, 20 ) );
+	PopAll( Frames );
+	
+	//	synchronised pops skip to the latest frame that's due
+	Params.mPopFrameSync = true;
+	TPixelBufferManager SyncFrames( Params );
+	for ( size_t Time=1;	Time<=6;	Time++ )
+		CHECK( Push( SyncFrames, Time ) );
+	SoyTime Timestamp( std::chrono::milliseconds(4) );
+	CHECK( SyncFrames.PopPixelBuffer( Timestamp ) != nullptr );
+	CHECK( Timestamp.GetTime() == 4 );
+	CHECK( SyncFrames.PeekPixelBuffer( SoyTime( std::chrono::milliseconds(5) ) ) );
+	CHECK( !SyncFrames.PeekPixelBuffer( SoyTime( std::chrono::milliseconds(4) ) ) );
+	
+	//	decoder & renderer threads; everything pushed comes out once, in order
+	const size_t FrameCount = 50000;
+	Params.mPopFrameSync = false;
+	Params.mMaxBufferSize = 16;
+	TPixelBufferManager ThreadedFrames( Params );
+	std::atomic<bool> Running( true );
+	std::thread Producer( [&]
+	{
+		auto IsRunning = [&]	{	return Running.load();	};
+		for ( size_t i=1;	i<=FrameCount;	i++ )
+		{
+			TPixelBufferFrame Frame;
+			Frame.mPixels = Pixels;
+			Frame.mTimestamp.mTime = i;
+			ThreadedFrames.PushPixelBuffer( Frame, IsRunning );
+		}
+	});
+	size_t Popped = 0;
+	size_t OutOfOrder = 0;
+	auto Timeout = std::chrono::steady_clock::now() + std::chrono::seconds(20);
+	while ( Popped < FrameCount && std::chrono::steady_clock::now() < Timeout )
+	{
+		SoyTime Timestamp;
+		if ( !ThreadedFrames.PopPixelBuffer( Timestamp ) )
+		{
+			std::this_thread::yield();
+			continue;
+		}
+		Popped++;
+		if ( Timestamp.GetTime() != Popped )
+			OutOfOrder++;
+	}
+	Running = false;
+	ThreadedFrames.WakeBlockedPush();
+	Producer.join();
+	CHECK( Popped == FrameCount );
+	CHECK( OutOfOrder == 0 );
+}
+
+TEST(MediaPacketBufferBlockingPush)
+{
+	//	a push into a full buffer waits for a pop (not its 100ms re-check timeout), and Block() can cancel it
+	for ( auto SingleProducerConsumer : { false, true } )
+	{
+		TMediaPacketBuffer Buffer( 2, SingleProducerConsumer );
+		auto NoBlock = []	{	return false;	};
+		Buffer.PushPacket( MakeTestPacket( 1 ), NoBlock );
+		Buffer.PushPacket( MakeTestPacket( 2 ), NoBlock );
+		
+		//	wakes on pop
+		{
+			std::atomic<bool> Pushed( false );
+			auto KeepWaiting = []	{	return true;	};
+			std::thread Producer( [&]
+			{
+				Buffer.PushPacket( MakeTestPacket( 3 ), KeepWaiting );
+				Pushed = true;
+			});
+			std::this_thread::sleep_for( std::chrono::milliseconds(20) );
+			CHECK( !Pushed );
+			
+			auto PopTime = std::chrono::steady_clock::now();
+			CHECK( Buffer.PopPacket() != nullptr );
+			while ( !Pushed && std::chrono::steady_clock::now() - PopTime < std::chrono::seconds(1) )
+				std::this_thread::yield();
+			auto PushLatency = std::chrono::steady_clock::now() - PopTime;
+			Producer.join();
+			CHECK( PushLatency < std::chrono::milliseconds(50) );
+			CHECK( Buffer.GetPacketCount() == 2 );
+			CHECK( GetTestMetaValue( Buffer, "PushWaitCount" ) == 1 );
+			CHECK( GetTestMetaValue( Buffer, "PushWaitCancelledCount" ) == 0 );
+			CHECK( GetTestMetaValue( Buffer, "PushWaitMaxUs" ) >= 20*1000 );
+		}
+		
+		//	still full when Block() gives up after re-checking on the timeout
+		{
+			size_t BlockCalls = 0;
+			auto GiveUpOnThirdCall = [&]	{	return ++BlockCalls < 3;	};
+			auto Start = std::chrono::steady_clock::now();
+			Buffer.PushPacket( MakeTestPacket( 4 ), GiveUpOnThirdCall );
+			auto Waited = std::chrono::steady_clock::now() - Start;
+			CHECK( BlockCalls == 3 );
+			CHECK( Waited >= std::chrono::milliseconds(150) );
+			CHECK( Buffer.GetPacketCount() == 2 );
+			CHECK( GetTestMetaValue( Buffer, "PushWaitCount" ) == 2 );
+			CHECK( GetTestMetaValue( Buffer, "PushWaitCancelledCount" ) == 1 );
+		}
+		
+		//	cancelled from another thread (eg. the extractor stopping) without waiting for the timeout
+		{
+			std::atomic<bool> Running( true );
+			std::atomic<bool> Returned( false );
+			auto IsRunning = [&]	{	return Running.load();	};
+			std::thread Producer( [&]
+			{
+				Buffer.PushPacket( MakeTestPacket( 5 ), IsRunning );
+				Returned = true;
+			});
+			std::this_thread::sleep_for( std::chrono::milliseconds(20) );
+			CHECK( !Returned );
+			
+			auto StopTime = std::chrono::steady_clock::now();
+			Running = false;
+			Buffer.WakeBlockedPush();
+			Producer.join();
+			CHECK( std::chrono::steady_clock::now() - StopTime < std::chrono::milliseconds(50) );
+			CHECK( Buffer.GetPacketCount() == 2 );
+			CHECK( GetTestMetaValue( Buffer, "PushWaitCount" ) == 3 );
+			CHECK( GetTestMetaValue( Buffer, "PushWaitCancelledCount" ) == 2 );
+		}
+		
+		CHECK( IsTestPacketOrder( PopTestPackets( Buffer ), { 2, 3 } ) );
+	}
+}
+
+TEST(ImageBatchDecodeMixed)
+{
+	//	corrupt entries are delivered with an error in their own slot and don't stop the rest. one thread decodes in push order
+	for ( size_t ThreadCount : { 1, 3 } )
+	{
+		TImageBatchDecoder Decoder( ThreadCount );
+		std::mutex ResultsLock;
+		Array<TImageBatchItem> Results;
+		Decoder.mOnDecoded.AddListener( [&](TImageBatchItem& Item)
+		{
+			std::lock_guard<std::mutex> Lock( ResultsLock );
+			Results.PushBack( Item );
+		});
+		
+		Array<std::shared_ptr<SoyPixels>> Sources;
+		Array<std::string> Names;
+		for ( size_t i=0;	i<7;	i++ )
+		{
+			std::stringstream Name;
+			Name << "image" << i;
+			auto Data = std::make_shared<Array<char>>();
+			std::shared_ptr<SoyPixels> Source;
+			if ( i == 2 || i == 5 )
+			{
+				//	a png cut off half way, and something that isn't an image at all
+				SoyPixels Pixels;
+				Pixels.Init( 20, 10, SoyPixelsFormat::RGB );
+				FillTestPattern( Pixels );
+				Pixels.GetPng( GetArrayBridge(*Data) );
+				if ( i == 2 )
+					Data->SetSize( Data->GetSize()/2 );
+				else
+					Data->SetAll( 'x' );
+			}
+			else
+			{
+				Source.reset( new SoyPixels );
+				Source->Init( 8+i, 3+i, (i%2) ? SoyPixelsFormat::RGBA : SoyPixelsFormat::RGB );
+				FillTestPattern( *Source );
+				Source->GetPng( GetArrayBridge(*Data) );
+			}
+			Sources.PushBack( Source );
+			Names.PushBack( Name.str() );
+			CHECK_EQUAL( i, Decoder.Push( Name.str(), Data ) );
+		}
+		Decoder.Wait();
+		
+		CHECK_EQUAL( Sources.GetSize(), Results.GetSize() );
+		Array<bool> Delivered;
+		Delivered.SetSize( Sources.GetSize() );
+		Delivered.SetAll( false );
+		for ( size_t r=0;	r<Results.GetSize();	r++ )
+		{
+			auto& Item = Results[r];
+			if ( ThreadCount == 1 )
+				CHECK_EQUAL( r, Item.mIndex );
+			if ( Item.mIndex >= Sources.GetSize() )
+			{
+				CHECK( false );
+				continue;
+			}
+			CHECK( !Delivered[Item.mIndex] );
+			Delivered[Item.mIndex] = true;
+			CHECK( Item.mName == Names[Item.mIndex] );
+			
+			auto& Source = Sources[Item.mIndex];
+			if ( !Source )
+			{
+				CHECK( !Item.mPixels );
+				CHECK( !Item.mError.empty() );
+				continue;
+			}
+			CHECK( Item.mError.empty() );
+			CHECK( Item.mPixels != nullptr );
+			if ( !Item.mPixels )
+				continue;
+			CHECK( Item.mPixels->GetMeta() == Source->GetMeta() );
+			CHECK( memcmp( Item.mPixels->GetPixelsArray().GetArray(), Source->GetPixelsArray().GetArray(), Source->GetPixelsArray().GetDataSize() ) == 0 );
+		}
+	}
+}
+
+
+TEST(StbFailureReasonPerThread)
+{
+	//	stb keeps its last error in a global, which must be per-thread or threads decoding different bad data report each other's errors
+	std::atomic<bool> Start( false );
+	auto DecodeBadData = [&](bool IsPng,size_t& WrongErrors)
+	{
+		Array<char> Data;
+		for ( size_t i=0;	i<64;	i++ )
+			Data.PushBack( static_cast<char>( i+1 ) );
+		if ( IsPng )
+		{
+			//	valid signature, broken first chunk
+			const char Signature[] = { static_cast<char>(0x89), 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+			for ( size_t i=0;	i<sizeofarray(Signature);	i++ )
+				Data[i] = Signature[i];
+			Data[12] = 'X';
+		}
+		std::string Expected = IsPng ? "first not IHDR" : "no SOI";
+		
+		//	start together so the decodes overlap as much as possible
+		while ( !Start )
+			std::this_thread::yield();
+		for ( size_t i=0;	i<2000;	i++ )
+		{
+			TStreamBuffer Buffer;
+			Buffer.Push( GetArrayBridge(Data) );
+			SoyPixels Pixels;
+			try
+			{
+				if ( IsPng )
+					Png::Read( Pixels, Buffer );
+				else
+					Jpeg::Read( Pixels, Buffer );
+				WrongErrors++;
+			}
+			catch ( std::exception& e )
+			{
+				if ( Expected != e.what() )
+					WrongErrors++;
+			}
+		}
+	};
+	
+	size_t PngWrongErrors = 0;
+	size_t JpegWrongErrors = 0;
+	std::thread PngThread( [&]	{	DecodeBadData( true, PngWrongErrors );	} );
+	std::thread JpegThread( [&]	{	DecodeBadData( false, JpegWrongErrors );	} );
+	Start = true;
+	PngThread.join();
+	JpegThread.join();
+	CHECK_EQUAL( 0, PngWrongErrors );
+	CHECK_EQUAL( 0, JpegWrongErrors );
+}
+
+
+TEST(ImageProbe)
+{
+	//	probing just reads the header, and should give the same meta as decoding does, from memory or a stream
+	SoyPixelsFormat::Type Formats[] = { SoyPixelsFormat::Greyscale, SoyPixelsFormat::GreyscaleAlpha, SoyPixelsFormat::RGB, SoyPixelsFormat::RGBA };
+	for ( auto Format : Formats )
+	{
+		SoyPixels Pixels;
+		Pixels.Init( 33, 17, Format );
+		FillTestPattern( Pixels );
+		Array<char> PngData;
+		CHECK( Pixels.GetPng( GetArrayBridge(PngData) ) );
+		
+		SoyPixelsMeta Meta;
+		CHECK( Png::Probe( Meta, GetArrayBridge(PngData) ) );
+		CHECK( Meta == Pixels.GetMeta() );
+		
+		SoyPixels Decoded;
+		Png::Read( Decoded, GetArrayBridge(PngData) );
+		CHECK( Decoded.GetMeta() == Meta );
+		
+		TStreamBuffer Stream;
+		Stream.Push( GetArrayBridge(PngData) );
+		SoyPixels StreamDecoded;
+		Png::Read( StreamDecoded, Stream );
+		CHECK( StreamDecoded.GetMeta() == Meta );
+		
+		auto Partial = GetRemoteArray( PngData.GetArray(), 16 );
+		CHECK( !Png::Probe( Meta, GetArrayBridge(Partial) ) );
+	}
+}
+
 #endif
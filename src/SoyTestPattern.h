@@ -0,0 +1,19 @@
+#pragma once
+
+#include "SoyPixels.h"
+
+
+//	shared by the unit tests (SoyTest.cpp) and benchmarks (SoyBenchmark.cpp)
+//	deterministic, but not flat, so filters and compression have something to do. Needs a channel count, so not planar formats
+inline void FillTestPattern(SoyPixelsImpl& Pixels)
+{
+	auto& PixelsArray = Pixels.GetPixelsArray();
+	auto Width = std::max<size_t>( 1, Pixels.GetWidth() );
+	auto Channels = std::max<size_t>( 1, Pixels.GetChannels() );
+	for ( size_t i=0;	i<PixelsArray.GetSize();	i++ )
+	{
+		auto x = (i/Channels) % Width;
+		auto y = (i/Channels) / Width;
+		PixelsArray[i] = static_cast<uint8>( x/5 + y/3 + (i%Channels)*40 + ((i*7919)%5) );
+	}
+}
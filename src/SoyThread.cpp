@@ -50,20 +50,26 @@ SoyEvent<SoyThread>& SoyThread::GetOnThreadStart()
 
 void Soy::TSemaphore::OnCompleted()
 {
+	//	set under the lock, otherwise we can complete between Wait() checking and waiting, and it sleeps until the timeout
+	std::lock_guard<std::mutex> Lock( mLock );
 	mCompleted = true;
 	
 	mConditional.notify_all();
 }
 
-void Soy::TSemaphore::Wait(const char* TimerName)
+void Soy::TSemaphore::OnFailed(const char* ThrownError)
 {
-	if ( mCompleted )
-	{
-		if ( !mThrownError.empty() )
-			throw Soy::AssertException( mThrownError );
-		return;
-	}
+	std::lock_guard<std::mutex> Lock( mLock );
+	mThrownError = ThrownError ? ThrownError : "Failed with unspecified error";
+	mCompleted = true;
 	
+	mConditional.notify_all();
+}
+
+void Soy::TSemaphore::Wait(const char* TimerName)
+{
+	//	always take the lock, even if already completed. The completing thread still holds it while notifying,
+	//	and the semaphore is often on the waiter's stack, so we mustn't return (and free it) until it lets go
 	std::unique_lock<std::mutex> Lock( mLock );
 	
 	//	gr: sometimes this gets stuck... so timeout and re-read IsCompleted...
@@ -96,6 +102,13 @@ void Soy::TSemaphore::Wait(const char* TimerName)
 }
 
 
+size_t PopWorker::TJobQueue::GetJobCount() const
+{
+	std::lock_guard<std::recursive_mutex> Lock( mJobLock );
+	return mJobs.size();
+}
+
+
 PopWorker::TJobQueue::~TJobQueue()
 {
 	//	to try and reduce crashes, hold the lock here as we destruct
@@ -134,7 +147,7 @@ void PopWorker::TJobQueue::Flush(TContext& Context)
 		mJobLock.unlock();
 		LockTimer.Stop(false);
 		if ( LockTimer.Report() )
-			std::Debug << "Job queue has " << mJobs.size() << std::endl;
+			std::Debug << "Job queue has " << GetJobCount() << std::endl;
 		
 		if ( !Job )
 			break;
@@ -243,11 +256,14 @@ SoyThread::SoyThread(const std::string& ThreadName) :
 	mIsRunning	( false )
 {
 	//	POSIX needs to name threads IN the thread. so do that for everyone by default
+	//	gr: the event fires for every thread, and the new thread can start before Start() has assigned mThread,
+	//		so only name ourselves, using the handle of the thread we're running on
 	auto NameThread = [this](SoyThread& Thread)
 	{
-	//	Soy::Assert( std::this_thread::id == Thread.get_id(), "Shouldn't call this outside of thread" );
+		if ( &Thread != this )
+			return;
 		if ( !mThreadName.empty() )
-			SetThreadName( mThreadName );
+			SetThreadName( mThreadName, GetCurrentThreadNativeHandle() );
 	};
 
 	mNameThreadListener = GetOnThreadStart().AddListener( NameThread );
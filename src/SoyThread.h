@@ -28,11 +28,7 @@ public:
 	void		OnCompleted();
 	
 	//	if whatever we're waiting for had an error, we re-throw the message in Wait() as a Soy::AssertException
-	void		OnFailed(const char* ThrownError)
-	{
-		mThrownError = ThrownError ? ThrownError : "Failed with unspecified error";
-		OnCompleted();
-	}
+	void		OnFailed(const char* ThrownError);
 	
 private:
 	std::mutex				mLock;
@@ -112,8 +108,8 @@ public:
 	bool			IsLockedToAnyThread()					{	return IsLocked( std::thread::id() );	}
 
 	void			Flush(TContext& Context);
-	size_t			GetJobCount() const						{	return mJobs.size();	}
-	bool			HasJobs() const							{	return !mJobs.empty();	}
+	size_t			GetJobCount() const;
+	bool			HasJobs() const							{	return GetJobCount() != 0;	}
 	void			PushJob(std::function<void()> Lambda);
 	void			PushJob(std::function<void()> Lambda,Soy::TSemaphore& Semaphore);
 	void			PushJob(std::shared_ptr<TJob>& Job)									{	PushJobImpl( Job, nullptr );	}
@@ -133,7 +129,7 @@ public:
 	
 private:
 	std::vector<std::shared_ptr<TJob>>	mJobs;			//	gr: change this to a nice soy ringbuffer
-	std::recursive_mutex				mJobLock;
+	mutable std::recursive_mutex		mJobLock;
 };
 
 
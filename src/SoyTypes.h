@@ -296,6 +296,55 @@ private:
 };
 
 
+//	zlib's checksum
+class TAdler32
+{
+public:
+	static const uint32_t	Base = 65521;	//	largest prime below 2^16
+	static const size_t		MaxRun = 5552;	//	most bytes we can sum before the 32bit sums could overflow
+
+public:
+	TAdler32()		{	Reset();	}
+	void			Reset()		{	mA = 1;	mB = 0;	}
+	void			AddData(const uint8_t* pData,const size_t length)
+	{
+		auto remaining = length;
+		while ( remaining > 0 )
+		{
+			auto Run = (remaining < MaxRun) ? remaining : MaxRun;
+			remaining -= Run;
+			for ( ;	Run--;	++pData )
+			{
+				mA += *pData;
+				mB += mA;
+			}
+			mA %= Base;
+			mB %= Base;
+		}
+	}
+	uint32_t		GetAdler32() const	{	return (mB << 16) | mA;	}
+
+	//	checksum of A's data followed by B's data (zlib's adler32_combine)
+	static uint32_t	Combine(uint32_t AdlerA,uint32_t AdlerB,size_t LengthB)
+	{
+		uint64_t Rem = LengthB % Base;
+		uint64_t Sum1 = AdlerA & 0xffff;
+		uint64_t Sum2 = (Rem * Sum1) % Base;
+		Sum1 += (AdlerB & 0xffff) + Base - 1;
+		Sum2 += ((AdlerA >> 16) & 0xffff) + ((AdlerB >> 16) & 0xffff) + Base - Rem;
+		if ( Sum1 >= Base )	Sum1 -= Base;
+		if ( Sum1 >= Base )	Sum1 -= Base;
+		if ( Sum2 >= (Base << 1) )	Sum2 -= (Base << 1);
+		if ( Sum2 >= Base )	Sum2 -= Base;
+		return static_cast<uint32_t>( Sum1 | (Sum2 << 16) );
+	}
+
+private:
+	uint32_t	mA;
+	uint32_t	mB;
+};
+
+
 namespace Soy
 {
 	namespace Private